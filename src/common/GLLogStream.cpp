@@ -101,6 +101,7 @@ void GLLogStream::clear()
 void GLLogStream::log(int level, const char * buf )
 {
 	QString tmp(buf);
+	QMutexLocker locker(&logMutex);
 	logTextList.push_back(std::make_pair(level,tmp));
 	qDebug("LOG: %i %s",level,buf);
 #ifdef MESHLAB_LOG_FILE_ENABLED
@@ -112,6 +113,7 @@ void GLLogStream::log(int level, const char * buf )
 	stream.flush();
 	f.close();
 #endif
+	locker.unlock();
 	emit logUpdated();
 }
 
@@ -28,6 +28,7 @@
 #include <list>
 #include <utility>
 #include <QMultiMap>
+#include <QMutex>
 #include <QPair>
 #include <QString>
 #include <QObject>
@@ -109,6 +110,7 @@ signals:
 private:
 	int bookmark; /// this field is used to place a bookmark for restoring the log. Useful for previeweing
 	QList<std::pair<int, QString> > logTextList;
+	QMutex logMutex; /// log() may be called concurrently by meshes loaded in parallel
 
 	// The list of strings used in realtime display of info over the mesh.
 	// Each box is identified by the title, name of the mesh and text.
@@ -23,6 +23,8 @@
 
 #include "mesh_document.h"
 
+#include "../utilities/parallel.h"
+
 template <class LayerElement>
 QString nameDisambiguator(std::list<LayerElement> &elemList, QString meshLabel)
 {
@@ -94,6 +96,7 @@ void MeshDocument::clear()
 	fullPathFilename = "";
 	documentLabel = "";
 	meshDocStateData().clear();
+	stateHistory.clear();
 }
 
 const MeshModel* MeshDocument::getMesh(unsigned int id) const
@@ -235,6 +238,11 @@ MeshDocumentStateData& MeshDocument::meshDocStateData()
 	return mdstate;
 }
 
+MeshModelStateHistory& MeshDocument::meshStateHistory()
+{
+	return stateHistory;
+}
+
 void MeshDocument::setDocLabel(const QString& docLb)
 {
 	documentLabel = docLb;
@@ -384,6 +392,7 @@ MeshDocument::MeshIterator MeshDocument::eraseMesh(MeshIterator it)
 				setCurrentMesh(this->meshList.front().id());
 		}
 
+		stateHistory.removeMesh(id);
 		it = meshList.erase(it);
 
 		emit meshSetChanged();
@@ -449,6 +458,41 @@ int MeshDocument::fn() const
 	return tot;
 }
 
+/**
+ * @brief Compacts the meshes of the document that contain deleted elements
+ * (usually, after the execution of a filter). Meshes without deleted elements
+ * are not touched; the others are compacted concurrently, one per thread.
+ */
+void MeshDocument::compactMeshes()
+{
+	std::vector<MeshModel*> toCompact;
+	for (MeshModel& mm : meshList) {
+		if (mm.hasDeletedElements())
+			toCompact.push_back(&mm);
+	}
+	if (toCompact.size() <= 1) {
+		for (MeshModel* mm : toCompact)
+			mm->compact();
+		return;
+	}
+
+	meshlab::parallelFor(toCompact.size(), [&](std::size_t i, unsigned int) {
+		toCompact[i]->compact();
+	});
+}
+
+/**
+ * @brief Returns an estimate of the memory (in bytes) taken by all the meshes
+ * of the document (see MeshModel::memoryFootprint).
+ */
+std::size_t MeshDocument::memoryFootprint() const
+{
+	std::size_t tot = 0;
+	for (const MeshModel& mm : meshList)
+		tot += mm.memoryFootprint();
+	return tot;
+}
+
 Box3m MeshDocument::bbox() const
 {
 	Box3m FullBBox;
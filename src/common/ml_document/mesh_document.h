@@ -26,6 +26,7 @@
 
 #include "mesh_model.h"
 #include "raster_model.h"
+#include "mesh_model_state.h"
 
 #include "helpers/mesh_document_state_data.h"
 
@@ -127,6 +128,7 @@ public:
 	void requestUpdatingPerMeshDecorators(int mesh_id);
 
 	MeshDocumentStateData& meshDocStateData();
+	MeshModelStateHistory& meshStateHistory();
 	void setDocLabel(const QString& docLb);
 	QString docLabel() const;
 	QString pathName() const;
@@ -163,6 +165,10 @@ public:
 
 	bool hasBeenModified() const;
 
+	void compactMeshes();
+
+	std::size_t memoryFootprint() const;
+
 	//iterator member functions
 	MeshIterator meshBegin();
 	MeshIterator meshEnd();
@@ -201,6 +207,8 @@ private:
 	QString documentLabel;
 
 	MeshDocumentStateData mdstate;
+	/// the saved states of the meshes, used to undo the filters
+	MeshModelStateHistory stateHistory;
 
 	bool busy;
 
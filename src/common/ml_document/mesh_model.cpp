@@ -382,6 +382,73 @@ void MeshModel::enable(int openingFileMask)
 		updateDataMask(MM_POLYGONAL);
 }
 
+/**
+ * @brief Returns true if the mesh contains vertices, edges or faces marked as
+ * deleted. The vcg::tri::Allocator keeps the counters vn, en and fn updated on
+ * each deletion, therefore there is no need to scan the vectors.
+ */
+bool MeshModel::hasDeletedElements() const
+{
+	return
+		cm.vn != (int) cm.vert.size() ||
+		cm.en != (int) cm.edge.size() ||
+		cm.fn != (int) cm.face.size();
+}
+
+/**
+ * @brief Removes the deleted elements from the vectors of the mesh.
+ * Nothing is done (and no memory is touched) if no element has been deleted.
+ */
+void MeshModel::compact()
+{
+	if (hasDeletedElements())
+		vcg::tri::Allocator<CMeshO>::CompactEveryVector(cm);
+}
+
+/**
+ * @brief Returns an estimate of the memory (in bytes) taken by the mesh: the
+ * vectors of vertices, edges and faces, their enabled optional components and
+ * the textures. Per mesh attributes are not considered.
+ */
+std::size_t MeshModel::memoryFootprint() const
+{
+	std::size_t vsize = sizeof(CVertexO);
+	if (cm.vert.IsVFAdjacencyEnabled())
+		vsize += sizeof(CFaceO*) + sizeof(int);
+	if (cm.vert.IsMarkEnabled())
+		vsize += sizeof(int);
+	if (cm.vert.IsTexCoordEnabled())
+		vsize += sizeof(vcg::TexCoord2f);
+	if (cm.vert.IsCurvatureDirEnabled())
+		vsize += 2 * (sizeof(Point3m) + sizeof(Scalarm));
+	if (cm.vert.IsRadiusEnabled())
+		vsize += sizeof(Scalarm);
+
+	std::size_t fsize = sizeof(CFaceO);
+	if (cm.face.IsQualityEnabled())
+		fsize += sizeof(Scalarm);
+	if (cm.face.IsMarkEnabled())
+		fsize += sizeof(int);
+	if (cm.face.IsColorEnabled())
+		fsize += sizeof(vcg::Color4b);
+	if (cm.face.IsFFAdjacencyEnabled())
+		fsize += 3 * (sizeof(CFaceO*) + sizeof(char));
+	if (cm.face.IsVFAdjacencyEnabled())
+		fsize += 3 * (sizeof(CFaceO*) + sizeof(char));
+	if (cm.face.IsCurvatureDirEnabled())
+		fsize += 2 * (sizeof(Point3m) + sizeof(Scalarm));
+	if (cm.face.IsWedgeTexCoordEnabled())
+		fsize += 3 * sizeof(vcg::TexCoord2f);
+
+	std::size_t total =
+		cm.vert.capacity() * vsize +
+		cm.face.capacity() * fsize +
+		cm.edge.capacity() * sizeof(CEdgeO);
+	for (const auto& t : textures)
+		total += t.second.sizeInBytes();
+	return total;
+}
+
 bool MeshModel::meshModified() const
 {
 	return modified;
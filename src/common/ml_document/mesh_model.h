@@ -199,6 +199,10 @@ public:
 
 	bool meshModified() const;
 	void setMeshModified(bool b = true);
+
+	bool hasDeletedElements() const;
+	void compact();
+	std::size_t memoryFootprint() const;
 	static int io2mm(int single_iobit);
 
 	CMeshO cm;
@@ -2,81 +2,79 @@
 
 #include "mesh_model.h"
 
-void MeshModelState::create(int _mask, MeshModel* _m)
+namespace {
+
+const int supportedMask =
+	MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_VERTCOORD |
+	MeshModel::MM_VERTNORMAL | MeshModel::MM_FACENORMAL | MeshModel::MM_FACECOLOR |
+	MeshModel::MM_FACEFLAGSELECT | MeshModel::MM_VERTFLAGSELECT |
+	MeshModel::MM_TRANSFMATRIX | MeshModel::MM_CAMERA;
+
+}
+
+MeshModelState::MeshModelState() : changeMask(MeshModel::MM_NONE), m(nullptr), id(-1)
+{
+}
+
+void MeshModelState::create(int _mask, MeshModel* _m, const MeshModelState* reference)
 {
+	clear();
 	m=_m;
+	id = m->id();
 	changeMask=_mask;
+
+	// the pages can be shared only with a state of the same mesh that saved the same attribute
+	auto ref = [&](int att) {
+		return (reference != nullptr && reference->m == m && (reference->changeMask & att)) ? reference : nullptr;
+	};
+
 	if(changeMask & MeshModel::MM_VERTCOLOR)
 	{
-		vertColor.resize(m->cm.vert.size());
-		std::vector<vcg::Color4b>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertColor.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) (*ci)=(*vi).C();
+		const MeshModelState* r = ref(MeshModel::MM_VERTCOLOR);
+		vertColor.create(m->cm.vert, [](const CVertexO& v) {return v.cC();}, r ? &r->vertColor : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_VERTQUALITY)
 	{
-		vertQuality.resize(m->cm.vert.size());
-		std::vector<float>::iterator qi;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), qi = vertQuality.begin(); vi != m->cm.vert.end(); ++vi, ++qi)
-			if(!(*vi).IsD()) (*qi)=(*vi).Q();
+		const MeshModelState* r = ref(MeshModel::MM_VERTQUALITY);
+		vertQuality.create(m->cm.vert, [](const CVertexO& v) {return v.cQ();}, r ? &r->vertQuality : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_VERTCOORD)
 	{
-		vertCoord.resize(m->cm.vert.size());
-		std::vector<Point3m>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertCoord.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) (*ci)=(*vi).P();
+		const MeshModelState* r = ref(MeshModel::MM_VERTCOORD);
+		vertCoord.create(m->cm.vert, [](const CVertexO& v) {return v.cP();}, r ? &r->vertCoord : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_VERTNORMAL)
 	{
-		vertNormal.resize(m->cm.vert.size());
-		std::vector<Point3m>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertNormal.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) (*ci)=(*vi).N();
+		const MeshModelState* r = ref(MeshModel::MM_VERTNORMAL);
+		vertNormal.create(m->cm.vert, [](const CVertexO& v) {return v.cN();}, r ? &r->vertNormal : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_FACENORMAL)
 	{
-		faceNormal.resize(m->cm.face.size());
-		std::vector<Point3m>::iterator ci;
-		CMeshO::FaceIterator fi;
-		for(fi = m->cm.face.begin(), ci = faceNormal.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-			if(!(*fi).IsD()) (*ci) = (*fi).N();
+		const MeshModelState* r = ref(MeshModel::MM_FACENORMAL);
+		faceNormal.create(m->cm.face, [](const CFaceO& f) {return f.cN();}, r ? &r->faceNormal : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_FACECOLOR)
 	{
 		m->updateDataMask(MeshModel::MM_FACECOLOR);
-		faceColor.resize(m->cm.face.size());
-		std::vector<vcg::Color4b>::iterator ci;
-		CMeshO::FaceIterator fi;
-		for(fi = m->cm.face.begin(), ci = faceColor.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-			if(!(*fi).IsD()) (*ci) = (*fi).C();
+		const MeshModelState* r = ref(MeshModel::MM_FACECOLOR);
+		faceColor.create(m->cm.face, [](const CFaceO& f) {return f.cC();}, r ? &r->faceColor : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_FACEFLAGSELECT)
 	{
-		faceSelection.resize(m->cm.face.size());
-		std::vector<bool>::iterator ci;
-		CMeshO::FaceIterator fi;
-		for(fi = m->cm.face.begin(), ci = faceSelection.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-			if(!(*fi).IsD()) (*ci) = (*fi).IsS();
+		const MeshModelState* r = ref(MeshModel::MM_FACEFLAGSELECT);
+		faceSelection.create(m->cm.face, [](const CFaceO& f) {return f.IsS();}, r ? &r->faceSelection : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_VERTFLAGSELECT)
 	{
-		vertSelection.resize(m->cm.vert.size());
-		std::vector<bool>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertSelection.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) (*ci) = (*vi).IsS();
+		const MeshModelState* r = ref(MeshModel::MM_VERTFLAGSELECT);
+		vertSelection.create(m->cm.vert, [](const CVertexO& v) {return v.IsS();}, r ? &r->vertSelection : nullptr);
 	}
 	
 	if(changeMask & MeshModel::MM_TRANSFMATRIX)
@@ -85,90 +83,70 @@ void MeshModelState::create(int _mask, MeshModel* _m)
 		this->shot = m->cm.shot;
 }
 
-bool MeshModelState::apply(MeshModel *_m)
+bool MeshModelState::apply(MeshModel *_m) const
 {
-	if(_m != m)
+	if(_m != m || m == nullptr)
 		return false;
 	if(changeMask & MeshModel::MM_VERTCOLOR)
 	{
-		if(vertColor.size() != m->cm.vert.size()) return false;
-		std::vector<vcg::Color4b>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertColor.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) (*vi).C()=(*ci);
+		if (!vertColor.apply(m->cm.vert,
+				[](const CVertexO& v) {return v.cC();},
+				[](CVertexO& v, const vcg::Color4b& c) {v.C() = c;}))
+			return false;
 	}
 	if(changeMask & MeshModel::MM_FACECOLOR)
 	{
-		if(faceColor.size() != m->cm.face.size()) return false;
-		std::vector<vcg::Color4b>::iterator ci;
-		CMeshO::FaceIterator fi;
-		for(fi = m->cm.face.begin(), ci = faceColor.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-			if(!(*fi).IsD()) (*fi).C()=(*ci);
+		if (!faceColor.apply(m->cm.face,
+				[](const CFaceO& f) {return f.cC();},
+				[](CFaceO& f, const vcg::Color4b& c) {f.C() = c;}))
+			return false;
 	}
 	if(changeMask & MeshModel::MM_VERTQUALITY)
 	{
-		if(vertQuality.size() != m->cm.vert.size()) return false;
-		std::vector<float>::iterator qi;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), qi = vertQuality.begin(); vi != m->cm.vert.end(); ++vi, ++qi)
-			if(!(*vi).IsD()) (*vi).Q()=(*qi);
+		if (!vertQuality.apply(m->cm.vert,
+				[](const CVertexO& v) {return v.cQ();},
+				[](CVertexO& v, const Scalarm& q) {v.Q() = q;}))
+			return false;
 	}
 	
 	if(changeMask & MeshModel::MM_VERTCOORD)
 	{
-		if(vertCoord.size() != m->cm.vert.size()) 
+		if (!vertCoord.apply(m->cm.vert,
+				[](const CVertexO& v) {return v.cP();},
+				[](CVertexO& v, const Point3m& p) {v.P() = p;}))
 			return false;
-		std::vector<Point3m>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertCoord.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) 
-				(*vi).P()=(*ci);
 	}
 	
 	if(changeMask & MeshModel::MM_VERTNORMAL)
 	{
-		if(vertNormal.size() != m->cm.vert.size()) return false;
-		std::vector<Point3m>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci=vertNormal.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) (*vi).N()=(*ci);
+		if (!vertNormal.apply(m->cm.vert,
+				[](const CVertexO& v) {return v.cN();},
+				[](CVertexO& v, const Point3m& n) {v.N() = n;}))
+			return false;
 	}
 	
 	if(changeMask & MeshModel::MM_FACENORMAL)
 	{
-		if(faceNormal.size() != m->cm.face.size()) return false;
-		std::vector<Point3m>::iterator ci;
-		CMeshO::FaceIterator fi;
-		for(fi = m->cm.face.begin(), ci=faceNormal.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-			if(!(*fi).IsD()) (*fi).N()=(*ci);
+		if (!faceNormal.apply(m->cm.face,
+				[](const CFaceO& f) {return f.cN();},
+				[](CFaceO& f, const Point3m& n) {f.N() = n;}))
+			return false;
 	}
 	
 	if(changeMask & MeshModel::MM_FACEFLAGSELECT)
 	{
-		if(faceSelection.size() != m->cm.face.size()) return false;
-		std::vector<bool>::iterator ci;
-		CMeshO::FaceIterator fi;
-		for(fi = m->cm.face.begin(), ci = faceSelection.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-		{
-			if((*ci))
-				(*fi).SetS();
-			else
-				(*fi).ClearS();
-		}
+		if (!faceSelection.apply(m->cm.face,
+				[](const CFaceO& f) {return f.IsS();},
+				[](CFaceO& f, bool s) {if (s) f.SetS(); else f.ClearS();}))
+			return false;
 	}
 	
 	if(changeMask & MeshModel::MM_VERTFLAGSELECT)
 	{
-		if(vertSelection.size() != m->cm.vert.size()) return false;
-		std::vector<bool>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertSelection.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-		{
-			if((*ci))
-				(*vi).SetS();
-			else
-				(*vi).ClearS();
-		}
+		if (!vertSelection.apply(m->cm.vert,
+				[](const CVertexO& v) {return v.IsS();},
+				[](CVertexO& v, bool s) {if (s) v.SetS(); else v.ClearS();}))
+			return false;
 	}
 	
 	
@@ -184,3 +162,178 @@ int MeshModelState::maskChangedAtts() const
 {
 	return changeMask;
 }
+
+const MeshModel* MeshModelState::mesh() const
+{
+	return m;
+}
+
+int MeshModelState::meshId() const
+{
+	return id;
+}
+
+void MeshModelState::clear()
+{
+	changeMask = MeshModel::MM_NONE;
+	m = nullptr;
+	id = -1;
+	vertQuality.clear();
+	vertColor.clear();
+	faceColor.clear();
+	vertCoord.clear();
+	vertNormal.clear();
+	faceNormal.clear();
+	faceSelection.clear();
+	vertSelection.clear();
+}
+
+bool MeshModelState::isSupported(int mask)
+{
+	return (mask & ~supportedMask) == 0;
+}
+
+size_t MeshModelState::memoryUsage() const
+{
+	std::unordered_set<const void*> counted;
+	size_t bytes = 0;
+	forEachPage([&](const void* page, size_t pageBytes) {
+		if (counted.insert(page).second)
+			bytes += pageBytes;
+	});
+	return bytes;
+}
+
+MeshModelStateHistory::MeshModelStateHistory(unsigned int maxLevels, size_t memoryBudget) :
+	maxLevels(maxLevels), memoryBudget(memoryBudget), bytes(0)
+{
+}
+
+void MeshModelStateHistory::setLimits(unsigned int maxLevels, size_t memoryBudget)
+{
+	this->maxLevels = maxLevels;
+	this->memoryBudget = memoryBudget;
+	shrink();
+}
+
+bool MeshModelStateHistory::push(int mask, MeshModel* m)
+{
+	if (m == nullptr || maxLevels == 0 || !MeshModelState::isSupported(mask))
+		return false;
+	states.push_back(MeshModelState());
+	try {
+		states.back().create(mask, m, lastState(m->id()));
+	}
+	catch (const std::bad_alloc&) {
+		states.pop_back();
+		return false;
+	}
+	addPages(states.back());
+	shrink();
+	return !states.empty() && states.back().mesh() == m;
+}
+
+bool MeshModelStateHistory::push(const MeshModelState& state)
+{
+	if (state.mesh() == nullptr || maxLevels == 0)
+		return false;
+	states.push_back(state);
+	addPages(states.back());
+	shrink();
+	return !states.empty() && states.back().mesh() == state.mesh();
+}
+
+bool MeshModelStateHistory::undo(MeshModel* m)
+{
+	if (states.empty())
+		return false;
+	bool ok = states.back().apply(m);
+	discardLast();
+	if (!ok && m != nullptr) // the mesh changed in a way that cannot be restored
+		removeMesh(m->id());
+	return ok;
+}
+
+void MeshModelStateHistory::discardLast()
+{
+	if (!states.empty()) {
+		removePages(states.back());
+		states.pop_back();
+	}
+}
+
+bool MeshModelStateHistory::canUndo() const
+{
+	return !states.empty();
+}
+
+int MeshModelStateHistory::lastMeshId() const
+{
+	return states.empty() ? -1 : states.back().meshId();
+}
+
+unsigned int MeshModelStateHistory::levels() const
+{
+	return states.size();
+}
+
+size_t MeshModelStateHistory::memoryUsage() const
+{
+	return bytes;
+}
+
+void MeshModelStateHistory::removeMesh(int meshId)
+{
+	for (auto it = states.begin(); it != states.end();) {
+		if (it->meshId() == meshId) {
+			removePages(*it);
+			it = states.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void MeshModelStateHistory::clear()
+{
+	states.clear();
+	pageRefs.clear();
+	bytes = 0;
+}
+
+const MeshModelState* MeshModelStateHistory::lastState(int meshId) const
+{
+	// the state being created is the last one, skip it
+	for (auto it = std::next(states.rbegin()); it != states.rend(); ++it)
+		if (it->meshId() == meshId)
+			return &(*it);
+	return nullptr;
+}
+
+void MeshModelStateHistory::addPages(const MeshModelState& state)
+{
+	state.forEachPage([this](const void* page, size_t pageBytes) {
+		if (pageRefs[page]++ == 0)
+			bytes += pageBytes;
+	});
+}
+
+void MeshModelStateHistory::removePages(const MeshModelState& state)
+{
+	state.forEachPage([this](const void* page, size_t pageBytes) {
+		auto it = pageRefs.find(page);
+		if (--it->second == 0) {
+			pageRefs.erase(it);
+			bytes -= pageBytes;
+		}
+	});
+}
+
+void MeshModelStateHistory::shrink()
+{
+	while (!states.empty() && (states.size() > maxLevels || bytes > memoryBudget)) {
+		removePages(states.front());
+		states.pop_front();
+	}
+}
@@ -24,40 +24,205 @@
 #ifndef MESHLAB_MESH_MODEL_STATE_H
 #define MESHLAB_MESH_MODEL_STATE_H
 
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "cmesh.h"
 
 class MeshModel;
 
+/*
+An attribute of the elements of a mesh (e.g. the vertex colors), saved in fixed size pages.
+The pages are immutable and shared: when the attribute is saved with a reference
+(a previous save of the same attribute), the pages that did not change are not copied
+but shared with the reference. Restoring writes only the pages that differ from the
+current content of the mesh.
+*/
+template <typename T>
+class MeshAttributePages
+{
+public:
+	static const size_t PAGE_SIZE = 4096;
+
+	MeshAttributePages() : n(0) {}
+
+	// saves get(e) for each element e of the container; the deleted elements are not saved
+	template <typename Container, typename Getter>
+	void create(const Container& c, Getter get, const MeshAttributePages* reference)
+	{
+		n = c.size();
+		pages.clear();
+		pages.reserve((n + PAGE_SIZE - 1) / PAGE_SIZE);
+		bool shareable = reference != nullptr && reference->n == n;
+		for (size_t start = 0, p = 0; start < n; start += PAGE_SIZE, ++p) {
+			size_t end = std::min(start + PAGE_SIZE, n);
+			std::vector<T> page(end - start, T());
+			for (size_t i = start; i < end; ++i)
+				if (!c[i].IsD())
+					page[i - start] = get(c[i]);
+			if (shareable && *reference->pages[p] == page)
+				pages.push_back(reference->pages[p]);
+			else
+				pages.push_back(std::make_shared<const std::vector<T>>(std::move(page)));
+		}
+	}
+
+	// restores the saved values; returns false if the number of elements has changed
+	template <typename Container, typename Getter, typename Setter>
+	bool apply(Container& c, Getter get, Setter set) const
+	{
+		if (c.size() != n)
+			return false;
+		for (size_t start = 0, p = 0; start < n; start += PAGE_SIZE, ++p) {
+			const std::vector<T>& page = *pages[p];
+			size_t i = start;
+			for (; i < start + page.size(); ++i)
+				if (!c[i].IsD() && !(get(c[i]) == page[i - start]))
+					break;
+			if (i == start + page.size())
+				continue; // page not touched
+			for (i = start; i < start + page.size(); ++i)
+				if (!c[i].IsD())
+					set(c[i], page[i - start]);
+		}
+		return true;
+	}
+
+	void clear()
+	{
+		n = 0;
+		pages.clear();
+	}
+
+	bool empty() const { return pages.empty(); }
+
+	// calls f(page, bytes) for each page
+	template <typename F>
+	void forEachPage(F f) const
+	{
+		for (const auto& page : pages)
+			f(static_cast<const void*>(page.get()), pageBytes(*page));
+	}
+
+private:
+	static size_t pageBytes(const std::vector<T>& page) { return page.size() * sizeof(T); }
+
+	size_t n;
+	std::vector<std::shared_ptr<const std::vector<T>>> pages;
+};
+
+template <>
+inline size_t MeshAttributePages<bool>::pageBytes(const std::vector<bool>& page)
+{
+	return (page.size() + 7) / 8;
+}
+
 /*
 A class designed to save partial aspects of the state of a mesh, such as vertex colors, current selections, vertex positions
 and then be able to restore them later.
 This is a fundamental part for the dynamic filters framework.
 
+The attributes are saved in shared pages (see MeshAttributePages): a state created with a
+reference state of the same mesh stores only the pages that changed since the reference
+was created, therefore keeping several states of the same mesh is cheap.
+
 Note: not all the MeshElements are supported!!
 */
 class MeshModelState
 {
 public:
+	MeshModelState();
+
 	// This function save the <mask> portion of a mesh into the private members of the MeshModelState class;
-	void create(int _mask, MeshModel* _m);
-	bool apply(MeshModel *_m);
+	// the pages that are equal to the ones of the reference state are shared with it.
+	void create(int _mask, MeshModel* _m, const MeshModelState* reference = nullptr);
+	bool apply(MeshModel *_m) const;
 	//bool isValid(MeshModel *m);
 	int maskChangedAtts() const;
+	const MeshModel* mesh() const;
+	int meshId() const;
+	void clear();
+
+	// returns true if all the attributes in mask can be saved by a MeshModelState
+	static bool isSupported(int mask);
+
+	// calls f(page, bytes) for each page of this state (the pages may be shared with other states)
+	template <typename F>
+	void forEachPage(F f) const
+	{
+		vertQuality.forEachPage(f);
+		vertColor.forEachPage(f);
+		faceColor.forEachPage(f);
+		vertCoord.forEachPage(f);
+		vertNormal.forEachPage(f);
+		faceNormal.forEachPage(f);
+		faceSelection.forEachPage(f);
+		vertSelection.forEachPage(f);
+	}
+	size_t memoryUsage() const;
 	
 private:
 	int changeMask; // a bit mask indicating what have been changed. Composed of MeshModel::MeshElement (e.g. stuff like MeshModel::MM_VERTCOLOR)
 	MeshModel *m; // the mesh which the changes refers to.
-	std::vector<float> vertQuality;
-	std::vector<vcg::Color4b> vertColor;
-	std::vector<vcg::Color4b> faceColor;
-	std::vector<Point3m> vertCoord;
-	std::vector<Point3m> vertNormal;
-	std::vector<Point3m> faceNormal;
-	std::vector<bool> faceSelection;
-	std::vector<bool> vertSelection;
+	int id;
+	MeshAttributePages<Scalarm> vertQuality;
+	MeshAttributePages<vcg::Color4b> vertColor;
+	MeshAttributePages<vcg::Color4b> faceColor;
+	MeshAttributePages<Point3m> vertCoord;
+	MeshAttributePages<Point3m> vertNormal;
+	MeshAttributePages<Point3m> faceNormal;
+	MeshAttributePages<bool> faceSelection;
+	MeshAttributePages<bool> vertSelection;
 	Matrix44m Tr;
 	Shotm shot;
 };
 
+/*
+A bounded history of MeshModelState, used to undo the filters that change only the attributes
+supported by MeshModelState.
+Each new state of a mesh is created using the previous state of the same mesh as reference,
+so the history stores only the pages changed by each filter. The oldest states are dropped
+when there are more than maxLevels states or when the pages stored by the history exceed the
+memory budget (each shared page is counted once).
+*/
+class MeshModelStateHistory
+{
+public:
+	MeshModelStateHistory(unsigned int maxLevels = 10, size_t memoryBudget = 512 * 1024 * 1024);
+
+	void setLimits(unsigned int maxLevels, size_t memoryBudget);
+
+	// saves the current state of the <mask> attributes of the mesh; returns false if it could not be stored
+	bool push(int mask, MeshModel* m);
+	bool push(const MeshModelState& state);
+
+	// restores the last saved state on the mesh it refers to and removes it from the history
+	bool undo(MeshModel* m);
+	void discardLast();
+
+	bool canUndo() const;
+	int lastMeshId() const;
+	unsigned int levels() const;
+	size_t memoryUsage() const;
+
+	// removes all the states of the given mesh (e.g. when the mesh is deleted or its topology changed)
+	void removeMesh(int meshId);
+	void clear();
+
+private:
+	const MeshModelState* lastState(int meshId) const;
+	void addPages(const MeshModelState& state);
+	void removePages(const MeshModelState& state);
+	void shrink();
+
+	unsigned int maxLevels;
+	size_t memoryBudget;
+	std::list<MeshModelState> states; // the last state is the most recent one
+	std::unordered_map<const void*, unsigned int> pageRefs; // number of states using each page
+	size_t bytes; // bytes of the pages in pageRefs
+};
+
 #endif // MESHLAB_MESH_MODEL_STATE_H
@@ -25,6 +25,7 @@
 #define ML_SCENE_GL_SHARED_DATA_CONTEXT_H
 
 #include "ml_shared_data_context.h"
+#include "../ml_thread_safe_memory_info.h"
 
 class MLSceneGLSharedDataContext : public QGLWidget
 {
@@ -32,13 +33,13 @@ class MLSceneGLSharedDataContext : public QGLWidget
 public:
 	//parent is set to NULL in order to avoid QT bug on MAC (business as usual...).
 	//The QGLWidget are destroyed by hand in the MainWindow destructor...
-	MLSceneGLSharedDataContext(MeshDocument& md, vcg::QtThreadSafeMemoryInfo& gpumeminfo, bool highprecision, size_t perbatchtriangles, size_t minfacespersmoothrendering = 0);
+	MLSceneGLSharedDataContext(MeshDocument& md, MLThreadSafeMemoryInfo& gpumeminfo, bool highprecision, size_t perbatchtriangles, size_t minfacespersmoothrendering = 0);
 
 	~MLSceneGLSharedDataContext();
 
 	void setMinFacesForSmoothRendering(size_t fcnum);
 
-	vcg::QtThreadSafeMemoryInfo& memoryInfoManager() const
+	MLThreadSafeMemoryInfo& memoryInfoManager() const
 	{
 		return _gpumeminfo;
 	}
@@ -114,7 +115,7 @@ private:
 	MeshDocument& _md;
 	typedef std::map<int, PerMeshMultiViewManager*> MeshIDManMap;
 	MeshIDManMap _meshboman;
-	vcg::QtThreadSafeMemoryInfo& _gpumeminfo;
+	MLThreadSafeMemoryInfo& _gpumeminfo;
 	size_t _perbatchtriangles;
 	size_t _minfacessmoothrendering;
 	bool _highprecision;
@@ -24,7 +24,7 @@
 #include "ml_thread_safe_memory_info.h"
 
 MLThreadSafeMemoryInfo::MLThreadSafeMemoryInfo( std::ptrdiff_t originalmem ) 
-	:vcg::NotThreadSafeMemoryInfo(originalmem),lock(QReadWriteLock::Recursive)
+	:vcg::NotThreadSafeMemoryInfo(originalmem), total(originalmem), used(0)
 {
 
 }
@@ -33,33 +33,87 @@ MLThreadSafeMemoryInfo::~MLThreadSafeMemoryInfo()
 {
 }
 
+/**
+ * @brief Registers mem bytes as used. As in vcg::NotThreadSafeMemoryInfo,
+ * an exception is thrown only if more memory than the whole budget is
+ * requested: use tryAcquireMemory to acquire memory only if it is available.
+ */
 void MLThreadSafeMemoryInfo::acquiredMemory(std::ptrdiff_t mem)
 {
-	QWriteLocker locker(&lock);
-	vcg::NotThreadSafeMemoryInfo::acquiredMemory(mem);
+	if (isLimited() && mem > total)
+		throw vcg::MemoryInfo::MemoryInfoException("It has been requested more memory than the total one.\n");
+	used += mem;
+}
+
+/**
+ * @brief Atomically checks that mem bytes are still available in the budget
+ * and, if so, registers them as used. Returns false (and nothing is acquired)
+ * otherwise.
+ */
+bool MLThreadSafeMemoryInfo::tryAcquireMemory(std::ptrdiff_t mem)
+{
+	if (!isLimited()) {
+		used += mem;
+		return true;
+	}
+	std::ptrdiff_t current = used;
+	do {
+		if (current + mem > total)
+			return false;
+	} while (!used.compare_exchange_weak(current, current + mem));
+	return true;
 }
 
 std::ptrdiff_t MLThreadSafeMemoryInfo::usedMemory() const
 {
-	QReadLocker locker(&lock);
-	return vcg::NotThreadSafeMemoryInfo::usedMemory();
-	
+	return used;
 }
 
 std::ptrdiff_t MLThreadSafeMemoryInfo::currentFreeMemory() const
 {
-	QReadLocker locker(&lock);
-	return vcg::NotThreadSafeMemoryInfo::currentFreeMemory();
+	return total - used;
 }
 
 void MLThreadSafeMemoryInfo::releasedMemory(std::ptrdiff_t mem)
 {
-	QWriteLocker locker(&lock);
-	vcg::NotThreadSafeMemoryInfo::releasedMemory(mem);
+	used -= mem;
 }
 
 bool MLThreadSafeMemoryInfo::isAdditionalMemoryAvailable( std::ptrdiff_t mem )
 {
-	QReadLocker locker(&lock);
-	return vcg::NotThreadSafeMemoryInfo::isAdditionalMemoryAvailable(mem);
+	return !isLimited() || used + mem <= total;
+}
+
+std::ptrdiff_t MLThreadSafeMemoryInfo::totalMemory() const
+{
+	return total;
+}
+
+/**
+ * @brief Changes the budget. The memory already acquired is kept: if it
+ * exceeds the new budget, no more memory will be available until it is
+ * released.
+ */
+void MLThreadSafeMemoryInfo::setTotalMemory(std::ptrdiff_t mem)
+{
+	total = mem;
+}
+
+bool MLThreadSafeMemoryInfo::isLimited() const
+{
+	return total > 0;
+}
+
+/**
+ * @brief Returns the process-wide accounting of the system memory.
+ *
+ * The memory taken by the meshes of the documents is not registered here:
+ * it is given by MeshDocument::memoryFootprint. This object keeps track of
+ * the additional memory reserved by the operations that are running
+ * (e.g. the estimated peak of a filter, see FilterPlugin::estimatedPeakMemory).
+ */
+MLThreadSafeMemoryInfo& MLThreadSafeMemoryInfo::systemMemoryInfo()
+{
+	static MLThreadSafeMemoryInfo info(0);
+	return info;
 }
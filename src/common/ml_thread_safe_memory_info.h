@@ -24,11 +24,20 @@
 #ifndef __ML_THREAD_SAFE_MEMORY_INFO_H
 #define __ML_THREAD_SAFE_MEMORY_INFO_H
 
-#include <QReadWriteLock>
+#include <atomic>
 
 #include <wrap/system/memory_info.h>
 
-
+/**
+ * @brief The MLThreadSafeMemoryInfo class keeps track of the memory acquired
+ * from a given budget. It is used both for the GPU memory used by the
+ * buffer objects of the viewers and, through systemMemoryInfo(), for the
+ * system memory that the filters declare to need while running.
+ *
+ * All the counters are atomic: the class can be used concurrently by any
+ * thread without locks. The budget can be changed at any time with
+ * setTotalMemory; a budget of 0 means that no limit is set.
+ */
 class MLThreadSafeMemoryInfo : public vcg::NotThreadSafeMemoryInfo
 {
 public:
@@ -38,6 +47,8 @@ public:
 
 	void acquiredMemory(std::ptrdiff_t mem);
 
+	bool tryAcquireMemory(std::ptrdiff_t mem);
+
 	std::ptrdiff_t usedMemory() const;
 
 	std::ptrdiff_t currentFreeMemory() const;
@@ -45,11 +56,18 @@ public:
 	void releasedMemory(std::ptrdiff_t mem = 0);
 	
 	bool isAdditionalMemoryAvailable(std::ptrdiff_t mem);
+
+	std::ptrdiff_t totalMemory() const;
+
+	void setTotalMemory(std::ptrdiff_t mem);
+
+	bool isLimited() const;
+
+	static MLThreadSafeMemoryInfo& systemMemoryInfo();
+
 private:
-	//mutable objects can be modified from the declared const functions
-	//in this way we have not to modified the basic vcg::MemoryInfo interface for the logically const functions
-	//whose need to lock the mutex for a simple reading operation
-	mutable QReadWriteLock lock;
+	std::atomic<std::ptrdiff_t> total;
+	std::atomic<std::ptrdiff_t> used;
 };
 
 #endif
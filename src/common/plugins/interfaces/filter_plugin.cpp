@@ -3,6 +3,8 @@
 
 #include <QtGlobal>
 
+#include <set>
+
 QString FilterPlugin::pythonFilterName(ActionIDType f) const
 {
 	return pymeshlab::computePythonName(filterName(f));
@@ -47,6 +49,41 @@ bool FilterPlugin::isFilterApplicable(const QAction* act, const MeshModel& m, QS
 	return MissingItems.isEmpty();
 }
 
+std::size_t FilterPlugin::estimatedPeakMemory(
+		const QAction* filter,
+		const RichParameterList& par,
+		const MeshDocument& md) const
+{
+	std::size_t mem = 0;
+	switch(filterArity(filter))
+	{
+	case SINGLE_MESH:
+		if (md.mm() != nullptr)
+			mem = md.mm()->memoryFootprint();
+		break;
+	case FIXED: {
+		std::set<int> ids;
+		for(const RichParameter& p : par) {
+			if (p.isOfType<RichMesh>() && ids.insert(p.value().getInt()).second) {
+				const MeshModel* mm = md.getMesh(p.value().getInt());
+				if (mm != nullptr)
+					mem += mm->memoryFootprint();
+			}
+		}
+		break;
+	}
+	case VARIABLE:
+		for(const MeshModel& mm : md.meshIterator()) {
+			if (mm.isVisible())
+				mem += mm.memoryFootprint();
+		}
+		break;
+	default:
+		break;
+	}
+	return mem;
+}
+
 MeshLabPlugin::ActionIDType FilterPlugin::ID(const QAction* a) const
 {
 	QString aa=a->text();
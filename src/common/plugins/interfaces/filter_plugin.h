@@ -140,6 +140,20 @@ public:
 	 */
 	virtual bool requiresGLContext(const QAction*) const {return false;}
 
+	/**
+	 * @brief Returns an estimate of the additional memory (in bytes) that the
+	 * filter needs while running, given its parameters and the input document.
+	 * It is used by the framework to check, before starting the filter, that
+	 * the memory budget set by the user is not going to be exceeded.
+	 * The default implementation assumes that the filter needs at most a copy
+	 * of the meshes it works on: re-implement it if the memory used by the
+	 * filter grows faster than its input (e.g. subdivisions).
+	 */
+	virtual std::size_t estimatedPeakMemory(
+			const QAction* filter,
+			const RichParameterList& par,
+			const MeshDocument& md) const;
+
 	/** 
 	 * @brief The FilterPrecondition mask is used to explicitate what kind of data a filter really needs to be applied.
 	 * For example algorithms that compute per face quality have as precondition the existence of faces
@@ -24,6 +24,8 @@
 #ifndef MESHLAB_IO_PLUGIN_H
 #define MESHLAB_IO_PLUGIN_H
 
+#include <QMutex>
+
 #include <wrap/callback.h>
 
 #include "meshlab_plugin_logger.h"
@@ -406,7 +408,8 @@ public:
 	 * non-critical error while loading or saving a file happens. This function
 	 * appends the warning message passed as parameter to a string that will be
 	 * shown by the framework at the end of the execution of the load/save
-	 * function
+	 * function. It can be called concurrently by several threads loading
+	 * files with the same plugin.
 	 * @param warningMessage
 	 */
 	void reportWarning(const QString& warningMessage) const;
@@ -430,10 +433,11 @@ public:
 	 * execution of load/save functions. It returns the warning string containing
 	 * all the warnings produced by the function, and it clears the string.
 	 */
-	QString warningMessageString() const;
+	virtual QString warningMessageString() const;
 
 private:
 	mutable QString warnString;
+	mutable QMutex warnMutex;
 };
 
 #define IO_PLUGIN_IID "vcg.meshlab.IOPlugin/1.0"
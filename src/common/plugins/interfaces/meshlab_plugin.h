@@ -48,6 +48,7 @@ class MeshLabPlugin
 {
 public:
 	friend class PluginManager;
+	friend class LazyPluginLoader;
 	
 	MeshLabPlugin() : enabled(true) {};
 	virtual ~MeshLabPlugin() {}
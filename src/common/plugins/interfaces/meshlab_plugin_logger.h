@@ -48,7 +48,7 @@ public:
 	virtual ~MeshLabPluginLogger() {}
 
 	/// Standard stuff that usually should not be redefined.
-	void setLog(GLLogStream* log);
+	virtual void setLog(GLLogStream* log);
 
 	// This function must be used to communicate useful information collected in the parsing/saving of the files.
 	// NEVER EVER use a msgbox to say something to the user.
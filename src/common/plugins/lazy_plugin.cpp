@@ -0,0 +1,787 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2022                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#include "lazy_plugin.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QKeySequence>
+#include <QThread>
+
+#include "../parameters/rich_parameters.h"
+
+namespace {
+
+QJsonArray scalarsToJson(const Scalarm* v, int n)
+{
+	QJsonArray a;
+	for (int i = 0; i < n; ++i)
+		a.append((double) v[i]);
+	return a;
+}
+
+void scalarsFromJson(const QJsonValue& a, Scalarm* v, int n)
+{
+	QJsonArray array = a.toArray();
+	for (int i = 0; i < n; ++i)
+		v[i] = (Scalarm) array.at(i).toDouble();
+}
+
+/**
+ * @brief Returns the description of the given parameter, or an empty object
+ * if parameters of its type cannot be stored in the manifest (shots).
+ *
+ * Values are stored as JSON numbers, so that the defaults are not rounded.
+ */
+QJsonObject parameterToJson(const RichParameter& rp)
+{
+	QJsonObject o;
+	o.insert("type", rp.stringType());
+	o.insert("name", rp.name());
+	o.insert("description", rp.fieldDescription());
+	o.insert("tooltip", rp.toolTip());
+	o.insert("advanced", rp.isAdvanced());
+	o.insert("category", rp.category());
+
+	const Value& v = rp.value();
+	if (v.isBool()) {
+		o.insert("value", v.getBool());
+	}
+	else if (v.isInt()) {
+		o.insert("value", v.getInt());
+	}
+	else if (v.isFloat()) {
+		o.insert("value", (double) v.getFloat());
+	}
+	else if (v.isString()) {
+		o.insert("value", v.getString());
+	}
+	else if (v.isColor()) {
+		QColor c = v.getColor();
+		o.insert("value", QJsonArray {c.red(), c.green(), c.blue(), c.alpha()});
+	}
+	else if (v.isPoint3()) {
+		o.insert("value", scalarsToJson(v.getPoint3().V(), 3));
+	}
+	else if (v.isMatrix44()) {
+		o.insert("value", scalarsToJson(v.getMatrix44().V(), 16));
+	}
+	else {
+		return QJsonObject();
+	}
+
+	if (rp.isOfType<RichPercentage>()) {
+		const RichPercentage& p = dynamic_cast<const RichPercentage&>(rp);
+		o.insert("min", (double) p.min);
+		o.insert("max", (double) p.max);
+	}
+	else if (rp.isOfType<RichDynamicFloat>()) {
+		const RichDynamicFloat& p = dynamic_cast<const RichDynamicFloat&>(rp);
+		o.insert("min", (double) p.min);
+		o.insert("max", (double) p.max);
+	}
+	else if (rp.isOfType<RichEnum>()) {
+		o.insert("values", QJsonArray::fromStringList(dynamic_cast<const RichEnum&>(rp).enumvalues));
+	}
+	else if (rp.isOfType<RichFileOpen>()) {
+		o.insert("exts", QJsonArray::fromStringList(dynamic_cast<const RichFileOpen&>(rp).exts));
+	}
+	else if (rp.isOfType<RichFileSave>()) {
+		o.insert("ext", dynamic_cast<const RichFileSave&>(rp).ext);
+	}
+	return o;
+}
+
+/**
+ * @brief Stores the given parameter list in the array. Returns false if one of
+ * the parameters cannot be stored.
+ */
+bool parameterListToJson(const RichParameterList& rpl, QJsonArray& array)
+{
+	for (const RichParameter& rp : rpl) {
+		QJsonObject o = parameterToJson(rp);
+		if (o.isEmpty())
+			return false;
+		array.append(o);
+	}
+	return true;
+}
+
+QStringList stringListFromJson(const QJsonValue& v)
+{
+	QStringList l;
+	for (const QJsonValue& s : v.toArray())
+		l.push_back(s.toString());
+	return l;
+}
+
+/**
+ * @brief Builds back a parameter list stored by parameterListToJson.
+ * RichMesh parameters refer to the given document.
+ */
+RichParameterList parameterListFromJson(const QJsonValue& array, const MeshDocument* md)
+{
+	RichParameterList rpl;
+	for (const QJsonValue& pv : array.toArray()) {
+		QJsonObject o       = pv.toObject();
+		QString type        = o.value("type").toString();
+		QString name        = o.value("name").toString();
+		QString desc        = o.value("description").toString();
+		QString tooltip     = o.value("tooltip").toString();
+		bool    advanced    = o.value("advanced").toBool();
+		QString category    = o.value("category").toString();
+		QJsonValue v        = o.value("value");
+		Scalarm min         = (Scalarm) o.value("min").toDouble();
+		Scalarm max         = (Scalarm) o.value("max").toDouble();
+
+		if (type == "RichBool") {
+			rpl.addParam(RichBool(name, v.toBool(), desc, tooltip, advanced, category));
+		}
+		else if (type == "RichInt") {
+			rpl.addParam(RichInt(name, v.toInt(), desc, tooltip, advanced, category));
+		}
+		else if (type == "RichFloat") {
+			rpl.addParam(RichFloat(name, (Scalarm) v.toDouble(), desc, tooltip, advanced, category));
+		}
+		else if (type == "RichString") {
+			rpl.addParam(RichString(name, v.toString(), desc, tooltip, advanced, category));
+		}
+		else if (type == "RichAbsPerc") {
+			rpl.addParam(RichPercentage(
+				name, (Scalarm) v.toDouble(), min, max, desc, tooltip, advanced, category));
+		}
+		else if (type == "RichDynamicFloat") {
+			rpl.addParam(RichDynamicFloat(
+				name, (Scalarm) v.toDouble(), min, max, desc, tooltip, advanced, category));
+		}
+		else if (type == "RichEnum") {
+			rpl.addParam(RichEnum(
+				name, v.toInt(), stringListFromJson(o.value("values")), desc, tooltip, advanced, category));
+		}
+		else if (type == "RichColor") {
+			QJsonArray c = v.toArray();
+			QColor color(c.at(0).toInt(), c.at(1).toInt(), c.at(2).toInt(), c.at(3).toInt());
+			rpl.addParam(RichColor(name, color, desc, tooltip, advanced, category));
+		}
+		else if (type == "RichPosition" || type == "RichDirection") {
+			Point3m p;
+			scalarsFromJson(v, p.V(), 3);
+			if (type == "RichPosition")
+				rpl.addParam(RichPosition(name, p, desc, tooltip, advanced, category));
+			else
+				rpl.addParam(RichDirection(name, p, desc, tooltip, advanced, category));
+		}
+		else if (type == "RichMatrix44f") {
+			Matrix44m m;
+			scalarsFromJson(v, m.V(), 16);
+			rpl.addParam(RichMatrix44(name, m, desc, tooltip, advanced, category));
+		}
+		else if (type == "RichMesh") {
+			rpl.addParam(RichMesh(name, v.toInt(), md, desc, tooltip, advanced, category));
+		}
+		else if (type == "RichOpenFile") {
+			rpl.addParam(RichFileOpen(
+				name, v.toString(), stringListFromJson(o.value("exts")), desc, tooltip, advanced, category));
+		}
+		else if (type == "RichSaveFile") {
+			rpl.addParam(RichFileSave(
+				name, v.toString(), o.value("ext").toString(), desc, tooltip, advanced, category));
+		}
+	}
+	return rpl;
+}
+
+QJsonArray formatsToJson(const std::list<FileFormat>& formats)
+{
+	QJsonArray array;
+	for (const FileFormat& ff : formats) {
+		QJsonObject o;
+		o.insert("description", ff.description);
+		o.insert("extensions", QJsonArray::fromStringList(ff.extensions));
+		array.append(o);
+	}
+	return array;
+}
+
+std::list<FileFormat> formatsFromJson(const QJsonValue& array)
+{
+	std::list<FileFormat> formats;
+	for (const QJsonValue& v : array.toArray()) {
+		QJsonObject o = v.toObject();
+		formats.push_back(FileFormat(
+			o.value("description").toString(), stringListFromJson(o.value("extensions"))));
+	}
+	return formats;
+}
+
+} // namespace
+
+LazyPluginLoader::LazyPluginLoader(const QFileInfo& fin) :
+		fin(fin), loader(fin.absoluteFilePath()), plugin(nullptr)
+{
+}
+
+LazyPluginLoader::~LazyPluginLoader()
+{
+	if (plugin != nullptr)
+		loader.unload();
+}
+
+/**
+ * @brief Returns the instance of the plugin, opening its library if it has not
+ * been opened yet.
+ *
+ * Throws a MLException if the library cannot be loaded anymore.
+ */
+QObject* LazyPluginLoader::instance()
+{
+	if (plugin == nullptr) {
+		QObject* p = loader.instance();
+		if (p == nullptr) {
+			throw MLException(
+				fin.fileName() + " does not seem to be a Qt Plugin.\n\n" + loader.errorString());
+		}
+		// the first use can come from a worker thread (e.g. a running
+		// filter): the plugin must live in the main thread as the others
+		QCoreApplication* app = QCoreApplication::instance();
+		if (app != nullptr && p->thread() != app->thread())
+			p->moveToThread(app->thread());
+		MeshLabPlugin* ifp = dynamic_cast<MeshLabPlugin*>(p);
+		if (ifp != nullptr)
+			ifp->plugFileInfo = fin;
+		plugin = p;
+	}
+	return plugin;
+}
+
+LazyFilterPlugin::LazyFilterPlugin(
+	const QFileInfo&    fin,
+	const QJsonObject&  description,
+	const MeshDocument* schemaDocument) :
+		name(description.value("name").toString()),
+		vendorName(description.value("vendor").toString()),
+		schemaDocument(schemaDocument),
+		loader(fin),
+		loaded(nullptr),
+		logStream(nullptr)
+{
+	for (const QJsonValue& v : description.value("filters").toArray()) {
+		QJsonObject  o  = v.toObject();
+		ActionIDType id = o.value("id").toInt();
+
+		Filter& f           = filters[id];
+		f.name              = o.value("name").toString();
+		f.pythonName        = o.value("pythonName").toString();
+		f.info              = o.value("info").toString();
+		f.filterClass       = (FilterClass) o.value("class").toInt();
+		f.requirements      = o.value("requirements").toInt();
+		f.preConditions     = o.value("preConditions").toInt();
+		f.postCondition     = o.value("postCondition").toInt();
+		f.arity             = (FilterArity) o.value("arity").toInt();
+		f.requiresGLContext = o.value("requiresGLContext").toBool();
+		f.parameters        = parameterListFromJson(o.value("parameters"), schemaDocument);
+
+		QAction* a = new QAction(o.value("text").toString(), this);
+		a->setShortcut(QKeySequence(o.value("shortcut").toString()));
+		a->setPriority((QAction::Priority) o.value("priority").toInt());
+		actionList.push_back(a);
+		typeList.push_back(id);
+	}
+}
+
+/**
+ * @brief Returns the description of the given filter plugin that is stored in
+ * the plugin manifest, or an empty object if the plugin cannot be loaded
+ * lazily: the icons of the actions are resources of the library, and
+ * parameters that cannot be stored would be lost.
+ */
+QJsonObject LazyFilterPlugin::describe(FilterPlugin& plugin, const MeshDocument& schemaDocument)
+{
+	QJsonArray filters;
+	for (QAction* a : plugin.actions()) {
+		if (!a->icon().isNull())
+			return QJsonObject();
+		QJsonArray parameters;
+		if (!parameterListToJson(plugin.initParameterList(a, schemaDocument), parameters))
+			return QJsonObject();
+
+		ActionIDType id = plugin.ID(a);
+		QJsonObject  o;
+		o.insert("id", id);
+		o.insert("text", a->text());
+		o.insert("shortcut", a->shortcut().toString());
+		o.insert("priority", (int) a->priority());
+		o.insert("name", plugin.filterName(id));
+		o.insert("pythonName", plugin.pythonFilterName(id));
+		o.insert("info", plugin.filterInfo(id));
+		o.insert("class", (int) plugin.getClass(a));
+		o.insert("requirements", plugin.getRequirements(a));
+		o.insert("preConditions", plugin.getPreConditions(a));
+		o.insert("postCondition", plugin.postCondition(a));
+		o.insert("arity", (int) plugin.filterArity(a));
+		o.insert("requiresGLContext", plugin.requiresGLContext(a));
+		o.insert("parameters", parameters);
+		filters.append(o);
+	}
+
+	QJsonObject description;
+	description.insert("name", plugin.pluginName());
+	description.insert("vendor", plugin.vendor());
+	description.insert("filters", filters);
+	return description;
+}
+
+std::pair<std::string, bool> LazyFilterPlugin::getMLVersion() const
+{
+	// the version has been checked before storing the plugin in the manifest
+	return std::make_pair(meshlab::meshlabVersion(), meshlab::builtWithDoublePrecision());
+}
+
+QString LazyFilterPlugin::pluginName() const
+{
+	return name;
+}
+
+QString LazyFilterPlugin::vendor() const
+{
+	return vendorName;
+}
+
+QString LazyFilterPlugin::filterName(ActionIDType filter) const
+{
+	auto it = filters.find(filter);
+	return it != filters.end() ? it->second.name : QString();
+}
+
+QString LazyFilterPlugin::pythonFilterName(ActionIDType filter) const
+{
+	auto it = filters.find(filter);
+	return it != filters.end() ? it->second.pythonName : QString();
+}
+
+QString LazyFilterPlugin::filterInfo(ActionIDType filter) const
+{
+	auto it = filters.find(filter);
+	return it != filters.end() ? it->second.info : QString();
+}
+
+FilterPlugin::FilterClass LazyFilterPlugin::getClass(const QAction* a) const
+{
+	return filter(a).filterClass;
+}
+
+int LazyFilterPlugin::getRequirements(const QAction* a)
+{
+	return filter(a).requirements;
+}
+
+bool LazyFilterPlugin::requiresGLContext(const QAction* a) const
+{
+	return filter(a).requiresGLContext;
+}
+
+int LazyFilterPlugin::getPreConditions(const QAction* a) const
+{
+	return filter(a).preConditions;
+}
+
+int LazyFilterPlugin::postCondition(const QAction* a) const
+{
+	return filter(a).postCondition;
+}
+
+FilterPlugin::FilterArity LazyFilterPlugin::filterArity(const QAction* a) const
+{
+	return filter(a).arity;
+}
+
+QString LazyFilterPlugin::filterScriptFunctionName(ActionIDType filter)
+{
+	return plugin()->filterScriptFunctionName(filter);
+}
+
+std::size_t LazyFilterPlugin::estimatedPeakMemory(
+	const QAction*           a,
+	const RichParameterList& par,
+	const MeshDocument&      md) const
+{
+	return plugin()->estimatedPeakMemory(pluginAction(a), par, md);
+}
+
+RichParameterList LazyFilterPlugin::initParameterList(const QAction* a, const MeshModel& m)
+{
+	return plugin()->initParameterList(pluginAction(a), m);
+}
+
+/**
+ * @brief The parameters computed on the parameter schema document are taken
+ * from the manifest; any other document needs the actual plugin.
+ */
+RichParameterList LazyFilterPlugin::initParameterList(const QAction* a, const MeshDocument& md)
+{
+	if (&md == schemaDocument)
+		return filter(a).parameters;
+	return plugin()->initParameterList(pluginAction(a), md);
+}
+
+std::map<std::string, QVariant> LazyFilterPlugin::applyFilter(
+	const QAction*           a,
+	const RichParameterList& par,
+	MeshDocument&            md,
+	unsigned int&            postConditionMask,
+	vcg::CallBackPos*        cb)
+{
+	return plugin()->applyFilter(pluginAction(a), par, md, postConditionMask, cb);
+}
+
+void LazyFilterPlugin::setLog(GLLogStream* log)
+{
+	QMutexLocker locker(&mutex);
+	MeshLabPluginLogger::setLog(log);
+	logStream = log;
+	if (loaded != nullptr)
+		loaded->setLog(log);
+}
+
+const LazyFilterPlugin::Filter& LazyFilterPlugin::filter(const QAction* a) const
+{
+	auto it = filters.find(ID(a));
+	if (it == filters.end())
+		wrongActionCalled(a);
+	return it->second;
+}
+
+/**
+ * @brief Returns the actual plugin, loading it on the first call.
+ * The GL context currently assigned to this plugin is passed to it.
+ */
+FilterPlugin* LazyFilterPlugin::plugin() const
+{
+	QMutexLocker locker(&mutex);
+	if (loaded == nullptr) {
+		FilterPlugin* fp = qobject_cast<FilterPlugin*>(loader.instance());
+		if (fp == nullptr)
+			throw MLException(name + " is not a filter plugin anymore.");
+		for (QAction* a : fp->actions())
+			loadedActions[fp->ID(a)] = a;
+		fp->setLog(logStream);
+		loaded = fp;
+	}
+	loaded->glContext = glContext;
+	return loaded;
+}
+
+/**
+ * @brief Returns the action of the actual plugin that corresponds to the given
+ * action of this plugin.
+ */
+QAction* LazyFilterPlugin::pluginAction(const QAction* a) const
+{
+	plugin();
+	auto it = loadedActions.find(ID(a));
+	if (it == loadedActions.end())
+		wrongActionCalled(a);
+	return it->second;
+}
+
+LazyIOPlugin::LazyIOPlugin(
+	const QFileInfo&    fin,
+	const QJsonObject&  description,
+	const MeshDocument* schemaDocument) :
+		name(description.value("name").toString()),
+		vendorName(description.value("vendor").toString()),
+		inputFormats(formatsFromJson(description.value("importFormats"))),
+		outputFormats(formatsFromJson(description.value("exportFormats"))),
+		inputImageFormats(formatsFromJson(description.value("importImageFormats"))),
+		outputImageFormats(formatsFromJson(description.value("exportImageFormats"))),
+		inputProjectFormats(formatsFromJson(description.value("importProjectFormats"))),
+		outputProjectFormats(formatsFromJson(description.value("exportProjectFormats"))),
+		schemaDocument(schemaDocument),
+		loader(fin),
+		loaded(nullptr),
+		logStream(nullptr)
+{
+	QJsonObject preOpen = description.value("preOpenParameters").toObject();
+	for (auto it = preOpen.begin(); it != preOpen.end(); ++it)
+		preOpenParameters[it.key()] = parameterListFromJson(it.value(), schemaDocument);
+
+	QJsonObject save = description.value("saveParameters").toObject();
+	for (auto it = save.begin(); it != save.end(); ++it)
+		saveParameters[it.key()] = parameterListFromJson(it.value(), schemaDocument);
+
+	QJsonObject masks = description.value("exportMasks").toObject();
+	for (auto it = masks.begin(); it != masks.end(); ++it) {
+		QJsonArray m = it.value().toArray();
+		exportMasks[it.key()] = std::make_pair(m.at(0).toInt(), m.at(1).toInt());
+	}
+}
+
+/**
+ * @brief Returns the description of the given IO plugin that is stored in the
+ * plugin manifest, or an empty object if the plugin cannot be loaded lazily
+ * because some of its parameters cannot be stored.
+ *
+ * Parameters and capabilities are stored by upper case format.
+ */
+QJsonObject LazyIOPlugin::describe(IOPlugin& plugin, const MeshDocument& schemaDocument)
+{
+	QJsonObject preOpen;
+	for (const FileFormat& ff : plugin.importFormats()) {
+		for (const QString& format : ff.extensions) {
+			QJsonArray parameters;
+			if (!parameterListToJson(plugin.initPreOpenParameter(format), parameters))
+				return QJsonObject();
+			preOpen.insert(format.toUpper(), parameters);
+		}
+	}
+
+	QJsonObject save, masks;
+	for (const FileFormat& ff : plugin.exportFormats()) {
+		for (const QString& format : ff.extensions) {
+			QJsonArray parameters;
+			if (!parameterListToJson(plugin.initSaveParameter(format, *schemaDocument.mm()), parameters))
+				return QJsonObject();
+			save.insert(format.toUpper(), parameters);
+
+			int capability = 0, defaultBits = 0;
+			plugin.exportMaskCapability(format, capability, defaultBits);
+			masks.insert(format.toUpper(), QJsonArray {capability, defaultBits});
+		}
+	}
+
+	QJsonObject description;
+	description.insert("name", plugin.pluginName());
+	description.insert("vendor", plugin.vendor());
+	description.insert("importFormats", formatsToJson(plugin.importFormats()));
+	description.insert("exportFormats", formatsToJson(plugin.exportFormats()));
+	description.insert("importImageFormats", formatsToJson(plugin.importImageFormats()));
+	description.insert("exportImageFormats", formatsToJson(plugin.exportImageFormats()));
+	description.insert("importProjectFormats", formatsToJson(plugin.importProjectFormats()));
+	description.insert("exportProjectFormats", formatsToJson(plugin.exportProjectFormats()));
+	description.insert("preOpenParameters", preOpen);
+	description.insert("saveParameters", save);
+	description.insert("exportMasks", masks);
+	return description;
+}
+
+std::pair<std::string, bool> LazyIOPlugin::getMLVersion() const
+{
+	// the version has been checked before storing the plugin in the manifest
+	return std::make_pair(meshlab::meshlabVersion(), meshlab::builtWithDoublePrecision());
+}
+
+QString LazyIOPlugin::pluginName() const
+{
+	return name;
+}
+
+QString LazyIOPlugin::vendor() const
+{
+	return vendorName;
+}
+
+std::list<FileFormat> LazyIOPlugin::importFormats() const
+{
+	return inputFormats;
+}
+
+std::list<FileFormat> LazyIOPlugin::exportFormats() const
+{
+	return outputFormats;
+}
+
+std::list<FileFormat> LazyIOPlugin::importImageFormats() const
+{
+	return inputImageFormats;
+}
+
+std::list<FileFormat> LazyIOPlugin::exportImageFormats() const
+{
+	return outputImageFormats;
+}
+
+std::list<FileFormat> LazyIOPlugin::importProjectFormats() const
+{
+	return inputProjectFormats;
+}
+
+std::list<FileFormat> LazyIOPlugin::exportProjectFormats() const
+{
+	return outputProjectFormats;
+}
+
+RichParameterList LazyIOPlugin::initPreOpenParameter(const QString& format) const
+{
+	auto it = preOpenParameters.find(format.toUpper());
+	if (it != preOpenParameters.end())
+		return it->second;
+	return plugin()->initPreOpenParameter(format);
+}
+
+void LazyIOPlugin::exportMaskCapability(const QString& format, int& capability, int& defaultBits) const
+{
+	auto it = exportMasks.find(format.toUpper());
+	if (it != exportMasks.end()) {
+		capability  = it->second.first;
+		defaultBits = it->second.second;
+	}
+	else {
+		plugin()->exportMaskCapability(format, capability, defaultBits);
+	}
+}
+
+/**
+ * @brief The parameters computed on the mesh of the parameter schema document
+ * are taken from the manifest; any other mesh needs the actual plugin.
+ */
+RichParameterList LazyIOPlugin::initSaveParameter(const QString& format, const MeshModel& m) const
+{
+	if (&m == schemaDocument->mm()) {
+		auto it = saveParameters.find(format.toUpper());
+		if (it != saveParameters.end())
+			return it->second;
+	}
+	return plugin()->initSaveParameter(format, m);
+}
+
+unsigned int LazyIOPlugin::numberMeshesContainedInFile(
+	const QString&           format,
+	const QString&           fileName,
+	const RichParameterList& preParams) const
+{
+	return plugin()->numberMeshesContainedInFile(format, fileName, preParams);
+}
+
+void LazyIOPlugin::open(
+	const QString&               format,
+	const QString&               fileName,
+	const std::list<MeshModel*>& meshModelList,
+	std::list<int>&              maskList,
+	const RichParameterList&     par,
+	vcg::CallBackPos*            cb)
+{
+	plugin()->open(format, fileName, meshModelList, maskList, par, cb);
+}
+
+void LazyIOPlugin::open(
+	const QString&           format,
+	const QString&           fileName,
+	MeshModel&               m,
+	int&                     mask,
+	const RichParameterList& par,
+	vcg::CallBackPos*        cb)
+{
+	plugin()->open(format, fileName, m, mask, par, cb);
+}
+
+void LazyIOPlugin::save(
+	const QString&           format,
+	const QString&           fileName,
+	MeshModel&               m,
+	const int                mask,
+	const RichParameterList& par,
+	vcg::CallBackPos*        cb)
+{
+	plugin()->save(format, fileName, m, mask, par, cb);
+}
+
+QImage LazyIOPlugin::openImage(const QString& format, const QString& fileName, vcg::CallBackPos* cb)
+{
+	return plugin()->openImage(format, fileName, cb);
+}
+
+void LazyIOPlugin::saveImage(
+	const QString&    format,
+	const QString&    fileName,
+	const QImage&     image,
+	int               quality,
+	vcg::CallBackPos* cb)
+{
+	plugin()->saveImage(format, fileName, image, quality, cb);
+}
+
+std::list<FileFormat> LazyIOPlugin::projectFileRequiresAdditionalFiles(
+	const QString& format,
+	const QString& fileName)
+{
+	return plugin()->projectFileRequiresAdditionalFiles(format, fileName);
+}
+
+std::vector<MeshModel*> LazyIOPlugin::openProject(
+	const QString&                format,
+	const QStringList&            fileNames,
+	MeshDocument&                 md,
+	std::vector<MLRenderingData>& rendOpt,
+	vcg::CallBackPos*             cb)
+{
+	return plugin()->openProject(format, fileNames, md, rendOpt, cb);
+}
+
+void LazyIOPlugin::saveProject(
+	const QString&                      format,
+	const QString&                      fileName,
+	const MeshDocument&                 md,
+	bool                                onlyVisibleMeshes,
+	const std::vector<MLRenderingData>& rendOpt,
+	vcg::CallBackPos*                   cb)
+{
+	plugin()->saveProject(format, fileName, md, onlyVisibleMeshes, rendOpt, cb);
+}
+
+void LazyIOPlugin::setLog(GLLogStream* log)
+{
+	QMutexLocker locker(&mutex);
+	MeshLabPluginLogger::setLog(log);
+	logStream = log;
+	if (loaded != nullptr)
+		loaded->setLog(log);
+}
+
+/**
+ * @brief The warnings are reported by the actual plugin.
+ */
+QString LazyIOPlugin::warningMessageString() const
+{
+	IOPlugin* iop = nullptr;
+	{
+		QMutexLocker locker(&mutex);
+		iop = loaded;
+	}
+	return iop != nullptr ? iop->warningMessageString() : QString();
+}
+
+/**
+ * @brief Returns the actual plugin, loading it on the first call.
+ */
+IOPlugin* LazyIOPlugin::plugin() const
+{
+	QMutexLocker locker(&mutex);
+	if (loaded == nullptr) {
+		IOPlugin* iop = qobject_cast<IOPlugin*>(loader.instance());
+		if (iop == nullptr)
+			throw MLException(name + " is not an IO plugin anymore.");
+		iop->setLog(logStream);
+		loaded = iop;
+	}
+	return loaded;
+}
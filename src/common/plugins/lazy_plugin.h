@@ -0,0 +1,249 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2022                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef MESHLAB_LAZY_PLUGIN_H
+#define MESHLAB_LAZY_PLUGIN_H
+
+#include "interfaces/filter_plugin.h"
+#include "interfaces/io_plugin.h"
+
+#include <map>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPluginLoader>
+
+/**
+ * @brief The LazyPluginLoader class opens the library of a plugin the first
+ * time that its instance is requested.
+ *
+ * It is not thread safe: the lazy plugins serialize the calls to instance().
+ */
+class LazyPluginLoader
+{
+public:
+	LazyPluginLoader(const QFileInfo& fin);
+	~LazyPluginLoader();
+
+	QObject* instance();
+
+private:
+	QFileInfo     fin;
+	QPluginLoader loader;
+	QObject*      plugin;
+};
+
+/**
+ * @brief The LazyFilterPlugin class stands in for a filter plugin whose
+ * description has been read from the plugin manifest.
+ *
+ * Names, classes, masks and the parameters computed on the parameter schema
+ * document are answered from the description; the library of the plugin is
+ * opened only when something that needs the actual filter is called (e.g.
+ * applyFilter, or initParameterList on any other document). The QActions of
+ * the LazyFilterPlugin are the ones seen by the rest of MeshLab: they are
+ * translated into the actions of the loaded plugin when calls are forwarded.
+ */
+class LazyFilterPlugin : public QObject, public FilterPlugin
+{
+	Q_OBJECT
+	Q_INTERFACES(FilterPlugin)
+
+public:
+	LazyFilterPlugin(
+		const QFileInfo&    fin,
+		const QJsonObject&  description,
+		const MeshDocument* schemaDocument);
+
+	static QJsonObject describe(FilterPlugin& plugin, const MeshDocument& schemaDocument);
+
+	std::pair<std::string, bool> getMLVersion() const;
+	QString pluginName() const;
+	QString vendor() const;
+
+	QString filterName(ActionIDType filter) const;
+	QString pythonFilterName(ActionIDType filter) const;
+	QString filterInfo(ActionIDType filter) const;
+	FilterClass getClass(const QAction* a) const;
+	int getRequirements(const QAction* a);
+	bool requiresGLContext(const QAction* a) const;
+	int getPreConditions(const QAction* a) const;
+	int postCondition(const QAction* a) const;
+	FilterArity filterArity(const QAction* a) const;
+	QString filterScriptFunctionName(ActionIDType filter);
+
+	std::size_t estimatedPeakMemory(
+		const QAction*           a,
+		const RichParameterList& par,
+		const MeshDocument&      md) const;
+	RichParameterList initParameterList(const QAction* a, const MeshModel& m);
+	RichParameterList initParameterList(const QAction* a, const MeshDocument& md);
+	std::map<std::string, QVariant> applyFilter(
+		const QAction*           a,
+		const RichParameterList& par,
+		MeshDocument&            md,
+		unsigned int&            postConditionMask,
+		vcg::CallBackPos*        cb);
+
+	void setLog(GLLogStream* log);
+
+private:
+	struct Filter
+	{
+		QString           name;
+		QString           pythonName;
+		QString           info;
+		FilterClass       filterClass;
+		int               requirements;
+		int               preConditions;
+		int               postCondition;
+		FilterArity       arity;
+		bool              requiresGLContext;
+		RichParameterList parameters;
+	};
+
+	const Filter& filter(const QAction* a) const;
+	FilterPlugin* plugin() const;
+	QAction*      pluginAction(const QAction* a) const;
+
+	QString                        name;
+	QString                        vendorName;
+	std::map<ActionIDType, Filter> filters;
+	const MeshDocument*            schemaDocument;
+
+	mutable QMutex                           mutex;
+	mutable LazyPluginLoader                 loader;
+	mutable FilterPlugin*                    loaded;
+	mutable std::map<ActionIDType, QAction*> loadedActions;
+	GLLogStream*                             logStream;
+};
+
+/**
+ * @brief The LazyIOPlugin class stands in for an IO plugin whose description
+ * has been read from the plugin manifest.
+ *
+ * The supported formats, the export capabilities, the pre-open parameters and
+ * the save parameters computed on the parameter schema document are answered
+ * from the description; the library of the plugin is opened the first time a
+ * file is opened or saved.
+ */
+class LazyIOPlugin : public QObject, public IOPlugin
+{
+	Q_OBJECT
+	Q_INTERFACES(IOPlugin)
+
+public:
+	LazyIOPlugin(
+		const QFileInfo&    fin,
+		const QJsonObject&  description,
+		const MeshDocument* schemaDocument);
+
+	static QJsonObject describe(IOPlugin& plugin, const MeshDocument& schemaDocument);
+
+	std::pair<std::string, bool> getMLVersion() const;
+	QString pluginName() const;
+	QString vendor() const;
+
+	std::list<FileFormat> importFormats() const;
+	std::list<FileFormat> exportFormats() const;
+	std::list<FileFormat> importImageFormats() const;
+	std::list<FileFormat> exportImageFormats() const;
+	std::list<FileFormat> importProjectFormats() const;
+	std::list<FileFormat> exportProjectFormats() const;
+
+	RichParameterList initPreOpenParameter(const QString& format) const;
+	void exportMaskCapability(const QString& format, int& capability, int& defaultBits) const;
+	RichParameterList initSaveParameter(const QString& format, const MeshModel& m) const;
+
+	unsigned int numberMeshesContainedInFile(
+		const QString&           format,
+		const QString&           fileName,
+		const RichParameterList& preParams) const;
+	void open(
+		const QString&               format,
+		const QString&               fileName,
+		const std::list<MeshModel*>& meshModelList,
+		std::list<int>&              maskList,
+		const RichParameterList&     par,
+		vcg::CallBackPos*            cb = nullptr);
+	void open(
+		const QString&           format,
+		const QString&           fileName,
+		MeshModel&               m,
+		int&                     mask,
+		const RichParameterList& par,
+		vcg::CallBackPos*        cb = nullptr);
+	void save(
+		const QString&           format,
+		const QString&           fileName,
+		MeshModel&               m,
+		const int                mask,
+		const RichParameterList& par,
+		vcg::CallBackPos*        cb = nullptr);
+	QImage openImage(const QString& format, const QString& fileName, vcg::CallBackPos* cb = nullptr);
+	void saveImage(
+		const QString&    format,
+		const QString&    fileName,
+		const QImage&     image,
+		int               quality = -1,
+		vcg::CallBackPos* cb      = nullptr);
+	std::list<FileFormat> projectFileRequiresAdditionalFiles(const QString& format, const QString& fileName);
+	std::vector<MeshModel*> openProject(
+		const QString&                format,
+		const QStringList&            fileNames,
+		MeshDocument&                 md,
+		std::vector<MLRenderingData>& rendOpt,
+		vcg::CallBackPos*             cb = nullptr);
+	void saveProject(
+		const QString&                      format,
+		const QString&                      fileName,
+		const MeshDocument&                 md,
+		bool                                onlyVisibleMeshes,
+		const std::vector<MLRenderingData>& rendOpt,
+		vcg::CallBackPos*                   cb = nullptr);
+
+	void setLog(GLLogStream* log);
+	QString warningMessageString() const;
+
+private:
+	IOPlugin* plugin() const;
+
+	QString                                name;
+	QString                                vendorName;
+	std::list<FileFormat>                  inputFormats;
+	std::list<FileFormat>                  outputFormats;
+	std::list<FileFormat>                  inputImageFormats;
+	std::list<FileFormat>                  outputImageFormats;
+	std::list<FileFormat>                  inputProjectFormats;
+	std::list<FileFormat>                  outputProjectFormats;
+	std::map<QString, RichParameterList>   preOpenParameters;
+	std::map<QString, RichParameterList>   saveParameters;
+	std::map<QString, std::pair<int, int>> exportMasks;
+	const MeshDocument*                    schemaDocument;
+
+	mutable QMutex           mutex;
+	mutable LazyPluginLoader loader;
+	mutable IOPlugin*        loaded;
+	GLLogStream*             logStream;
+};
+
+#endif // MESHLAB_LAZY_PLUGIN_H
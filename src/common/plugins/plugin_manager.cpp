@@ -22,10 +22,14 @@
 ****************************************************************************/
 
 #include "plugin_manager.h"
+#include "lazy_plugin.h"
 
 #include <QObject>
 #include <QDir>
 #include <QApplication>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QStandardPaths>
 
 #include <vcg/complex/algorithms/create/platonic.h>
 
@@ -47,15 +51,33 @@ static QStringList fileNamePluginDLLs() {
 #endif
 }
 
-PluginManager::PluginManager()
+/**
+ * @brief Returns the path of the file where the descriptions of the plugin
+ * files are cached between different executions.
+ */
+static QString pluginManifestPath()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+		"/meshlab/plugin_manifest.json";
+}
+
+PluginManager::PluginManager() :
+	manifestLoaded(false), manifestChanged(false)
 {
+	initParameterSchemaDocument(schemaDocument);
 }
 
 PluginManager::~PluginManager()
 {
-	for (auto& plugin : allPluginLoaders){
-		plugin->unload();
-		delete plugin;
+	for (unsigned int i = 0; i < allPlugins.size(); ++i){
+		if (allPluginLoaders[i] != nullptr) {
+			allPluginLoaders[i]->unload();
+			delete allPluginLoaders[i];
+		}
+		else {
+			//lazy plugins are owned by the PluginManager
+			delete allPlugins[i];
+		}
 	}
 }
 
@@ -79,6 +101,25 @@ MeshLabPluginType PluginManager::checkPlugin(const QString& filename)
 		throw MLException(fin.fileName() + " does not seem to be a Qt Plugin.\n\n" + loader.errorString());
 	}
 
+	try {
+		MeshLabPluginType type = checkPluginInstance(plugin, fin);
+		loader.unload();
+		return type;
+	}
+	catch (const MLException& e) {
+		loader.unload();
+		throw e;
+	}
+}
+
+/**
+ * @brief Checks if the given instance, loaded from the given file, is a valid
+ * MeshLab plugin, and returns its type.
+ *
+ * Throws a MLException if it is not a valid MeshLab plugin.
+ */
+MeshLabPluginType PluginManager::checkPluginInstance(QObject* plugin, const QFileInfo& fin)
+{
 	MeshLabPlugin* ifp = dynamic_cast<MeshLabPlugin *>(plugin);
 	if (!ifp){
 		throw MLException(fin.fileName() + " is not a MeshLab plugin.");
@@ -124,7 +165,6 @@ MeshLabPluginType PluginManager::checkPlugin(const QString& filename)
 		checkFilterPlugin(qobject_cast<FilterPlugin *>(plugin));
 	}
 
-	loader.unload();
 	return type;
 }
 
@@ -166,6 +206,7 @@ void PluginManager::loadPlugins(QDir pluginsDirectory)
 				errors.push_back(std::make_pair(fileName, e.what()));
 			}
 		}
+		savePluginManifest();
 		if (errors.size() > 0){
 			QString singleError = "Unable to load the following plugins:\n\n";
 			for (const auto& p : errors){
@@ -189,29 +230,69 @@ MeshLabPlugin* PluginManager::loadPlugin(const QString& fileName)
 	QFileInfo fin(fileName);
 	if (pluginFiles.find(fin.absoluteFilePath()) != pluginFiles.end())
 		throw MLException(fin.fileName() + " has been already loaded.");
+	if (!fin.exists()){
+		throw MLException(fileName + " does not exists.");
+	}
 
-	checkPlugin(fileName);
+	// a file that has been already found not to be a valid MeshLab plugin
+	// and has not been changed since then is not loaded again
+	QJsonObject entry = manifestEntry(fin);
+	if (entry.contains("error"))
+		throw MLException(entry.value("error").toString());
+
+	MeshLabPlugin* ifp = nullptr;
+	QPluginLoader* loader = nullptr;
+	if (entry.contains("filter")) {
+		// the library will be loaded the first time one of its filters is used
+		ifp = new LazyFilterPlugin(fin, entry.value("filter").toObject(), &schemaDocument);
+	}
+	else if (entry.contains("io")) {
+		// the library will be loaded the first time a file is opened or saved
+		ifp = new LazyIOPlugin(fin, entry.value("io").toObject(), &schemaDocument);
+	}
+	else {
+		// the library is loaded just once: the same instance is first checked
+		// and then added to the PluginManager
+		loader = new QPluginLoader(fin.absoluteFilePath());
+		QObject *plugin = loader->instance();
+		if (!plugin) {
+			QString error = fin.fileName() + " does not seem to be a Qt Plugin.\n\n" + loader->errorString();
+			delete loader;
+			throw MLException(error);
+		}
+		try {
+			checkPluginInstance(plugin, fin);
+		}
+		catch (const MLException& e) {
+			loader->unload();
+			delete loader;
+			QJsonObject errorEntry;
+			errorEntry.insert("error", QString(e.what()));
+			setManifestEntry(fin, errorEntry);
+			throw e;
+		}
+		ifp = dynamic_cast<MeshLabPlugin *>(plugin);
+		if (entry.isEmpty())
+			setManifestEntry(fin, describePlugin(ifp));
+	}
 
 	//load the plugin depending on the type (can be more than one type!)
-	QPluginLoader* loader = new QPluginLoader(fin.absoluteFilePath());
-	QObject *plugin = loader->instance();
-	MeshLabPlugin* ifp = dynamic_cast<MeshLabPlugin *>(plugin);
 	MeshLabPluginType type(ifp);
 	
 	if (type.isDecoratePlugin()){
-		decoratePlugins.pushDecoratePlugin(qobject_cast<DecoratePlugin *>(plugin));
+		decoratePlugins.pushDecoratePlugin(dynamic_cast<DecoratePlugin *>(ifp));
 	}
 	if (type.isEditPlugin()){
-		editPlugins.pushEditPlugin(qobject_cast<EditPlugin *>(plugin));
+		editPlugins.pushEditPlugin(dynamic_cast<EditPlugin *>(ifp));
 	}
 	if (type.isFilterPlugin()){
-		filterPlugins.pushFilterPlugin(qobject_cast<FilterPlugin *>(plugin));
+		filterPlugins.pushFilterPlugin(dynamic_cast<FilterPlugin *>(ifp));
 	}
 	if (type.isIOPlugin()){
-		ioPlugins.pushIOPlugin(qobject_cast<IOPlugin *>(plugin));
+		ioPlugins.pushIOPlugin(dynamic_cast<IOPlugin *>(ifp));
 	}
 	if (type.isRenderPlugin()){
-		renderPlugins.pushRenderPlugin(qobject_cast<RenderPlugin *>(plugin));
+		renderPlugins.pushRenderPlugin(dynamic_cast<RenderPlugin *>(ifp));
 	}
 
 	//set the QFileInfo to the plugin, and add it to the continer
@@ -223,6 +304,111 @@ MeshLabPlugin* PluginManager::loadPlugin(const QString& fileName)
 	return ifp;
 }
 
+/**
+ * @brief Returns the manifest entry of the given file, if the file has not
+ * been modified since the entry was written by the running MeshLab version.
+ * Returns an empty object otherwise.
+ *
+ * An entry contains either the error obtained checking a library that is not
+ * a valid MeshLab plugin, or the description used to load a filter ("filter")
+ * or IO ("io") plugin lazily, or nothing for the valid plugins that are always
+ * loaded at startup. A library that cannot be loaded at all (e.g. a missing
+ * dependency) is never stored, and it is always tried again.
+ */
+QJsonObject PluginManager::manifestEntry(const QFileInfo& fin)
+{
+	loadPluginManifest();
+	QJsonObject entry = manifest.value(fin.absoluteFilePath()).toObject();
+	if (entry.isEmpty())
+		return QJsonObject();
+	if (entry.value("size").toDouble() != (double) fin.size() ||
+			entry.value("modified").toDouble() != (double) fin.lastModified().toMSecsSinceEpoch())
+		return QJsonObject();
+	return entry;
+}
+
+/**
+ * @brief Stores in the manifest the given entry for the given file, together
+ * with the size and the modification time of the file.
+ */
+void PluginManager::setManifestEntry(const QFileInfo& fin, QJsonObject entry)
+{
+	loadPluginManifest();
+	entry.insert("size", (double) fin.size());
+	entry.insert("modified", (double) fin.lastModified().toMSecsSinceEpoch());
+	manifest.insert(fin.absoluteFilePath(), entry);
+	manifestChanged = true;
+}
+
+/**
+ * @brief Returns the manifest entry of a valid plugin. Only plugins of a single
+ * type, filter or IO, are described, so that they can be loaded lazily the
+ * next times.
+ */
+QJsonObject PluginManager::describePlugin(MeshLabPlugin* ifp)
+{
+	QJsonObject entry;
+	MeshLabPluginType type(ifp);
+	if (type.isMultipleTypePlugin())
+		return entry;
+	try {
+		if (type.isFilterPlugin()) {
+			QJsonObject d = LazyFilterPlugin::describe(*dynamic_cast<FilterPlugin*>(ifp), schemaDocument);
+			if (!d.isEmpty())
+				entry.insert("filter", d);
+		}
+		else if (type.isIOPlugin()) {
+			QJsonObject d = LazyIOPlugin::describe(*dynamic_cast<IOPlugin*>(ifp), schemaDocument);
+			if (!d.isEmpty())
+				entry.insert("io", d);
+		}
+	}
+	catch (const MLException&) {
+		// a plugin that cannot compute its parameters on the schema document
+		// is loaded at startup, as before
+		entry = QJsonObject();
+	}
+	return entry;
+}
+
+/**
+ * @brief Reads the plugin manifest, if it has not been read yet. A manifest
+ * written by a different MeshLab version is discarded.
+ */
+void PluginManager::loadPluginManifest()
+{
+	if (manifestLoaded)
+		return;
+	manifestLoaded = true;
+	QFile file(pluginManifestPath());
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+	if (root.value("version").toString() != QString::fromStdString(meshlab::meshlabVersion()))
+		return;
+	manifest = root.value("plugins").toObject();
+}
+
+/**
+ * @brief Writes the plugin manifest, if it has been changed since it was
+ * read. Failing to write the manifest is not an error.
+ */
+void PluginManager::savePluginManifest()
+{
+	if (!manifestChanged)
+		return;
+	QFileInfo fin(pluginManifestPath());
+	QDir().mkpath(fin.absolutePath());
+	QFile file(fin.absoluteFilePath());
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return;
+	QJsonObject root;
+	root.insert("version", QString::fromStdString(meshlab::meshlabVersion()));
+	root.insert("plugins", manifest);
+	file.write(QJsonDocument(root).toJson());
+	manifestChanged = false;
+}
+
 void PluginManager::unloadPlugin(MeshLabPlugin* ifp)
 {
 	auto it = std::find(allPlugins.begin(), allPlugins.end(), ifp);
@@ -247,8 +433,13 @@ void PluginManager::unloadPlugin(MeshLabPlugin* ifp)
 		QPluginLoader* l = allPluginLoaders[index];
 		allPluginLoaders.erase(allPluginLoaders.begin() + index);
 		allPlugins.erase(it);
-		l->unload();
-		delete l;
+		if (l != nullptr) {
+			l->unload();
+			delete l;
+		}
+		else {
+			delete ifp;
+		}
 	}
 }
 
@@ -280,6 +471,36 @@ int PluginManager::numberIOPlugins() const
 	return ioPlugins.size();
 }
 
+/**
+ * @brief Returns the document used to compute the default parameters of the
+ * filters and of the IO formats that are stored in the plugin manifest.
+ *
+ * Lazy plugins answer from the manifest when their parameters are requested on
+ * this document, without loading their library.
+ */
+const MeshDocument& PluginManager::parameterSchemaDocument() const
+{
+	return schemaDocument;
+}
+
+/**
+ * @brief Fills the given document with the mesh used to compute default
+ * parameter values: a 1x1x1 cube (with extremes [-0.5; 0.5]), with per vertex
+ * and per face quality.
+ */
+void PluginManager::initParameterSchemaDocument(MeshDocument& md)
+{
+	md.clear();
+	Box3m b(Point3m(-0.5,-0.5,-0.5),Point3m(0.5,0.5,0.5));
+	CMeshO cube;
+	vcg::tri::Box<CMeshO>(cube,b);
+	md.addNewMesh(cube, "cube");
+	int mask = 0;
+	mask |= vcg::tri::io::Mask::IOM_VERTQUALITY;
+	mask |= vcg::tri::io::Mask::IOM_FACEQUALITY;
+	md.mm()->enable(mask);
+}
+
 // Search among all the decorator plugins the one that contains a decoration with the given name
 DecoratePlugin *PluginManager::getDecoratePlugin(const QString& name)
 {
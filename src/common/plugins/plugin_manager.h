@@ -33,6 +33,7 @@
 
 #include <QPluginLoader>
 #include <QObject>
+#include <QJsonObject>
 
 /**
  * @brief The PluginManager class provides the basic tools for managing all the plugins.
@@ -59,6 +60,9 @@ public:
 	unsigned int size() const;
 	int numberIOPlugins() const;
 
+	const MeshDocument& parameterSchemaDocument() const;
+	static void initParameterSchemaDocument(MeshDocument& md);
+
 	DecoratePlugin* getDecoratePlugin(const QString& name);
 
 	QAction* filterAction(const QString& name);
@@ -104,6 +108,14 @@ private:
 	std::vector<QPluginLoader*> allPluginLoaders;
 	std::set<QString> pluginFiles; //used to check if a plugin file has been already loaded
 
+	//cache of the descriptions of the plugin files, persisted between executions
+	QJsonObject manifest;
+	bool manifestLoaded;
+	bool manifestChanged;
+
+	//document on which the parameters stored in the manifest are computed
+	MeshDocument schemaDocument;
+
 	//Plugin containers: used for better organization of each type of plugin
 	// note: these containers do not own any plugin. Plugins are owned by the PluginManager
 	IOPluginContainer ioPlugins;
@@ -112,8 +124,15 @@ private:
 	DecoratePluginContainer decoratePlugins;
 	EditPluginContainer editPlugins;
 
+	static MeshLabPluginType checkPluginInstance(QObject* plugin, const QFileInfo& fin);
 	static void checkFilterPlugin(FilterPlugin* iFilter);
 
+	QJsonObject manifestEntry(const QFileInfo& fin);
+	void setManifestEntry(const QFileInfo& fin, QJsonObject entry);
+	QJsonObject describePlugin(MeshLabPlugin* ifp);
+	void loadPluginManifest();
+	void savePluginManifest();
+
 	template <typename RangeIterator>
 	static QStringList inputFormatListDialog(RangeIterator iterator);
 
@@ -26,17 +26,16 @@
 #include "../mlexception.h"
 #include <algorithm>
 #include "python_utils.h"
-#include <vcg/complex/algorithms/create/platonic.h>
 
-pymeshlab::FunctionSet::FunctionSet()
+pymeshlab::FunctionSet::FunctionSet() : parameterDocument(&dummyMeshDocument)
 {
 }
 
-pymeshlab::FunctionSet::FunctionSet(const PluginManager& pm)
+pymeshlab::FunctionSet::FunctionSet(const PluginManager& pm) :
+	parameterDocument(&pm.parameterSchemaDocument())
 {
-	//dummy MeshDocument use to compute default value parameters
-	//the mesh used is a 1x1x1 cube (with extremes [-0.5; 0.5])
-	initDummyMeshDocument();
+	//default value parameters are computed on the 1x1x1 cube document of the
+	//PluginManager, on which lazy plugins answer without being loaded
 
 	for (IOPlugin* iop : pm.ioPluginIterator()){
 		loadIOPlugin(iop);
@@ -55,7 +54,7 @@ void pymeshlab::FunctionSet::loadFilterPlugin(FilterPlugin* fp)
 		QString pythonFilterName = fp->pythonFilterName(act);
 		Function f(pythonFilterName, originalFilterName, description);
 
-		RichParameterList rps = fp->initParameterList(act, dummyMeshDocument);
+		RichParameterList rps = fp->initParameterList(act, *parameterDocument);
 
 		for (const RichParameter& rp : rps){
 			FunctionParameter par(rp);
@@ -94,7 +93,7 @@ void pymeshlab::FunctionSet::loadIOPlugin(IOPlugin* iop)
 			QString originalFilterName = outputFormat.toLower();
 			QString pythonFilterName = outputFormat.toLower();
 			Function f(pythonFilterName, originalFilterName, "Save " + outputFormat + " format.");
-			RichParameterList rps = iop->initSaveParameter(outputFormat, *dummyMeshDocument.mm());
+			RichParameterList rps = iop->initSaveParameter(outputFormat, *parameterDocument->mm());
 			if (outputFormat.toUpper() == "PLY"){
 				f.setDescription(
 					"Save PLY format.</p></br> Ply exporter also support saving custom attributes. "
@@ -253,16 +252,3 @@ void pymeshlab::FunctionSet::updateSaveParameters(IOPlugin* plugin,
 
 
 }
-
-void pymeshlab::FunctionSet::initDummyMeshDocument()
-{
-	dummyMeshDocument.clear();
-	Box3m b(Point3m(-0.5,-0.5,-0.5),Point3m(0.5,0.5,0.5));
-	CMeshO dummyMesh;
-	vcg::tri::Box<CMeshO>(dummyMesh,b);
-	dummyMeshDocument.addNewMesh(dummyMesh, "cube");
-	int mask = 0;
-	mask |= vcg::tri::io::Mask::IOM_VERTQUALITY;
-	mask |= vcg::tri::io::Mask::IOM_FACEQUALITY;
-	dummyMeshDocument.mm()->enable(mask);
-}
@@ -91,9 +91,8 @@ private:
 			const QString& outputFormat,
 			Function& f);
 
-	void initDummyMeshDocument();
-
 	MeshDocument dummyMeshDocument;
+	const MeshDocument* parameterDocument;
 
 	std::set<Function> filterSet;
 	std::set<Function> loadMeshSet;
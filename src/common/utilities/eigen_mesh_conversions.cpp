@@ -78,6 +78,11 @@ class PolyMesh :
  * the sizes of vertex and face matrices. If this requirement is not satisfied,
  * a MLException will be thrown.
  *
+ * The mesh is built directly into the given CMeshO (e.g. the cm of a
+ * MeshModel), whose previous content is discarded: no intermediate mesh is
+ * created and copied.
+ *
+ * @param m: the mesh that will contain the given components
  * @param vertices: #V*3 matrix of scalars (vertex coordinates)
  * @param faces: #F*3 matrix of integers (vertex indices composing the faces)
  * @param vertexNormals: #V*3 matrix of scalars (vertex normals)
@@ -86,9 +91,9 @@ class PolyMesh :
  * @param faceQuality: #F vector of scalars (face quality)
  * @param vertexColor: #V*4 vector of scalars (RGBA vertex colors in interval [0-1])
  * @param faceColor: #F*4 vector of scalars (RGBA face colors in interval [0-1])
- * @return a CMeshO made of the given components
  */
-CMeshO meshlab::meshFromMatrices(
+void meshlab::meshFromMatrices(
+	CMeshO&                 m,
 	const EigenMatrixX3m&   vertices,
 	const Eigen::MatrixX3i& faces,
 	const Eigen::MatrixX2i& edges,
@@ -99,10 +104,9 @@ CMeshO meshlab::meshFromMatrices(
 	const EigenMatrixX4m&   vertexColor,
 	const EigenMatrixX4m&   faceColor)
 {
-	CMeshO m;
+	m.Clear();
 	if (vertices.rows() > 0) {
 		// add vertices and their associated normals and quality if any
-		std::vector<CMeshO::VertexPointer> ivp(vertices.rows());
 
 		bool hasVNormals = vertexNormals.rows() > 0;
 		bool hasVQuality = vertexQuality.rows() > 0;
@@ -124,7 +128,6 @@ CMeshO meshlab::meshFromMatrices(
 		}
 		CMeshO::VertexIterator vi = vcg::tri::Allocator<CMeshO>::AddVertices(m, vertices.rows());
 		for (unsigned int i = 0; i < vertices.rows(); ++i, ++vi) {
-			ivp[i]  = &*vi;
 			vi->P() = CMeshO::CoordType(vertices(i, 0), vertices(i, 1), vertices(i, 2));
 			if (hasVNormals) {
 				vi->N() = CMeshO::CoordType(
@@ -171,16 +174,16 @@ CMeshO meshlab::meshFromMatrices(
 		CMeshO::FaceIterator fi = vcg::tri::Allocator<CMeshO>::AddFaces(m, faces.rows());
 		for (unsigned int i = 0; i < faces.rows(); ++i, ++fi) {
 			for (unsigned int j = 0; j < 3; j++) {
-				if ((unsigned int) faces(i, j) >= ivp.size()) {
+				if ((unsigned int) faces(i, j) >= m.vert.size()) {
 					throw MLException(
 						"Error while creating mesh: bad vertex index " +
 						QString::number(faces(i, j)) + " in face " + QString::number(i) +
 						"; vertex " + QString::number(j) + ".");
 				}
 			}
-			fi->V(0) = ivp[faces(i, 0)];
-			fi->V(1) = ivp[faces(i, 1)];
-			fi->V(2) = ivp[faces(i, 2)];
+			fi->V(0) = &m.vert[faces(i, 0)];
+			fi->V(1) = &m.vert[faces(i, 1)];
+			fi->V(2) = &m.vert[faces(i, 2)];
 
 			if (hasFNormals) {
 				fi->N() =
@@ -203,15 +206,15 @@ CMeshO meshlab::meshFromMatrices(
 		CMeshO::EdgeIterator ei = vcg::tri::Allocator<CMeshO>::AddEdges(m, edges.rows());
 		for (unsigned int i = 0; i < edges.rows(); ++i, ++ei) {
 			for (unsigned int j = 0; j < 2; j++) {
-				if ((unsigned int) edges(i, j) >= ivp.size()) {
+				if ((unsigned int) edges(i, j) >= m.vert.size()) {
 					throw MLException(
 						"Error while creating mesh: bad vertex index " +
 						QString::number(edges(i, j)) + " in edge " + QString::number(i) +
 						"; vertex " + QString::number(j) + ".");
 				}
 			}
-			ei->V(0) = ivp[edges(i, 0)];
-			ei->V(1) = ivp[edges(i, 1)];
+			ei->V(0) = &m.vert[edges(i, 0)];
+			ei->V(1) = &m.vert[edges(i, 1)];
 		}
 
 		if (!hasFNormals) {
@@ -224,7 +227,36 @@ CMeshO meshlab::meshFromMatrices(
 	else {
 		throw MLException("Error while creating mesh: Vertex matrix is empty.");
 	}
+}
 
+/**
+ * @brief Creates a CMeshO mesh from the data contained in the given matrices.
+ * See the other overload of meshFromMatrices for the description of the
+ * parameters.
+ */
+CMeshO meshlab::meshFromMatrices(
+	const EigenMatrixX3m&   vertices,
+	const Eigen::MatrixX3i& faces,
+	const Eigen::MatrixX2i& edges,
+	const EigenMatrixX3m&   vertexNormals,
+	const EigenMatrixX3m&   faceNormals,
+	const EigenVectorXm&    vertexQuality,
+	const EigenVectorXm&    faceQuality,
+	const EigenMatrixX4m&   vertexColor,
+	const EigenMatrixX4m&   faceColor)
+{
+	CMeshO m;
+	meshFromMatrices(
+		m,
+		vertices,
+		faces,
+		edges,
+		vertexNormals,
+		faceNormals,
+		vertexQuality,
+		faceQuality,
+		vertexColor,
+		faceColor);
 	return m;
 }
 
@@ -588,7 +620,7 @@ Eigen::MatrixX3i meshlab::faceMatrix(const CMeshO& mesh)
 	vcg::tri::RequireFaceCompactness(mesh);
 
 	// create eigen matrix of faces
-	Eigen::MatrixXi faces(mesh.FN(), 3);
+	Eigen::MatrixX3i faces(mesh.FN(), 3);
 
 	// copy faces
 	for (int i = 0; i < mesh.FN(); i++) {
@@ -614,7 +646,7 @@ Eigen::MatrixX2i meshlab::edgeMatrix(const CMeshO& mesh)
 	vcg::tri::RequireEdgeCompactness(mesh);
 
 	// create eigen matrix of edges
-	Eigen::MatrixXi edges(mesh.EN(), 2);
+	Eigen::MatrixX2i edges(mesh.EN(), 2);
 
 	// copy faces
 	for (int i = 0; i < mesh.EN(); i++) {
@@ -41,6 +41,18 @@ typedef Eigen::Matrix<Scalarm, Eigen::Dynamic, Eigen::Dynamic> EigenMatrixXm;
 namespace meshlab {
 
 // From eigen to CMeshO
+void meshFromMatrices(
+	CMeshO&                 m,
+	const EigenMatrixX3m&   vertices,
+	const Eigen::MatrixX3i& faces         = Eigen::MatrixX3i(),
+	const Eigen::MatrixX2i& edges         = Eigen::MatrixX2i(),
+	const EigenMatrixX3m&   vertexNormals = EigenMatrixX3m(),
+	const EigenMatrixX3m&   faceNormals   = EigenMatrixX3m(),
+	const EigenVectorXm&    vertexQuality = EigenVectorXm(),
+	const EigenVectorXm&    faceQuality   = EigenVectorXm(),
+	const EigenMatrixX4m&   vertexColor   = EigenMatrixX4m(),
+	const EigenMatrixX4m&   faceColor     = EigenMatrixX4m());
+
 CMeshO meshFromMatrices(
 	const EigenMatrixX3m&   vertices,
 	const Eigen::MatrixX3i& faces         = Eigen::MatrixX3i(),
@@ -0,0 +1,189 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "eigen_mesh_view.h"
+
+#include <algorithm>
+
+static_assert(
+	sizeof(CVertexO) % sizeof(Scalarm) == 0 && sizeof(CFaceO) % sizeof(Scalarm) == 0,
+	"vertices and faces must be mappable as strided arrays of scalars");
+
+namespace {
+
+template<typename Elem>
+Eigen::Index scalarStride()
+{
+	return sizeof(Elem) / sizeof(Scalarm);
+}
+
+} // namespace
+
+meshlab::MeshArrayView::MeshArrayView(CMeshO& mesh) : mesh(mesh)
+{
+}
+
+template<int N>
+void meshlab::MeshArrayView::IndexCache<N>::invalidate(unsigned int first, unsigned int last)
+{
+	last = std::min<unsigned int>(last, indices.rows());
+	for (unsigned int p = first / PAGE_SIZE; p * PAGE_SIZE < last; ++p)
+		validPages[p] = false;
+}
+
+template<int N, typename ElemContainer>
+void meshlab::MeshArrayView::updateCache(IndexCache<N>& cache, const ElemContainer& elems)
+{
+	// indices are relative to the address of the first vertex
+	const void* vd = mesh.vert.empty() ? nullptr : &mesh.vert[0];
+	if (vd != vertData || mesh.vert.size() != vertCount) {
+		vertData  = vd;
+		vertCount = mesh.vert.size();
+		faceCache.validPages.assign(faceCache.validPages.size(), false);
+		edgeCache.validPages.assign(edgeCache.validPages.size(), false);
+	}
+
+	const void* ed = elems.empty() ? nullptr : &elems[0];
+	if (ed != cache.elemData || elems.size() != cache.elemCount) {
+		cache.elemData  = ed;
+		cache.elemCount = elems.size();
+		cache.indices.resize(elems.size(), N);
+		cache.validPages.assign((elems.size() + PAGE_SIZE - 1) / PAGE_SIZE, false);
+	}
+
+	for (unsigned int p = 0; p < cache.validPages.size(); ++p) {
+		if (cache.validPages[p])
+			continue;
+		const size_t last = std::min<size_t>((p + 1) * PAGE_SIZE, elems.size());
+		for (size_t i = p * PAGE_SIZE; i < last; ++i) {
+			for (int j = 0; j < N; ++j)
+				cache.indices(i, j) = (int) vcg::tri::Index(mesh, elems[i].cV(j));
+		}
+		cache.validPages[p] = true;
+	}
+}
+
+/**
+ * @brief Returns a #V*3 map of the vertex coordinates of the mesh.
+ */
+meshlab::MeshArrayView::MatrixX3mMap meshlab::MeshArrayView::vertexMatrix()
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	Scalarm* data = mesh.vert.empty() ? nullptr : mesh.vert[0].P().V();
+	return MatrixX3mMap(
+		data, mesh.vert.size(), 3, Eigen::OuterStride<>(scalarStride<CVertexO>()));
+}
+
+/**
+ * @brief Returns a #V*3 map of the vertex normals of the mesh.
+ */
+meshlab::MeshArrayView::MatrixX3mMap meshlab::MeshArrayView::vertexNormalMatrix()
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	vcg::tri::RequirePerVertexNormal(mesh);
+	Scalarm* data = mesh.vert.empty() ? nullptr : mesh.vert[0].N().V();
+	return MatrixX3mMap(
+		data, mesh.vert.size(), 3, Eigen::OuterStride<>(scalarStride<CVertexO>()));
+}
+
+/**
+ * @brief Returns a #V*4 map of the RGBA vertex colors of the mesh, with values
+ * in the interval [0-255].
+ */
+meshlab::MeshArrayView::MatrixX4ucMap meshlab::MeshArrayView::vertexColorMatrix()
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	vcg::tri::RequirePerVertexColor(mesh);
+	unsigned char* data = mesh.vert.empty() ? nullptr : mesh.vert[0].C().V();
+	return MatrixX4ucMap(data, mesh.vert.size(), 4, Eigen::OuterStride<>(sizeof(CVertexO)));
+}
+
+/**
+ * @brief Returns a #V map of the vertex quality of the mesh.
+ */
+meshlab::MeshArrayView::VectorXmMap meshlab::MeshArrayView::vertexQualityArray()
+{
+	vcg::tri::RequireVertexCompactness(mesh);
+	vcg::tri::RequirePerVertexQuality(mesh);
+	Scalarm* data = mesh.vert.empty() ? nullptr : &mesh.vert[0].Q();
+	return VectorXmMap(data, mesh.vert.size(), Eigen::InnerStride<>(scalarStride<CVertexO>()));
+}
+
+/**
+ * @brief Returns a #F*3 map of the face normals of the mesh.
+ */
+meshlab::MeshArrayView::MatrixX3mMap meshlab::MeshArrayView::faceNormalMatrix()
+{
+	vcg::tri::RequireFaceCompactness(mesh);
+	vcg::tri::RequirePerFaceNormal(mesh);
+	Scalarm* data = mesh.face.empty() ? nullptr : mesh.face[0].N().V();
+	return MatrixX3mMap(
+		data, mesh.face.size(), 3, Eigen::OuterStride<>(scalarStride<CFaceO>()));
+}
+
+/**
+ * @brief Returns a #F*3 map of the vertex indices of the faces of the mesh.
+ * Only the invalidated pages of the cache are computed.
+ */
+meshlab::MeshArrayView::ConstMatrixX3iMap meshlab::MeshArrayView::faceMatrix()
+{
+	vcg::tri::RequireFaceCompactness(mesh);
+	updateCache(faceCache, mesh.face);
+	return ConstMatrixX3iMap(faceCache.indices.data(), faceCache.indices.rows(), 3);
+}
+
+/**
+ * @brief Returns a #E*2 map of the vertex indices of the edges of the mesh.
+ * Only the invalidated pages of the cache are computed.
+ */
+meshlab::MeshArrayView::ConstMatrixX2iMap meshlab::MeshArrayView::edgeMatrix()
+{
+	vcg::tri::RequireEdgeCompactness(mesh);
+	updateCache(edgeCache, mesh.edge);
+	return ConstMatrixX2iMap(edgeCache.indices.data(), edgeCache.indices.rows(), 2);
+}
+
+/**
+ * @brief Notifies that the vertices of the faces in the range [first, last)
+ * have been changed.
+ */
+void meshlab::MeshArrayView::invalidateFaces(unsigned int first, unsigned int last)
+{
+	faceCache.invalidate(first, last);
+}
+
+/**
+ * @brief Notifies that the vertices of the edges in the range [first, last)
+ * have been changed.
+ */
+void meshlab::MeshArrayView::invalidateEdges(unsigned int first, unsigned int last)
+{
+	edgeCache.invalidate(first, last);
+}
+
+void meshlab::MeshArrayView::invalidate()
+{
+	faceCache.invalidate(0, faceCache.indices.rows());
+	edgeCache.invalidate(0, edgeCache.indices.rows());
+}
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef MESHLAB_EIGEN_MESH_VIEW_H
+#define MESHLAB_EIGEN_MESH_VIEW_H
+
+#include "eigen_mesh_conversions.h"
+
+#include <vector>
+
+namespace meshlab {
+
+/**
+ * @brief The MeshArrayView class gives access to the per element data of a
+ * compact CMeshO as Eigen matrices, avoiding the copies made by the
+ * vertexMatrix, faceMatrix... functions.
+ *
+ * Components that are stored as numbers inside vertices and faces
+ * (coordinates, normals, quality, colors) are returned as strided
+ * Eigen::Map(s) of the vectors of the mesh: nothing is copied, and writing
+ * into a map modifies the mesh.
+ *
+ * Face and edge indices are stored in the mesh as pointers, and they are
+ * converted into a cache of PAGE_SIZE rows pages. A page is computed again
+ * only after it has been invalidated: all the pages are invalidated when the
+ * vectors of the mesh are reallocated or resized, while changes that do not
+ * touch the vectors (e.g. a filter that changes the vertices of some faces)
+ * must be notified with invalidateFaces/invalidateEdges.
+ *
+ * Maps are valid until the vectors of the mesh are reallocated.
+ */
+class MeshArrayView
+{
+public:
+	static const unsigned int PAGE_SIZE = 4096;
+
+	typedef Eigen::Matrix<Scalarm, Eigen::Dynamic, 3, Eigen::RowMajor>       RowMatrixX3m;
+	typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, 4, Eigen::RowMajor> RowMatrixX4uc;
+	typedef Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>           RowMatrixX3i;
+	typedef Eigen::Matrix<int, Eigen::Dynamic, 2, Eigen::RowMajor>           RowMatrixX2i;
+
+	typedef Eigen::Map<RowMatrixX3m, Eigen::Unaligned, Eigen::OuterStride<>>  MatrixX3mMap;
+	typedef Eigen::Map<RowMatrixX4uc, Eigen::Unaligned, Eigen::OuterStride<>> MatrixX4ucMap;
+	typedef Eigen::Map<EigenVectorXm, Eigen::Unaligned, Eigen::InnerStride<>> VectorXmMap;
+	typedef Eigen::Map<const RowMatrixX3i>                                    ConstMatrixX3iMap;
+	typedef Eigen::Map<const RowMatrixX2i>                                    ConstMatrixX2iMap;
+
+	MeshArrayView(CMeshO& mesh);
+
+	MatrixX3mMap  vertexMatrix();
+	MatrixX3mMap  vertexNormalMatrix();
+	MatrixX4ucMap vertexColorMatrix();
+	VectorXmMap   vertexQualityArray();
+	MatrixX3mMap  faceNormalMatrix();
+
+	ConstMatrixX3iMap faceMatrix();
+	ConstMatrixX2iMap edgeMatrix();
+
+	void invalidateFaces(unsigned int first, unsigned int last);
+	void invalidateEdges(unsigned int first, unsigned int last);
+	void invalidate();
+
+private:
+	/**
+	 * The cache of the vertex indices of faces or edges: the rows of the
+	 * matrix are computed one page at a time.
+	 */
+	template<int N>
+	struct IndexCache
+	{
+		Eigen::Matrix<int, Eigen::Dynamic, N, Eigen::RowMajor> indices;
+		std::vector<bool> validPages;
+
+		// the state of the mesh vectors when the cache was computed
+		const void* elemData = nullptr;
+		size_t      elemCount = 0;
+
+		void invalidate(unsigned int first, unsigned int last);
+	};
+
+	template<int N, typename ElemContainer>
+	void updateCache(IndexCache<N>& cache, const ElemContainer& elems);
+
+	CMeshO& mesh;
+	IndexCache<3> faceCache;
+	IndexCache<2> edgeCache;
+
+	// the vertex vector when the caches were computed
+	const void* vertData = nullptr;
+	size_t      vertCount = 0;
+};
+
+} // namespace meshlab
+
+#endif // MESHLAB_EIGEN_MESH_VIEW_H
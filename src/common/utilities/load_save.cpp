@@ -22,6 +22,10 @@
  ****************************************************************************/
 
 #include "load_save.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <exception>
 
 #include <QDir>
 #include <QElapsedTimer>
@@ -33,41 +37,20 @@
 
 namespace meshlab {
 
+namespace {
+
 /**
- * @brief This function assumes that you already have the following data:
- * - the plugin that is needed to load the mesh
- * - the number of meshes that will be loaded from the file
- * - the list of MeshModel(s) that will contain the loaded mesh(es)
- * - the open parameters that will be used to load the mesh(es)
- *
- * The function will take care to load the mesh, load textures if needed
- * and make all the clean operations after loading the meshes.
- * If load fails, throws a MLException.
- *
- * @param[i] fileName: the filename
- * @param[i] ioPlugin: the plugin that supports the file format to load
- * @param[i] prePar: the pre open parameters
- * @param[i/o] meshList: the list of meshes that will be loaded from the file
- * @param[o] maskList: masks of loaded components for each loaded mesh
- * @param cb: callback
- * @return the list of texture names that could not be loaded
+ * @brief Loads the textures of the just opened meshes and makes all the clean
+ * operations that must be done after opening a mesh file.
+ * Returns the list of texture names that could not be loaded.
  */
-std::list<std::string> loadMesh(
-	const QString&               fileName,
+std::list<std::string> postLoadMesh(
 	IOPlugin*                    ioPlugin,
-	const RichParameterList&     prePar,
 	const std::list<MeshModel*>& meshList,
-	std::list<int>&              maskList,
+	const std::list<int>&        maskList,
 	vcg::CallBackPos*            cb)
 {
 	std::list<std::string> unloadedTextures;
-	QFileInfo              fi(fileName);
-	QString                extension = fi.suffix();
-
-	QDir oldDir = QDir::current();
-	QDir::setCurrent(fi.absolutePath());
-	ioPlugin->open(extension, fi.fileName(), meshList, maskList, prePar, cb);
-	QDir::setCurrent(oldDir.absolutePath());
 
 	auto itmesh = meshList.begin();
 	auto itmask = maskList.begin();
@@ -80,7 +63,7 @@ std::list<std::string> loadMesh(
 
 		int delVertNum = vcg::tri::Clean<CMeshO>::RemoveDegenerateVertex(mm->cm);
 		int delFaceNum = vcg::tri::Clean<CMeshO>::RemoveDegenerateFace(mm->cm);
-		vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm->cm);
+		mm->compact();
 		if (delVertNum > 0 || delFaceNum > 0)
 			ioPlugin->reportWarning(QString("Warning mesh contains %1 vertices with NAN coords and "
 											"%2 degenerated faces.\nCorrected.")
@@ -116,6 +99,46 @@ std::list<std::string> loadMesh(
 	return unloadedTextures;
 }
 
+} // namespace
+
+/**
+ * @brief This function assumes that you already have the following data:
+ * - the plugin that is needed to load the mesh
+ * - the number of meshes that will be loaded from the file
+ * - the list of MeshModel(s) that will contain the loaded mesh(es)
+ * - the open parameters that will be used to load the mesh(es)
+ *
+ * The function will take care to load the mesh, load textures if needed
+ * and make all the clean operations after loading the meshes.
+ * If load fails, throws a MLException.
+ *
+ * @param[i] fileName: the filename
+ * @param[i] ioPlugin: the plugin that supports the file format to load
+ * @param[i] prePar: the pre open parameters
+ * @param[i/o] meshList: the list of meshes that will be loaded from the file
+ * @param[o] maskList: masks of loaded components for each loaded mesh
+ * @param cb: callback
+ * @return the list of texture names that could not be loaded
+ */
+std::list<std::string> loadMesh(
+	const QString&               fileName,
+	IOPlugin*                    ioPlugin,
+	const RichParameterList&     prePar,
+	const std::list<MeshModel*>& meshList,
+	std::list<int>&              maskList,
+	vcg::CallBackPos*            cb)
+{
+	QFileInfo fi(fileName);
+	QString   extension = fi.suffix();
+
+	QDir oldDir = QDir::current();
+	QDir::setCurrent(fi.absolutePath());
+	ioPlugin->open(extension, fi.fileName(), meshList, maskList, prePar, cb);
+	QDir::setCurrent(oldDir.absolutePath());
+
+	return postLoadMesh(ioPlugin, meshList, maskList, cb);
+}
+
 /**
  * @brief loads the given filename and puts the loaded mesh(es) into the
  * given MeshDocument. Returns the list of loaded meshes.
@@ -197,6 +220,129 @@ std::list<MeshModel*> loadMeshWithStandardParameters(
 	return meshList;
 }
 
+/**
+ * @brief loads all the given mesh files and puts the loaded meshes into the
+ * given MeshDocument, using the standard open parameters for each file.
+ * Returns, for each file, the list of meshes loaded from it.
+ *
+ * The layers of all the files are created in the MeshDocument before loading,
+ * in the same order of the filenames; the files (and their textures) are then
+ * loaded concurrently by a pool of threads. The callback is invoked only by
+ * the calling thread, and reports the number of files already loaded.
+ *
+ * If the load of a file fails, an exception is thrown (the one of the first
+ * file that failed, in the order of filenames), and MeshDocument won't
+ * contain any of the new meshes.
+ */
+std::vector<std::list<MeshModel*>> loadMeshesWithStandardParameters(
+	const QStringList& filenames,
+	MeshDocument&      md,
+	vcg::CallBackPos*  cb)
+{
+	struct MeshFile
+	{
+		QString               filename;
+		IOPlugin*             ioPlugin = nullptr;
+		RichParameterList     openParams;
+		std::list<MeshModel*> meshList;
+		std::exception_ptr    error;
+	};
+
+	PluginManager&        pm = meshlab::pluginManagerInstance();
+	std::vector<MeshFile> files(filenames.size());
+
+	auto deleteLoadedMeshes = [&]() {
+		for (const MeshFile& f : files)
+			for (const MeshModel* mm : f.meshList)
+				md.delMesh(mm->id());
+	};
+
+	// plugins and parameters are looked up, and the layers are created, by
+	// the calling thread: the order of the layers does not depend on the order
+	// in which the files are loaded
+	MeshModel* lastMesh = nullptr;
+	for (unsigned int i = 0; i < files.size(); ++i) {
+		MeshFile& f = files[i];
+		QFileInfo fi(filenames[i]);
+		QString   extension = fi.suffix();
+		f.filename          = fi.absoluteFilePath();
+		f.ioPlugin          = pm.inputMeshPlugin(extension);
+
+		if (f.ioPlugin == nullptr) {
+			deleteLoadedMeshes();
+			throw MLException(
+				"Mesh " + filenames[i] +
+				" cannot be opened. Your MeshLab version "
+				"has not plugin to read " +
+				extension + " file format");
+		}
+
+		f.ioPlugin->setLog(&md.Log);
+		f.openParams = f.ioPlugin->initPreOpenParameter(extension);
+		f.openParams.join(meshlab::defaultGlobalParameterList());
+
+		unsigned int nMeshes = 0;
+		try {
+			nMeshes = f.ioPlugin->numberMeshesContainedInFile(extension, f.filename, f.openParams);
+		}
+		catch (const MLException& e) {
+			deleteLoadedMeshes();
+			throw e;
+		}
+		for (unsigned int j = 0; j < nMeshes; j++) {
+			MeshModel* mm = md.addNewMesh(f.filename, fi.fileName(), false);
+			if (nMeshes != 1) {
+				mm->setIdInFile(j);
+			}
+			f.meshList.push_back(mm);
+			lastMesh = mm;
+		}
+	}
+	if (lastMesh != nullptr)
+		md.setCurrentMesh(lastMesh->id());
+
+	// the files are opened with their absolute path: the current directory
+	// is shared by all the threads and cannot be changed while loading.
+	// A file that fails to load, or a callback that throws (e.g. the user
+	// canceled the load), stops the threads before the next file
+	std::atomic<bool> abort(false);
+	std::exception_ptr error;
+	try {
+		parallelFor(
+			files.size(),
+			[&](std::size_t i, unsigned int) {
+				MeshFile& f = files[i];
+				try {
+					std::list<int> masks;
+					f.ioPlugin->open(
+						QFileInfo(f.filename).suffix(), f.filename, f.meshList, masks, f.openParams, nullptr);
+					postLoadMesh(f.ioPlugin, f.meshList, masks, nullptr);
+				}
+				catch (...) {
+					f.error = std::current_exception();
+					abort   = true;
+				}
+			},
+			cb, 0, 100, "Loading meshes...", 0, &abort);
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+
+	for (unsigned int i = 0; i < files.size() && error == nullptr; ++i)
+		error = files[i].error;
+	if (error != nullptr) {
+		deleteLoadedMeshes();
+		std::rethrow_exception(error);
+	}
+
+	std::vector<std::list<MeshModel*>> meshLists;
+	meshLists.reserve(files.size());
+	for (MeshFile& f : files)
+		meshLists.push_back(std::move(f.meshList));
+	return meshLists;
+}
+
 void reloadMesh(
 	const QString&               filename,
 	const std::list<MeshModel*>& meshList,
@@ -48,6 +48,11 @@ std::list<MeshModel*> loadMeshWithStandardParameters(
 	vcg::CallBackPos* cb     = nullptr,
 	RichParameterList prePar = RichParameterList());
 
+std::vector<std::list<MeshModel*>> loadMeshesWithStandardParameters(
+	const QStringList& filenames,
+	MeshDocument&      md,
+	vcg::CallBackPos*  cb = nullptr);
+
 void reloadMesh(
 	const QString&               filename,
 	const std::list<MeshModel*>& meshList,
@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QThread>
+
+namespace meshlab {
+
+/**
+ * @brief Returns the number of threads to use for the parallel algorithms:
+ * the ideal thread count of the machine, at most maxThreads (if not zero).
+ */
+unsigned int threadCount(std::size_t maxThreads)
+{
+	std::size_t n = std::max(QThread::idealThreadCount(), 1);
+	if (maxThreads > 0)
+		n = std::min(n, maxThreads);
+	return (unsigned int) n;
+}
+
+/**
+ * @brief Runs worker(0), ..., worker(nThreads - 1), each one on its own thread.
+ *
+ * The calling thread waits for the workers and calls progress (if not empty)
+ * about every 100 milliseconds: it is the only thread that reports the
+ * progress, so progress may invoke a vcg::CallBackPos. The workers should
+ * return as soon as they find abort set: it is set when a worker or progress
+ * throws. The first exception is rethrown after all the threads have been
+ * joined.
+ */
+void runThreads(
+	unsigned int                             nThreads,
+	const std::function<void(unsigned int)>& worker,
+	const std::function<void()>&             progress,
+	std::atomic<bool>&                       abort)
+{
+	unsigned int            running = nThreads;
+	std::exception_ptr      error;
+	std::mutex              mutex;
+	std::condition_variable finished;
+
+	auto run = [&](unsigned int thread) {
+		try {
+			worker(thread);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error)
+				error = std::current_exception();
+			abort = true;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		--running;
+		finished.notify_one();
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(nThreads);
+	try {
+		for (unsigned int t = 0; t < nThreads; ++t)
+			threads.emplace_back(run, t);
+		std::unique_lock<std::mutex> lock(mutex);
+		while (running > 0) {
+			finished.wait_for(lock, std::chrono::milliseconds(100));
+			if (progress && !abort) {
+				lock.unlock();
+				progress();
+				lock.lock();
+			}
+		}
+	}
+	catch (...) {
+		abort = true;
+		for (std::thread& t : threads)
+			t.join();
+		throw;
+	}
+	for (std::thread& t : threads)
+		t.join();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+/**
+ * @brief Runs job(i, thread) for each i in [0, n) on a pool of threads;
+ * thread is the index, in [0, threadCount(maxThreads)), of the thread that
+ * runs the job, and can be used to access per thread data.
+ *
+ * The progress is reported through cb in [progressFrom, progressTo] only by
+ * the calling thread (see runThreads). No job is started after abort (if
+ * given) has been set, also by another thread; it is set when a job or the
+ * callback throws.
+ */
+void parallelFor(
+	std::size_t                                            n,
+	const std::function<void(std::size_t, unsigned int)>& job,
+	vcg::CallBackPos*                                      cb,
+	int                                                    progressFrom,
+	int                                                    progressTo,
+	const char*                                            message,
+	unsigned int                                           maxThreads,
+	std::atomic<bool>*                                     abort)
+{
+	if (n == 0)
+		return;
+	std::atomic<bool>        localAbort(false);
+	std::atomic<bool>&       stop = abort != nullptr ? *abort : localAbort;
+	std::atomic<std::size_t> next(0);
+	std::atomic<std::size_t> done(0);
+
+	auto worker = [&](unsigned int thread) {
+		for (std::size_t i = next++; i < n && !stop; i = next++) {
+			job(i, thread);
+			++done;
+		}
+	};
+	std::function<void()> progress;
+	if (cb != nullptr) {
+		progress = [&]() {
+			cb(progressFrom + int((progressTo - progressFrom) * done / n), message);
+		};
+	}
+	unsigned int nThreads = threadCount(maxThreads > 0 ? std::min<std::size_t>(maxThreads, n) : n);
+	runThreads(nThreads, worker, progress, stop);
+}
+
+} // namespace meshlab
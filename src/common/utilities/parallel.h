@@ -0,0 +1,55 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef MESHLAB_PARALLEL_H
+#define MESHLAB_PARALLEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+#include <wrap/callback.h>
+
+namespace meshlab {
+
+unsigned int threadCount(std::size_t maxThreads = 0);
+
+void runThreads(
+	unsigned int                             nThreads,
+	const std::function<void(unsigned int)>& worker,
+	const std::function<void()>&             progress,
+	std::atomic<bool>&                       abort);
+
+void parallelFor(
+	std::size_t                                            n,
+	const std::function<void(std::size_t, unsigned int)>& job,
+	vcg::CallBackPos*                                      cb           = nullptr,
+	int                                                    progressFrom = 0,
+	int                                                    progressTo   = 100,
+	const char*                                            message      = "",
+	unsigned int                                           maxThreads   = 0,
+	std::atomic<bool>*                                     abort        = nullptr);
+
+} // namespace meshlab
+
+#endif // MESHLAB_PARALLEL_H
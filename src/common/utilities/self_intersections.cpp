@@ -0,0 +1,326 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#include "self_intersections.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <vcg/complex/algorithms/clean.h>
+
+namespace {
+
+// distances from a plane below this value are considered zero, as in the
+// triangle-triangle test of vcg (the plane normals are not normalized)
+const Scalarm PLANE_EPSILON = Scalarm(1e-6);
+
+// number of faces processed by a thread at a time
+const unsigned int QUERY_CHUNK = 1024;
+
+bool overlap(const Box3m& a, const Box3m& b)
+{
+	// touching boxes overlap: faces sharing a vertex must be tested
+	return a.min[0] <= b.max[0] && a.max[0] >= b.min[0] && a.min[1] <= b.max[1] &&
+		   a.max[1] >= b.min[1] && a.min[2] <= b.max[2] && a.max[2] >= b.min[2];
+}
+
+Scalarm surfaceArea(const Box3m& b)
+{
+	Point3m d = b.Dim();
+	return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+} // namespace
+
+meshlab::SelfIntersectionFinder::SelfIntersectionFinder(CMeshO& mesh) : mesh(mesh)
+{
+	const size_t fn = mesh.face.size();
+	boxes.resize(fn);
+	for (std::vector<Scalarm>& c : coords)
+		c.resize(fn);
+	for (std::vector<Scalarm>& p : planes)
+		p.resize(fn);
+	for (size_t i = 0; i < fn; ++i) {
+		const CFaceO& f = mesh.face[i];
+		if (f.IsD())
+			continue;
+		for (int v = 0; v < 3; ++v) {
+			boxes[i].Add(f.cP(v));
+			for (int k = 0; k < 3; ++k)
+				coords[v * 3 + k][i] = f.cP(v)[k];
+		}
+		Point3m n = (f.cP(1) - f.cP(0)) ^ (f.cP(2) - f.cP(0));
+		planes[0][i] = n[0];
+		planes[1][i] = n[1];
+		planes[2][i] = n[2];
+		planes[3][i] = n * f.cP(0);
+	}
+	build();
+}
+
+/**
+ * @brief Returns the pairs (f, g), with f < g, of the indices of the faces
+ * that intersect, sorted.
+ */
+std::vector<meshlab::SelfIntersectionFinder::FacePair>
+meshlab::SelfIntersectionFinder::intersectingPairs(vcg::CallBackPos* cb) const
+{
+	const size_t nChunks = (faces.size() + QUERY_CHUNK - 1) / QUERY_CHUNK;
+	std::vector<std::vector<FacePair>> chunkPairs(nChunks);
+
+	// scratch buffers of each thread
+	struct Buffers
+	{
+		std::vector<unsigned int> stack;
+		std::vector<unsigned int> candidates;
+		std::vector<Scalarm>      buffer;
+	};
+	std::vector<Buffers> buffers(threadCount(nChunks));
+
+	parallelFor(
+		nChunks,
+		[&](size_t c, unsigned int thread) {
+			Buffers&     b   = buffers[thread];
+			const size_t end = std::min(faces.size(), (c + 1) * QUERY_CHUNK);
+			for (size_t i = c * QUERY_CHUNK; i < end; ++i)
+				query(faces[i], b.stack, b.candidates, b.buffer, chunkPairs[c]);
+		},
+		cb, 0, 100, "Looking for self intersections");
+
+	std::vector<FacePair> pairs;
+	for (const std::vector<FacePair>& cp : chunkPairs)
+		pairs.insert(pairs.end(), cp.begin(), cp.end());
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
+
+/**
+ * @brief Replaces the face selection of the mesh with the faces that
+ * intersect some other face, and returns their number.
+ */
+unsigned int meshlab::SelfIntersectionFinder::selectIntersectingFaces(vcg::CallBackPos* cb) const
+{
+	std::vector<FacePair> pairs = intersectingPairs(cb);
+	vcg::tri::UpdateSelection<CMeshO>::FaceClear(mesh);
+	unsigned int selected = 0;
+	for (const FacePair& p : pairs) {
+		for (unsigned int f : {p.first, p.second}) {
+			if (!mesh.face[f].IsS()) {
+				mesh.face[f].SetS();
+				++selected;
+			}
+		}
+	}
+	return selected;
+}
+
+/**
+ * @brief Builds the tree top down. Each node is split with the binned
+ * surface area heuristic on the face centroids; when all the centroids
+ * coincide, the faces are split in two halves.
+ */
+void meshlab::SelfIntersectionFinder::build()
+{
+	faces.clear();
+	nodes.clear();
+	std::vector<Point3m> centroids(mesh.face.size());
+	for (size_t i = 0; i < mesh.face.size(); ++i) {
+		if (!mesh.face[i].IsD()) {
+			faces.push_back(i);
+			centroids[i] = boxes[i].Center();
+		}
+	}
+	if (faces.empty())
+		return;
+
+	struct Range
+	{
+		unsigned int node, begin, end;
+	};
+	nodes.reserve(2 * (faces.size() / LEAF_SIZE + 1));
+	nodes.emplace_back();
+	std::vector<Range> stack = {{0, 0, (unsigned int) faces.size()}};
+	while (!stack.empty()) {
+		Range r = stack.back();
+		stack.pop_back();
+
+		Box3m box, centroidBox;
+		for (unsigned int k = r.begin; k < r.end; ++k) {
+			box.Add(boxes[faces[k]]);
+			centroidBox.Add(centroids[faces[k]]);
+		}
+		nodes[r.node].box = box;
+		if (r.end - r.begin <= LEAF_SIZE) {
+			nodes[r.node].first = r.begin;
+			nodes[r.node].count = r.end - r.begin;
+			continue;
+		}
+
+		int     bestAxis = -1;
+		int     bestBin  = 0;
+		Scalarm bestCost = std::numeric_limits<Scalarm>::max();
+		auto    binOf    = [&](unsigned int f, int axis) {
+			Scalarm ext = centroidBox.max[axis] - centroidBox.min[axis];
+			int     b   = int(SAH_BINS * (centroids[f][axis] - centroidBox.min[axis]) / ext);
+			return std::min<int>(b, SAH_BINS - 1);
+		};
+		for (int axis = 0; axis < 3; ++axis) {
+			if (centroidBox.max[axis] <= centroidBox.min[axis])
+				continue;
+			Box3m        binBoxes[SAH_BINS];
+			unsigned int binCounts[SAH_BINS] = {};
+			for (unsigned int k = r.begin; k < r.end; ++k) {
+				int b = binOf(faces[k], axis);
+				binBoxes[b].Add(boxes[faces[k]]);
+				++binCounts[b];
+			}
+			// cost of the splits after each bin, sweeping from the right
+			Scalarm      rightArea[SAH_BINS];
+			unsigned int rightCount[SAH_BINS];
+			Box3m        acc;
+			unsigned int count = 0;
+			for (int b = SAH_BINS - 1; b > 0; --b) {
+				acc.Add(binBoxes[b]);
+				count += binCounts[b];
+				rightArea[b]  = count > 0 ? surfaceArea(acc) : 0;
+				rightCount[b] = count;
+			}
+			acc.SetNull();
+			count = 0;
+			for (int b = 0; b < (int) SAH_BINS - 1; ++b) {
+				acc.Add(binBoxes[b]);
+				count += binCounts[b];
+				if (count == 0 || rightCount[b + 1] == 0)
+					continue;
+				Scalarm cost = surfaceArea(acc) * count + rightArea[b + 1] * rightCount[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin  = b;
+				}
+			}
+		}
+
+		unsigned int mid;
+		if (bestAxis < 0) {
+			mid = r.begin + (r.end - r.begin) / 2;
+		}
+		else {
+			auto it = std::partition(
+				faces.begin() + r.begin, faces.begin() + r.end, [&](unsigned int f) {
+					return binOf(f, bestAxis) <= bestBin;
+				});
+			mid = it - faces.begin();
+		}
+
+		unsigned int left = nodes.size();
+		nodes.emplace_back();
+		nodes.emplace_back();
+		nodes[r.node].first = left;
+		stack.push_back({left, r.begin, mid});
+		stack.push_back({left + 1, mid, r.end});
+	}
+}
+
+/**
+ * @brief Appends to pairs the faces with index greater than f that intersect
+ * f. stack, candidates and buffer are working memory, kept by the caller to
+ * avoid an allocation for each query.
+ */
+void meshlab::SelfIntersectionFinder::query(
+	unsigned int               f,
+	std::vector<unsigned int>& stack,
+	std::vector<unsigned int>& candidates,
+	std::vector<Scalarm>&      buffer,
+	std::vector<FacePair>&     pairs) const
+{
+	const Box3m& fb = boxes[f];
+	candidates.clear();
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!overlap(node.box, fb))
+			continue;
+		if (node.count > 0) {
+			for (unsigned int k = node.first; k < node.first + node.count; ++k) {
+				unsigned int g = faces[k];
+				if (g > f && overlap(boxes[g], fb))
+					candidates.push_back(g);
+			}
+		}
+		else {
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+		}
+	}
+	const size_t n = candidates.size();
+	if (n == 0)
+		return;
+
+	// gather the vertices and the planes of the candidates, then discard the
+	// ones that lie strictly on one side of the plane of f, or that have f
+	// strictly on one side of their plane
+	buffer.resize(14 * n);
+	Scalarm* c[9];
+	Scalarm* p[4];
+	for (int i = 0; i < 9; ++i) {
+		c[i] = &buffer[i * n];
+		for (size_t k = 0; k < n; ++k)
+			c[i][k] = coords[i][candidates[k]];
+	}
+	for (int i = 0; i < 4; ++i) {
+		p[i] = &buffer[(9 + i) * n];
+		for (size_t k = 0; k < n; ++k)
+			p[i][k] = planes[i][candidates[k]];
+	}
+	Scalarm* keep = &buffer[13 * n];
+
+	const Scalarm fx0 = coords[0][f], fy0 = coords[1][f], fz0 = coords[2][f];
+	const Scalarm fx1 = coords[3][f], fy1 = coords[4][f], fz1 = coords[5][f];
+	const Scalarm fx2 = coords[6][f], fy2 = coords[7][f], fz2 = coords[8][f];
+	const Scalarm fnx = planes[0][f], fny = planes[1][f], fnz = planes[2][f], fd = planes[3][f];
+	const Scalarm eps = PLANE_EPSILON;
+	for (size_t k = 0; k < n; ++k) {
+		Scalarm d0 = fnx * c[0][k] + fny * c[1][k] + fnz * c[2][k] - fd;
+		Scalarm d1 = fnx * c[3][k] + fny * c[4][k] + fnz * c[5][k] - fd;
+		Scalarm d2 = fnx * c[6][k] + fny * c[7][k] + fnz * c[8][k] - fd;
+		Scalarm e0 = p[0][k] * fx0 + p[1][k] * fy0 + p[2][k] * fz0 - p[3][k];
+		Scalarm e1 = p[0][k] * fx1 + p[1][k] * fy1 + p[2][k] * fz1 - p[3][k];
+		Scalarm e2 = p[0][k] * fx2 + p[1][k] * fy2 + p[2][k] * fz2 - p[3][k];
+		bool separated = ((d0 > eps) & (d1 > eps) & (d2 > eps)) |
+						 ((d0 < -eps) & (d1 < -eps) & (d2 < -eps)) |
+						 ((e0 > eps) & (e1 > eps) & (e2 > eps)) |
+						 ((e0 < -eps) & (e1 < -eps) & (e2 < -eps));
+		keep[k] = separated ? 0 : 1;
+	}
+
+	CFaceO* fp = &mesh.face[f];
+	for (size_t k = 0; k < n; ++k) {
+		if (keep[k] != 0 &&
+			vcg::tri::Clean<CMeshO>::TestFaceFaceIntersection(fp, &mesh.face[candidates[k]]))
+			pairs.push_back(FacePair(f, candidates[k]));
+	}
+}
@@ -0,0 +1,99 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef MESHLAB_SELF_INTERSECTIONS_H
+#define MESHLAB_SELF_INTERSECTIONS_H
+
+#include "../ml_document/cmesh.h"
+
+#include <utility>
+#include <vector>
+
+namespace meshlab {
+
+/**
+ * @brief The SelfIntersectionFinder class finds the pairs of intersecting
+ * faces of a mesh. Two faces intersect according to the same test used by
+ * vcg::tri::Clean::SelfIntersections: faces that share an edge never
+ * intersect, duplicated faces always do.
+ *
+ * The candidate pairs are found with a bounding volume hierarchy of the face
+ * bounding boxes, built with the surface area heuristic: unlike a uniform
+ * grid, it does not degrade when the faces have very different sizes.
+ * The tree is visited in parallel, with one query per face. The candidates of
+ * a query are first tested in batch against the plane of the face (and the
+ * face against their planes) with plain loops over contiguous arrays, that
+ * the compiler vectorizes; only the remaining ones go through the exact
+ * triangle-triangle test.
+ *
+ * The tree refers to the faces by index: it is valid until the faces or the
+ * vertex positions of the mesh change.
+ */
+class SelfIntersectionFinder
+{
+public:
+	typedef std::pair<unsigned int, unsigned int> FacePair;
+
+	SelfIntersectionFinder(CMeshO& mesh);
+
+	std::vector<FacePair> intersectingPairs(vcg::CallBackPos* cb = nullptr) const;
+	unsigned int          selectIntersectingFaces(vcg::CallBackPos* cb = nullptr) const;
+
+private:
+	static const unsigned int LEAF_SIZE = 4;
+	static const unsigned int SAH_BINS  = 16;
+
+	/**
+	 * A node of the tree: a leaf if count > 0, with the faces
+	 * faces[first, first + count); otherwise an inner node with children
+	 * first and first + 1.
+	 */
+	struct Node
+	{
+		Box3m        box;
+		unsigned int first = 0;
+		unsigned int count = 0;
+	};
+
+	void build();
+	void query(
+		unsigned int               f,
+		std::vector<unsigned int>& stack,
+		std::vector<unsigned int>& candidates,
+		std::vector<Scalarm>&      buffer,
+		std::vector<FacePair>&     pairs) const;
+
+	CMeshO& mesh;
+
+	std::vector<Node>         nodes;
+	std::vector<unsigned int> faces; // indices of the non deleted faces, in leaf order
+	std::vector<Box3m>        boxes; // per face
+
+	// per face vertex coordinates and plane (n . p = d), stored by component
+	std::vector<Scalarm> coords[9];
+	std::vector<Scalarm> planes[4];
+};
+
+} // namespace meshlab
+
+#endif // MESHLAB_SELF_INTERSECTIONS_H
@@ -161,6 +161,8 @@ void FilterDockDialog::on_applyPushButton_clicked()
 	}
 
 	if (isPreviewable() && isPreviewMeshStateValid && parameters == prevParams) {
+		// the filter is not executed again: the no-preview state is the one to undo
+		md->meshStateHistory().push(noPreviewMeshState);
 		previewMeshState.apply(mesh);
 		updateRenderingData(mw, mesh);
 	}
@@ -169,7 +171,7 @@ void FilterDockDialog::on_applyPushButton_clicked()
 
 	if (isPreviewable()) {
 		// save the no-preview state, after the filter was applied
-		noPreviewMeshState.create(mask, mesh);
+		noPreviewMeshState.create(mask, mesh, &previewMeshState);
 	}
 
 	if (currentGLArea)
@@ -205,8 +207,8 @@ void FilterDockDialog::applyDynamic()
 		noPreviewMeshState.apply(mesh);
 		// then, apply dynamically with the new parameters
 		mw->executeFilter(filter, parameters, true);
-		// save the preview state
-		previewMeshState.create(mask, mesh);
+		// save the preview state (only the pages changed by the filter are copied)
+		previewMeshState.create(mask, mesh, &noPreviewMeshState);
 		isPreviewMeshStateValid = true;
 
 		if (currentGLArea)
@@ -0,0 +1,259 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "filter_thread.h"
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <common/mlexception.h>
+#include <common/ml_document/mesh_document.h>
+
+namespace {
+
+bool inParallelRegion()
+{
+#ifdef _OPENMP
+	return omp_in_parallel() != 0;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Thrown by the callback of the running filter when the user asked to cancel
+ * it. It is caught only by FilterThread::run.
+ */
+class FilterCanceledException : public MLException
+{
+public:
+	FilterCanceledException() : MLException("Filter canceled by the user") {}
+	~FilterCanceledException() throw() {}
+};
+
+}
+
+std::atomic<FilterThread*> FilterThread::runningThread(nullptr);
+
+FilterThread::FilterThread(
+		FilterPlugin&            plugin,
+		const QAction*           action,
+		const RichParameterList& parameters,
+		MeshDocument&            md,
+		QObject*                 parent) :
+	QThread(parent),
+	filterPlugin(plugin),
+	filterAction(action),
+	params(parameters),
+	md(md),
+	canceled(false),
+	succeeded(false),
+	outOfMemory(false),
+	postCondMask(MeshModel::MM_UNKNOWN),
+	lastProgressTime(0)
+{
+}
+
+FilterThread::~FilterThread()
+{
+	wait();
+}
+
+/**
+ * @brief Saves a copy of the given meshes, that will be restored by rollback()
+ * if the filter is canceled or fails. Must be called before start().
+ */
+void FilterThread::saveRollbackState(const std::list<MeshModel*>& meshes)
+{
+	meshIdsBeforeFilter.clear();
+	for (const MeshModel& mm : md.meshIterator())
+		meshIdsBeforeFilter.push_back(mm.id());
+
+	rollbackState.clear();
+	for (MeshModel* mm : meshes) {
+		if (mm != nullptr) {
+			rollbackState.push_back(MeshRollbackState{
+				mm->id(), mm->dataMask(), mm->isVisible(), mm->label(), mm->cm, mm->getTextures()});
+		}
+	}
+}
+
+/**
+ * @brief Restores the document as it was before the filter started:
+ * - the layers created by the filter are removed;
+ * - the saved meshes are restored (a saved mesh deleted by the filter is
+ *   added again as a new layer).
+ * Must be called from the GUI thread, after the thread has finished.
+ */
+void FilterThread::rollback()
+{
+	std::vector<unsigned int> newMeshes;
+	for (const MeshModel& mm : md.meshIterator()) {
+		if (std::find(meshIdsBeforeFilter.begin(), meshIdsBeforeFilter.end(), mm.id()) == meshIdsBeforeFilter.end())
+			newMeshes.push_back(mm.id());
+	}
+	for (unsigned int id : newMeshes)
+		md.delMesh(id);
+
+	for (MeshRollbackState& s : rollbackState) {
+		MeshModel* mm = md.getMesh(s.id);
+		if (mm == nullptr) {
+			mm = md.addNewMesh(s.cm, s.label, false);
+		}
+		else {
+			// the swap of CMeshO does not exchange the per mesh data
+			Matrix44m tr = s.cm.Tr;
+			int svn = s.cm.svn, sfn = s.cm.sfn;
+			mm->cm = std::move(s.cm);
+			mm->cm.Tr = tr;
+			mm->cm.svn = svn;
+			mm->cm.sfn = sfn;
+		}
+		mm->updateDataMask();
+		mm->updateDataMask(s.dataMask);
+		mm->clearTextures();
+		for (const auto& t : s.textures)
+			mm->addTexture(t.first, t.second);
+		mm->setVisible(s.visible);
+	}
+	rollbackState.clear();
+}
+
+void FilterThread::setFrozenMeshIds(const std::vector<int>& ids)
+{
+	frozenIds = ids;
+}
+
+const std::vector<int>& FilterThread::frozenMeshIds() const
+{
+	return frozenIds;
+}
+
+/**
+ * @brief Asks the filter to stop. The filter will be interrupted the next
+ * time it reports its progress through the callback.
+ */
+void FilterThread::cancel()
+{
+	canceled = true;
+}
+
+bool FilterThread::isCanceled() const
+{
+	return canceled;
+}
+
+bool FilterThread::hasSucceeded() const
+{
+	return succeeded;
+}
+
+bool FilterThread::isOutOfMemory() const
+{
+	return outOfMemory;
+}
+
+const QString& FilterThread::errorMessage() const
+{
+	return error;
+}
+
+const QAction* FilterThread::action() const
+{
+	return filterAction;
+}
+
+FilterPlugin& FilterThread::plugin() const
+{
+	return filterPlugin;
+}
+
+unsigned int FilterThread::postConditionMask() const
+{
+	return postCondMask;
+}
+
+const std::map<std::string, QVariant>& FilterThread::outputValues() const
+{
+	return outValues;
+}
+
+qint64 FilterThread::elapsed() const
+{
+	return timer.elapsed();
+}
+
+void FilterThread::run()
+{
+	runningThread = this;
+	timer.start();
+	try {
+		outValues = filterPlugin.applyFilter(filterAction, params, md, postCondMask, filterCallBack);
+		if (postCondMask == MeshModel::MM_UNKNOWN)
+			postCondMask = filterPlugin.postCondition(filterAction);
+		md.compactMeshes();
+		succeeded = true;
+	}
+	catch (const FilterCanceledException& e) {
+		error = e.what();
+	}
+	catch (const std::bad_alloc& e) {
+		outOfMemory = true;
+		error = e.what();
+	}
+	catch (const MLException& e) {
+		error = e.what();
+	}
+	catch (const std::exception& e) {
+		error = e.what();
+	}
+	runningThread = nullptr;
+}
+
+/**
+ * @brief The vcg::CallBackPos given to the filter running in the thread.
+ * Progress is forwarded to the GUI (at most every 100 msec); if a cancel has
+ * been requested, the filter is interrupted by throwing an exception. The
+ * exception is thrown only in the filter thread, and outside of OpenMP
+ * parallel regions (whose master thread is the filter thread, but that cannot
+ * be left by an exception): elsewhere the callback just returns false.
+ */
+bool FilterThread::filterCallBack(const int pos, const char* str)
+{
+	FilterThread* ft = runningThread;
+	if (ft == nullptr)
+		return true;
+	if (ft->canceled) {
+		if (QThread::currentThread() == ft && !inParallelRegion())
+			throw FilterCanceledException();
+		return false;
+	}
+	qint64 now = ft->timer.elapsed();
+	qint64 last = ft->lastProgressTime;
+	if (now - last >= 100 && ft->lastProgressTime.compare_exchange_strong(last, now))
+		emit ft->progressUpdated(pos, QString(str));
+	return true;
+}
@@ -0,0 +1,127 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef MESHLAB_FILTER_THREAD_H
+#define MESHLAB_FILTER_THREAD_H
+
+#include <atomic>
+#include <list>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <common/plugins/interfaces/filter_plugin.h>
+
+/**
+ * @brief The FilterThread class runs the applyFilter function of a
+ * FilterPlugin on a worker thread, so that the GUI stays responsive while
+ * long filters are executed.
+ *
+ * The progress of the filter is reported through the usual
+ * vcg::CallBackPos mechanism: the callback passed to the filter forwards
+ * the progress to the GUI thread with the progressUpdated signal, and it
+ * is also the point where a cancel request is honored (the filter is
+ * interrupted the next time it calls the callback).
+ *
+ * Before starting, the meshes that the filter is going to modify can be
+ * saved with saveRollbackState(): if the filter is canceled or fails,
+ * rollback() restores them and removes the layers created by the filter.
+ *
+ * While the thread is running, the MeshDocument must not be accessed by the
+ * GUI thread: the viewers draw only the GPU buffers of the meshes listed in
+ * frozenMeshIds(), which is the read-only snapshot of the document taken
+ * when the filter started.
+ */
+class FilterThread : public QThread
+{
+	Q_OBJECT
+public:
+	FilterThread(
+		FilterPlugin&            plugin,
+		const QAction*           action,
+		const RichParameterList& parameters,
+		MeshDocument&            md,
+		QObject*                 parent = nullptr);
+	~FilterThread();
+
+	void saveRollbackState(const std::list<MeshModel*>& meshes);
+	void rollback();
+
+	void setFrozenMeshIds(const std::vector<int>& ids);
+	const std::vector<int>& frozenMeshIds() const;
+
+	void cancel();
+	bool isCanceled() const;
+	bool hasSucceeded() const;
+	bool isOutOfMemory() const;
+	const QString& errorMessage() const;
+
+	const QAction* action() const;
+	FilterPlugin& plugin() const;
+	unsigned int postConditionMask() const;
+	const std::map<std::string, QVariant>& outputValues() const;
+	qint64 elapsed() const;
+
+signals:
+	void progressUpdated(int pos, const QString& str);
+
+protected:
+	void run();
+
+private:
+	struct MeshRollbackState
+	{
+		int id;
+		int dataMask;
+		bool visible;
+		QString label;
+		CMeshO cm;
+		std::map<std::string, QImage> textures;
+	};
+
+	static bool filterCallBack(const int pos, const char* str);
+
+	static std::atomic<FilterThread*> runningThread;
+
+	FilterPlugin& filterPlugin;
+	const QAction* filterAction;
+	RichParameterList params;
+	MeshDocument& md;
+
+	std::list<MeshRollbackState> rollbackState;
+	std::vector<int> meshIdsBeforeFilter;
+	std::vector<int> frozenIds;
+
+	std::atomic<bool> canceled;
+	bool succeeded;
+	bool outOfMemory;
+	QString error;
+	unsigned int postCondMask;
+	std::map<std::string, QVariant> outValues;
+
+	QElapsedTimer timer;
+	std::atomic<qint64> lastProgressTime;
+};
+
+#endif // MESHLAB_FILTER_THREAD_H
@@ -435,6 +435,8 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
     if(!isValid())
         return;
 
+    const FilterThread* filterthread = (mw() != nullptr) ? mw()->runningFilterThread() : nullptr;
+
     QElapsedTimer time;
     time.start();
 
@@ -560,16 +562,45 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
 
         glPopAttrib();
     } ///end if busy
+    else if ((filterthread != nullptr) && (mvc() != nullptr) && (mvc()->sharedDataContext() != nullptr))
+    {
+        // A filter is running in background and the meshes cannot be read:
+        // only the buffers already allocated on the GPU for the meshes existing
+        // when the filter started are drawn (no decorators, no editing tools).
+        glPushAttrib(GL_ALL_ATTRIB_BITS);
+        MLSceneGLSharedDataContext* datacont = mvc()->sharedDataContext();
+        for (int id : filterthread->frozenMeshIds())
+        {
+            if (meshVisibilityMap[id])
+            {
+                MLRenderingData curr;
+                datacont->getRenderInfoPerMeshView(id, context(), curr);
+                MLPerViewGLOptions opts;
+                if (curr.get(opts) == false)
+                    continue;
+                setLightingColors(opts);
+                if (opts._back_face_cull)
+                    glEnable(GL_CULL_FACE);
+                else
+                    glDisable(GL_CULL_FACE);
+                datacont->draw(id, context());
+            }
+        }
+        glPopAttrib();
+    }
 
     glPopMatrix(); // We restore the state to immediately after the trackball (and before the bbox scaling/translating)
 
     if(trackBallVisible && !takeSnapTile && !(iEdit && !suspendedEditor))
         trackball.DrawPostApply();
 
-    foreach(QAction * p, iPerDocDecoratorlist)
+    if (filterthread == nullptr)
     {
-        DecoratePlugin * decorInterface = qobject_cast<DecoratePlugin *>(p->parent());
-        decorInterface->decorateDoc(p, *this->md(), this->glas.currentGlobalParamSet, this, &painter, md()->Log);
+        foreach(QAction * p, iPerDocDecoratorlist)
+        {
+            DecoratePlugin * decorInterface = qobject_cast<DecoratePlugin *>(p->parent());
+            decorInterface->decorateDoc(p, *this->md(), this->glas.currentGlobalParamSet, this, &painter, md()->Log);
+        }
     }
 
     // The picking of the surface position has to be done in object space,
@@ -655,7 +686,7 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
 
     // Draw the log area background
     // on the bottom of the glArea
-    if (infoAreaVisible)
+    if (infoAreaVisible && (filterthread == nullptr))
     {
         glPushAttrib(GL_ENABLE_BIT);
         glDisable(GL_DEPTH_TEST);
@@ -995,6 +1026,16 @@ void GLArea::saveSnapshot()
 	}
 }
 
+void GLArea::invalidateEditedMeshesHistory()
+{
+	if (md() == NULL || iEdit == NULL)
+		return;
+	if (!iEdit->isSingleMeshEdit())
+		md()->meshStateHistory().clear();
+	else if (lastModelEdited != NULL)
+		md()->meshStateHistory().removeMesh(lastModelEdited->id());
+}
+
 // Slot called when the current mesh has changed.
 void GLArea::manageCurrentMeshChange()
 {
@@ -1006,6 +1047,7 @@ void GLArea::manageCurrentMeshChange()
         // last model edited should always be set when start edit is called
 
         iEdit->layerChanged(*this->md(), *lastModelEdited, this,parentmultiview->sharedDataContext());
+        invalidateEditedMeshesHistory();
 
         //now update the last model edited
         //TODO this is not the best design....   iEdit should maybe keep track of the model on its own
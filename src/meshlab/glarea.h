@@ -236,6 +236,8 @@ public slots:
 
 			if (mm() != NULL)
 				iEdit->endEdit(*mm(), this, parentmultiview->sharedDataContext());
+
+			invalidateEditedMeshesHistory();
         }
 		
 		//MLSceneGLSharedDataContext* shared;
@@ -464,6 +466,9 @@ private:
     //the last model that start edit was called with
     MeshModel *lastModelEdited;
 
+    // the states saved in the undo history before the editor changed the meshes cannot be restored anymore
+    void invalidateEditedMeshesHistory();
+
 public:
 	inline MLSceneGLSharedDataContext* getSceneGLSharedContext()
 	{
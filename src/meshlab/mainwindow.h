@@ -31,13 +31,14 @@
 
 #include "common/plugins/plugin_manager.h"
 
-#include <wrap/qt/qt_thread_safe_memory_info.h>
+#include <common/ml_thread_safe_memory_info.h>
 
 #include "glarea.h"
 #include "layerDialog.h"
 #include "dialogs/filter_dock_dialog.h"
 #include "multiViewer_Container.h"
 #include "ml_render_gui.h"
+#include "filter_thread.h"
 
 #include <QDir>
 #include <QMainWindow>
@@ -62,6 +63,7 @@ class QProgressDialog;
 class QNetworkAccessManager;
 class QNetworkReply;
 class QToolBar;
+class QToolButton;
 
 class MainWindowSetting
 {
@@ -101,6 +103,21 @@ public:
 
 	bool sendAnonymousData;
 	inline static QString sendAnonymousDataParam() {return "MeshLab::System::sendAnonymousData"; }
+
+	bool backgroundFilters;
+	inline static QString backgroundFiltersParam() {return "MeshLab::System::backgroundFilters"; }
+
+	bool rollbackCanceledFilters;
+	inline static QString rollbackCanceledFiltersParam() {return "MeshLab::System::rollbackCanceledFilters"; }
+
+	unsigned int undoLevels;
+	inline static QString undoLevelsParam() {return "MeshLab::System::undoLevels"; }
+
+	size_t undoMemoryBudget;
+	inline static QString undoMemoryBudgetParam() {return "MeshLab::System::undoMemoryBudget"; }
+
+	std::ptrdiff_t maxSystemMemory;
+	inline static QString maxSystemMemoryParam() {return "MeshLab::System::maxSystemMemory"; }
 };
 
 class MainWindow : public QMainWindow
@@ -142,6 +159,7 @@ public slots:
 	void updateCustomSettings();
 	void updateLayerDialog();
 	void applyLastFilter();
+	void undoLastFilter();
 	bool addRenderingDataIfNewlyGeneratedMesh(int meshid);
 
 	void updateRenderingDataAccordingToActions(int meshid, const QList<MLRenderingAction*>& acts);
@@ -162,6 +180,8 @@ private slots:
 	void endEdit();
 	void updateProgressBar(const int pos,const QString& text);
 	void updateTexture(int meshid);
+	void filterThreadFinished();
+	void cancelFilterThread();
 public:
 
 	bool exportMesh(QString fileName,MeshModel* mod,const bool saveAllPossibleAttributes);
@@ -175,6 +195,7 @@ public:
 	unsigned int viewsRequiringRenderingActions(int meshid,MLRenderingAction* act);
 
 	void updateSharedContextDataAfterFilterExecution(int postcondmask,int fclasses,bool& newmeshcreated);
+	const FilterThread* runningFilterThread() const { return filterThread; }
 	void readViewFromFile(QString const& filename);
 
 private slots:
@@ -284,6 +305,13 @@ private:
 
 	void setCurrentMeshBestTab();
 
+	void startFilterThread(const QAction* action, const RichParameterList& params, const RichParameterList& mergedenvironment, bool saveOnHistory);
+	void postFilterExecution(const QAction* action, const RichParameterList& params, const RichParameterList& mergedenvironment, unsigned int postCondMask, bool saveOnHistory, qint64 elapsed, bool& newmeshcreated);
+	void updateViewsAfterFilterExecution(bool newmeshcreated);
+	bool saveUndoState(const QAction* action);
+	bool reserveFilterMemory(const QAction* action, const RichParameterList& mergedenvironment, bool background);
+	void releaseFilterMemory();
+
 
 	QNetworkAccessManager httpReq;
 	int idHost;
@@ -292,11 +320,23 @@ private:
 
 	FilterDockDialog* filterDockDialog;
 	static QProgressBar *qb;
+	QToolButton* cancelFilterButton;
+
+	// the filter running in background (nullptr if no filter is running)
+	FilterThread* filterThread;
+	RichParameterList filterThreadParams;
+	RichParameterList filterThreadEnvironment;
+	bool filterThreadSaveOnHistory;
+	bool filterThreadUndoSaved;
+	std::vector<int> filterThreadAddedMeshes;
+
+	// system memory reserved for the running filter
+	std::ptrdiff_t filterReservedMemory;
 
 	QMdiArea *mdiarea;
 	LayerDialog *layerDialog;
 	QSignalMapper *windowMapper;
-	vcg::QtThreadSafeMemoryInfo* gpumeminfo;
+	MLThreadSafeMemoryInfo* gpumeminfo;
 	QProgressBar* nvgpumeminfo;
 
 	/*
@@ -323,7 +363,7 @@ public:
 		return NULL;
 	}
 
-	inline vcg::QtThreadSafeMemoryInfo* memoryInfoManager() const {return gpumeminfo;}
+	inline MLThreadSafeMemoryInfo* memoryInfoManager() const {return gpumeminfo;}
 	const RichParameterList& currentGlobalPars() const { return currentGlobalParams; }
 	RichParameterList& currentGlobalPars() { return currentGlobalParams; }
 	const RichParameterList& defaultGlobalPars() const { return defaultGlobalParams; }
@@ -443,6 +483,7 @@ private:
 	QAction* exitAct;
 	//////
 	QAction* lastFilterAct;
+	QAction* undoFilterAct;
 	QAction* runFilterScriptAct;
 	QAction* showFilterScriptAct;
 	//QAction* showFilterEditAct;
@@ -22,6 +22,7 @@
  ****************************************************************************/
 
 #include <QToolBar>
+#include <QToolButton>
 #include <QProgressBar>
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -47,6 +48,11 @@ QProgressBar *MainWindow::qb;
 
 MainWindow::MainWindow() :
 		filterDockDialog(nullptr),
+		cancelFilterButton(nullptr),
+		filterThread(nullptr),
+		filterThreadSaveOnHistory(false),
+		filterThreadUndoSaved(false),
+		filterReservedMemory(0),
 		searcher(meshlab::actionSearcherInstance()),
 		httpReq(this),
 		gpumeminfo(NULL),
@@ -126,7 +132,7 @@ MainWindow::MainWindow() :
 	createActions();
 	createToolBars();
 	createMenus();
-	gpumeminfo = new vcg::QtThreadSafeMemoryInfo(mwsettings.maxgpumem);
+	gpumeminfo = new MLThreadSafeMemoryInfo(mwsettings.maxgpumem);
 	setAcceptDrops(true);
 	mdiarea->setAcceptDrops(true);
 	setWindowTitle(MeshLabApplication::shortName());
@@ -137,6 +143,12 @@ MainWindow::MainWindow() :
 	qb->setMinimum(0);
 	qb->reset();
 	statusBar()->addPermanentWidget(qb, 0);
+	cancelFilterButton = new QToolButton(this);
+	cancelFilterButton->setText(tr("Cancel"));
+	cancelFilterButton->setToolTip(tr("Cancel the filter running in background"));
+	cancelFilterButton->setVisible(false);
+	connect(cancelFilterButton, SIGNAL(clicked()), this, SLOT(cancelFilterThread()));
+	statusBar()->addPermanentWidget(cancelFilterButton, 0);
 
 	nvgpumeminfo = new QProgressBar(this);
     nvgpumeminfo->setStyleSheet(" QProgressBar { background-color: #d0d0d0; border: 2px solid grey; border-radius: 0px; text-align: center; }"
@@ -151,6 +163,10 @@ MainWindow::MainWindow() :
 
 MainWindow::~MainWindow()
 {
+	if (filterThread != nullptr) {
+		filterThread->cancel();
+		filterThread->wait();
+	}
 	delete gpumeminfo;
 }
 
@@ -433,6 +449,13 @@ connectRenderModeActionList(rendlist);*/
 	lastFilterAct->setEnabled(false);
 	connect(lastFilterAct, SIGNAL(triggered()), this, SLOT(applyLastFilter()));
 
+	undoFilterAct = new QAction(tr("Undo last filter"), this);
+	undoFilterAct->setShortcutContext(Qt::ApplicationShortcut);
+	undoFilterAct->setShortcut(Qt::CTRL + Qt::Key_Z);
+	undoFilterAct->setToolTip(tr("Restore the attributes changed by the last filter applied (only for the filters that do not change the topology of the mesh)."));
+	undoFilterAct->setEnabled(false);
+	connect(undoFilterAct, SIGNAL(triggered()), this, SLOT(undoLastFilter()));
+
 	showFilterScriptAct = new QAction(tr("Show current filter script"), this);
 	showFilterScriptAct->setEnabled(false);
 	connect(showFilterScriptAct, SIGNAL(triggered()), this, SLOT(showFilterScript()));
@@ -687,6 +710,7 @@ void MainWindow::fillFilterMenu()
 	clearMenu(filterMenu);
 	//filterMenu->clear();
 	filterMenu->addAction(lastFilterAct);
+	filterMenu->addAction(undoFilterAct);
 	filterMenu->addAction(showFilterScriptAct);
 	filterMenu->addSeparator();
 	//filterMenu->addMenu(new SearcherMenu(this,filterMenu));
@@ -1287,6 +1311,11 @@ void MainWindowSetting::initGlobalParameterList(RichParameterList& gbllist)
 	gbllist.addParam(RichString(meshSetNameParam(), "ms", "Name of the MeshSet object.", "Set the MeshSet name object in the PyMeshLab call copied in the clipboard from the filter dock dialog."));
 	gbllist.addParam(RichBool(checkForUpdateParam(), true, "Automatic online check for updated version of MeshLab", "If true, MeshLab periodically will check online if a new version has been released"));
 	gbllist.addParam(RichBool(sendAnonymousDataParam(), true, "Send anonymous and aggregate statistics", "If true, MeshLab periodically will send a few aggregated statistic of usage (number of opened and saved mesh and total number of vertices loaded)"));
+	gbllist.addParam(RichBool(backgroundFiltersParam(), true, "Run filters in background", "If true, the filters that do not need an OpenGL context are executed in a separate thread: the viewer stays responsive and the filter can be canceled from the status bar."));
+	gbllist.addParam(RichBool(rollbackCanceledFiltersParam(), true, "Restore meshes of canceled filters", "If true, a copy of the meshes processed by a filter running in background is kept, and restored if the filter is canceled or fails. Disable it to save memory when processing huge meshes."));
+	gbllist.addParam(RichInt(undoLevelsParam(), 10, "Undo levels", "Maximum number of filters that can be undone. Only the filters that change the attributes of a single mesh (e.g. positions, colors, selections) without changing its topology can be undone. Set it to 0 to disable the undo."));
+	gbllist.addParam(RichInt(undoMemoryBudgetParam(), 512, "Undo memory (in MB)", "Maximum memory used to store the undo history. Only the portions of the attributes changed by each filter are stored; when the budget is exceeded, the oldest filters cannot be undone anymore."));
+	gbllist.addParam(RichInt(maxSystemMemoryParam(), 0, "Maximum System Memory (in MB)", "Maximum system memory that can be used by the meshes and the filters. Before running a filter, the memory it needs is estimated from its input: if the budget would be exceeded, MeshLab asks before starting it. Set it to 0 to disable the check."));
 }
 
 void MainWindowSetting::updateGlobalParameterList(const RichParameterList& rpl)
@@ -1303,6 +1332,12 @@ void MainWindowSetting::updateGlobalParameterList(const RichParameterList& rpl)
 	meshSetName = rpl.getString(meshSetNameParam());
 	checkForUpdate = rpl.getBool(checkForUpdateParam());
 	sendAnonymousData = rpl.getBool(sendAnonymousDataParam());
+	backgroundFilters = rpl.getBool(backgroundFiltersParam());
+	rollbackCanceledFilters = rpl.getBool(rollbackCanceledFiltersParam());
+	undoLevels = (unsigned int) std::max(0, rpl.getInt(undoLevelsParam()));
+	undoMemoryBudget = (size_t) std::max(0, rpl.getInt(undoMemoryBudgetParam())) * (1024 * 1024);
+	maxSystemMemory = (std::ptrdiff_t) std::max(0, rpl.getInt(maxSystemMemoryParam())) * (1024 * 1024);
+	MLThreadSafeMemoryInfo::systemMemoryInfo().setTotalMemory(maxSystemMemory);
 }
 
 void MainWindow::defaultPerViewRenderingData(MLRenderingData& dt) const
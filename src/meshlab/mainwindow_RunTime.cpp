@@ -24,6 +24,7 @@
 
 
 #include "mainwindow.h"
+#include <algorithm>
 #include <exception>
 #include "ml_default_decorators.h"
 
@@ -103,6 +104,8 @@ void MainWindow::updateRecentProjActions()
 void MainWindow::updateCustomSettings()
 {
 	mwsettings.updateGlobalParameterList(currentGlobalParams);
+	if (gpumeminfo != NULL)
+		gpumeminfo->setTotalMemory(mwsettings.maxgpumem);
 	emit dispatchCustomSettings(currentGlobalParams);
 
 }
@@ -278,6 +281,10 @@ void MainWindow::updateLayerDialog()
 {
 	if ((meshDoc() == NULL) || ((layerDialog != NULL) && !(layerDialog->isVisible())))
 		return;
+	// the document cannot be read while a filter is running in background;
+	// the dialog is updated when the filter finishes
+	if (filterThread != nullptr)
+		return;
 	MultiViewer_Container* mvc = currentViewContainer();
 	if (mvc == NULL)
 		return;
@@ -333,11 +340,16 @@ void MainWindow::updateMenus()
 	
 	updateRecentFileActions();
 	updateRecentProjActions();
-	filterMenu->setEnabled(!filterMenu->actions().isEmpty());
+	// no other filter can be started while a filter is running in background
+	filterMenu->setEnabled(!filterMenu->actions().isEmpty() && filterThread == nullptr);
 	if (!filterMenu->actions().isEmpty())
-		updateSubFiltersMenu(GLA() != NULL,notEmptyActiveDoc);
+		updateSubFiltersMenu(GLA() != NULL && filterThread == nullptr, notEmptyActiveDoc && filterThread == nullptr);
 	lastFilterAct->setEnabled(false);
 	lastFilterAct->setText(QString("Apply filter"));
+	// an active editor may be changing the meshes: their history is invalidated when it ends
+	undoFilterAct->setEnabled(
+		activeDoc && filterThread == nullptr && (GLA() == nullptr || GLA()->getCurrentEditAction() == nullptr) &&
+		meshDoc()->meshStateHistory().canUndo());
 	editMenu->setEnabled(!editMenu->actions().isEmpty());
 	updateMenuItems(editMenu,activeDoc);
 	renderMenu->setEnabled(!renderMenu->actions().isEmpty());
@@ -672,7 +684,7 @@ void MainWindow::showFilterScript()
 
 void MainWindow::runFilterScript()
 {
-	if (meshDoc() == nullptr)
+	if (meshDoc() == nullptr || filterThread != nullptr)
 		return;
 	QString filterName;
 	try {
@@ -730,8 +742,7 @@ void MainWindow::runFilterScript()
 			iFilter->applyFilter(action, pair.second, *meshDoc(), postCondMask, QCallBack);
 			if (postCondMask == MeshModel::MM_UNKNOWN)
 				postCondMask = iFilter->postCondition(action);
-			for (MeshModel* mm = meshDoc()->nextMesh(); mm != NULL; mm = meshDoc()->nextMesh(mm))
-				vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm->cm);
+			meshDoc()->compactMeshes();
 			meshDoc()->setBusy(false);
 			if (shar != NULL)
 				shar->removeView(iFilter->glContext);
@@ -802,6 +813,10 @@ void MainWindow::startFilter(const QAction* action)
 {
 	if(currentViewContainer() == NULL) return;
 	if(GLA() == NULL) return;
+	if(filterThread != nullptr) {
+		MainWindow::globalStatusBar()->showMessage("Another filter is running. Wait for it to finish or cancel it.",5000);
+		return;
+	}
 	
 	// In order to avoid that a filter changes something assumed by the current editing tool,
 	// before actually starting the filter we close the current editing tool (if any).
@@ -1023,6 +1038,10 @@ from the user defined dialog
 void MainWindow::executeFilter(
 	const QAction* action, const RichParameterList& params, bool isPreview, bool saveOnHistory)
 {
+	if (filterThread != nullptr) {
+		MainWindow::globalStatusBar()->showMessage("Another filter is running. Wait for it to finish or cancel it.",5000);
+		return;
+	}
 	FilterPlugin *iFilter = qobject_cast<FilterPlugin *>(action->parent());
 	qb->show();
 	iFilter->setLog(&meshDoc()->Log);
@@ -1041,12 +1060,33 @@ void MainWindow::executeFilter(
 		meshDoc()->Log.clearBookmark();
 	else
 		meshDoc()->Log.backToBookmark();
+	RichParameterList mergedenvironment(params);
+	mergedenvironment.join(currentGlobalParams);
+
+	// Filters that do not need a gl context are executed in a separate thread.
+	// Previews of dynamic filters are always executed here, they must be fast and
+	// the dock dialog expects the result as soon as executeFilter returns
+	bool background = !isPreview && mwsettings.backgroundFilters && !iFilter->requiresGLContext(action);
+
+	if (!isPreview && !reserveFilterMemory(action, mergedenvironment, background)) {
+		MainWindow::globalStatusBar()->showMessage("Filter not started: memory budget exceeded.",5000);
+		return;
+	}
+
+	bool undoSaved = false;
+	if (!isPreview)
+		undoSaved = saveUndoState(action);
+
+	if (background) {
+		startFilterThread(action, params, mergedenvironment, saveOnHistory);
+		filterThreadUndoSaved = undoSaved;
+		return;
+	}
+
 	// (4) Apply the Filter
 	qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
 	QElapsedTimer tt; tt.start();
 	meshDoc()->setBusy(true);
-	RichParameterList mergedenvironment(params);
-	mergedenvironment.join(currentGlobalParams);
 	
 	MLSceneGLSharedDataContext* shar = NULL;
 	QGLWidget* filterWidget = NULL;
@@ -1089,8 +1129,7 @@ void MainWindow::executeFilter(
 		iFilter->applyFilter(action, mergedenvironment, *(meshDoc()), postCondMask, QCallBack);
 		if (postCondMask == MeshModel::MM_UNKNOWN)
 			postCondMask = iFilter->postCondition(action);
-		for (MeshModel& mm : meshDoc()->meshIterator())
-			vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm.cm);
+		meshDoc()->compactMeshes();
 		
 		if (shar != NULL) {
 			shar->removeView(iFilter->glContext);
@@ -1101,113 +1140,395 @@ void MainWindow::executeFilter(
 		
 		qApp->restoreOverrideCursor();
 		
-		// (5) Apply post filter actions (e.g. recompute non updated stuff if needed)
-		
-		meshDoc()->Log.logf(GLLogStream::SYSTEM,"Applied filter %s in %i msec",qUtf8Printable(action->text()),tt.elapsed());
-		if (meshDoc()->mm() != NULL)
-			meshDoc()->mm()->setMeshModified();
-		MainWindow::globalStatusBar()->showMessage("Filter successfully completed...",2000);
-		if(GLA()) {
-			GLA()->setLastAppliedFilter(action);
-		}
-		lastFilterAct->setText(QString("Apply filter ") + action->text());
-		lastFilterAct->setEnabled(true);
+		postFilterExecution(action, params, mergedenvironment, postCondMask, saveOnHistory, tt.elapsed(), newmeshcreated);
+	}
+	catch (const std::bad_alloc& bdall) {
+		meshDoc()->setBusy(false);
+		qApp->restoreOverrideCursor();
+		QMessageBox::warning(
+					this, tr("Filter Failure"),
+					QString("Operating system was not able to allocate the requested memory.<br><b>"
+					"Failure of filter <font color=red>: '%1'</font><br>").arg(action->text())+bdall.what()); // text
+		MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
+	}
+	catch(const MLException& exc){
+		meshDoc()->setBusy(false);
+		qApp->restoreOverrideCursor();
+		QMessageBox::warning(
+				this,
+				tr("Filter Failure"),
+				"Failure of filter <font color=red>: '" + iFilter->filterName(action) + "'</font><br><br>" + exc.what());
+		meshDoc()->Log.log(GLLogStream::SYSTEM, iFilter->filterName(action) + " failed: " + exc.what());
+		MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
+	}
+	releaseFilterMemory();
 
-		
-		
-		FilterPlugin::FilterArity arity = iFilter->filterArity(action);
-		QList<MeshModel*> tmp;
-		switch(arity)
+	updateViewsAfterFilterExecution(newmeshcreated);
+}
+
+/*
+Checks that the memory needed by the filter (as estimated by the filter itself,
+plus the copy of its input kept to restore it if a background filter is
+canceled) fits in the system memory budget, together with the meshes of the
+document. If it does, the memory is reserved until releaseFilterMemory is
+called; otherwise the user is asked whether to run the filter anyway.
+Returns false if the filter must not be started.
+*/
+bool MainWindow::reserveFilterMemory(const QAction* action, const RichParameterList& mergedenvironment, bool background)
+{
+	MLThreadSafeMemoryInfo& meminfo = MLThreadSafeMemoryInfo::systemMemoryInfo();
+	filterReservedMemory = 0;
+	if (!meminfo.isLimited())
+		return true;
+
+	FilterPlugin *iFilter = qobject_cast<FilterPlugin *>(action->parent());
+	std::ptrdiff_t needed = iFilter->estimatedPeakMemory(action, mergedenvironment, *meshDoc());
+	if (background && mwsettings.rollbackCanceledFilters)
+		needed += iFilter->FilterPlugin::estimatedPeakMemory(action, mergedenvironment, *meshDoc());
+	std::ptrdiff_t documentMemory = meshDoc()->memoryFootprint();
+
+	if (meminfo.isAdditionalMemoryAvailable(documentMemory + needed) && meminfo.tryAcquireMemory(needed)) {
+		filterReservedMemory = needed;
+		return true;
+	}
+
+	const double mb = 1024 * 1024;
+	QMessageBox::StandardButton ret = QMessageBox::question(
+				this, tr("Memory Budget Exceeded"),
+				QString("Filter <b>%1</b> may need about %2 MB, but only %3 MB of the %4 MB budget are available "
+						"(the meshes of the project take %5 MB).<br><br>Run it anyway?")
+				.arg(action->text())
+				.arg(needed / mb, 0, 'f', 0)
+				.arg(std::max<std::ptrdiff_t>(meminfo.currentFreeMemory() - documentMemory, 0) / mb, 0, 'f', 0)
+				.arg(meminfo.totalMemory() / mb, 0, 'f', 0)
+				.arg(documentMemory / mb, 0, 'f', 0),
+				QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+	return ret == QMessageBox::Yes;
+}
+
+void MainWindow::releaseFilterMemory()
+{
+	MLThreadSafeMemoryInfo::systemMemoryInfo().releasedMemory(filterReservedMemory);
+	filterReservedMemory = 0;
+}
+
+/*
+Starts the execution of the filter in a FilterThread.
+The document is marked as busy until the thread has finished: the viewers keep
+drawing the buffers already allocated on the GPU for the meshes that exist now,
+and the rest of the post filter actions is done by filterThreadFinished.
+*/
+void MainWindow::startFilterThread(
+	const QAction* action, const RichParameterList& params, const RichParameterList& mergedenvironment, bool saveOnHistory)
+{
+	FilterPlugin *iFilter = qobject_cast<FilterPlugin *>(action->parent());
+	iFilter->glContext = nullptr;
+
+	meshDoc()->meshDocStateData().clear();
+	meshDoc()->meshDocStateData().create(*meshDoc());
+
+	filterThread = new FilterThread(*iFilter, action, mergedenvironment, *meshDoc(), this);
+	filterThreadParams = params;
+	filterThreadEnvironment = mergedenvironment;
+	filterThreadSaveOnHistory = saveOnHistory;
+	filterThreadUndoSaved = false;
+	filterThreadAddedMeshes.clear();
+
+	if (mwsettings.rollbackCanceledFilters) {
+		std::list<MeshModel*> processed;
+		switch(iFilter->filterArity(action))
 		{
 		case (FilterPlugin::SINGLE_MESH):
-		{
-			tmp.push_back(meshDoc()->mm());
+			processed.push_back(meshDoc()->mm());
 			break;
-		}
 		case (FilterPlugin::FIXED):
-		{
-			for(const RichParameter& p : mergedenvironment)
-			{
-				if (p.isOfType<RichMesh>())
-				{
+			for(const RichParameter& p : mergedenvironment) {
+				if (p.isOfType<RichMesh>()) {
 					MeshModel* mm = meshDoc()->getMesh(p.value().getInt());
-					if (mm != NULL)
-						tmp.push_back(mm);
+					if (mm != NULL && std::find(processed.begin(), processed.end(), mm) == processed.end())
+						processed.push_back(mm);
 				}
 			}
 			break;
-		}
 		case (FilterPlugin::VARIABLE):
-		{
-			for(MeshModel* mm = meshDoc()->nextMesh();mm != NULL;mm=meshDoc()->nextMesh(mm))
-			{
-				if (mm->isVisible())
-					tmp.push_back(mm);
+			for(MeshModel& mm : meshDoc()->meshIterator()) {
+				if (mm.isVisible())
+					processed.push_back(&mm);
 			}
 			break;
-		}
 		default:
 			break;
 		}
-		
-		if(iFilter->getClass(action) & FilterPlugin::MeshCreation )
-			GLA()->resetTrackBall();
-		
-		for(int jj = 0;jj < tmp.size();++jj) {
-			MeshModel* mm = tmp[jj];
-			if (mm != NULL) {
-				// at the end for filters that change the color, or selection set the appropriate rendering mode
-				if(iFilter->getClass(action) & FilterPlugin::FaceColoring )
-					mm->updateDataMask(MeshModel::MM_FACECOLOR);
-				
-				if(iFilter->getClass(action) & FilterPlugin::VertexColoring )
-					mm->updateDataMask(MeshModel::MM_VERTCOLOR);
-				
-				if(iFilter->getClass(action) & FilterPlugin::MeshColoring )
-					mm->updateDataMask(MeshModel::MM_COLOR);
-				
-				if(postCondMask & MeshModel::MM_CAMERA)
-					mm->updateDataMask(MeshModel::MM_CAMERA);
-				
-				if(iFilter->getClass(action) & FilterPlugin::Texture )
-					updateTexture(mm->id());
-			}
+		try {
+			filterThread->saveRollbackState(processed);
 		}
-		
-		int fclasses =	iFilter->getClass(action);
-		//MLSceneGLSharedDataContext* sharedcont = GLA()->getSceneGLSharedContext();
-		
-		updateSharedContextDataAfterFilterExecution(postCondMask,fclasses,newmeshcreated);
+		catch (const std::bad_alloc&) {
+			filterThread->saveRollbackState(std::list<MeshModel*>());
+			meshDoc()->Log.log(GLLogStream::WARNING, "Not enough memory to save a copy of the meshes: the filter cannot be undone if canceled.");
+		}
+	}
+
+	std::vector<int> frozen;
+	MultiViewer_Container* mvc = currentViewContainer();
+	if (mvc != nullptr && mvc->sharedDataContext() != nullptr) {
+		for (const MeshModel& mm : meshDoc()->meshIterator()) {
+			if (mvc->sharedDataContext()->isBORenderingAvailable(mm.id()))
+				frozen.push_back(mm.id());
+		}
+	}
+	filterThread->setFrozenMeshIds(frozen);
+
+	connect(filterThread, SIGNAL(progressUpdated(int, QString)), this, SLOT(updateProgressBar(int, QString)));
+	connect(filterThread, SIGNAL(finished()), this, SLOT(filterThreadFinished()));
+
+	closeFilterDockDialog();
+	meshDoc()->setBusy(true);
+	cancelFilterButton->setEnabled(true);
+	cancelFilterButton->setVisible(true);
+	MainWindow::globalStatusBar()->showMessage("Running filter " + action->text() + "...", 5000);
+	updateMenus();
+	filterThread->start();
+}
+
+void MainWindow::cancelFilterThread()
+{
+	if (filterThread != nullptr) {
+		filterThread->cancel();
+		cancelFilterButton->setEnabled(false);
+		MainWindow::globalStatusBar()->showMessage("Canceling filter...", 5000);
+	}
+}
+
+void MainWindow::filterThreadFinished()
+{
+	if (filterThread == nullptr)
+		return;
+	FilterThread* ft = filterThread;
+	filterThread = nullptr;
+	cancelFilterButton->setVisible(false);
+	meshDoc()->setBusy(false);
+
+	const QAction* action = ft->action();
+	FilterPlugin& iFilter = ft->plugin();
+
+	// the meshes added by the filter have not been registered in the shared
+	// context while the thread was running
+	for (int id : filterThreadAddedMeshes)
+		meshAdded(id);
+	filterThreadAddedMeshes.clear();
+
+	bool newmeshcreated = false;
+	if (ft->hasSucceeded()) {
+		try {
+			postFilterExecution(action, filterThreadParams, filterThreadEnvironment, ft->postConditionMask(), filterThreadSaveOnHistory, ft->elapsed(), newmeshcreated);
+		}
+		catch(const MLException& exc){
+			meshDoc()->Log.log(GLLogStream::SYSTEM, iFilter.filterName(action) + " failed: " + exc.what());
+			MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
+		}
+	}
+	else {
+		ft->rollback();
+		// the meshes have been restored, there is nothing to undo
+		if (filterThreadUndoSaved && mwsettings.rollbackCanceledFilters)
+			meshDoc()->meshStateHistory().discardLast();
 		meshDoc()->meshDocStateData().clear();
+		meshDoc()->meshDocStateData().create(*meshDoc());
+		updateSharedContextDataAfterFilterExecution(MeshModel::MM_ALL, 0, newmeshcreated);
+		meshDoc()->meshDocStateData().clear();
+		if (ft->isCanceled()) {
+			meshDoc()->Log.log(GLLogStream::SYSTEM, iFilter.filterName(action) + " canceled");
+			MainWindow::globalStatusBar()->showMessage("Filter canceled...",2000);
+		}
+		else {
+			if (ft->isOutOfMemory()) {
+				QMessageBox::warning(
+						this, tr("Filter Failure"),
+						QString("Operating system was not able to allocate the requested memory.<br><b>"
+						"Failure of filter <font color=red>: '%1'</font><br>").arg(action->text())+ft->errorMessage());
+			}
+			else {
+				QMessageBox::warning(
+						this,
+						tr("Filter Failure"),
+						"Failure of filter <font color=red>: '" + iFilter.filterName(action) + "'</font><br><br>" + ft->errorMessage());
+			}
+			meshDoc()->Log.log(GLLogStream::SYSTEM, iFilter.filterName(action) + " failed: " + ft->errorMessage());
+			MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
+		}
+	}
+	ft->deleteLater();
+	releaseFilterMemory();
+	updateViewsAfterFilterExecution(newmeshcreated);
+	updateLog();
+}
 
-		if (saveOnHistory){
-			//Insert the filter to filterHistory
-			FilterNameParameterValuesPair tmp;
-			tmp.first = action->text();
-			tmp.second = params;
-			meshDoc()->filterHistory.append(tmp);
+/*
+Post filter actions common to the filters executed in the GUI thread and in
+background (e.g. recompute non updated stuff if needed, update rendering data).
+*/
+void MainWindow::postFilterExecution(
+	const QAction* action,
+	const RichParameterList& params,
+	const RichParameterList& mergedenvironment,
+	unsigned int postCondMask,
+	bool saveOnHistory,
+	qint64 elapsed,
+	bool& newmeshcreated)
+{
+	FilterPlugin *iFilter = qobject_cast<FilterPlugin *>(action->parent());
+
+	// (5) Apply post filter actions (e.g. recompute non updated stuff if needed)
+	
+	meshDoc()->Log.logf(GLLogStream::SYSTEM,"Applied filter %s in %i msec",qUtf8Printable(action->text()),(int)elapsed);
+	if (meshDoc()->mm() != NULL)
+		meshDoc()->mm()->setMeshModified();
+	MainWindow::globalStatusBar()->showMessage("Filter successfully completed...",2000);
+	if(GLA()) {
+		GLA()->setLastAppliedFilter(action);
+	}
+	lastFilterAct->setText(QString("Apply filter ") + action->text());
+	lastFilterAct->setEnabled(true);
+
+	
+	
+	FilterPlugin::FilterArity arity = iFilter->filterArity(action);
+	QList<MeshModel*> tmp;
+	switch(arity)
+	{
+	case (FilterPlugin::SINGLE_MESH):
+	{
+		tmp.push_back(meshDoc()->mm());
+		break;
+	}
+	case (FilterPlugin::FIXED):
+	{
+		for(const RichParameter& p : mergedenvironment)
+		{
+			if (p.isOfType<RichMesh>())
+			{
+				MeshModel* mm = meshDoc()->getMesh(p.value().getInt());
+				if (mm != NULL)
+					tmp.push_back(mm);
+			}
 		}
+		break;
 	}
-	catch (const std::bad_alloc& bdall) {
-		meshDoc()->setBusy(false);
-		qApp->restoreOverrideCursor();
-		QMessageBox::warning(
-					this, tr("Filter Failure"),
-					QString("Operating system was not able to allocate the requested memory.<br><b>"
-					"Failure of filter <font color=red>: '%1'</font><br>").arg(action->text())+bdall.what()); // text
-		MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
+	case (FilterPlugin::VARIABLE):
+	{
+		for(MeshModel* mm = meshDoc()->nextMesh();mm != NULL;mm=meshDoc()->nextMesh(mm))
+		{
+			if (mm->isVisible())
+				tmp.push_back(mm);
+		}
+		break;
 	}
-	catch(const MLException& exc){
-		meshDoc()->setBusy(false);
-		qApp->restoreOverrideCursor();
-		QMessageBox::warning(
-				this,
-				tr("Filter Failure"),
-				"Failure of filter <font color=red>: '" + iFilter->filterName(action) + "'</font><br><br>" + exc.what());
-		meshDoc()->Log.log(GLLogStream::SYSTEM, iFilter->filterName(action) + " failed: " + exc.what());
-		MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
+	default:
+		break;
+	}
+	
+	if((iFilter->getClass(action) & FilterPlugin::MeshCreation) && GLA())
+		GLA()->resetTrackBall();
+	
+	for(int jj = 0;jj < tmp.size();++jj) {
+		MeshModel* mm = tmp[jj];
+		if (mm != NULL) {
+			// at the end for filters that change the color, or selection set the appropriate rendering mode
+			if(iFilter->getClass(action) & FilterPlugin::FaceColoring )
+				mm->updateDataMask(MeshModel::MM_FACECOLOR);
+			
+			if(iFilter->getClass(action) & FilterPlugin::VertexColoring )
+				mm->updateDataMask(MeshModel::MM_VERTCOLOR);
+			
+			if(iFilter->getClass(action) & FilterPlugin::MeshColoring )
+				mm->updateDataMask(MeshModel::MM_COLOR);
+			
+			if(postCondMask & MeshModel::MM_CAMERA)
+				mm->updateDataMask(MeshModel::MM_CAMERA);
+			
+			if(iFilter->getClass(action) & FilterPlugin::Texture )
+				updateTexture(mm->id());
+		}
+	}
+	
+	// the filter changed something that cannot be restored: the previous states are no more valid
+	if (postCondMask != MeshModel::MM_NONE && !MeshModelState::isSupported(postCondMask))
+		meshDoc()->meshStateHistory().clear();
+
+	int fclasses =	iFilter->getClass(action);
+	//MLSceneGLSharedDataContext* sharedcont = GLA()->getSceneGLSharedContext();
+	
+	updateSharedContextDataAfterFilterExecution(postCondMask,fclasses,newmeshcreated);
+	meshDoc()->meshDocStateData().clear();
+
+	if (saveOnHistory){
+		//Insert the filter to filterHistory
+		FilterNameParameterValuesPair tmp;
+		tmp.first = action->text();
+		tmp.second = params;
+		meshDoc()->filterHistory.append(tmp);
+	}
+}
+
+/*
+Saves in the undo history of the document the state of the attributes of the current mesh
+that are going to be changed by the filter. When the filter changes something that cannot be
+saved (e.g. the topology, or more than one mesh), the filters applied before it cannot be
+undone anymore and the history is cleared.
+Returns true if the state has been saved.
+*/
+bool MainWindow::saveUndoState(const QAction* action)
+{
+	FilterPlugin *iFilter = qobject_cast<FilterPlugin *>(action->parent());
+	MeshModelStateHistory& history = meshDoc()->meshStateHistory();
+	history.setLimits(mwsettings.undoLevels, mwsettings.undoMemoryBudget);
+
+	int mask = iFilter->postCondition(action);
+	if (mask == MeshModel::MM_NONE)
+		return false;
+	if (iFilter->filterArity(action) != FilterPlugin::SINGLE_MESH || meshDoc()->mm() == nullptr ||
+		!MeshModelState::isSupported(mask)) {
+		history.clear();
+		return false;
+	}
+	if (!history.push(mask, meshDoc()->mm())) {
+		if (mwsettings.undoLevels > 0)
+			meshDoc()->Log.log(GLLogStream::WARNING, "Not enough undo memory: the filter cannot be undone.");
+		return false;
+	}
+	return true;
+}
+
+void MainWindow::undoLastFilter()
+{
+	if (meshDoc() == nullptr || meshDoc()->isBusy() || filterThread != nullptr)
+		return;
+	MeshModelStateHistory& history = meshDoc()->meshStateHistory();
+	if (!history.canUndo()) {
+		MainWindow::globalStatusBar()->showMessage("Nothing to undo", 2000);
+		return;
 	}
+	closeFilterDockDialog();
+	MeshModel* mm = meshDoc()->getMesh(history.lastMeshId());
+	if (mm == nullptr || !history.undo(mm)) {
+		MainWindow::globalStatusBar()->showMessage("The last filter cannot be undone", 2000);
+		updateMenus();
+		return;
+	}
+	vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);
+	mm->setMeshModified();
+	MultiViewer_Container* mvc = currentViewContainer();
+	if (mvc != nullptr && mvc->sharedDataContext() != nullptr) {
+		mvc->sharedDataContext()->meshAttributesUpdated(mm->id(), true, MLRenderingData::RendAtts(true));
+		mvc->sharedDataContext()->manageBuffers(mm->id());
+	}
+	meshDoc()->Log.log(GLLogStream::SYSTEM, "Undo last filter on " + mm->label());
+	MainWindow::globalStatusBar()->showMessage("Undo done", 2000);
+	updateViewsAfterFilterExecution(false);
+}
 
+void MainWindow::updateViewsAfterFilterExecution(bool newmeshcreated)
+{
 	qb->reset();
 	layerDialog->setVisible(layerDialog->isVisible() || ((newmeshcreated) && (meshDoc()->meshNumber() > 0)));
 	updateLayerDialog();
@@ -1242,7 +1563,7 @@ void MainWindow::suspendEditMode()
 }
 void MainWindow::applyEditMode()
 {
-	if(!GLA()) { //prevents crash without mesh
+	if(!GLA() || meshDoc()->isBusy()) { //prevents crash without mesh or while a filter is running
 		QAction *action = qobject_cast<QAction *>(sender());
 		action->setChecked(false);
 		return;
@@ -2229,6 +2550,8 @@ void MainWindow::reloadAllMesh()
 						isReload[i] = false;
 					i++;
 				}
+				for (MeshModel* m : meshList)
+					meshDoc()->meshStateHistory().removeMesh(m->id());
 				try {
 					meshlab::reloadMesh(fileName, meshList, &meshDoc()->Log, QCallBack);
 					for (MeshModel* m : meshList){
@@ -2286,6 +2609,9 @@ void MainWindow::reload()
 		i++;
 	}
 
+	// the states saved before the reload cannot be applied to the reloaded meshes
+	for (MeshModel* m : meshList)
+		meshDoc()->meshStateHistory().removeMesh(m->id());
 	try {
 		QElapsedTimer t;
 		t.start();
@@ -2774,6 +3100,12 @@ void MainWindow::showEvent(QShowEvent * event)
 
 void MainWindow::meshAdded(int mid)
 {
+	// meshes added by a filter running in background are registered in the
+	// shared context when the filter finishes
+	if (filterThread != nullptr) {
+		filterThreadAddedMeshes.push_back(mid);
+		return;
+	}
 	MultiViewer_Container* mvc = currentViewContainer();
 	if (mvc != NULL)
 	{
@@ -3120,7 +3452,11 @@ unsigned int MainWindow::viewsRequiringRenderingActions(int meshid, MLRenderingA
 
 void MainWindow::updateLog()
 {
+	if (filterThread != nullptr)
+		return;
 	GLLogStream* senderlog = qobject_cast<GLLogStream*>(sender());
+	if ((senderlog == NULL) && (meshDoc() != NULL))
+		senderlog = &meshDoc()->Log;
 	if ((senderlog != NULL) && (layerDialog != NULL))
 		layerDialog->updateLog(*senderlog);
 }
@@ -48,7 +48,7 @@ MultiViewer_Container *Splitter::getRootContainer()
 	return mvc;
 }
 
-MultiViewer_Container::MultiViewer_Container(vcg::QtThreadSafeMemoryInfo& meminfo, bool highprec,size_t perbatchprimitives, size_t minfacespersmoothrendering,QWidget *parent)
+MultiViewer_Container::MultiViewer_Container(MLThreadSafeMemoryInfo& meminfo, bool highprec,size_t perbatchprimitives, size_t minfacespersmoothrendering,QWidget *parent)
     : Splitter(parent),meshDoc()
 {
 	setChildrenCollapsible(false);
@@ -340,6 +340,12 @@ void MultiViewer_Container::updateTrackballInViewers()
 
 void MultiViewer_Container::closeEvent( QCloseEvent *event )
 {
+	if (meshDoc.isBusy())
+	{
+		QMessageBox::warning(this, tr("MeshLab"), tr("Project '%1' is being processed by a filter.\nCancel the filter before closing the project.").arg(meshDoc.docLabel()));
+		event->ignore();
+		return;
+	}
 	if (meshDoc.hasBeenModified())
 	{
 		QMessageBox::StandardButton ret=QMessageBox::question(
@@ -33,6 +33,7 @@
 
 #include <common/ml_document/mesh_document.h>
 #include <common/ml_shared_data_context/ml_shared_data_context.h>
+#include <common/ml_thread_safe_memory_info.h>
 
 // Class list
 class GLArea;
@@ -62,7 +63,7 @@ class MultiViewer_Container : public Splitter
         typedef vcg::Shot<double> Shot;
 
 public:
-    MultiViewer_Container(vcg::QtThreadSafeMemoryInfo& meminfo,bool highprec,size_t perbatchprimitives,size_t minfacesforsmoothrendering,QWidget *parent);
+    MultiViewer_Container(MLThreadSafeMemoryInfo& meminfo,bool highprec,size_t perbatchprimitives,size_t minfacesforsmoothrendering,QWidget *parent);
     ~MultiViewer_Container();
 
 	bool isMultiViewerContainer() const { return true; }
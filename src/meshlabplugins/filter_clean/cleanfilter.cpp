@@ -22,6 +22,7 @@
  ****************************************************************************/
 
 #include "cleanfilter.h"
+#include "parallel_ball_pivoting.h"
 
 #include <QCoreApplication>
 #include <vcg/complex/algorithms/clean.h>
@@ -295,6 +296,13 @@ RichParameterList CleanFilter::initParameterList(const QAction* action, const Me
 			"if true all the initial faces of the mesh are deleted and the whole surface is "
 			"rebuilt from scratch. Otherwise the current faces are used as a starting point. "
 			"Useful if you run the algorithm multiple times with an increasing ball radius."));
+		parlst.addParam(RichBool(
+			"Parallel",
+			false,
+			"Parallel reconstruction",
+			"If true the point cloud is split in slabs that are reconstructed concurrently; a "
+			"last pass closes the seams between them. Ignored if the mesh already has faces "
+			"that are not deleted."));
 		break;
 	case FP_REMOVE_ISOLATED_DIAMETER:
 		parlst.addParam(RichPercentage(
@@ -431,10 +439,15 @@ std::map<std::string, QVariant> CleanFilter::applyFilter(
 			m.cm.face.resize(0);
 		}
 		m.updateDataMask(MeshModel::MM_VERTFACETOPO);
-		int                       startingFn = m.cm.fn;
-		tri::BallPivoting<CMeshO> pivot(m.cm, Radius, Clustering, CreaseThr);
-		// the main processing
-		pivot.BuildMesh(cb);
+		int startingFn = m.cm.fn;
+		if (par.getBool("Parallel") && startingFn == 0) {
+			ParallelBallPivoting(m.cm, Radius, Clustering, CreaseThr, cb);
+		}
+		else {
+			tri::BallPivoting<CMeshO> pivot(m.cm, Radius, Clustering, CreaseThr);
+			// the main processing
+			pivot.BuildMesh(cb);
+		}
 		m.clearDataMask(MeshModel::MM_FACEFACETOPO);
 		log("Reconstructed surface. Added %i faces", m.cm.fn - startingFn);
 	} break;
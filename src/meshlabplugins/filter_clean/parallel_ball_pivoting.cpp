@@ -0,0 +1,243 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#include "parallel_ball_pivoting.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <common/utilities/parallel.h>
+
+#include <vcg/complex/algorithms/create/ball_pivoting.h>
+#include <vcg/complex/algorithms/update/topology.h>
+
+namespace {
+
+// The bit flags reserved by BallPivoting are static members of the vertex
+// type: each concurrent reconstruction uses the mesh type of its own SLOT.
+const int MAX_PARALLEL_SESSIONS = 16;
+
+// slabs with fewer points are not worth a separate reconstruction
+const std::size_t MIN_SLAB_POINTS = 4096;
+
+template <int SLOT>
+class SlabVertex;
+template <int SLOT>
+class SlabFace;
+
+template <int SLOT>
+class SlabUsedTypes :
+		public vcg::UsedTypes<
+			vcg::Use<SlabVertex<SLOT>>::template AsVertexType,
+			vcg::Use<SlabFace<SLOT>>::template AsFaceType>
+{
+};
+
+template <int SLOT>
+class SlabVertex :
+		public vcg::Vertex<
+			SlabUsedTypes<SLOT>,
+			vcg::vertex::Coord3m,
+			vcg::vertex::Normal3m,
+			vcg::vertex::BitFlags,
+			vcg::vertex::Mark,
+			vcg::vertex::VFAdj>
+{
+};
+
+template <int SLOT>
+class SlabFace :
+		public vcg::Face<
+			SlabUsedTypes<SLOT>,
+			vcg::face::VertexRef,
+			vcg::face::Normal3m,
+			vcg::face::BitFlags,
+			vcg::face::Mark,
+			vcg::face::VFAdj>
+{
+};
+
+template <int SLOT>
+class SlabMesh :
+		public vcg::tri::TriMesh<std::vector<SlabVertex<SLOT>>, std::vector<SlabFace<SLOT>>>
+{
+};
+
+struct Slab
+{
+	std::size_t begin = 0, end = 0; // range of the sorted points, margins included
+	Scalarm     lo = 0, hi = 0;     // a face belongs to the slab if its vertices are in [lo, hi)
+	std::vector<std::array<unsigned int, 3>> faces; // indices of the vertices of the mesh
+};
+
+/**
+ * Reconstructs the points of the slab (margins included) in a separate mesh
+ * and keeps the faces that belong to the slab.
+ */
+template <int SLOT>
+void pivotSlab(
+	Slab&                            slab,
+	const CMeshO&                    m,
+	const std::vector<unsigned int>& sorted,
+	int                              axis,
+	Scalarm                          radius,
+	Scalarm                          clustering,
+	Scalarm                          creaseThr)
+{
+	typedef SlabMesh<SLOT> MeshType;
+
+	MeshType sm;
+	vcg::tri::Allocator<MeshType>::AddVertices(sm, slab.end - slab.begin);
+	for (std::size_t i = slab.begin; i < slab.end; ++i) {
+		const CVertexO& v = m.vert[sorted[i]];
+		sm.vert[i - slab.begin].P() = v.cP();
+		sm.vert[i - slab.begin].N() = v.cN();
+	}
+	vcg::tri::UpdateBounding<MeshType>::Box(sm);
+
+	vcg::tri::BallPivoting<MeshType> pivot(sm, radius, clustering, creaseThr);
+	pivot.BuildMesh();
+
+	for (const auto& f : sm.face) {
+		if (f.IsD())
+			continue;
+		std::array<unsigned int, 3> face;
+		bool                        inside = true;
+		for (int j = 0; j < 3 && inside; ++j) {
+			face[j]         = sorted[slab.begin + vcg::tri::Index(sm, f.cV(j))];
+			const Scalarm c = m.vert[face[j]].cP()[axis];
+			inside          = c >= slab.lo && c < slab.hi;
+		}
+		if (inside)
+			slab.faces.push_back(face);
+	}
+}
+
+typedef void (*SlabPivoter)(
+	Slab&, const CMeshO&, const std::vector<unsigned int>&, int, Scalarm, Scalarm, Scalarm);
+
+template <int... I>
+std::array<SlabPivoter, sizeof...(I)> slabPivoters(std::integer_sequence<int, I...>)
+{
+	return {{&pivotSlab<I>...}};
+}
+
+} // namespace
+
+void ParallelBallPivoting(
+	CMeshO&           m,
+	Scalarm           radius,
+	Scalarm           clustering,
+	Scalarm           creaseThr,
+	vcg::CallBackPos* cb)
+{
+	vcg::tri::UpdateBounding<CMeshO>::Box(m);
+	// same guess of vcg::tri::BallPivoting: all the passes must use the same radius
+	if (radius == 0 && m.vn > 0)
+		radius = std::sqrt(m.bbox.Diag() * m.bbox.Diag() / m.vn);
+
+	const unsigned int nThreads = meshlab::threadCount(MAX_PARALLEL_SESSIONS);
+	const int     axis   = m.bbox.MaxDim();
+	const Scalarm margin = 2 * radius;
+
+	// points sorted along the axis; the slabs split them in about equal
+	// parts, but are never thinner than two margins
+	std::vector<unsigned int> sorted;
+	std::vector<Scalarm>      keys;
+	std::vector<Scalarm>      cuts;
+	std::size_t nSlabs = std::min<std::size_t>(4 * nThreads, std::size_t(m.vn) / MIN_SLAB_POINTS);
+	if (nThreads > 1 && nSlabs > 1 && radius > 0) {
+		sorted.reserve(m.vn);
+		for (std::size_t i = 0; i < m.vert.size(); ++i)
+			if (!m.vert[i].IsD())
+				sorted.push_back(i);
+		std::sort(sorted.begin(), sorted.end(), [&](unsigned int a, unsigned int b) {
+			return m.vert[a].cP()[axis] < m.vert[b].cP()[axis];
+		});
+		keys.resize(sorted.size());
+		for (std::size_t i = 0; i < sorted.size(); ++i)
+			keys[i] = m.vert[sorted[i]].cP()[axis];
+
+		Scalarm last = keys.front();
+		for (std::size_t k = 1; k < nSlabs; ++k) {
+			const Scalarm c = keys[k * keys.size() / nSlabs];
+			if (c - last >= 2 * margin && keys.back() - c >= 2 * margin) {
+				cuts.push_back(c);
+				last = c;
+			}
+		}
+	}
+	if (cuts.empty()) {
+		vcg::tri::BallPivoting<CMeshO> pivot(m, radius, clustering, creaseThr);
+		pivot.BuildMesh(cb);
+		return;
+	}
+
+	std::vector<Slab> slabs(cuts.size() + 1);
+	for (std::size_t s = 0; s < slabs.size(); ++s) {
+		Slab& slab = slabs[s];
+		slab.lo    = s == 0 ? -std::numeric_limits<Scalarm>::max() : cuts[s - 1];
+		slab.hi    = s == cuts.size() ? std::numeric_limits<Scalarm>::max() : cuts[s];
+		slab.begin = s == 0 ? 0 : std::lower_bound(keys.begin(), keys.end(), slab.lo - margin) - keys.begin();
+		slab.end   = s == cuts.size() ? keys.size() :
+		                                std::lower_bound(keys.begin(), keys.end(), slab.hi + margin) - keys.begin();
+	}
+	std::vector<Scalarm>().swap(keys);
+
+	// reconstruction of the slabs; the callback is invoked only by this thread
+	static const std::array<SlabPivoter, MAX_PARALLEL_SESSIONS> pivoters =
+		slabPivoters(std::make_integer_sequence<int, MAX_PARALLEL_SESSIONS>());
+	meshlab::parallelFor(
+		slabs.size(),
+		[&](std::size_t s, unsigned int slot) {
+			pivoters[slot](slabs[s], m, sorted, axis, radius, clustering, creaseThr);
+		},
+		cb, 0, 80, "Pivoting the slabs", nThreads);
+
+	std::size_t nFaces = 0;
+	for (const Slab& slab : slabs)
+		nFaces += slab.faces.size();
+	if (nFaces > 0) {
+		auto fi = vcg::tri::Allocator<CMeshO>::AddFaces(m, nFaces);
+		for (const Slab& slab : slabs) {
+			for (const auto& face : slab.faces) {
+				for (int j = 0; j < 3; ++j)
+					fi->V(j) = &m.vert[face[j]];
+				++fi;
+			}
+		}
+	}
+	slabs.clear();
+
+	// the faces of the slabs are the initial front of the last pass, that
+	// closes the gaps left along the cuts
+	if (cb)
+		cb(80, "Closing the seams between the slabs");
+	vcg::tri::UpdateTopology<CMeshO>::VertexFace(m);
+	vcg::tri::BallPivoting<CMeshO> pivot(m, radius, clustering, creaseThr);
+	pivot.BuildMesh(cb);
+}
@@ -0,0 +1,50 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef FILTER_CLEAN_PARALLEL_BALL_PIVOTING_H
+#define FILTER_CLEAN_PARALLEL_BALL_PIVOTING_H
+
+#include <common/ml_document/cmesh.h>
+
+/**
+ * @brief Ball pivoting reconstruction of a point cloud without faces, with
+ * the same parameters of vcg::tri::BallPivoting.
+ *
+ * The cloud is split in slabs along the longest side of its bounding box,
+ * with about the same number of points each. The slabs are reconstructed
+ * concurrently, each one over its points plus the ones within two radii from
+ * its borders, and only the faces lying entirely inside the slab are kept.
+ * A last serial pass over the whole mesh uses the merged faces as the initial
+ * front and closes the seams between the slabs.
+ *
+ * Falls back to the serial reconstruction when the cloud is too small or too
+ * thin to be split.
+ */
+void ParallelBallPivoting(
+	CMeshO&           m,
+	Scalarm           radius,
+	Scalarm           clustering,
+	Scalarm           creaseThr,
+	vcg::CallBackPos* cb);
+
+#endif // FILTER_CLEAN_PARALLEL_BALL_PIVOTING_H
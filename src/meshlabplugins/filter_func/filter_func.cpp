@@ -22,6 +22,12 @@
  ****************************************************************************/
 
 #include "filter_func.h"
+#include "parallel_evaluator.h"
+
+#include <atomic>
+
+#include <QElapsedTimer>
+
 #include <vcg/complex/algorithms/create/platonic.h>
 
 #include <vcg/complex/algorithms/create/marching_cubes.h>
@@ -689,113 +695,83 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 	unsigned int& /*postConditionMask*/,
 	vcg::CallBackPos* cb)
 {
-	errorMsg = "";
 	if (this->getClass(filter) == FilterPlugin::MeshCreation)
 		md.addNewMesh("", this->filterName(ID(filter)));
 	MeshModel& m = *(md.mm());
-	Q_UNUSED(cb);
 	switch (ID(filter)) {
 	case FF_VERT_SELECTION: {
-		std::string expr  = par.getString("condSelect").toStdString();
-		auto        wexpr = conversion::fromStringToWString(expr);
-
-		// muparser initialization and explicitly define parser variables
-		Parser p;
-		setPerVertexVariables(p, m.cm);
-
-		// set expression inserted by user as string (required by muparser)
-		p.SetExpr(wexpr);
+		std::string expr = par.getString("condSelect").toStdString();
 
-		int    numvert = 0;
-		time_t start   = clock();
+		// check the expression and gather the variables it uses
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_VERTEX, {expr});
 
-		// every parser variables is related to vertex coord and attributes.
-		CMeshO::VertexIterator vi;
-		for (vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-			if (!(*vi).IsD()) {
-				setAttributes(vi, m.cm);
+		std::atomic<int> numvert(0);
+		QElapsedTimer timer;
+		timer.start();
 
-				bool selected = false;
-
-				// use parser to evaluate boolean function specified above
-				// in case of fail, error dialog contains details of parser's error
-				try {
-					selected = p.Eval();
-				}
-				catch (Parser::exception_type& e) {
-					throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-				}
-
-				// set vertex as selected or clear selection
-				if (selected) {
-					(*vi).SetS();
+		// set vertex as selected or clear selection
+		evaluator.evaluate(
+			[](std::size_t) { return true; },
+			[&](std::size_t i, const double* values) {
+				if (values[0] != 0) {
+					m.cm.vert[i].SetS();
 					numvert++;
 				}
 				else
-					(*vi).ClearS();
-			}
+					m.cm.vert[i].ClearS();
+			},
+			cb);
 
 		// if succeeded log stream contains number of vertices and time elapsed
 		log("selected %d vertices in %.2f sec.",
-			numvert,
-			(clock() - start) / (float) CLOCKS_PER_SEC);
+			numvert.load(),
+			timer.elapsed() / 1000.0f);
 	} break;
 
 	case FF_FACE_SELECTION: {
-		QString select = par.getString("condSelect");
-
-		// muparser initialization and explicitly define parser variables
-		Parser p;
-		setPerFaceVariables(p, m.cm);
-
-		// set expression inserted by user as string (required by muparser)
-		p.SetExpr(conversion::fromStringToWString(select.toStdString()));
-
-		int    numface = 0;
-		time_t start   = clock();
+		std::string expr = par.getString("condSelect").toStdString();
 
-		// every parser variables is related to face attributes.
-		CMeshO::FaceIterator fi;
-		for (fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-			if (!(*fi).IsD()) {
-				setAttributes(fi, m.cm);
+		// check the expression and gather the variables it uses
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_FACE, {expr});
 
-				bool selected = false;
-
-				// use parser to evaluate boolean function specified above
-				// in case of fail, error dialog contains details of parser's error
-				try {
-					selected = p.Eval();
-				}
-				catch (Parser::exception_type& e) {
-					throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-				}
+		std::atomic<int> numface(0);
+		QElapsedTimer timer;
+		timer.start();
 
-				// set face as selected or clear selection
-				if (selected) {
-					(*fi).SetS();
+		// set face as selected or clear selection
+		evaluator.evaluate(
+			[](std::size_t) { return true; },
+			[&](std::size_t i, const double* values) {
+				if (values[0] != 0) {
+					m.cm.face[i].SetS();
 					numface++;
 				}
 				else
-					(*fi).ClearS();
-			}
+					m.cm.face[i].ClearS();
+			},
+			cb);
 
 		// if succeeded log stream contains number of vertices and time elapsed
-		log("selected %d faces in %.2f sec.", numface, (clock() - start) / (float) CLOCKS_PER_SEC);
+		log("selected %d faces in %.2f sec.",
+			numface.load(),
+			timer.elapsed() / 1000.0f);
 
 	} break;
 
 	case FF_GEOM_FUNC:
 	case FF_VERT_COLOR:
 	case FF_VERT_NORMAL: {
-		std::string func_x, func_y, func_z, func_a;
 		// FF_VERT_COLOR : x = r, y = g, z = b
 		// FF_VERT_NORMAL : x = r, y = g, z = b
-		func_x = par.getString("x").toStdString();
-		func_y = par.getString("y").toStdString();
-		func_z = par.getString("z").toStdString();
-		if (ID(filter) == FF_VERT_COLOR)
-			func_a = par.getString("a").toStdString();
+		std::vector<std::string> funcs = {
+			par.getString("x").toStdString(),
+			par.getString("y").toStdString(),
+			par.getString("z").toStdString()};
+		std::vector<std::string> labels = {"1st func : ", "2nd func : ", "3rd func : "};
+		if (ID(filter) == FF_VERT_COLOR) {
+			funcs.push_back(par.getString("a").toStdString());
+			labels.push_back("4th func : ");
+		}
 
 		bool onSelected = par.getBool("onselected");
 
@@ -812,73 +788,28 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 			tri::UpdateSelection<CMeshO>::VertexFromFaceLoose(m.cm);
 		}
 
-		// muparser initialization and explicitly define parser variables
-		// function for x,y and z must use different parser and variables
-		Parser p1, p2, p3, p4;
-
-		setPerVertexVariables(p1, m.cm);
-		setPerVertexVariables(p2, m.cm);
-		setPerVertexVariables(p3, m.cm);
-		setPerVertexVariables(p4, m.cm);
-
-		p1.SetExpr(conversion::fromStringToWString(func_x));
-		p2.SetExpr(conversion::fromStringToWString(func_y));
-		p3.SetExpr(conversion::fromStringToWString(func_z));
-		p4.SetExpr(conversion::fromStringToWString(func_a));
-
-		double  newx = 0, newy = 0, newz = 0, newa = 255;
-		QString errorMsg = "";
+		// errors of all the functions are reported together, each one with its label
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_VERTEX, funcs, labels);
 
-		time_t start = clock();
+		if (ID(filter) == FF_VERT_COLOR)
+			m.updateDataMask(MeshModel::MM_VERTCOLOR);
 
-		// every parser variables is related to vertex coord and attributes.
-		CMeshO::VertexIterator vi;
-		for (vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-			if (!(*vi).IsD())
-				if ((!onSelected) || ((*vi).IsS())) {
-					setAttributes(vi, m.cm);
-
-					// every function is evaluated by different parser.
-					// errorMessage dialog contains errors for func x, func y and func z
-					try {
-						newx = p1.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("1st func : ", e);
-					}
-					try {
-						newy = p2.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("2nd func : ", e);
-					}
-					try {
-						newz = p3.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("3rd func : ", e);
-					}
-					if (ID(filter) == FF_VERT_COLOR) {
-						try {
-							newa = p4.Eval();
-						}
-						catch (Parser::exception_type& e) {
-							showParserError("4th func : ", e);
-						}
-					}
-					if (errorMsg != "")
-						throw MLException(errorMsg);
-
-					if (ID(filter) == FF_GEOM_FUNC) // set new vertex coord for this iteration
-						(*vi).P() = Point3m(newx, newy, newz);
-					if (ID(filter) == FF_VERT_NORMAL) // set new color for this iteration
-						(*vi).N() = Point3m(newx, newy, newz);
-					if (ID(filter) == FF_VERT_COLOR) // set new color for this iteration
-					{
-						(*vi).C() = Color4b(newx, newy, newz, newa);
-						m.updateDataMask(MeshModel::MM_VERTCOLOR);
-					}
-				}
+		QElapsedTimer timer;
+		timer.start();
+
+		const int id = ID(filter);
+		evaluator.evaluate(
+			[&](std::size_t i) { return !onSelected || m.cm.vert[i].IsS(); },
+			[&](std::size_t i, const double* values) {
+				CVertexO& v = m.cm.vert[i];
+				if (id == FF_GEOM_FUNC) // set new vertex coord
+					v.P() = Point3m(values[0], values[1], values[2]);
+				if (id == FF_VERT_NORMAL) // set new normal
+					v.N() = Point3m(values[0], values[1], values[2]);
+				if (id == FF_VERT_COLOR) // set new color
+					v.C() = Color4b(values[0], values[1], values[2], values[3]);
+			},
+			cb);
 
 		if (ID(filter) == FF_GEOM_FUNC) {
 			// update bounding box, normalize normals
@@ -890,7 +821,7 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		// if succeeded log stream contains number of vertices processed and time elapsed
 		log("%d vertices processed in %.2f sec.",
 			m.cm.vn,
-			(clock() - start) / (float) CLOCKS_PER_SEC);
+			timer.elapsed() / 1000.0f);
 	} break;
 
 	case FF_VERT_QUALITY: {
@@ -912,30 +843,14 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 
 		m.updateDataMask(MeshModel::MM_VERTQUALITY);
 
-		// muparser initialization and define custom variables
-		Parser p;
-		setPerVertexVariables(p, m.cm);
-
-		// set expression to calc with parser
-		p.SetExpr(conversion::fromStringToWString(func_q));
-
-		// every parser variables is related to vertex coord and attributes.
-		time_t                 start = clock();
-		CMeshO::VertexIterator vi;
-		for (vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-			if (!(*vi).IsD())
-				if ((!onSelected) || ((*vi).IsS())) {
-					setAttributes(vi, m.cm);
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_VERTEX, {func_q});
 
-					// use parser to evaluate function specified above
-					// in case of fail, errorMessage dialog contains details of parser's error
-					try {
-						(*vi).Q() = p.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-					}
-				}
+		QElapsedTimer timer;
+		timer.start();
+		evaluator.evaluate(
+			[&](std::size_t i) { return !onSelected || m.cm.vert[i].IsS(); },
+			[&](std::size_t i, const double* values) { m.cm.vert[i].Q() = values[0]; },
+			cb);
 
 		// normalize quality with values in [0..1]
 		if (par.getBool("normalize"))
@@ -949,7 +864,7 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		// if succeeded log stream contains number of vertices and time elapsed
 		log("%d vertices processed in %.2f sec.",
 			m.cm.vn,
-			(clock() - start) / (float) CLOCKS_PER_SEC);
+			timer.elapsed() / 1000.0f);
 	} break;
 	case FF_VERT_TEXTURE_FUNC: {
 		std::string func_u     = par.getString("u").toStdString();
@@ -971,51 +886,31 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 
 		m.updateDataMask(MeshModel::MM_VERTTEXCOORD);
 
-		// muparser initialization and define custom variables
-		Parser pu, pv;
-		setPerVertexVariables(pu, m.cm);
-		setPerVertexVariables(pv, m.cm);
-
-		// set expression to calc with parser
-#ifdef _UNICODE
-		pu.SetExpr(conversion::fromStringToWString(func_u));
-		pv.SetExpr(conversion::fromStringToWString(func_v));
-#else
-		pu.SetExpr(func_u);
-		pv.SetExpr(func_v);
-#endif
-
-		// every parser variables is related to vertex coord and attributes.
-		time_t                 start = clock();
-		CMeshO::VertexIterator vi;
-		for (vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-			if (!(*vi).IsD())
-				if ((!onSelected) || ((*vi).IsS())) {
-					setAttributes(vi, m.cm);
-
-					// use parser to evaluate function specified above
-					// in case of fail, errorMessage dialog contains details of parser's error
-					try {
-						(*vi).T().U() = pu.Eval();
-						(*vi).T().V() = pv.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-					}
-				}
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_VERTEX, {func_u, func_v});
+
+		QElapsedTimer timer;
+		timer.start();
+		evaluator.evaluate(
+			[&](std::size_t i) { return !onSelected || m.cm.vert[i].IsS(); },
+			[&](std::size_t i, const double* values) {
+				m.cm.vert[i].T().U() = values[0];
+				m.cm.vert[i].T().V() = values[1];
+			},
+			cb);
 
 		log("%d vertices processed in %.2f sec.",
 			m.cm.vn,
-			(clock() - start) / (float) CLOCKS_PER_SEC);
+			timer.elapsed() / 1000.0f);
 	} break;
 	case FF_WEDGE_TEXTURE_FUNC: {
-		std::string func_u0    = par.getString("u0").toStdString();
-		std::string func_v0    = par.getString("v0").toStdString();
-		std::string func_u1    = par.getString("u1").toStdString();
-		std::string func_v1    = par.getString("v1").toStdString();
-		std::string func_u2    = par.getString("u2").toStdString();
-		std::string func_v2    = par.getString("v2").toStdString();
-		bool        onSelected = par.getBool("onselected");
+		std::vector<std::string> funcs = {
+			par.getString("u0").toStdString(),
+			par.getString("v0").toStdString(),
+			par.getString("u1").toStdString(),
+			par.getString("v1").toStdString(),
+			par.getString("u2").toStdString(),
+			par.getString("v2").toStdString()};
+		bool onSelected = par.getBool("onselected");
 
 		if (onSelected && m.cm.sfn == 0) // if no selection, fail
 		{
@@ -1025,51 +920,27 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 
 		m.updateDataMask(MeshModel::MM_VERTTEXCOORD);
 
-		// muparser initialization and define custom variables
-		Parser pu0, pv0, pu1, pv1, pu2, pv2;
-		setPerFaceVariables(pu0, m.cm);
-		setPerFaceVariables(pv0, m.cm);
-		setPerFaceVariables(pu1, m.cm);
-		setPerFaceVariables(pv1, m.cm);
-		setPerFaceVariables(pu2, m.cm);
-		setPerFaceVariables(pv2, m.cm);
-
-		// set expression to calc with parser
-		pu0.SetExpr(conversion::fromStringToWString(func_u0));
-		pv0.SetExpr(conversion::fromStringToWString(func_v0));
-		pu1.SetExpr(conversion::fromStringToWString(func_u1));
-		pv1.SetExpr(conversion::fromStringToWString(func_v1));
-		pu2.SetExpr(conversion::fromStringToWString(func_u2));
-		pv2.SetExpr(conversion::fromStringToWString(func_v2));
-
-		// every parser variables is related to vertex coord and attributes.
-		time_t start = clock();
-		for (CMeshO::FaceIterator fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-			if (!(*fi).IsD())
-				if ((!onSelected) || ((*fi).IsS())) {
-					setAttributes(fi, m.cm);
-
-					// use parser to evaluate function specified above
-					// in case of fail, errorMessage dialog contains details of parser's error
-					try {
-						(*fi).WT(0).U() = pu0.Eval();
-						(*fi).WT(0).V() = pv0.Eval();
-						(*fi).WT(1).U() = pu1.Eval();
-						(*fi).WT(1).V() = pv1.Eval();
-						(*fi).WT(2).U() = pu2.Eval();
-						(*fi).WT(2).V() = pv2.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-					}
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_FACE, funcs);
+
+		QElapsedTimer timer;
+		timer.start();
+		evaluator.evaluate(
+			[&](std::size_t i) { return !onSelected || m.cm.face[i].IsS(); },
+			[&](std::size_t i, const double* values) {
+				for (int k = 0; k < 3; ++k) {
+					m.cm.face[i].WT(k).U() = values[2 * k];
+					m.cm.face[i].WT(k).V() = values[2 * k + 1];
 				}
+			},
+			cb);
 
-		log("%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+		log("%d faces processed in %.2f sec.", m.cm.fn, timer.elapsed() / 1000.0f);
 	} break;
 		case FF_FACE_NORMAL: {
-		std::string func_nx     = par.getString("x").toStdString();
-		std::string func_ny     = par.getString("y").toStdString();
-		std::string func_nz     = par.getString("z").toStdString();
+		std::vector<std::string> funcs = {
+			par.getString("x").toStdString(),
+			par.getString("y").toStdString(),
+			par.getString("z").toStdString()};
 		bool        onSelected = par.getBool("onselected");
 		if (onSelected && m.cm.sfn == 0) // if no selection, fail
 		{
@@ -1077,66 +948,33 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 			throw MLException("Cannot apply only on selection: there is no selection");
 		}
 		m.updateDataMask(MeshModel::MM_FACENORMAL);
-		Parser p_nx, p_ny, p_nz;
-		
-		setPerFaceVariables(p_nx, m.cm);
-		setPerFaceVariables(p_ny, m.cm);
-		setPerFaceVariables(p_nz, m.cm);
-		p_nx.SetExpr(conversion::fromStringToWString(func_nx));
-		p_ny.SetExpr(conversion::fromStringToWString(func_ny));
-		p_nz.SetExpr(conversion::fromStringToWString(func_nz));
-		
-		
-		double nx = 0, ny = 0, nz = 0;
-		errorMsg = "";
-		
-		time_t start = clock();
-		
-		// every parser variables is related to face attributes.
-		for (CMeshO::FaceIterator  fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-			if (!(*fi).IsD())
-				if ((!onSelected) || ((*fi).IsS())) {
-					setAttributes(fi, m.cm);
-					
-					// evaluate functions to generate new color
-					// in case of fail, error dialog contains details of parser's error
-					try {
-						nx = p_nx.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func nx: ", e);
-					}
-					try {
-						ny = p_ny.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func ny: ", e);
-					}
-					try {
-						nz = p_nz.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func nz: ", e);
-					}					
-					
-					if (errorMsg != "")
-						throw MLException(errorMsg);
-					
-					// set new color for this iteration
-					(*fi).N() = Point3m(nx,ny,nz);
-				}
-		
+
+		ParallelEvaluator evaluator(
+			m.cm, ParallelEvaluator::PER_FACE, funcs, {"func nx: ", "func ny: ", "func nz: "});
+
+		QElapsedTimer timer;
+		timer.start();
+
+		// set new normal for every face
+		evaluator.evaluate(
+			[&](std::size_t i) { return !onSelected || m.cm.face[i].IsS(); },
+			[&](std::size_t i, const double* values) {
+				m.cm.face[i].N() = Point3m(values[0], values[1], values[2]);
+			},
+			cb);
+
 		// if succeeded log stream contains number of vertices processed and time elapsed
-		log("%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+		log("%d faces processed in %.2f sec.", m.cm.fn, timer.elapsed() / 1000.0f);
 		
 		
 	} break;
 	case FF_FACE_COLOR: {
-		std::string func_r     = par.getString("r").toStdString();
-		std::string func_g     = par.getString("g").toStdString();
-		std::string func_b     = par.getString("b").toStdString();
-		std::string func_a     = par.getString("a").toStdString();
-		bool        onSelected = par.getBool("onselected");
+		std::vector<std::string> funcs = {
+			par.getString("r").toStdString(),
+			par.getString("g").toStdString(),
+			par.getString("b").toStdString(),
+			par.getString("a").toStdString()};
+		bool onSelected = par.getBool("onselected");
 
 		if (onSelected && m.cm.sfn == 0) // if no selection, fail
 		{
@@ -1146,69 +984,23 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 
 		m.updateDataMask(MeshModel::MM_FACECOLOR);
 
-		// muparser initialization and explicitly define parser variables
-		// every function must uses own parser and variables
-		Parser p1, p2, p3, p4;
-
-		setPerFaceVariables(p1, m.cm);
-		setPerFaceVariables(p2, m.cm);
-		setPerFaceVariables(p3, m.cm);
-		setPerFaceVariables(p4, m.cm);
-
-		p1.SetExpr(conversion::fromStringToWString(func_r));
-		p2.SetExpr(conversion::fromStringToWString(func_g));
-		p3.SetExpr(conversion::fromStringToWString(func_b));
-		p4.SetExpr(conversion::fromStringToWString(func_a));
+		// errors of all the functions are reported together, each one with its label
+		ParallelEvaluator evaluator(
+			m.cm, ParallelEvaluator::PER_FACE, funcs, {"func r: ", "func g: ", "func b: ", "func a: "});
 
-		// RGB is related to every face
-		CMeshO::FaceIterator fi;
-		double               newr = 0, newg = 0, newb = 0, newa = 255;
-		errorMsg = "";
+		QElapsedTimer timer;
+		timer.start();
 
-		time_t start = clock();
-
-		// every parser variables is related to face attributes.
-		for (fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-			if (!(*fi).IsD())
-				if ((!onSelected) || ((*fi).IsS())) {
-					setAttributes(fi, m.cm);
-
-					// evaluate functions to generate new color
-					// in case of fail, error dialog contains details of parser's error
-					try {
-						newr = p1.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func r: ", e);
-					}
-					try {
-						newg = p2.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func g: ", e);
-					}
-					try {
-						newb = p3.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func b: ", e);
-					}
-					try {
-						newa = p4.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func a: ", e);
-					}
-
-					if (errorMsg != "")
-						throw MLException(errorMsg);
-
-					// set new color for this iteration
-					(*fi).C() = Color4b(newr, newg, newb, newa);
-				}
+		// set new color for every face
+		evaluator.evaluate(
+			[&](std::size_t i) { return !onSelected || m.cm.face[i].IsS(); },
+			[&](std::size_t i, const double* values) {
+				m.cm.face[i].C() = Color4b(values[0], values[1], values[2], values[3]);
+			},
+			cb);
 
 		// if succeeded log stream contains number of vertices processed and time elapsed
-		log("%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+		log("%d faces processed in %.2f sec.", m.cm.fn, timer.elapsed() / 1000.0f);
 
 	} break;
 
@@ -1224,34 +1016,14 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 
 		m.updateDataMask(MeshModel::MM_FACEQUALITY);
 
-		// muparser initialization and define custom variables
-		Parser pf;
-		setPerFaceVariables(pf, m.cm);
-
-		// set expression to calc with parser
-		pf.SetExpr(conversion::fromStringToWString(func_q));
-
-		time_t start = clock();
-		errorMsg     = "";
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_FACE, {func_q}, {"func q: "});
 
-		// every parser variables is related to face attributes.
-		CMeshO::FaceIterator fi;
-		for (fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-			if (!(*fi).IsD())
-				if ((!onSelected) || ((*fi).IsS())) {
-					setAttributes(fi, m.cm);
-
-					// evaluate functions to generate new quality
-					// in case of fail, error dialog contains details of parser's error
-					try {
-						(*fi).Q() = pf.Eval();
-					}
-					catch (Parser::exception_type& e) {
-						showParserError("func q: ", e);
-					}
-					if (errorMsg != "")
-						throw MLException(errorMsg);
-				}
+		QElapsedTimer timer;
+		timer.start();
+		evaluator.evaluate(
+			[&](std::size_t i) { return !onSelected || m.cm.face[i].IsS(); },
+			[&](std::size_t i, const double* values) { m.cm.face[i].Q() = values[0]; },
+			cb);
 
 		// normalize quality with values in [0..1]
 		if (par.getBool("normalize"))
@@ -1264,7 +1036,7 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		}
 
 		// if succeeded log stream contains number of faces processed and time elapsed
-		log("%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+		log("%d faces processed in %.2f sec.", m.cm.fn, timer.elapsed() / 1000.0f);
 
 	} break;
 
@@ -1284,39 +1056,23 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		else
 			h = tri::Allocator<CMeshO>::AddPerVertexAttribute<Scalarm>(m.cm, name);
 
-		Parser p;
-		setPerVertexVariables(p, m.cm);
-
-		p.SetExpr(conversion::fromStringToWString(expr));
+		// the new attribute is already in the mesh, so it can be used by the
+		// expression and by the other filters
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_VERTEX, {expr});
 
-		time_t start = clock();
+		QElapsedTimer timer;
+		timer.start();
 
 		// perform calculation of attribute's value with function specified by user
-		CMeshO::VertexIterator vi;
-		for (vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-			if (!(*vi).IsD()) {
-				setAttributes(vi, m.cm);
-
-				// add new user-defined attribute
-				try {
-					h[vi] = p.Eval();
-				}
-				catch (Parser::exception_type& e) {
-					throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-				}
-			}
-
-		// add string, double and handler to vector.
-		// vectors keep tracks of new attributes and let muparser use explicit variables
-		// it's possible to use custom attributes in other filters
-		v_attrNames.push_back(name);
-		v_attrValue.push_back(0);
-		v_handlers.push_back(h);
+		evaluator.evaluate(
+			[](std::size_t) { return true; },
+			[&](std::size_t i, const double* values) { h[i] = values[0]; },
+			cb);
 
 		// if succeeded log stream contains number of vertices processed and time elapsed
 		log("%d vertices processed in %.2f sec.",
 			m.cm.vn,
-			(clock() - start) / (float) CLOCKS_PER_SEC);
+			timer.elapsed() / 1000.0f);
 
 	} break;
 
@@ -1326,7 +1082,6 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		checkAttributeName(name);
 
 		// add per-face attribute with type float and name specified by user
-		// add per-vertex attribute with type float and name specified by user
 		CMeshO::PerFaceAttributeHandle<Scalarm> h;
 		if (tri::HasPerFaceAttribute(m.cm, name)) {
 			h = tri::Allocator<CMeshO>::FindPerFaceAttribute<Scalarm>(m.cm, name);
@@ -1336,37 +1091,28 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		}
 		else
 			h = tri::Allocator<CMeshO>::AddPerFaceAttribute<Scalarm>(m.cm, name);
-		Parser p;
-		setPerFaceVariables(p, m.cm);
-		p.SetExpr(conversion::fromStringToWString(expr));
 
-		time_t start = clock();
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_FACE, {expr});
 
-		// every parser variables is related to face attributes.
-		CMeshO::FaceIterator fi;
-		for (fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-			if (!(*fi).IsD()) {
-				setAttributes(fi, m.cm);
+		QElapsedTimer timer;
+		timer.start();
 
-				// add new user-defined attribute
-				try {
-					h[fi] = p.Eval();
-				}
-				catch (Parser::exception_type& e) {
-					throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-				}
-			}
+		evaluator.evaluate(
+			[](std::size_t) { return true; },
+			[&](std::size_t i, const double* values) { h[i] = values[0]; },
+			cb);
 
 		// if succeeded log stream contains number of vertices processed and time elapsed
-		log("%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+		log("%d faces processed in %.2f sec.", m.cm.fn, timer.elapsed() / 1000.0f);
 
 	} break;
 
 	case FF_DEF_VERT_POINT_ATTRIB: {
 		std::string name = par.getString("name").toStdString();
-		std::string x_expr = par.getString("x_expr").toStdString();
-		std::string y_expr = par.getString("y_expr").toStdString();
-		std::string z_expr = par.getString("z_expr").toStdString();
+		std::vector<std::string> exprs = {
+			par.getString("x_expr").toStdString(),
+			par.getString("y_expr").toStdString(),
+			par.getString("z_expr").toStdString()};
 		checkAttributeName(name);
 
 		// add per-vertex attribute with type float and name specified by user
@@ -1380,56 +1126,35 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		else
 			h = tri::Allocator<CMeshO>::AddPerVertexAttribute<Point3m>(m.cm, name);
 
-		Parser p_x, p_y, p_z;
-		setPerVertexVariables(p_x, m.cm);
-		setPerVertexVariables(p_y, m.cm);
-		setPerVertexVariables(p_z, m.cm);
-		p_x.SetExpr(conversion::fromStringToWString(x_expr));
-		p_y.SetExpr(conversion::fromStringToWString(y_expr));
-		p_z.SetExpr(conversion::fromStringToWString(z_expr));
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_VERTEX, exprs);
 
-		time_t start = clock();
+		QElapsedTimer timer;
+		timer.start();
 
 		// perform calculation of attribute's value with function specified by user
-		CMeshO::VertexIterator vi;
-		for (vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-			if (!(*vi).IsD()) {
-				setAttributes(vi, m.cm);
-
-				try {
-					h[vi][0] = p_x.Eval();
-					h[vi][1] = p_y.Eval();
-					h[vi][2] = p_z.Eval();
-				}
-				catch (Parser::exception_type& e) {
-					throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-				}
-			}
-
-		// add string, double and handler to vector.
-		// vectors keep tracks of new attributes and let muparser use explicit variables
-		// it's possible to use custom attributes in other filters
-
-		//v_attrNames.push_back(name);
-		//v_attrValue.push_back(0);
-		//v_handlers.push_back(h);
+		evaluator.evaluate(
+			[](std::size_t) { return true; },
+			[&](std::size_t i, const double* values) {
+				h[i] = Point3m(values[0], values[1], values[2]);
+			},
+			cb);
 
 		// if succeeded log stream contains number of vertices processed and time elapsed
 		log("%d vertices processed in %.2f sec.",
 			m.cm.vn,
-			(clock() - start) / (float) CLOCKS_PER_SEC);
+			timer.elapsed() / 1000.0f);
 
 	} break;
 
 	case FF_DEF_FACE_POINT_ATTRIB: {
 		std::string name = par.getString("name").toStdString();
-		std::string x_expr = par.getString("x_expr").toStdString();
-		std::string y_expr = par.getString("y_expr").toStdString();
-		std::string z_expr = par.getString("z_expr").toStdString();
+		std::vector<std::string> exprs = {
+			par.getString("x_expr").toStdString(),
+			par.getString("y_expr").toStdString(),
+			par.getString("z_expr").toStdString()};
 		checkAttributeName(name);
 
 		// add per-face attribute with type float and name specified by user
-		// add per-vertex attribute with type float and name specified by user
 		CMeshO::PerFaceAttributeHandle<Point3m> h;
 		if (tri::HasPerFaceAttribute(m.cm, name)) {
 			h = tri::Allocator<CMeshO>::FindPerFaceAttribute<Point3m>(m.cm, name);
@@ -1439,35 +1164,21 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 		}
 		else
 			h = tri::Allocator<CMeshO>::AddPerFaceAttribute<Point3m>(m.cm, name);
-		Parser p_x, p_y, p_z;
-		setPerFaceVariables(p_x, m.cm);
-		setPerFaceVariables(p_y, m.cm);
-		setPerFaceVariables(p_z, m.cm);
-		p_x.SetExpr(conversion::fromStringToWString(x_expr));
-		p_y.SetExpr(conversion::fromStringToWString(y_expr));
-		p_z.SetExpr(conversion::fromStringToWString(z_expr));
-
-		time_t start = clock();
-
-		// every parser variables is related to face attributes.
-		CMeshO::FaceIterator fi;
-		for (fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-			if (!(*fi).IsD()) {
-				setAttributes(fi, m.cm);
-
-				// add new user-defined attribute
-				try {
-					h[fi][0] = p_x.Eval();
-					h[fi][1] = p_y.Eval();
-					h[fi][2] = p_z.Eval();
-				}
-				catch (Parser::exception_type& e) {
-					throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
-				}
-			}
+
+		ParallelEvaluator evaluator(m.cm, ParallelEvaluator::PER_FACE, exprs);
+
+		QElapsedTimer timer;
+		timer.start();
+
+		evaluator.evaluate(
+			[](std::size_t) { return true; },
+			[&](std::size_t i, const double* values) {
+				h[i] = Point3m(values[0], values[1], values[2]);
+			},
+			cb);
 
 		// if succeeded log stream contains number of vertices processed and time elapsed
-		log("%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+		log("%d faces processed in %.2f sec.", m.cm.fn, timer.elapsed() / 1000.0f);
 
 	} break;
 
@@ -1594,367 +1305,6 @@ std::map<std::string, QVariant> FilterFunctionPlugin::applyFilter(
 	return std::map<std::string, QVariant>();
 }
 
-// display parsing error in dialog
-void FilterFunctionPlugin::showParserError(const QString& s, Parser::exception_type& e)
-{
-	errorMsg += s;
-	errorMsg += conversion::fromWStringToString(e.GetMsg()).c_str();
-	errorMsg += "\n";
-}
-
-// set per-vertex attributes associated to parser variables
-void FilterFunctionPlugin::setAttributes(CMeshO::VertexIterator& vi, CMeshO& m)
-{
-	x = (*vi).P()[0]; // coord x
-	y = (*vi).P()[1]; // coord y
-	z = (*vi).P()[2]; // coord z
-
-	nx = (*vi).N()[0]; // normal coord x
-	ny = (*vi).N()[1]; // normal coord y
-	nz = (*vi).N()[2]; // normal coord z
-
-	r = (*vi).C()[0]; // color R
-	g = (*vi).C()[1]; // color G
-	b = (*vi).C()[2]; // color B
-	a = (*vi).C()[3]; // color ALPHA
-
-	q = (*vi).Q(); // quality
-
-	vsel = ((*vi).IsS()) ? 1.0 : 0.0; // selection
-
-	v = vi - m.vert.begin(); // zero based index of current vertex
-
-	if (tri::HasPerVertexTexCoord(m)) {
-		vtu = (*vi).T().U();
-		vtv = (*vi).T().V();
-		ti  = (*vi).T().N();
-	}
-	else {
-		vtu = vtv = ti = 0;
-	}
-
-	// if user-defined attributes exist (vector is not empty)
-	//  set variables to explicit value obtained through attribute's handler
-	for (int i = 0; i < (int) v_attrValue.size(); i++)
-		v_attrValue[i] = v_handlers[i][vi];
-
-	for (int i = 0; i < (int) v3_handlers.size(); i++) {
-		v3_attrValue[i * 3 + 0] = v3_handlers[i][vi].X();
-		v3_attrValue[i * 3 + 1] = v3_handlers[i][vi].Y();
-		v3_attrValue[i * 3 + 2] = v3_handlers[i][vi].Z();
-	}
-}
-
-// set per-face attributes associated to parser variables
-void FilterFunctionPlugin::setAttributes(CMeshO::FaceIterator& fi, CMeshO& m)
-{
-	// set attributes for First vertex
-	// coords, normal coords, quality
-	x0 = (*fi).V(0)->P()[0];
-	y0 = (*fi).V(0)->P()[1];
-	z0 = (*fi).V(0)->P()[2];
-
-	nx0 = (*fi).V(0)->N()[0];
-	ny0 = (*fi).V(0)->N()[1];
-	nz0 = (*fi).V(0)->N()[2];
-
-	r0 = (*fi).V(0)->C()[0];
-	g0 = (*fi).V(0)->C()[1];
-	b0 = (*fi).V(0)->C()[2];
-	a0 = (*fi).V(0)->C()[3];
-
-	q0 = (*fi).V(0)->Q();
-
-	// set attributes for Second vertex
-	// coords, normal coords, quality
-	x1 = (*fi).V(1)->P()[0];
-	y1 = (*fi).V(1)->P()[1];
-	z1 = (*fi).V(1)->P()[2];
-
-	nx1 = (*fi).V(1)->N()[0];
-	ny1 = (*fi).V(1)->N()[1];
-	nz1 = (*fi).V(1)->N()[2];
-
-	r1 = (*fi).V(1)->C()[0];
-	g1 = (*fi).V(1)->C()[1];
-	b1 = (*fi).V(1)->C()[2];
-	a1 = (*fi).V(1)->C()[3];
-
-	q1 = (*fi).V(1)->Q();
-
-	// set attributes for Third vertex
-	// coords, normal coords, quality
-	x2 = (*fi).V(2)->P()[0];
-	y2 = (*fi).V(2)->P()[1];
-	z2 = (*fi).V(2)->P()[2];
-
-	nx2 = (*fi).V(2)->N()[0];
-	ny2 = (*fi).V(2)->N()[1];
-	nz2 = (*fi).V(2)->N()[2];
-
-	r2 = (*fi).V(2)->C()[0];
-	g2 = (*fi).V(2)->C()[1];
-	b2 = (*fi).V(2)->C()[2];
-	a2 = (*fi).V(2)->C()[3];
-
-	q2 = (*fi).V(2)->Q();
-
-	if (HasPerFaceQuality(m))
-		fq = (*fi).Q();
-	else
-		fq = 0;
-
-	// set face color attributes
-	if (HasPerFaceColor(m)) {
-		fr = (*fi).C()[0];
-		fg = (*fi).C()[1];
-		fb = (*fi).C()[2];
-		fa = (*fi).C()[3];
-	}
-	else {
-		fr = fg = fb = fa = 255;
-	}
-
-	// face normal
-	fnx = (*fi).N()[0];
-	fny = (*fi).N()[1];
-	fnz = (*fi).N()[2];
-
-	// zero based index of face
-	f = fi - m.face.begin();
-
-	// zero based index of its vertices
-	v0i = ((*fi).V(0) - &m.vert[0]);
-	v1i = ((*fi).V(1) - &m.vert[0]);
-	v2i = ((*fi).V(2) - &m.vert[0]);
-
-	if (tri::HasPerWedgeTexCoord(m)) {
-		wtu0 = (*fi).WT(0).U();
-		wtv0 = (*fi).WT(0).V();
-		wtu1 = (*fi).WT(1).U();
-		wtv1 = (*fi).WT(1).V();
-		wtu2 = (*fi).WT(2).U();
-		wtv2 = (*fi).WT(2).V();
-		ti   = (*fi).WT(0).N();
-	}
-	else {
-		wtu0 = wtv0 = wtu1 = wtv1 = wtu2 = wtv2 = ti = 0;
-	}
-
-	// selection
-	vsel0 = ((*fi).V(0)->IsS()) ? 1.0 : 0.0;
-	vsel1 = ((*fi).V(1)->IsS()) ? 1.0 : 0.0;
-	vsel2 = ((*fi).V(2)->IsS()) ? 1.0 : 0.0;
-	fsel  = ((*fi).IsS()) ? 1.0 : 0.0;
-
-	// if user-defined attributes exist (vector is not empty)
-	//  set variables to explicit value obtained through attribute's handler
-	for (int i = 0; i < (int) f_attrValue.size(); i++)
-		f_attrValue[i] = f_handlers[i][fi];
-	
-	for (int i = 0; i < (int) f3_handlers.size(); i++) {
-		f3_attrValue[i * 3 + 0] = f3_handlers[i][fi].X();
-		f3_attrValue[i * 3 + 1] = f3_handlers[i][fi].Y();
-		f3_attrValue[i * 3 + 2] = f3_handlers[i][fi].Z();
-	}
-	
-}
-
-// Function explicitly define parser variables to perform per-vertex filter action
-// x, y, z for vertex coord, nx, ny, nz for normal coord, r, g ,b for color
-// and q for quality
-void FilterFunctionPlugin::setPerVertexVariables(Parser& p, CMeshO& m)
-{
-	p.DefineVar(conversion::fromStringToWString("x"), &x);
-	p.DefineVar(conversion::fromStringToWString("y"), &y);
-	p.DefineVar(conversion::fromStringToWString("z"), &z);
-	p.DefineVar(conversion::fromStringToWString("nx"), &nx);
-	p.DefineVar(conversion::fromStringToWString("ny"), &ny);
-	p.DefineVar(conversion::fromStringToWString("nz"), &nz);
-	p.DefineVar(conversion::fromStringToWString("r"), &r);
-	p.DefineVar(conversion::fromStringToWString("g"), &g);
-	p.DefineVar(conversion::fromStringToWString("b"), &b);
-	p.DefineVar(conversion::fromStringToWString("a"), &a);
-	p.DefineVar(conversion::fromStringToWString("q"), &q);
-	p.DefineVar(conversion::fromStringToWString("vi"), &v);
-	p.DefineVar(conversion::fromStringToWString("vtu"), &vtu);
-	p.DefineVar(conversion::fromStringToWString("vtv"), &vtv);
-	p.DefineVar(conversion::fromStringToWString("ti"), &ti);
-	p.DefineVar(conversion::fromStringToWString("vsel"), &vsel);
-
-	// define var for user-defined attributes (if any exists)
-	// if vector is empty, code won't be executed
-	v_handlers.clear();
-	v_attrNames.clear();
-	v_attrValue.clear();
-	std::vector<std::string> AllVertexAttribName;
-	tri::Allocator<CMeshO>::GetAllPerVertexAttribute<Scalarm>(m, AllVertexAttribName);
-	v_attrValue.reserve(AllVertexAttribName.size());
-	for (int i = 0; i < (int) AllVertexAttribName.size(); i++) {
-		CMeshO::PerVertexAttributeHandle<Scalarm> hh =
-			tri::Allocator<CMeshO>::GetPerVertexAttribute<Scalarm>(m, AllVertexAttribName[i]);
-		v_handlers.push_back(hh);
-		v_attrNames.push_back(AllVertexAttribName[i]);
-		v_attrValue.push_back(0);
-		p.DefineVar(conversion::fromStringToWString(v_attrNames.back()), &v_attrValue.back());
-		qDebug("Adding custom per vertex float variable %s", v_attrNames.back().c_str());
-	}
-	AllVertexAttribName.clear();
-	v3_handlers.clear();
-	v3_attrNames.clear();
-	v3_attrValue.clear();
-	tri::Allocator<CMeshO>::GetAllPerVertexAttribute<Point3m>(m, AllVertexAttribName);
-	v3_attrValue.reserve(AllVertexAttribName.size());
-	for (int i = 0; i < (int) AllVertexAttribName.size(); i++) {
-		CMeshO::PerVertexAttributeHandle<Point3m> hh3 =
-			tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3m>(m, AllVertexAttribName[i]);
-
-		v3_handlers.push_back(hh3);
-
-		v3_attrValue.push_back(0);
-		v3_attrNames.push_back(AllVertexAttribName[i] + "_x");
-		p.DefineVar(conversion::fromStringToWString(v3_attrNames.back()), &v3_attrValue.back());
-
-		v3_attrValue.push_back(0);
-		v3_attrNames.push_back(AllVertexAttribName[i] + "_y");
-		p.DefineVar(conversion::fromStringToWString(v3_attrNames.back()), &v3_attrValue.back());
-
-		v3_attrValue.push_back(0);
-		v3_attrNames.push_back(AllVertexAttribName[i] + "_z");
-		p.DefineVar(conversion::fromStringToWString(v3_attrNames.back()), &v3_attrValue.back());
-		qDebug("Adding custom per vertex Point3f variable %s", v3_attrNames.back().c_str());
-	}
-}
-
-// Function explicitly define parser variables to perform Per-Face filter action
-void FilterFunctionPlugin::setPerFaceVariables(Parser& p, CMeshO& m)
-{
-	// coord of the three vertices within a face
-	p.DefineVar(conversion::fromStringToWString("x0"), &x0);
-	p.DefineVar(conversion::fromStringToWString("y0"), &y0);
-	p.DefineVar(conversion::fromStringToWString("z0"), &z0);
-	p.DefineVar(conversion::fromStringToWString("x1"), &x1);
-	p.DefineVar(conversion::fromStringToWString("y1"), &y1);
-	p.DefineVar(conversion::fromStringToWString("z1"), &z1);
-	p.DefineVar(conversion::fromStringToWString("x2"), &x2);
-	p.DefineVar(conversion::fromStringToWString("y2"), &y2);
-	p.DefineVar(conversion::fromStringToWString("z2"), &z2);
-
-	// attributes of the vertices
-	// normals:
-	p.DefineVar(conversion::fromStringToWString("nx0"), &nx0);
-	p.DefineVar(conversion::fromStringToWString("ny0"), &ny0);
-	p.DefineVar(conversion::fromStringToWString("nz0"), &nz0);
-
-	p.DefineVar(conversion::fromStringToWString("nx1"), &nx1);
-	p.DefineVar(conversion::fromStringToWString("ny1"), &ny1);
-	p.DefineVar(conversion::fromStringToWString("nz1"), &nz1);
-
-	p.DefineVar(conversion::fromStringToWString("nx2"), &nx2);
-	p.DefineVar(conversion::fromStringToWString("ny2"), &ny2);
-	p.DefineVar(conversion::fromStringToWString("nz2"), &nz2);
-
-	// colors:
-	p.DefineVar(conversion::fromStringToWString("r0"), &r0);
-	p.DefineVar(conversion::fromStringToWString("g0"), &g0);
-	p.DefineVar(conversion::fromStringToWString("b0"), &b0);
-	p.DefineVar(conversion::fromStringToWString("a0"), &a0);
-
-	p.DefineVar(conversion::fromStringToWString("r1"), &r1);
-	p.DefineVar(conversion::fromStringToWString("g1"), &g1);
-	p.DefineVar(conversion::fromStringToWString("b1"), &b1);
-	p.DefineVar(conversion::fromStringToWString("a1"), &a1);
-
-	p.DefineVar(conversion::fromStringToWString("r2"), &r2);
-	p.DefineVar(conversion::fromStringToWString("g2"), &g2);
-	p.DefineVar(conversion::fromStringToWString("b2"), &b2);
-	p.DefineVar(conversion::fromStringToWString("a2"), &a2);
-
-	// quality
-	p.DefineVar(conversion::fromStringToWString("q0"), &q0);
-	p.DefineVar(conversion::fromStringToWString("q1"), &q1);
-	p.DefineVar(conversion::fromStringToWString("q2"), &q2);
-
-	// face color
-	p.DefineVar(conversion::fromStringToWString("fr"), &fr);
-	p.DefineVar(conversion::fromStringToWString("fg"), &fg);
-	p.DefineVar(conversion::fromStringToWString("fb"), &fb);
-	p.DefineVar(conversion::fromStringToWString("fa"), &fa);
-
-	// face normal
-	p.DefineVar(conversion::fromStringToWString("fnx"), &fnx);
-	p.DefineVar(conversion::fromStringToWString("fny"), &fny);
-	p.DefineVar(conversion::fromStringToWString("fnz"), &fnz);
-
-	// face quality
-	p.DefineVar(conversion::fromStringToWString("fq"), &fq);
-
-	// index
-	p.DefineVar(conversion::fromStringToWString("fi"), &f);
-	p.DefineVar(conversion::fromStringToWString("vi0"), &v0i);
-	p.DefineVar(conversion::fromStringToWString("vi1"), &v1i);
-	p.DefineVar(conversion::fromStringToWString("vi2"), &v2i);
-
-	// texture
-	p.DefineVar(conversion::fromStringToWString("wtu0"), &wtu0);
-	p.DefineVar(conversion::fromStringToWString("wtv0"), &wtv0);
-	p.DefineVar(conversion::fromStringToWString("wtu1"), &wtu1);
-	p.DefineVar(conversion::fromStringToWString("wtv1"), &wtv1);
-	p.DefineVar(conversion::fromStringToWString("wtu2"), &wtu2);
-	p.DefineVar(conversion::fromStringToWString("wtv2"), &wtv2);
-	p.DefineVar(conversion::fromStringToWString("ti"), &ti);
-
-	// selection
-	p.DefineVar(conversion::fromStringToWString("vsel0"), &vsel0);
-	p.DefineVar(conversion::fromStringToWString("vsel1"), &vsel1);
-	p.DefineVar(conversion::fromStringToWString("vsel2"), &vsel2);
-	p.DefineVar(conversion::fromStringToWString("fsel"), &fsel);
-
-	// define var for user-defined attributes (if any exists)
-	// if vector is empty, code won't be executed
-	f_handlers.clear();
-	f_attrNames.clear();
-	f_attrValue.clear();
-	std::vector<std::string> AllFaceAttribName;
-	tri::Allocator<CMeshO>::GetAllPerFaceAttribute<Scalarm>(m, AllFaceAttribName);
-	f_attrValue.reserve(AllFaceAttribName.size());
-	qDebug("Searching for Scalar Face Attributes (%lu)",AllFaceAttribName.size());
-	for (int i = 0; i < (int) AllFaceAttribName.size(); i++) {
-		CMeshO::PerFaceAttributeHandle<Scalarm> hh =
-			tri::Allocator<CMeshO>::GetPerFaceAttribute<Scalarm>(m, AllFaceAttribName[i]);
-		f_handlers.push_back(hh);
-		f_attrNames.push_back(AllFaceAttribName[i]);
-		f_attrValue.push_back(0);
-		p.DefineVar(conversion::fromStringToWString(f_attrNames.back()), &f_attrValue.back());
-	}
-	AllFaceAttribName.clear();
-	f3_handlers.clear();
-	f3_attrNames.clear();
-	f3_attrValue.clear();
-	tri::Allocator<CMeshO>::GetAllPerFaceAttribute<Point3m>(m, AllFaceAttribName);
-	f3_attrValue.reserve(AllFaceAttribName.size());
-	qDebug("Searching for Point3 Face Attributes (%lu)",AllFaceAttribName.size());
-	for (int i = 0; i < (int) AllFaceAttribName.size(); i++) {
-		CMeshO::PerFaceAttributeHandle<Point3m> hh3 =
-			tri::Allocator<CMeshO>::GetPerFaceAttribute<Point3m>(m, AllFaceAttribName[i]);
-		
-		f3_handlers.push_back(hh3);
-		
-		f3_attrValue.push_back(0);
-		f3_attrNames.push_back(AllFaceAttribName[i] + "_x");
-		p.DefineVar(conversion::fromStringToWString(f3_attrNames.back()), &f3_attrValue.back());
-		
-		f3_attrValue.push_back(0);
-		f3_attrNames.push_back(AllFaceAttribName[i] + "_y");
-		p.DefineVar(conversion::fromStringToWString(f3_attrNames.back()), &f3_attrValue.back());
-		
-		f3_attrValue.push_back(0);
-		f3_attrNames.push_back(AllFaceAttribName[i] + "_z");
-		p.DefineVar(conversion::fromStringToWString(f3_attrNames.back()), &f3_attrValue.back());
-		qDebug("Adding custom per face Point3f variable %s", f3_attrNames.back().c_str());
-	}
-}
-
 void FilterFunctionPlugin::checkAttributeName(const std::string &name) const
 {
 	static const std::string validChars =
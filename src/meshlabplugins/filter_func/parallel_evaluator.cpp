@@ -0,0 +1,274 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#include "parallel_evaluator.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+
+#include <common/mlexception.h>
+#include <common/utilities/parallel.h>
+
+#include "muParser.h"
+#include "string_conversion.h"
+
+using namespace mu;
+using namespace vcg;
+
+/**
+ * @brief Checks the syntax of the given expressions, throwing a MLException
+ * that lists all the errors (each one prefixed by the corresponding label),
+ * and collects the variables used by the expressions.
+ */
+ParallelEvaluator::ParallelEvaluator(
+	CMeshO&                         m,
+	ElementType                     type,
+	const std::vector<std::string>& expressions,
+	const std::vector<std::string>& labels) :
+		m(m), type(type), expressions(expressions)
+{
+	std::vector<Variable> allVariables;
+	if (type == PER_VERTEX)
+		addVertexVariables(allVariables);
+	else
+		addFaceVariables(allVariables);
+
+	std::vector<double>   dummy(allVariables.size(), 0);
+	std::set<std::string> used;
+	std::string           errors;
+	for (std::size_t e = 0; e < expressions.size(); ++e) {
+		Parser p;
+		for (std::size_t i = 0; i < allVariables.size(); ++i)
+			p.DefineVar(conversion::fromStringToWString(allVariables[i].name), &dummy[i]);
+		try {
+			// evaluating once also reports the undefined variables, that are
+			// silently ignored by GetUsedVar
+			p.SetExpr(conversion::fromStringToWString(expressions[e]));
+			p.Eval();
+			for (const auto& var : p.GetUsedVar())
+				used.insert(conversion::fromWStringToString(var.first));
+		}
+		catch (Parser::exception_type& ex) {
+			if (e < labels.size())
+				errors += labels[e];
+			errors += conversion::fromWStringToString(ex.GetMsg()) + "\n";
+		}
+	}
+	if (!errors.empty())
+		throw MLException(QString::fromStdString(errors));
+
+	for (Variable& var : allVariables)
+		if (used.count(var.name) > 0)
+			variables.push_back(std::move(var));
+}
+
+/**
+ * @brief Evaluates the expressions on all the non deleted elements for which
+ * filter returns true, and calls store with the index of the element and the
+ * values of the expressions (in the order given in the constructor).
+ *
+ * filter and store are called concurrently by several threads, but always
+ * on different elements; store must not change the values read by the
+ * variables of other elements.
+ */
+void ParallelEvaluator::evaluate(
+	const std::function<bool(std::size_t)>&                 filter,
+	const std::function<void(std::size_t, const double*)>& store,
+	vcg::CallBackPos*                                       cb) const
+{
+	const std::size_t n = type == PER_VERTEX ? m.vert.size() : m.face.size();
+	const std::size_t nBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	if (nBlocks == 0)
+		return;
+
+	// per thread values of the used variables, results of the expressions,
+	// and the parsers that read them. The parsers are evaluated one element
+	// at a time: the bulk mode of muparser runs its own OpenMP loop, that
+	// must not be nested in these threads
+	struct ThreadData
+	{
+		std::vector<double>                  values;
+		std::vector<double>                  results;
+		std::vector<std::unique_ptr<Parser>> parsers;
+	};
+	std::vector<ThreadData> threadData(meshlab::threadCount(nBlocks));
+
+	meshlab::parallelFor(
+		nBlocks,
+		[&](std::size_t b, unsigned int thread) {
+			ThreadData& d = threadData[thread];
+			try {
+				if (d.parsers.size() != expressions.size()) {
+					d.values.resize(variables.size());
+					d.results.resize(expressions.size());
+					for (const std::string& expr : expressions) {
+						d.parsers.emplace_back(new Parser());
+						for (std::size_t v = 0; v < variables.size(); ++v)
+							d.parsers.back()->DefineVar(
+								conversion::fromStringToWString(variables[v].name), &d.values[v]);
+						d.parsers.back()->SetExpr(conversion::fromStringToWString(expr));
+					}
+				}
+
+				const std::size_t end = std::min(n, (b + 1) * BLOCK_SIZE);
+				for (std::size_t i = b * BLOCK_SIZE; i < end; ++i) {
+					bool deleted = type == PER_VERTEX ? m.vert[i].IsD() : m.face[i].IsD();
+					if (deleted || !filter(i))
+						continue;
+					for (std::size_t v = 0; v < variables.size(); ++v)
+						d.values[v] = variables[v].value(i);
+					for (std::size_t e = 0; e < d.parsers.size(); ++e)
+						d.results[e] = d.parsers[e]->Eval();
+					store(i, d.results.data());
+				}
+			}
+			catch (Parser::exception_type& e) {
+				throw MLException(conversion::fromWStringToString(e.GetMsg()).c_str());
+			}
+		},
+		cb, 0, 100, "Evaluating expressions");
+}
+
+void ParallelEvaluator::addVertexVariables(std::vector<Variable>& vars) const
+{
+	CMeshO& m = this->m;
+	for (int k = 0; k < 3; ++k) {
+		std::string c(1, "xyz"[k]);
+		vars.push_back({c, [&m, k](std::size_t i) { return double(m.vert[i].P()[k]); }});
+		vars.push_back({"n" + c, [&m, k](std::size_t i) { return double(m.vert[i].N()[k]); }});
+	}
+	for (int k = 0; k < 4; ++k) {
+		vars.push_back(
+			{std::string(1, "rgba"[k]), [&m, k](std::size_t i) { return double(m.vert[i].C()[k]); }});
+	}
+	vars.push_back({"q", [&m](std::size_t i) { return double(m.vert[i].Q()); }});
+	vars.push_back({"vi", [](std::size_t i) { return double(i); }});
+	if (tri::HasPerVertexTexCoord(m)) {
+		vars.push_back({"vtu", [&m](std::size_t i) { return double(m.vert[i].T().U()); }});
+		vars.push_back({"vtv", [&m](std::size_t i) { return double(m.vert[i].T().V()); }});
+		vars.push_back({"ti", [&m](std::size_t i) { return double(m.vert[i].T().N()); }});
+	}
+	else {
+		for (const char* name : {"vtu", "vtv", "ti"})
+			vars.push_back({name, [](std::size_t) { return 0.0; }});
+	}
+	vars.push_back({"vsel", [&m](std::size_t i) { return m.vert[i].IsS() ? 1.0 : 0.0; }});
+
+	// user-defined attributes
+	std::vector<std::string> names;
+	tri::Allocator<CMeshO>::GetAllPerVertexAttribute<Scalarm>(m, names);
+	for (const std::string& name : names) {
+		CMeshO::PerVertexAttributeHandle<Scalarm> h =
+			tri::Allocator<CMeshO>::GetPerVertexAttribute<Scalarm>(m, name);
+		vars.push_back({name, [h](std::size_t i) mutable { return double(h[i]); }});
+	}
+	names.clear();
+	tri::Allocator<CMeshO>::GetAllPerVertexAttribute<Point3m>(m, names);
+	for (const std::string& name : names) {
+		CMeshO::PerVertexAttributeHandle<Point3m> h =
+			tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3m>(m, name);
+		for (int k = 0; k < 3; ++k) {
+			vars.push_back(
+				{name + "_" + "xyz"[k], [h, k](std::size_t i) mutable { return double(h[i][k]); }});
+		}
+	}
+}
+
+void ParallelEvaluator::addFaceVariables(std::vector<Variable>& vars) const
+{
+	CMeshO& m = this->m;
+	// attributes of the three vertices of the face
+	for (int j = 0; j < 3; ++j) {
+		std::string idx = std::to_string(j);
+		for (int k = 0; k < 3; ++k) {
+			std::string c(1, "xyz"[k]);
+			vars.push_back({c + idx, [&m, j, k](std::size_t i) { return double(m.face[i].V(j)->P()[k]); }});
+			vars.push_back(
+				{"n" + c + idx, [&m, j, k](std::size_t i) { return double(m.face[i].V(j)->N()[k]); }});
+		}
+		for (int k = 0; k < 4; ++k) {
+			vars.push_back({std::string(1, "rgba"[k]) + idx, [&m, j, k](std::size_t i) {
+								return double(m.face[i].V(j)->C()[k]);
+							}});
+		}
+		vars.push_back({"q" + idx, [&m, j](std::size_t i) { return double(m.face[i].V(j)->Q()); }});
+		vars.push_back({"vi" + idx, [&m, j](std::size_t i) {
+							return double(m.face[i].V(j) - &m.vert[0]);
+						}});
+		vars.push_back({"vsel" + idx, [&m, j](std::size_t i) {
+							return m.face[i].V(j)->IsS() ? 1.0 : 0.0;
+						}});
+		if (tri::HasPerWedgeTexCoord(m)) {
+			vars.push_back({"wtu" + idx, [&m, j](std::size_t i) { return double(m.face[i].WT(j).U()); }});
+			vars.push_back({"wtv" + idx, [&m, j](std::size_t i) { return double(m.face[i].WT(j).V()); }});
+		}
+		else {
+			vars.push_back({"wtu" + idx, [](std::size_t) { return 0.0; }});
+			vars.push_back({"wtv" + idx, [](std::size_t) { return 0.0; }});
+		}
+	}
+	if (tri::HasPerWedgeTexCoord(m))
+		vars.push_back({"ti", [&m](std::size_t i) { return double(m.face[i].WT(0).N()); }});
+	else
+		vars.push_back({"ti", [](std::size_t) { return 0.0; }});
+
+	// attributes of the face
+	for (int k = 0; k < 4; ++k) {
+		std::string name = std::string("f") + "rgba"[k];
+		if (tri::HasPerFaceColor(m))
+			vars.push_back({name, [&m, k](std::size_t i) { return double(m.face[i].C()[k]); }});
+		else
+			vars.push_back({name, [](std::size_t) { return 255.0; }});
+	}
+	for (int k = 0; k < 3; ++k) {
+		vars.push_back({std::string("fn") + "xyz"[k], [&m, k](std::size_t i) {
+							return double(m.face[i].N()[k]);
+						}});
+	}
+	if (tri::HasPerFaceQuality(m))
+		vars.push_back({"fq", [&m](std::size_t i) { return double(m.face[i].Q()); }});
+	else
+		vars.push_back({"fq", [](std::size_t) { return 0.0; }});
+	vars.push_back({"fi", [](std::size_t i) { return double(i); }});
+	vars.push_back({"fsel", [&m](std::size_t i) { return m.face[i].IsS() ? 1.0 : 0.0; }});
+
+	// user-defined attributes
+	std::vector<std::string> names;
+	tri::Allocator<CMeshO>::GetAllPerFaceAttribute<Scalarm>(m, names);
+	for (const std::string& name : names) {
+		CMeshO::PerFaceAttributeHandle<Scalarm> h =
+			tri::Allocator<CMeshO>::GetPerFaceAttribute<Scalarm>(m, name);
+		vars.push_back({name, [h](std::size_t i) mutable { return double(h[i]); }});
+	}
+	names.clear();
+	tri::Allocator<CMeshO>::GetAllPerFaceAttribute<Point3m>(m, names);
+	for (const std::string& name : names) {
+		CMeshO::PerFaceAttributeHandle<Point3m> h =
+			tri::Allocator<CMeshO>::GetPerFaceAttribute<Point3m>(m, name);
+		for (int k = 0; k < 3; ++k) {
+			vars.push_back(
+				{name + "_" + "xyz"[k], [h, k](std::size_t i) mutable { return double(h[i][k]); }});
+		}
+	}
+}
@@ -0,0 +1,81 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef FILTER_FUNC_PARALLEL_EVALUATOR_H
+#define FILTER_FUNC_PARALLEL_EVALUATOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+
+/**
+ * @brief The ParallelEvaluator class evaluates a set of muparser expressions over
+ * all the vertices (or all the faces) of a mesh.
+ *
+ * Elements are processed in blocks of BLOCK_SIZE, in parallel: each thread
+ * has its own parsers, bound to its own copy of the variables used by the
+ * expressions, and evaluates them one element at a time.
+ *
+ * The available variables are the ones documented in the filter info:
+ * x, y, z, nx, ny, nz, r, g, b, a, q, vi, vtu, vtv, ti, vsel and the custom
+ * attributes for vertices; x0..z2, nx0..nz2, r0..a2, q0..q2, fr, fg, fb, fa,
+ * fnx, fny, fnz, fq, fi, vi0..vi2, wtu0..wtv2, ti, vsel0..vsel2, fsel and the
+ * custom attributes for faces.
+ */
+class ParallelEvaluator
+{
+public:
+	enum ElementType { PER_VERTEX, PER_FACE };
+
+	static const int BLOCK_SIZE = 4096;
+
+	ParallelEvaluator(
+		CMeshO&                         m,
+		ElementType                     type,
+		const std::vector<std::string>& expressions,
+		const std::vector<std::string>& labels = std::vector<std::string>());
+
+	void evaluate(
+		const std::function<bool(std::size_t)>&                 filter,
+		const std::function<void(std::size_t, const double*)>& store,
+		vcg::CallBackPos*                                       cb = nullptr) const;
+
+private:
+	struct Variable
+	{
+		std::string                        name;
+		std::function<double(std::size_t)> value;
+	};
+
+	void addVertexVariables(std::vector<Variable>& vars) const;
+	void addFaceVariables(std::vector<Variable>& vars) const;
+
+	CMeshO&                  m;
+	ElementType              type;
+	std::vector<std::string> expressions;
+	std::vector<Variable>    variables; // only the ones used by the expressions
+};
+
+#endif // FILTER_FUNC_PARALLEL_EVALUATOR_H
@@ -148,8 +148,12 @@ std::map<std::string, QVariant> FilterGeodesic::applyFilter(const QAction *filte
 
 		// Now actually compute the geodesic distance from the closest point
 		Scalarm dist_thr = par.getAbsPerc("maxDistance");
-		tri::EuclideanDistance<CMeshO> dd;
-		tri::Geodesic<CMeshO>::Compute(m.cm, vector<CVertexO*>(1,startVertex),dd,dist_thr);
+		if (par.getBool("heatMethod"))
+			heatGeodesicDistance(m, vector<CVertexO*>(1,startVertex), dist_thr);
+		else {
+			tri::EuclideanDistance<CMeshO> dd;
+			tri::Geodesic<CMeshO>::Compute(m.cm, vector<CVertexO*>(1,startVertex),dd,dist_thr);
+		}
 
 		// Cleaning Quality value of the unreferenced vertices
 		// Unreached vertices has a quality that is maxfloat
@@ -176,7 +180,19 @@ std::map<std::string, QVariant> FilterGeodesic::applyFilter(const QAction *filte
 		tri::UpdateFlags<CMeshO>::FaceBorderFromVF(m.cm);
 		tri::UpdateFlags<CMeshO>::VertexBorderFromFaceBorder(m.cm);
 
-		bool ret = tri::Geodesic<CMeshO>::DistanceFromBorder(m.cm);
+		bool ret;
+		if (par.getBool("heatMethod")) {
+			std::vector<CMeshO::VertexPointer> borderVec;
+			ForEachVertex(m.cm, [&borderVec] (CMeshO::VertexType & v) {
+				if (v.IsB())
+					borderVec.push_back(&v);
+			});
+			ret = !borderVec.empty();
+			if (ret)
+				heatGeodesicDistance(m, borderVec, 0);
+		}
+		else
+			ret = tri::Geodesic<CMeshO>::DistanceFromBorder(m.cm);
 
 		// Cleaning Quality value of the unreferenced vertices
 		// Unreached vertices has a quality that is maxfloat
@@ -213,8 +229,12 @@ std::map<std::string, QVariant> FilterGeodesic::applyFilter(const QAction *filte
 		if (seedVec.size() > 0)
 		{
 			Scalarm dist_thr = par.getAbsPerc("maxDistance");
-			tri::EuclideanDistance<CMeshO> dd;
-			tri::Geodesic<CMeshO>::Compute(m.cm, seedVec, dd, dist_thr);
+			if (par.getBool("heatMethod"))
+				heatGeodesicDistance(m, seedVec, dist_thr);
+			else {
+				tri::EuclideanDistance<CMeshO> dd;
+				tri::Geodesic<CMeshO>::Compute(m.cm, seedVec, dd, dist_thr);
+			}
 
 			// Cleaning Quality value of the unreferenced vertices
 			// Unreached vertices has a quality that is maxfloat
@@ -249,12 +269,17 @@ RichParameterList FilterGeodesic::initParameterList(const QAction *action, const
 	RichParameterList parlst;
 	switch(ID(action))
 	{
+	case FP_QUALITY_BORDER_GEODESIC :
+		parlst.addParam(RichBool("heatMethod",false,"Heat method","If true the distance is computed with the heat method: it needs the factorization of two sparse systems, that is kept for the following computations on the same mesh, as long as it is not modified; then each computation is much faster."));
+		break;
 	case FP_QUALITY_POINT_GEODESIC :
 		parlst.addParam(RichPosition("startPoint",m.cm.bbox.min,"Starting point","The starting point from which geodesic distance has to be computed. If it is not a surface vertex, the closest vertex to the specified point is used as starting seed point."));
 		parlst.addParam(RichPercentage("maxDistance",m.cm.bbox.Diag(),0,m.cm.bbox.Diag()*2,"Max Distance","If not zero it indicates a cut off value to be used during geodesic distance computation."));
+		parlst.addParam(RichBool("heatMethod",false,"Heat method","If true the distance is computed with the heat method: it needs the factorization of two sparse systems, that is kept for the following computations on the same mesh, as long as it is not modified; then each computation is much faster."));
 		break;
 	case FP_QUALITY_SELECTED_GEODESIC :
 		parlst.addParam(RichPercentage("maxDistance",m.cm.bbox.Diag(),0,m.cm.bbox.Diag()*2,"Max Distance","If not zero it indicates a cut off value to be used during geodesic distance computation."));
+		parlst.addParam(RichBool("heatMethod",false,"Heat method","If true the distance is computed with the heat method: it needs the factorization of two sparse systems, that is kept for the following computations on the same mesh, as long as it is not modified; then each computation is much faster."));
 		break;
 	default: break; // do not add any parameter for the other filters
 	}
@@ -271,4 +296,87 @@ int FilterGeodesic::postCondition(const QAction * filter) const
 	default                            : return MeshModel::MM_ALL;
 	}
 }
+/**
+ * @brief Stores in the quality of the vertices the heat method geodesic
+ * distance from the seeds; the vertices that are not reached, or farther than
+ * maxDistance (if not zero), get the maximum value, like in tri::Geodesic.
+ *
+ * The solver is built again only if the mesh, or its geometry, changed since
+ * the last call.
+ */
+void FilterGeodesic::heatGeodesicDistance(MeshModel& m, const std::vector<CVertexO*>& seeds, Scalarm maxDistance)
+{
+	CMeshO& cm = m.cm;
+
+	std::uint64_t key = 14695981039346656037ULL; // FNV-1a
+	auto hash = [&key](const void* data, std::size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; ++i)
+			key = (key ^ bytes[i]) * 1099511628211ULL;
+	};
+	for (const CVertexO& v : cm.vert)
+		if (!v.IsD())
+			hash(&v.cP(), sizeof(Point3m));
+	for (const CFaceO& f : cm.face) {
+		if (!f.IsD()) {
+			for (int j = 0; j < 3; ++j) {
+				std::size_t vi = f.cV(j) - &cm.vert[0];
+				hash(&vi, sizeof(vi));
+			}
+		}
+	}
+
+	if (!heatGeodesic || heatGeodesicMeshId != m.id() || heatGeodesicKey != key) {
+		heatGeodesic.reset();
+		// only the vertices referenced by the faces are part of the systems
+		heatGeodesicIndex.assign(cm.vert.size(), -1);
+		int nVertices = 0;
+		for (const CFaceO& f : cm.face)
+			if (!f.IsD())
+				for (int j = 0; j < 3; ++j) {
+					int& index = heatGeodesicIndex[f.cV(j) - &cm.vert[0]];
+					if (index < 0)
+						index = nVertices++;
+				}
+		Eigen::MatrixX3d V(nVertices, 3);
+		for (std::size_t i = 0; i < cm.vert.size(); ++i)
+			if (heatGeodesicIndex[i] >= 0)
+				for (int k = 0; k < 3; ++k)
+					V(heatGeodesicIndex[i], k) = cm.vert[i].cP()[k];
+		Eigen::MatrixX3i F(cm.fn, 3);
+		int fi = 0;
+		for (const CFaceO& f : cm.face)
+			if (!f.IsD()) {
+				for (int j = 0; j < 3; ++j)
+					F(fi, j) = heatGeodesicIndex[f.cV(j) - &cm.vert[0]];
+				++fi;
+			}
+
+		heatGeodesic.reset(new HeatGeodesic(V, F));
+		heatGeodesicMeshId = m.id();
+		heatGeodesicKey = key;
+		log("Heat method: factorized the systems of %i vertices", nVertices);
+	}
+
+	std::vector<int> seedSet;
+	for (CVertexO* s : seeds) {
+		int index = heatGeodesicIndex[s - &cm.vert[0]];
+		if (index >= 0)
+			seedSet.push_back(index);
+	}
+	Eigen::MatrixXd distances = heatGeodesic->distances({seedSet});
+
+	const Scalarm unreached = std::numeric_limits<Scalarm>::max();
+	for (std::size_t i = 0; i < cm.vert.size(); ++i) {
+		if (cm.vert[i].IsD())
+			continue;
+		const int index = heatGeodesicIndex[i];
+		const double d = index >= 0 ? distances(index, 0) : std::numeric_limits<double>::infinity();
+		if (d == std::numeric_limits<double>::infinity() || (maxDistance > 0 && d > maxDistance))
+			cm.vert[i].Q() = unreached;
+		else
+			cm.vert[i].Q() = d;
+	}
+}
+
 MESHLAB_PLUGIN_NAME_EXPORTER(FilterGeodesic)
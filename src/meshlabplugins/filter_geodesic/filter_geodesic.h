@@ -27,6 +27,11 @@
 #include <common/plugins/interfaces/filter_plugin.h>
 #include <vcg/complex/algorithms/geodesic.h>
 
+#include <cstdint>
+#include <memory>
+
+#include "heat_geodesic.h"
+
 
 class FilterGeodesic : public QObject, public FilterPlugin
 {
@@ -61,6 +66,15 @@ class FilterGeodesic : public QObject, public FilterPlugin
 	RichParameterList initParameterList(const QAction*, const MeshModel &/*m*/);
 	int postCondition(const QAction * filter) const;
 	FilterArity filterArity(const QAction*) const {return SINGLE_MESH;}
+
+private:
+	void heatGeodesicDistance(MeshModel& m, const std::vector<CVertexO*>& seeds, Scalarm maxDistance);
+
+	// heat method factorization of the last mesh, kept until its geometry changes
+	std::unique_ptr<HeatGeodesic> heatGeodesic;
+	int heatGeodesicMeshId = -1;
+	std::uint64_t heatGeodesicKey = 0;
+	std::vector<int> heatGeodesicIndex; // index in the solver of each vertex, -1 if unreferenced
 };
 
 
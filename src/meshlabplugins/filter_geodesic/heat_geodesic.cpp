@@ -0,0 +1,174 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+#include "heat_geodesic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <common/mlexception.h>
+
+namespace {
+
+int findRoot(std::vector<int>& parent, int i)
+{
+	while (parent[i] != i)
+		i = parent[i] = parent[parent[i]];
+	return i;
+}
+
+}
+
+HeatGeodesic::HeatGeodesic(const Eigen::MatrixX3d& positions, const Eigen::MatrixX3i& triangles, double timeFactor) :
+		V(positions), F(triangles), cotangents(F.rows(), 3), mass(Eigen::VectorXd::Zero(V.rows()))
+{
+	const int n = V.rows();
+	if (n == 0 || F.rows() == 0)
+		throw MLException("Heat method geodesic: the mesh has no faces.");
+
+	std::vector<Eigen::Triplet<double>> triplets;
+	triplets.reserve(F.rows() * 12);
+	double edgeSum = 0;
+	for (int f = 0; f < F.rows(); ++f) {
+		for (int c = 0; c < 3; ++c) {
+			const int i = F(f, c), j = F(f, (c + 1) % 3), k = F(f, (c + 2) % 3);
+			const Eigen::Vector3d a = V.row(j) - V.row(i);
+			const Eigen::Vector3d b = V.row(k) - V.row(i);
+			const double crossNorm = a.cross(b).norm();
+			// degenerate triangles do not contribute to the Laplacian
+			const double cot = crossNorm > 0 ? a.dot(b) / crossNorm : 0;
+			cotangents(f, c) = cot;
+			mass(i) += crossNorm / 6;
+			edgeSum += (V.row(j) - V.row(k)).norm();
+
+			// the angle at i weights the opposite edge jk
+			triplets.emplace_back(j, k, -cot / 2);
+			triplets.emplace_back(k, j, -cot / 2);
+			triplets.emplace_back(j, j, cot / 2);
+			triplets.emplace_back(k, k, cot / 2);
+		}
+	}
+	Eigen::SparseMatrix<double> L(n, n);
+	L.setFromTriplets(triplets.begin(), triplets.end());
+
+	// vertices of degenerate triangles only must not make the systems singular
+	const double minMass = 1e-12 * mass.sum() / n;
+	for (int i = 0; i < n; ++i)
+		mass(i) = std::max(mass(i), minMass);
+	Eigen::SparseMatrix<double> M(n, n);
+	std::vector<Eigen::Triplet<double>> diagonal;
+	diagonal.reserve(n);
+	for (int i = 0; i < n; ++i)
+		diagonal.emplace_back(i, i, mass(i));
+	M.setFromTriplets(diagonal.begin(), diagonal.end());
+
+	const double h = edgeSum / (3 * F.rows());
+	const double t = timeFactor * h * h;
+
+	heatSolver.compute(M + t * L);
+	if (heatSolver.info() != Eigen::Success)
+		throw MLException("Heat method geodesic: the factorization of the heat flow failed.");
+	// L is singular (constants on each component): a tiny shift makes it definite
+	poissonSolver.compute(L + (1e-8 / t) * M);
+	if (poissonSolver.info() != Eigen::Success)
+		throw MLException("Heat method geodesic: the factorization of the Laplacian failed.");
+
+	std::vector<int> parent(n);
+	std::iota(parent.begin(), parent.end(), 0);
+	for (int f = 0; f < F.rows(); ++f)
+		for (int c = 1; c < 3; ++c)
+			parent[findRoot(parent, F(f, c))] = findRoot(parent, F(f, 0));
+	component.assign(n, -1);
+	std::vector<int> rootComponent(n, -1);
+	nComponents = 0;
+	for (int i = 0; i < n; ++i) {
+		int& c = rootComponent[findRoot(parent, i)];
+		if (c < 0)
+			c = nComponents++;
+		component[i] = c;
+	}
+}
+
+Eigen::MatrixXd HeatGeodesic::distances(const std::vector<std::vector<int>>& seedSets) const
+{
+	const int n = V.rows();
+	const int k = seedSets.size();
+
+	// heat flow from the seeds
+	Eigen::MatrixXd rhs = Eigen::MatrixXd::Zero(n, k);
+	for (int s = 0; s < k; ++s)
+		for (int v : seedSets[s])
+			rhs(v, s) = 1;
+	const Eigen::MatrixXd u = heatSolver.solve(rhs);
+
+	// divergence of the normalized gradient field of the heat
+	Eigen::MatrixXd div = Eigen::MatrixXd::Zero(n, k);
+	for (int f = 0; f < F.rows(); ++f) {
+		const Eigen::Vector3d p[3] = {V.row(F(f, 0)), V.row(F(f, 1)), V.row(F(f, 2))};
+		Eigen::Vector3d normal = (p[1] - p[0]).cross(p[2] - p[0]);
+		const double doubleArea = normal.norm();
+		if (!(doubleArea > 0))
+			continue;
+		normal /= doubleArea;
+		for (int s = 0; s < k; ++s) {
+			Eigen::Vector3d grad = Eigen::Vector3d::Zero();
+			for (int c = 0; c < 3; ++c)
+				grad += u(F(f, c), s) * normal.cross(p[(c + 2) % 3] - p[(c + 1) % 3]);
+			const double gradNorm = grad.norm();
+			if (!(gradNorm > 0))
+				continue;
+			const Eigen::Vector3d X = -grad / gradNorm;
+			for (int c = 0; c < 3; ++c) {
+				const int j = (c + 1) % 3, l = (c + 2) % 3;
+				div(F(f, c), s) += 0.5 * (cotangents(f, l) * (p[j] - p[c]).dot(X) +
+				                          cotangents(f, j) * (p[l] - p[c]).dot(X));
+			}
+		}
+	}
+
+	// Poisson equation L phi = -div, made consistent on each component
+	for (int s = 0; s < k; ++s) {
+		std::vector<double> divSum(nComponents, 0), massSum(nComponents, 0);
+		for (int i = 0; i < n; ++i) {
+			divSum[component[i]] += div(i, s);
+			massSum[component[i]] += mass(i);
+		}
+		for (int i = 0; i < n; ++i)
+			div(i, s) = -div(i, s) + mass(i) * divSum[component[i]] / massSum[component[i]];
+	}
+	Eigen::MatrixXd phi = poissonSolver.solve(div);
+
+	// distances are zero on the nearest seed of each component
+	const double inf = std::numeric_limits<double>::infinity();
+	for (int s = 0; s < k; ++s) {
+		std::vector<double> offset(nComponents, inf);
+		for (int v : seedSets[s])
+			offset[component[v]] = std::min(offset[component[v]], phi(v, s));
+		for (int i = 0; i < n; ++i) {
+			const double o = offset[component[i]];
+			phi(i, s) = o == inf ? inf : std::max(phi(i, s) - o, 0.0);
+		}
+	}
+	return phi;
+}
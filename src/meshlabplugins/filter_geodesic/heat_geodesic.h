@@ -0,0 +1,74 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef FILTERGEODESIC_HEAT_GEODESIC_H
+#define FILTERGEODESIC_HEAT_GEODESIC_H
+
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <Eigen/Sparse>
+
+/**
+ * @brief Geodesic distances on a triangle mesh with the heat method (Crane,
+ * Weischedel, Wardetzky, "Geodesics in Heat", 2013).
+ *
+ * The constructor builds the cotangent Laplacian and the lumped mass matrix
+ * of the mesh, and factorizes the two systems of the method: the heat flow
+ * (M + tL) and the Poisson equation (L). Then each query costs two back
+ * substitutions, and many seed sets can be solved as a single batch.
+ *
+ * The heat flow uses Neumann boundary conditions. The distances are computed
+ * separately on each connected component; the vertices of the components
+ * without seeds are not reached.
+ */
+class HeatGeodesic
+{
+public:
+	/**
+	 * @param positions: the vertex positions
+	 * @param triangles: the indices of the vertices of the triangles; every vertex must be referenced
+	 * @param timeFactor: the heat flow time, relative to the squared mean
+	 * edge length
+	 */
+	HeatGeodesic(const Eigen::MatrixX3d& positions, const Eigen::MatrixX3i& triangles, double timeFactor = 1);
+
+	/**
+	 * @brief The distances from each set of seeds (indices in V): a column
+	 * for each set, +infinity on the vertices that are not reached.
+	 */
+	Eigen::MatrixXd distances(const std::vector<std::vector<int>>& seedSets) const;
+
+private:
+	Eigen::MatrixX3d V;
+	Eigen::MatrixX3i F;
+	Eigen::MatrixX3d cotangents; // of the angle at each corner of the triangles
+	Eigen::VectorXd  mass;
+	std::vector<int> component;  // connected component of each vertex
+	int              nComponents;
+
+	Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> heatSolver;
+	Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> poissonSolver;
+};
+
+#endif // FILTERGEODESIC_HEAT_GEODESIC_H
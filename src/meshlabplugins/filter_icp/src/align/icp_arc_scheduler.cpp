@@ -0,0 +1,324 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "icp_arc_scheduler.h"
+#include "overlap_grid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <set>
+
+#include <QElapsedTimer>
+
+#include <common/mlexception.h>
+#include <common/utilities/parallel.h>
+
+struct IcpArcScheduler::FixedMesh
+{
+	vcg::AlignPair::A2Mesh mesh;
+	vcg::AlignPair::A2Grid grid;
+	vcg::AlignPair::A2GridVert gridVert;
+	std::size_t bytes = 0;
+	bool inUse = false;
+	unsigned long long lastUse = 0;
+};
+
+IcpArcScheduler::IcpArcScheduler(MeshTreem& meshTree, std::size_t cacheBudget) :
+	meshTree(meshTree), cacheBudget(cacheBudget), cacheSize(0), useCounter(0)
+{
+}
+
+IcpArcScheduler::~IcpArcScheduler()
+{
+}
+
+const std::vector<IcpArcScheduler::ArcInfo>& IcpArcScheduler::arcs() const
+{
+	return arcInfos;
+}
+
+/**
+ * @brief Computes the overlapping arcs among the glued meshes of the tree,
+ * aligns them concurrently and then runs the global alignment, that updates
+ * the transformation matrices of the meshes.
+ * Throws a MLException if there are no overlapping arcs or if none of them
+ * could be aligned.
+ */
+void IcpArcScheduler::process(
+		vcg::AlignPair::Param& ap,
+		MeshTreem::Param&      mtp,
+		vcg::CallBackPos*      cb)
+{
+	arcInfos.clear();
+
+	// the meshes are accessed by the worker threads only through this map
+	std::map<int, MeshModel*> meshes;
+	Box3m bb;
+	for (auto& ni : meshTree.nodeMap) {
+		MeshTreem::MeshNode* mn = ni.second;
+		if (mn->glued) {
+			mn->m->updateDataMask(MeshModel::MM_FACEMARK);
+			meshes[mn->m->id()] = mn->m;
+			bb.Add(mn->m->cm.Tr, mn->m->cm.bbox);
+		}
+	}
+
+	OverlapGrid og(bb, mtp.OGSize);
+	for (const auto& m : meshes)
+		og.addMesh(m.second->cm, m.first);
+	og.compute(cb);
+
+	// the arcs are sorted by decreasing overlap
+	std::vector<std::pair<int, int>> arcs;
+	std::vector<float> arcAreas;
+	for (const OverlapGrid::Arc& arc : og.arcs()) {
+		if (arc.normArea <= mtp.arcThreshold)
+			break;
+		arcs.push_back(std::make_pair(arc.s, arc.t));
+		arcAreas.push_back(arc.normArea);
+	}
+	if (arcs.empty())
+		throw MLException("There are no overlapping meshes: no candidate alignment arcs.");
+
+	std::vector<vcg::AlignPair::Result> results(arcs.size());
+	arcInfos.resize(arcs.size());
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<bool> started(arcs.size(), false);
+	std::set<int> busyFixed;
+	std::size_t firstPending = 0, pending = arcs.size(), done = 0;
+	std::atomic<bool> abort(false);
+	std::exception_ptr error;
+
+	// next arc that can be aligned now (its fixed mesh is not used by
+	// another thread), preferring the ones with an already built grid;
+	// must be called with the mutex locked
+	auto pickArc = [&]() -> int {
+		int candidate = -1;
+		while (firstPending < arcs.size() && started[firstPending])
+			++firstPending;
+		for (std::size_t i = firstPending; i < arcs.size(); ++i) {
+			if (started[i] || busyFixed.count(arcs[i].first) > 0)
+				continue;
+			if (cache.count(arcs[i].first) > 0)
+				return (int) i;
+			if (candidate < 0)
+				candidate = (int) i;
+		}
+		return candidate;
+	};
+
+	auto worker = [&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!abort && pending > 0) {
+			int i = pickArc();
+			if (i < 0) {
+				// the timeout lets the thread see abort, set without notifying
+				// when the callback throws
+				changed.wait_for(lock, std::chrono::milliseconds(100));
+				continue;
+			}
+			const int fixId = arcs[i].first, movId = arcs[i].second;
+			started[i] = true;
+			--pending;
+			busyFixed.insert(fixId);
+
+			FixedMesh* fix = nullptr;
+			auto it = cache.find(fixId);
+			if (it != cache.end()) {
+				fix = it->second.get();
+				fix->inUse = true;
+			}
+			lock.unlock();
+
+			std::unique_ptr<FixedMesh> built;
+			QElapsedTimer timer;
+			timer.start();
+			try {
+				vcg::AlignPair::Param arcParam = ap;
+				if (fix == nullptr) {
+					built = buildFixedMesh(*meshes.at(fixId), arcParam);
+					fix = built.get();
+				}
+				alignArc(*fix, *meshes.at(fixId), *meshes.at(movId), arcParam, results[i]);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> errorLock(mutex);
+				if (!error)
+					error = std::current_exception();
+				abort = true;
+			}
+
+			ArcInfo& info = arcInfos[i];
+			info.fixId = fixId;
+			info.movId = movId;
+			info.seconds = timer.elapsed() / 1000.0;
+			info.cachedFix = !built;
+			info.valid = results[i].isValid();
+			info.err = results[i].err;
+			if (!info.valid)
+				info.status = vcg::AlignPair::errorMsg(results[i].status);
+
+			lock.lock();
+			if (built) {
+				cacheSize += built->bytes;
+				fix = built.get();
+				cache[fixId] = std::move(built);
+			}
+			if (fix != nullptr) {
+				fix->inUse = false;
+				fix->lastUse = ++useCounter;
+			}
+			evictFixedMeshes();
+			busyFixed.erase(fixId);
+			++done;
+			changed.notify_all();
+		}
+	};
+
+	// the static data used by AlignPair for the similarity matching is not
+	// thread safe: in that case the arcs are aligned one at a time
+	unsigned int nThreads = 1;
+	if (ap.MatchMode == vcg::AlignPair::Param::MMRigid)
+		nThreads = meshlab::threadCount(arcs.size());
+	meshlab::runThreads(
+		nThreads,
+		[&](unsigned int) { worker(); },
+		[&]() {
+			std::size_t d;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				d = done;
+			}
+			if (cb)
+				cb(int(90 * d / arcs.size()), "Aligning arcs");
+		},
+		abort);
+	cache.clear();
+	cacheSize = 0;
+	if (error)
+		std::rethrow_exception(error);
+
+	bool hasValidAlign = false;
+	meshTree.resultList.clear();
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		results[i].area = arcAreas[i];
+		hasValidAlign |= results[i].isValid();
+		meshTree.resultList.push_back(results[i]);
+	}
+	if (!hasValidAlign)
+		throw MLException("None of the candidate alignment arcs could be aligned: nothing done.");
+
+	if (cb)
+		cb(90, "Global alignment");
+	meshTree.ProcessGlobal(ap);
+}
+
+/**
+ * @brief Builds the A2Mesh of the given fixed mesh, in its local reference
+ * frame, and the uniform grid used for the closest point queries.
+ */
+std::unique_ptr<IcpArcScheduler::FixedMesh> IcpArcScheduler::buildFixedMesh(
+		MeshModel&             m,
+		vcg::AlignPair::Param& ap) const
+{
+	std::unique_ptr<FixedMesh> fix(new FixedMesh());
+	vcg::AlignPair aligner;
+	aligner.convertMesh<CMeshO>(m.cm, fix->mesh);
+
+	// rough estimate: the copy of the mesh plus a few pointers per element
+	// for the cells and the links of the grid
+	std::size_t gridElements;
+	if (m.cm.fn == 0 || ap.UseVertexOnly) {
+		fix->mesh.initVert(vcg::Matrix44d::Identity());
+		vcg::AlignPair::InitFixVert(&fix->mesh, ap, fix->gridVert);
+		gridElements = m.cm.vn;
+	}
+	else {
+		fix->mesh.init(vcg::Matrix44d::Identity());
+		vcg::AlignPair::initFix(&fix->mesh, ap, fix->grid);
+		gridElements = m.cm.fn;
+	}
+	fix->bytes =
+		fix->mesh.vert.size() * sizeof(vcg::AlignPair::A2Vertex) +
+		fix->mesh.face.size() * sizeof(vcg::AlignPair::A2Face) +
+		gridElements * 3 * sizeof(void*);
+	return fix;
+}
+
+/**
+ * @brief Runs the ICP of the moving mesh over the given fixed mesh. As in
+ * MeshTree::ProcessArc, the moving mesh is brought in the local reference
+ * frame of the fixed one, because the global alignment expects the
+ * results in that frame.
+ */
+void IcpArcScheduler::alignArc(
+		FixedMesh&              fix,
+		MeshModel&              fixMesh,
+		MeshModel&              movMesh,
+		vcg::AlignPair::Param&  ap,
+		vcg::AlignPair::Result& result) const
+{
+	vcg::Matrix44d fixM = vcg::Matrix44d::Construct(fixMesh.cm.Tr);
+	vcg::Matrix44d movM = vcg::Matrix44d::Construct(movMesh.cm.Tr);
+	vcg::Matrix44d movToFix = vcg::Inverse(fixM) * movM;
+
+	vcg::AlignPair aligner;
+	std::vector<vcg::AlignPair::A2Vertex> movVert;
+	aligner.convertVertex(movMesh.cm.vert, movVert);
+	aligner.sampleMovVert(movVert, ap.SampleNum, ap.SampleMode);
+
+	aligner.mov = &movVert;
+	aligner.fix = &fix.mesh;
+	aligner.ap = ap;
+
+	aligner.align(movToFix, fix.grid, fix.gridVert, result);
+
+	result.FixName = fixMesh.id();
+	result.MovName = movMesh.id();
+}
+
+/**
+ * @brief Releases the least recently used grids until the cache fits in
+ * its budget. Grids in use by a thread are never released, so the budget
+ * can be exceeded by at most one grid per thread.
+ */
+void IcpArcScheduler::evictFixedMeshes()
+{
+	while (cacheSize > cacheBudget) {
+		auto lru = cache.end();
+		for (auto it = cache.begin(); it != cache.end(); ++it) {
+			if (!it->second->inUse && (lru == cache.end() || it->second->lastUse < lru->second->lastUse))
+				lru = it;
+		}
+		if (lru == cache.end())
+			return;
+		cacheSize -= lru->second->bytes;
+		cache.erase(lru);
+	}
+}
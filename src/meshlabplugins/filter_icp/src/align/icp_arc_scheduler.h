@@ -0,0 +1,91 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ICP_ARC_SCHEDULER_H
+#define ICP_ARC_SCHEDULER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "icp_align_parameter.h"
+
+/**
+ * @brief The IcpArcScheduler class performs the same steps of
+ * MeshTree::Process (overlap computation with the occupancy grid, pairwise
+ * ICP of the overlapping arcs, global alignment), but the arcs are aligned on
+ * a pool of threads.
+ *
+ * Two arcs can be aligned at the same time only if they have a different
+ * fixed mesh: the closest point queries on the grid of the fixed mesh mark
+ * its faces, so the grid cannot be shared between threads.
+ *
+ * The A2Mesh and the search grid of a fixed mesh are built once and kept
+ * for all the arcs where the mesh is fixed (they are in the local reference
+ * frame of the mesh, so they do not depend on its current position).
+ * When the cached grids exceed the given memory budget, the least recently
+ * used ones are released.
+ */
+class IcpArcScheduler
+{
+public:
+	struct ArcInfo
+	{
+		int fixId;
+		int movId;
+		double seconds; // ICP time, including the build of a non cached grid
+		bool cachedFix;
+		bool valid;
+		double err;
+		std::string status;
+	};
+
+	IcpArcScheduler(MeshTreem& meshTree, std::size_t cacheBudget);
+	~IcpArcScheduler();
+
+	void process(vcg::AlignPair::Param& ap, MeshTreem::Param& mtp, vcg::CallBackPos* cb);
+
+	const std::vector<ArcInfo>& arcs() const;
+
+private:
+	struct FixedMesh;
+
+	std::unique_ptr<FixedMesh> buildFixedMesh(MeshModel& m, vcg::AlignPair::Param& ap) const;
+	void alignArc(
+		FixedMesh&                  fix,
+		MeshModel&                  fixMesh,
+		MeshModel&                  movMesh,
+		vcg::AlignPair::Param&      ap,
+		vcg::AlignPair::Result&     result) const;
+	void evictFixedMeshes();
+
+	MeshTreem& meshTree;
+	std::size_t cacheBudget;
+	std::size_t cacheSize;
+	unsigned long long useCounter;
+	std::map<int, std::unique_ptr<FixedMesh>> cache;
+	std::vector<ArcInfo> arcInfos;
+};
+
+#endif // ICP_ARC_SCHEDULER_H
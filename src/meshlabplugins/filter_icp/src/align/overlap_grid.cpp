@@ -0,0 +1,164 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "overlap_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <common/utilities/parallel.h>
+
+#include <vcg/space/index/grid_util.h>
+
+/**
+ * @brief Creates a grid over the given box with about size cells, with the
+ * same subdivision of vcg::OccupancyGrid.
+ */
+OverlapGrid::OverlapGrid(const Box3m& bbox, int size) : bbox(bbox)
+{
+	vcg::BestDim<Scalarm>((long long) std::max(size, 1), bbox.Dim(), siz);
+	for (int i = 0; i < 3; ++i)
+		voxel[i] = bbox.Dim()[i] / siz[i];
+	nCells = std::size_t(siz[0]) * siz[1] * siz[2];
+}
+
+/**
+ * @brief Adds a mesh, identified by the given id, to the ones whose overlaps
+ * are computed. The mesh is voxelized only by compute, so it must not be
+ * modified (or destroyed) before.
+ */
+void OverlapGrid::addMesh(const CMeshO& m, int id)
+{
+	meshes.push_back(MeshCells {&m, id, {}});
+}
+
+/**
+ * @brief Voxelizes the meshes and computes the overlapping arcs.
+ */
+void OverlapGrid::compute(vcg::CallBackPos* cb)
+{
+	std::sort(meshes.begin(), meshes.end(), [](const MeshCells& a, const MeshCells& b) {
+		return a.id < b.id;
+	});
+	arcList.clear();
+	if (meshes.empty())
+		return;
+
+	meshlab::parallelFor(
+		meshes.size(),
+		[&](std::size_t i, unsigned int) {
+			MeshCells&                 mc = meshes[i];
+			const CMeshO&              m  = *mc.mesh;
+			std::vector<std::uint64_t> occupied((nCells + 63) / 64, 0);
+			for (const CVertexO& v : m.vert) {
+				if (!v.IsD()) {
+					const std::uint32_t c = cellOf(m.Tr * v.cP());
+					occupied[c / 64] |= std::uint64_t(1) << (c % 64);
+				}
+			}
+			mc.cells.clear();
+			for (std::size_t w = 0; w < occupied.size(); ++w) {
+				std::uint64_t bits = occupied[w];
+				for (std::uint32_t b = 0; bits != 0; ++b, bits >>= 1) {
+					if (bits & 1)
+						mc.cells.push_back(std::uint32_t(w * 64 + b));
+				}
+			}
+		},
+		cb, 0, 50, "Voxelizing the meshes");
+
+	// the meshes occupying each cell, in increasing order
+	std::vector<std::uint32_t> cellBegin(nCells + 1, 0);
+	for (const MeshCells& mc : meshes)
+		for (std::uint32_t c : mc.cells)
+			++cellBegin[c + 1];
+	for (std::size_t c = 0; c < nCells; ++c)
+		cellBegin[c + 1] += cellBegin[c];
+	std::vector<std::uint32_t> cellMeshes(cellBegin[nCells]);
+	{
+		std::vector<std::uint32_t> fill(cellBegin.begin(), cellBegin.end() - 1);
+		for (std::size_t i = 0; i < meshes.size(); ++i)
+			for (std::uint32_t c : meshes[i].cells)
+				cellMeshes[fill[c]++] = i;
+	}
+
+	// the arcs of each mesh with the following ones
+	std::vector<std::vector<Arc>> meshArcs(meshes.size());
+	meshlab::parallelFor(
+		meshes.size(),
+		[&](std::size_t s, unsigned int) {
+			std::vector<int>           count(meshes.size(), 0);
+			std::vector<std::uint32_t> touched;
+			for (std::uint32_t c : meshes[s].cells) {
+				for (std::uint32_t k = cellBegin[c]; k < cellBegin[c + 1]; ++k) {
+					const std::uint32_t t = cellMeshes[k];
+					if (t > s && count[t]++ == 0)
+						touched.push_back(t);
+				}
+			}
+			std::sort(touched.begin(), touched.end());
+			const int sArea = int(meshes[s].cells.size());
+			for (std::uint32_t t : touched) {
+				const int tArea = int(meshes[t].cells.size());
+				meshArcs[s].push_back(
+					Arc {meshes[s].id, meshes[t].id, count[t], float(count[t]) / std::min(sArea, tArea)});
+			}
+		},
+		cb, 50, 100, "Computing the overlaps");
+
+	for (std::vector<Arc>& a : meshArcs)
+		arcList.insert(arcList.end(), a.begin(), a.end());
+	std::stable_sort(arcList.begin(), arcList.end(), [](const Arc& a, const Arc& b) {
+		return a.normArea > b.normArea;
+	});
+}
+
+/**
+ * @brief The overlapping arcs, sorted by decreasing normalized area.
+ */
+const std::vector<OverlapGrid::Arc>& OverlapGrid::arcs() const
+{
+	return arcList;
+}
+
+/**
+ * @brief The number of cells occupied by the mesh with the given id, or 0 if
+ * there is no such mesh or compute has not been called yet.
+ */
+int OverlapGrid::area(int id) const
+{
+	for (const MeshCells& mc : meshes)
+		if (mc.id == id)
+			return int(mc.cells.size());
+	return 0;
+}
+
+std::uint32_t OverlapGrid::cellOf(const Point3m& p) const
+{
+	int ip[3];
+	for (int i = 0; i < 3; ++i) {
+		ip[i] = voxel[i] > 0 ? int(std::floor((p[i] - bbox.min[i]) / voxel[i])) : 0;
+		ip[i] = std::min(std::max(ip[i], 0), siz[i] - 1);
+	}
+	return std::uint32_t(ip[0] + siz[0] * (ip[1] + siz[1] * ip[2]));
+}
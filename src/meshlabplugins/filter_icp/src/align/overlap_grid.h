@@ -0,0 +1,83 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef OVERLAP_GRID_H
+#define OVERLAP_GRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+
+/**
+ * @brief The OverlapGrid class computes the same overlaps of
+ * vcg::OccupancyGrid: the vertices of the meshes (with their transformation
+ * matrix applied) are voxelized in a grid of about the given number of cells,
+ * and two meshes overlap in the cells occupied by both.
+ *
+ * The meshes are voxelized concurrently, each one in a bitset of the cells,
+ * and stored as the sorted list of the cells they occupy. Then, for each cell,
+ * the list of the meshes occupying it is built, and the overlaps of each mesh
+ * with the following ones are counted concurrently by visiting the lists of
+ * its cells: the cost depends on the occupied cells only, not on the number of
+ * mesh pairs.
+ */
+class OverlapGrid
+{
+public:
+	struct Arc
+	{
+		int   s;        // id of the first mesh
+		int   t;        // id of the second mesh, greater than s
+		int   area;     // number of cells occupied by both the meshes
+		float normArea; // area over the smallest area of the two meshes
+	};
+
+	OverlapGrid(const Box3m& bbox, int size);
+
+	void addMesh(const CMeshO& m, int id);
+	void compute(vcg::CallBackPos* cb = nullptr);
+
+	const std::vector<Arc>& arcs() const;
+	int area(int id) const;
+
+private:
+	struct MeshCells
+	{
+		const CMeshO*              mesh;
+		int                        id;
+		std::vector<std::uint32_t> cells; // sorted
+	};
+
+	std::uint32_t cellOf(const Point3m& p) const;
+
+	Box3m        bbox;
+	Point3m      voxel;
+	vcg::Point3i siz;
+	std::size_t  nCells;
+
+	std::vector<MeshCells> meshes;  // sorted by id after compute
+	std::vector<Arc>       arcList; // sorted by decreasing normArea
+};
+
+#endif // OVERLAP_GRID_H
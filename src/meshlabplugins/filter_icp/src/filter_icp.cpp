@@ -22,6 +22,8 @@
 ****************************************************************************/
 
 #include "filter_icp.h"
+#include "align/icp_arc_scheduler.h"
+#include "align/overlap_grid.h"
 
 #define PAR_SOURCE_MESH         "SourceMesh"
 #define PAR_BASE_MESH           "BaseMesh"
@@ -29,8 +31,10 @@
 #define PAR_OG_SIZE             "OGSize"
 #define PAR_ONLY_VISIBLE_MESHES "OnlyVisibleMeshes"
 #define PAR_SAVE_LAST_ITERATION "SaveLastIteration"
+#define PAR_GRID_CACHE_SIZE     "GridCacheSize"
 
 #define DEFAULT_OG_SIZE 50000
+#define DEFAULT_GRID_CACHE_SIZE 1024
 
 /* Static variables needed by the vcg::AlignPair::align() method */
 std::vector<vcg::Point3d> *vcg::PointMatchingScale::fix;
@@ -214,6 +218,10 @@ RichParameterList FilterIcpPlugin::initParameterList(const QAction *action, cons
             parameterList.addParam(RichMesh(PAR_BASE_MESH, 0, &md, "Base Mesh", "The base mesh is the one who will stay fixed during the alignment process."));
             /**/
             parameterList.addParam(RichBool(PAR_ONLY_VISIBLE_MESHES, false, "Only visible meshes", "Apply the global alignment only to the visible meshes"));
+            /* Add the memory budget of the search grids kept between the arcs */
+            parameterList.addParam(RichInt(PAR_GRID_CACHE_SIZE, DEFAULT_GRID_CACHE_SIZE, "Grid Cache Size (MB)",
+                                           "The search grid of a mesh is built once and reused for all the arcs where the mesh is fixed. "
+                                           "This is the maximum amount of memory used for keeping these grids; with 0 every arc builds its own grid.", true));
 
             /* Add the Arc Creation Parameters */
             FilterIcpAlignParameter::MeshTreeParamToRichParameterSet(this->meshTreeParameters, parameterList);
@@ -266,11 +274,11 @@ std::map<std::string, QVariant> FilterIcpPlugin::applyFilter(
             FilterIcpAlignParameter::RichParameterSetToAlignPairParam(par, this->alignParameters);
             // Read the parameters for the New Arc Creation
             FilterIcpAlignParameter::RichParameterSetToMeshTreeParam(par, this->meshTreeParameters);
-            return globalAlignment(md, par);
+            return globalAlignment(md, par, cb);
         }
 
         case FP_OVERLAPPING_MESHES: {
-            return checkOverlappingMeshes(md, par);
+            return checkOverlappingMeshes(md, par, cb);
         }
 
         default: {
@@ -281,7 +289,9 @@ std::map<std::string, QVariant> FilterIcpPlugin::applyFilter(
     return std::map<std::string, QVariant>();
 }
 
-std::map<std::string, QVariant> FilterIcpPlugin::globalAlignment(MeshDocument& meshDocument, const RichParameterList &par) {
+std::map<std::string, QVariant> FilterIcpPlugin::globalAlignment(MeshDocument& meshDocument, const RichParameterList &par, vcg::CallBackPos *cb) {
+
+    using SourceTargetPair = std::pair<unsigned int, unsigned int>;
 
     MeshTreem meshTree {};
 
@@ -331,11 +341,35 @@ std::map<std::string, QVariant> FilterIcpPlugin::globalAlignment(MeshDocument& m
 
     // Start the global alignment
     log("Starting the global alignment filter...");
-    meshTree.Process(this->alignParameters, this->meshTreeParameters);
-    log("Global alignment completed!");
+    std::size_t cacheBudget = std::size_t(std::max(par.getInt(PAR_GRID_CACHE_SIZE), 0)) << 20;
+    IcpArcScheduler scheduler(meshTree, cacheBudget);
+    scheduler.process(this->alignParameters, this->meshTreeParameters, cb);
+
+    auto alignedArcs = std::vector<SourceTargetPair>{};
+    std::list<double> arcTimes;
+    std::list<double> arcErrors;
+    int cachedArcs = 0;
+    for (const IcpArcScheduler::ArcInfo& arc : scheduler.arcs()) {
+        if (arc.valid) {
+            log("[%d -> %d]: aligned in %.2f sec, error %.4f%s", arc.fixId, arc.movId, arc.seconds, arc.err,
+                arc.cachedFix ? " (cached grid)" : "");
+        }
+        else {
+            log("[%d -> %d]: alignment failed in %.2f sec: %s", arc.fixId, arc.movId, arc.seconds, arc.status.c_str());
+        }
+        alignedArcs.push_back(SourceTargetPair{(unsigned int) arc.fixId, (unsigned int) arc.movId});
+        arcTimes.push_back(arc.seconds);
+        arcErrors.push_back(arc.valid ? arc.err : -1);
+        cachedArcs += arc.cachedFix ? 1 : 0;
+    }
+    log("Global alignment completed! %d of %d arcs reused a cached grid", cachedArcs, (int) scheduler.arcs().size());
     meshTree.clear();
 
-    return std::map<std::string, QVariant> {};
+    return std::map<std::string, QVariant> {
+            {"arcs",        QVariant::fromValue(alignedArcs)},
+            {"arc_times",   QVariant::fromValue(arcTimes)},
+            {"arc_errors",  QVariant::fromValue(arcErrors)},
+    };
 }
 
 std::map<std::string, QVariant> FilterIcpPlugin::applyIcpTwoMeshes(MeshDocument& meshDocument, const RichParameterList &par) {
@@ -452,40 +486,41 @@ std::map<std::string, QVariant> FilterIcpPlugin::applyIcpTwoMeshes(MeshDocument&
     };
 }
 
-std::map<std::string, QVariant> FilterIcpPlugin::checkOverlappingMeshes(MeshDocument& meshDocument, const RichParameterList& par) {
+std::map<std::string, QVariant> FilterIcpPlugin::checkOverlappingMeshes(MeshDocument& meshDocument, const RichParameterList& par, vcg::CallBackPos *cb) {
 
     using SourceTargetPair = std::pair<unsigned int, unsigned int>;
 
     const int occupancyGridSize = par.getInt(PAR_OG_SIZE);
-    const unsigned int meshNumber = meshDocument.meshNumber();
 
     auto overlapPairs = std::vector<SourceTargetPair>{};
-    auto occupancyGrid = vcg::OccupancyGrid<CMeshO, Scalarm>{};
+    auto overlapFractions = std::vector<float>{};
 
-    /* Init occupancy grid using information we have */
-    occupancyGrid.Init(meshNumber, meshDocument.bbox(), occupancyGridSize);
+    /* Init the occupancy grid using information we have */
+    OverlapGrid occupancyGrid(meshDocument.bbox(), occupancyGridSize);
 
     /* Add each meshes contained in the document inside the Occupancy Grid */
     for (auto& mesh : meshDocument.meshIterator()) {
-        occupancyGrid.AddMesh(mesh.cm, mesh.cm.Tr, mesh.id());
+        occupancyGrid.addMesh(mesh.cm, mesh.id());
     }
 
-    /* Compute the Occupancy Grid to see the overlapping meshes */
-    occupancyGrid.Compute();
+    /* Voxelize the meshes and compute the overlapping ones, concurrently */
+    occupancyGrid.compute(cb);
 
-    for (auto& arc: occupancyGrid.SVA) {
+    for (auto& arc: occupancyGrid.arcs()) {
 
         auto sourceName = meshDocument.getMesh(arc.s)->shortName().toStdString();
         auto targetName = meshDocument.getMesh(arc.t)->shortName().toStdString();
 
-        log("[%d -> %d]: Mesh \"%s\" overlaps with \"%s\".\n", arc.s, arc.t, sourceName.c_str(), targetName.c_str());
+        log("[%d -> %d]: Mesh \"%s\" overlaps with \"%s\" (%.1f%%).\n", arc.s, arc.t, sourceName.c_str(), targetName.c_str(), arc.normArea * 100);
 
-        /* Add a pair inside the overlapPairs vector */
-        overlapPairs.push_back(SourceTargetPair{arc.s, arc.t});
+        /* Add a pair inside the overlapPairs vector, with its overlap fraction */
+        overlapPairs.push_back(SourceTargetPair{(unsigned int) arc.s, (unsigned int) arc.t});
+        overlapFractions.push_back(arc.normArea);
     }
 
     return std::map<std::string, QVariant>{
-            {"overlappingMeshesPairs", QVariant::fromValue(overlapPairs)}
+            {"overlappingMeshesPairs",     QVariant::fromValue(overlapPairs)},
+            {"overlappingMeshesFractions", QVariant::fromValue(overlapFractions)}
     };
 }
 
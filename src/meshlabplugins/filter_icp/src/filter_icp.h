@@ -87,9 +87,9 @@ private:
     vcg::AlignPair::Param alignParameters;
     MeshTreem::Param meshTreeParameters;
 
-    std::map<std::string, QVariant> globalAlignment(MeshDocument &meshDocument, const RichParameterList &par);
+    std::map<std::string, QVariant> globalAlignment(MeshDocument &meshDocument, const RichParameterList &par, vcg::CallBackPos *cb);
     std::map<std::string, QVariant> applyIcpTwoMeshes(MeshDocument &meshDocument, const RichParameterList &par);
-    std::map<std::string, QVariant> checkOverlappingMeshes(MeshDocument& meshDocument, const RichParameterList& par);
+    std::map<std::string, QVariant> checkOverlappingMeshes(MeshDocument& meshDocument, const RichParameterList& par, vcg::CallBackPos *cb);
     static void saveLastIterationPoints(MeshDocument &meshDocument, vcg::AlignPair::Result &alignerResult) ;
 };
 
@@ -23,8 +23,14 @@
 
 #include <common/ml_document/mesh_model.h>
 #include "filter_io_nxs.h"
+#include <algorithm>
+#include <map>
+#include <queue>
 #include <thread>
 
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
 #include <QTextStream>
 #include <QTemporaryDir>
 #include <nxsbuild/nexusbuilder.h>
@@ -34,8 +40,10 @@
 #include <nxsbuild/kdtree.h>
 
 #include <nxsbuild/nexusbuilder.h>
+#include <common/nexusdata.h>
 #include <common/traversal.h>
 #include <nxsedit/extractor.h>
+#include <vcg/complex/algorithms/clean.h>
 
 FilterIONXSPlugin::FilterIONXSPlugin()
 {
@@ -55,7 +63,10 @@ QString FilterIONXSPlugin::pluginName() const
 
 std::list<FileFormat> FilterIONXSPlugin::importFormats() const
 {
-	return {};
+	return {
+		FileFormat("Multiresolution Nexus Model", "NXS"),
+		FileFormat("Compressed Multiresolution Nexus Model", "NXZ")
+	};
 }
 
 std::list<FileFormat> FilterIONXSPlugin::exportFormats() const
@@ -66,15 +77,44 @@ std::list<FileFormat> FilterIONXSPlugin::exportFormats() const
 	};
 }
 
+RichParameterList FilterIONXSPlugin::initPreOpenParameter(const QString& format) const
+{
+	RichParameterList params;
+	if (format.toUpper() == "NXS" || format.toUpper() == "NXZ"){
+		params.addParam(RichInt("max_faces", 1000000, "Max faces",
+						"Maximum number of faces (points, for point clouds) of the loaded model. "
+						"The nodes of the multiresolution are refined in order of decreasing error, "
+						"until the next one would exceed this budget. 0 means no limit."));
+		params.addParam(RichFloat("max_error", 0, "Max error",
+						"Nodes whose error (in the units of the model) is lower than this threshold "
+						"are not refined. 0 means no threshold."));
+		params.addParam(RichBool("use_roi", false, "Region of interest",
+						"If true, only the nodes that intersect the sphere defined below are refined; "
+						"the rest of the model is loaded at the coarsest level."));
+		params.addParam(RichPosition("roi_center", Point3m(0,0,0), "ROI center", "Center of the region of interest"));
+		params.addParam(RichFloat("roi_radius", 0, "ROI radius", "Radius of the region of interest"));
+	}
+	return params;
+}
+
 void FilterIONXSPlugin::open(
 		const QString& fileFormat,
-		const QString&,
-		MeshModel&,
-		int& ,
-		const RichParameterList& ,
-		vcg::CallBackPos*)
+		const QString& fileName,
+		MeshModel& m,
+		int& mask,
+		const RichParameterList& params,
+		vcg::CallBackPos* cb)
 {
-	wrongOpenFormat(fileFormat);
+	if (fileFormat.toUpper() == "NXS" || fileFormat.toUpper() == "NXZ"){
+		if (cb)
+			cb(1, "Loading Nexus model...");
+		loadNxs(fileName, m, mask, params, cb);
+		if (cb)
+			cb(100, "Nexus model loaded");
+	}
+	else {
+		wrongOpenFormat(fileFormat);
+	}
 }
 
 void FilterIONXSPlugin::exportMaskCapability(
@@ -586,4 +626,226 @@ void FilterIONXSPlugin::compressNxs(
 	}
 }
 
+void FilterIONXSPlugin::loadNxs(
+		const QString& fileName,
+		MeshModel& m,
+		int& mask,
+		const RichParameterList& params,
+		vcg::CallBackPos* cb)
+{
+	QFileInfo finfo(fileName);
+	if (fileName.isEmpty() || !finfo.exists())
+		throw MLException("Cannot open file. Filename not valid.");
+
+	const uint64_t maxFaces = std::max(params.getInt("max_faces"), 0);
+	const float maxError = params.getFloat("max_error");
+	const bool useRoi = params.getBool("use_roi");
+	const vcg::Point3f roiCenter = vcg::Point3f::Construct(params.getPoint3m("roi_center"));
+	const float roiRadius = params.getFloat("roi_radius");
+
+	nx::NexusData nexus;
+	try {
+		nexus.open(fileName.toStdString().c_str());
+
+		nx::Signature& signature = nexus.header.signature;
+		const uint32_t sink = nexus.header.n_nodes - 1;
+		const bool pointCloud = !signature.face.hasIndex();
+		const bool hasNormals = signature.vertex.hasNormals();
+		const bool hasColors = signature.vertex.hasColors();
+		const bool hasTextures = signature.vertex.hasTextures() && nexus.header.n_textures > 0;
+
+		//for each node, its children and the faces of the node that each child replaces
+		//(the faces of the patches pointing to the child); for each node, its parents
+		std::vector<std::vector<std::pair<uint32_t, uint64_t>>> children(sink);
+		std::vector<std::vector<std::pair<uint32_t, uint64_t>>> parents(sink);
+		for (uint32_t n = 0; n < sink; n++) {
+			nx::Node& node = nexus.nodes[n];
+			uint32_t start = 0;
+			for (uint32_t p = node.first_patch; p < node.last_patch(); p++) {
+				nx::Patch& patch = nexus.patches[p];
+				uint64_t faces = pointCloud ? 0 : patch.triangle_offset - start;
+				start = patch.triangle_offset;
+				if (patch.node == sink)
+					continue;
+				auto child = std::find_if(children[n].begin(), children[n].end(),
+						[&](const std::pair<uint32_t, uint64_t>& c) { return c.first == patch.node; });
+				if (child == children[n].end())
+					children[n].emplace_back(patch.node, faces);
+				else
+					child->second += faces;
+			}
+			for (const auto& c : children[n])
+				parents[c.first].emplace_back(n, c.second);
+		}
+
+		//the cut: starting from the root, the node with the largest error is
+		//selected, until the error threshold or the face budget are reached.
+		//A node can be selected only when all its parents are, and, with a
+		//region of interest, only if it intersects the region.
+		auto cost = [&](uint32_t n) -> uint64_t {
+			return pointCloud ? nexus.nodes[n].nvert : nexus.nodes[n].nface;
+		};
+		auto refinable = [&](uint32_t n) {
+			const vcg::Sphere3f& sphere = nexus.nodes[n].sphere;
+			return !useRoi || vcg::Distance(sphere.Center(), roiCenter) <= sphere.Radius() + roiRadius;
+		};
+
+		std::vector<bool> selected(sink + 1, false);
+		std::vector<size_t> missingParents(sink);
+		for (uint32_t n = 0; n < sink; n++)
+			missingParents[n] = parents[n].size();
+		std::priority_queue<std::pair<float, uint32_t>> candidates;
+		auto select = [&](uint32_t n) {
+			selected[n] = true;
+			for (const auto& c : children[n]) {
+				if (--missingParents[c.first] == 0 && refinable(c.first))
+					candidates.emplace(nexus.nodes[c.first].error, c.first);
+			}
+		};
+
+		uint64_t faces = cost(0);
+		select(0);
+		while (!candidates.empty()) {
+			const float error = candidates.top().first;
+			const uint32_t n = candidates.top().second;
+			if (maxError > 0 && error < maxError)
+				break;
+			uint64_t newFaces = faces + cost(n);
+			for (const auto& p : parents[n])
+				newFaces -= p.second;
+			if (maxFaces > 0 && newFaces > maxFaces)
+				break;
+			candidates.pop();
+			faces = newFaces;
+			select(n);
+		}
+
+		//the selected nodes with at least a patch whose child is not selected
+		//are decoded: those patches are the surface of the cut
+		std::vector<uint32_t> nodes;
+		size_t vertexNumber = 0;
+		size_t faceNumber = 0;
+		for (uint32_t n = 0; n < sink; n++) {
+			if (!selected[n])
+				continue;
+			nx::Node& node = nexus.nodes[n];
+			bool used = false;
+			uint32_t start = 0;
+			for (uint32_t p = node.first_patch; p < node.last_patch(); p++) {
+				nx::Patch& patch = nexus.patches[p];
+				if (!selected[patch.node]) {
+					used = true;
+					if (!pointCloud)
+						faceNumber += patch.triangle_offset - start;
+				}
+				start = patch.triangle_offset;
+			}
+			if (used) {
+				nodes.push_back(n);
+				vertexNumber += node.nvert;
+			}
+		}
+
+		if (hasNormals)
+			mask |= vcg::tri::io::Mask::IOM_VERTNORMAL;
+		if (hasColors)
+			mask |= vcg::tri::io::Mask::IOM_VERTCOLOR;
+		if (hasTextures && !pointCloud)
+			mask |= vcg::tri::io::Mask::IOM_WEDGTEXCOORD;
+		m.enable(mask);
+
+		//the textures used by the patches of the cut, read from the file
+		std::map<uint32_t, int> textureIndex;
+		if (hasTextures && !pointCloud) {
+			for (uint32_t n : nodes) {
+				nx::Node& node = nexus.nodes[n];
+				for (uint32_t p = node.first_patch; p < node.last_patch(); p++) {
+					nx::Patch& patch = nexus.patches[p];
+					if (!selected[patch.node] && patch.texture != 0xffffffff && textureIndex.count(patch.texture) == 0) {
+						textureIndex[patch.texture] = (int) textureIndex.size();
+					}
+				}
+			}
+			QFile file(fileName);
+			if (!file.open(QFile::ReadOnly))
+				throw MLException("Cannot open file " + fileName);
+			for (const auto& t : textureIndex) {
+				nx::Texture& texture = nexus.textures[t.first];
+				file.seek(texture.getBeginOffset());
+				QImage image;
+				image.loadFromData(file.read(texture.getSize()));
+				m.addTexture(finfo.baseName().toStdString() + "_" + std::to_string(t.first) + ".jpg", image);
+			}
+		}
+
+		CMeshO::VertexIterator vi = vcg::tri::Allocator<CMeshO>::AddVertices(m.cm, vertexNumber);
+		CMeshO::FaceIterator fi = vcg::tri::Allocator<CMeshO>::AddFaces(m.cm, faceNumber);
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (cb)
+				cb(1 + (int) (90 * i / nodes.size()), "Decoding Nexus nodes...");
+
+			const uint32_t n = nodes[i];
+			nx::Node& node = nexus.nodes[n];
+			nexus.loadRam(n);
+			nx::NodeData& data = nexus.nodedata[n];
+
+			CMeshO::VertexIterator nodeVertices = vi;
+			vcg::Point3f* coords = data.coords();
+			vcg::Point3s* normals = hasNormals ? data.normals(signature, node.nvert) : nullptr;
+			vcg::Color4b* colors = hasColors ? data.colors(signature, node.nvert) : nullptr;
+			vcg::Point2f* texCoords = hasTextures ? data.texCoords(signature, node.nvert) : nullptr;
+			for (uint32_t v = 0; v < node.nvert; v++, ++vi) {
+				vi->P() = Point3m::Construct(coords[v]);
+				if (normals)
+					vi->N() = Point3m::Construct(normals[v]).Normalize();
+				if (colors)
+					vi->C() = colors[v];
+			}
+
+			if (!pointCloud) {
+				uint16_t* indices = data.faces(signature, node.nvert);
+				uint32_t start = 0;
+				for (uint32_t p = node.first_patch; p < node.last_patch(); p++) {
+					nx::Patch& patch = nexus.patches[p];
+					if (!selected[patch.node]) {
+						auto ti = textureIndex.find(patch.texture);
+						const int tex = ti == textureIndex.end() ? -1 : ti->second;
+						for (uint32_t k = start; k < patch.triangle_offset; k++, ++fi) {
+							for (int j = 0; j < 3; j++) {
+								const uint16_t index = indices[3 * k + j];
+								fi->V(j) = &*(nodeVertices + index);
+								if (texCoords) {
+									fi->WT(j).U() = texCoords[index][0];
+									fi->WT(j).V() = texCoords[index][1];
+									fi->WT(j).N() = tex;
+								}
+							}
+						}
+					}
+					start = patch.triangle_offset;
+				}
+			}
+			nexus.dropRam(n);
+		}
+
+		//the nodes share the vertices along their borders: stitching them
+		if (cb)
+			cb(91, "Stitching Nexus nodes...");
+		vcg::tri::Clean<CMeshO>::RemoveDuplicateVertex(m.cm);
+		if (!pointCloud)
+			vcg::tri::Clean<CMeshO>::RemoveUnreferencedVertex(m.cm);
+		vcg::tri::Allocator<CMeshO>::CompactEveryVector(m.cm);
+		vcg::tri::UpdateBounding<CMeshO>::Box(m.cm);
+
+		log("Loaded %d of %d Nexus nodes: %d vertices, %d faces",
+			(int) nodes.size(), (int) sink, m.cm.VN(), m.cm.FN());
+	}
+	catch (QString error) {
+		throw MLException("Fatal error: " + error);
+	}
+	catch (const char *error) {
+		throw MLException("Fatal error: " + QString(error));
+	}
+}
+
 MESHLAB_PLUGIN_NAME_EXPORTER(FilterIONXSPlugin)
@@ -42,6 +42,8 @@ public:
 	std::list<FileFormat> importFormats() const;
 	std::list<FileFormat> exportFormats() const;
 
+	RichParameterList initPreOpenParameter(const QString& format) const;
+
 	void open(
 			const QString &format, /// the extension of the format e.g. "PLY"
 			const QString &fileName, /// The name of the file to be opened
@@ -106,6 +108,13 @@ private:
 			const QString& inputFile,
 			const QString& outputFile,
 			const RichParameterList& params);
+
+	void loadNxs(
+			const QString& fileName,
+			MeshModel& m,
+			int& mask,
+			const RichParameterList& params,
+			vcg::CallBackPos* cb);
 };
 
 #endif //IO_NXS_PLUGIN_H
@@ -32,9 +32,84 @@
 #include <QXmlStreamWriter>
 #include <vcg/complex/append.h>
 
+#include <common/utilities/parallel.h>
+
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 using namespace vcg;
 
+namespace {
+
+/**
+ * @brief Fills the (empty) mesh of dest with the given faces of src.
+ * Vertices are the indices of the src vertices that go in dest, in their
+ * final order; corners holds, for each face, the indices in dest of its three
+ * vertices. Only the textures actually used by the faces and the vertices
+ * are added to dest, and the texture indices are remapped accordingly.
+ */
+void copyMeshPart(
+		const MeshModel& src,
+		const size_t*    faces,
+		size_t           fn,
+		const size_t*    vertices,
+		size_t           vn,
+		const int*       corners,
+		MeshModel&       dest)
+{
+	const CMeshO& sm = src.cm;
+	CMeshO&       dm = dest.cm;
+	const bool vertTex = tri::HasPerVertexTexCoord(sm) && tri::HasPerVertexTexCoord(dm);
+	const bool wedgeTex = tri::HasPerWedgeTexCoord(sm) && tri::HasPerWedgeTexCoord(dm);
+	std::vector<int> texRemap(sm.textures.size(), -1);
+
+	tri::Allocator<CMeshO>::AddVertices(dm, vn);
+	tri::Allocator<CMeshO>::AddFaces(dm, fn);
+	for (size_t i = 0; i < vn; ++i) {
+		CVertexO& v = dm.vert[i];
+		v.ImportData(sm.vert[vertices[i]]);
+		v.ClearS();
+		if (vertTex && v.T().N() >= 0 && v.T().N() < (int) texRemap.size())
+			texRemap[v.T().N()] = 0;
+	}
+	for (size_t i = 0; i < fn; ++i) {
+		CFaceO& f = dm.face[i];
+		f.ImportData(sm.face[faces[i]]);
+		f.ClearS();
+		for (int j = 0; j < 3; ++j) {
+			f.V(j) = &dm.vert[corners[3 * i + j]];
+			if (wedgeTex && f.WT(j).N() >= 0 && f.WT(j).N() < (int) texRemap.size())
+				texRemap[f.WT(j).N()] = 0;
+		}
+	}
+
+	int nTex = 0;
+	for (size_t t = 0; t < texRemap.size(); ++t) {
+		if (texRemap[t] >= 0) {
+			texRemap[t] = nTex++;
+			dest.addTexture(sm.textures[t], src.getTexture(sm.textures[t]));
+		}
+	}
+	if (vertTex) {
+		for (CVertexO& v : dm.vert)
+			if (v.T().N() >= 0 && v.T().N() < (int) texRemap.size())
+				v.T().N() = texRemap[v.T().N()];
+	}
+	if (wedgeTex) {
+		for (CFaceO& f : dm.face)
+			for (int j = 0; j < 3; ++j)
+				if (f.WT(j).N() >= 0 && f.WT(j).N() < (int) texRemap.size())
+					f.WT(j).N() = texRemap[f.WT(j).N()];
+	}
+
+	if (tri::HasFFAdjacency(dm))
+		tri::UpdateTopology<CMeshO>::FaceFace(dm);
+	dm.Tr = sm.Tr;
+}
+
+} // namespace
+
 // Constructor
 FilterLayerPlugin::FilterLayerPlugin()
 {
@@ -410,31 +485,142 @@ std::map<std::string, QVariant> FilterLayerPlugin::applyFilter(
 		bool alsoUnreferenced = par.getBool("AlsoUnreferenced");
 
 		MeshModel* destModel = md.addNewMesh("", "Merged Mesh", true);
-
-		std::list<unsigned int> toBeDeletedList;
-
-		unsigned int cnt = 0;
+		CMeshO&    dm        = destModel->cm;
+
+		// each layer is copied, already transformed, in its own range of the
+		// elements of the merged mesh
+		struct MergedLayer
+		{
+			MeshModel*       mesh;
+			std::vector<int> vertRemap; // index in the range of the layer, -1 if not copied
+			std::vector<int> texRemap;
+			size_t           vn = 0, fn = 0, en = 0;
+			size_t           vBegin = 0, fBegin = 0, eBegin = 0;
+		};
+		std::vector<MergedLayer> layers;
+		std::list<unsigned int>  toBeDeletedList;
 		for (MeshModel& mmp : md.meshIterator()) {
-			++cnt;
-			if (mmp.isVisible() || !mergeVisible) {
-				if (mmp.id() != destModel->id()) {
-					cb(cnt * 100 / md.meshNumber(), "Merging layers...");
-					tri::UpdatePosition<CMeshO>::Matrix(mmp.cm, mmp.cm.Tr, true);
-					toBeDeletedList.push_back(mmp.id());
-					if (!alsoUnreferenced) {
-						vcg::tri::Clean<CMeshO>::RemoveUnreferencedVertex(mmp.cm);
-					}
-					destModel->updateDataMask(&mmp);
-					tri::Append<CMeshO, CMeshO>::Mesh(destModel->cm, mmp.cm);
+			if ((mmp.isVisible() || !mergeVisible) && mmp.id() != destModel->id()) {
+				layers.emplace_back();
+				layers.back().mesh = &mmp;
+				toBeDeletedList.push_back(mmp.id());
+			}
+		}
 
-					for (const std::string& txt : mmp.cm.textures) {
-						destModel->addTexture(txt, mmp.getTexture(txt));
+		// count the elements of each layer and number its copied vertices
+		meshlab::parallelFor(
+			layers.size(),
+			[&](size_t l, unsigned int) {
+				MergedLayer&  ml = layers[l];
+				const CMeshO& m  = ml.mesh->cm;
+				ml.vertRemap.assign(m.vert.size(), -1);
+				if (alsoUnreferenced) {
+					for (size_t i = 0; i < m.vert.size(); ++i)
+						if (!m.vert[i].IsD())
+							ml.vertRemap[i] = 0;
+				}
+				for (const CFaceO& f : m.face) {
+					if (!f.IsD()) {
+						++ml.fn;
+						for (int j = 0; j < 3; ++j)
+							ml.vertRemap[tri::Index(m, f.cV(j))] = 0;
 					}
-
-					tri::UpdatePosition<CMeshO>::Matrix(mmp.cm, Inverse(mmp.cm.Tr), true);
 				}
+				for (const CEdgeO& e : m.edge) {
+					if (!e.IsD()) {
+						++ml.en;
+						for (int j = 0; j < 2; ++j)
+							ml.vertRemap[tri::Index(m, e.cV(j))] = 0;
+					}
+				}
+				for (int& r : ml.vertRemap)
+					if (r >= 0)
+						r = ml.vn++;
+			},
+			cb,
+			0,
+			20,
+			"Merging layers...");
+
+		// the merged mesh is allocated once, with the components of all the
+		// layers; the textures are merged by name
+		size_t vn = 0, fn = 0, en = 0;
+		for (MergedLayer& ml : layers) {
+			ml.vBegin = vn;
+			ml.fBegin = fn;
+			ml.eBegin = en;
+			vn += ml.vn;
+			fn += ml.fn;
+			en += ml.en;
+			destModel->updateDataMask(ml.mesh);
+			for (const std::string& txt : ml.mesh->cm.textures) {
+				destModel->addTexture(txt, ml.mesh->getTexture(txt));
+				ml.texRemap.push_back(
+					std::find(dm.textures.begin(), dm.textures.end(), txt) - dm.textures.begin());
 			}
 		}
+		tri::Allocator<CMeshO>::AddVertices(dm, vn);
+		tri::Allocator<CMeshO>::AddFaces(dm, fn);
+		if (en > 0)
+			tri::Allocator<CMeshO>::AddEdges(dm, en);
+
+		// copy the layers in parallel, applying their transformation; as in
+		// UpdatePosition::Matrix, normals are rotated without scaling
+		meshlab::parallelFor(
+			layers.size(),
+			[&](size_t l, unsigned int) {
+				const MergedLayer& ml = layers[l];
+				const CMeshO&      m  = ml.mesh->cm;
+				const Matrix44m&   tr = m.Tr;
+				Matrix33m          nm(tr, 3);
+				Scalarm            scale = std::cbrt(nm.Determinant());
+				if (scale == 0)
+					scale = 1;
+				auto texIndex = [&ml](short n) -> short {
+					return n >= 0 && n < (short) ml.texRemap.size() ? ml.texRemap[n] : n;
+				};
+				const bool vertTex  = tri::HasPerVertexTexCoord(m) && tri::HasPerVertexTexCoord(dm);
+				const bool wedgeTex = tri::HasPerWedgeTexCoord(m) && tri::HasPerWedgeTexCoord(dm);
+
+				for (size_t i = 0; i < m.vert.size(); ++i) {
+					if (ml.vertRemap[i] < 0)
+						continue;
+					CVertexO& v = dm.vert[ml.vBegin + ml.vertRemap[i]];
+					v.ImportData(m.vert[i]);
+					v.P() = tr * m.vert[i].cP();
+					v.N() = (nm * m.vert[i].cN()) / scale;
+					if (vertTex)
+						v.T().N() = texIndex(v.T().N());
+				}
+				size_t k = ml.fBegin;
+				for (const CFaceO& sf : m.face) {
+					if (sf.IsD())
+						continue;
+					CFaceO& f = dm.face[k++];
+					f.ImportData(sf);
+					f.N() = (nm * sf.cN()) / scale;
+					for (int j = 0; j < 3; ++j) {
+						f.V(j) = &dm.vert[ml.vBegin + ml.vertRemap[tri::Index(m, sf.cV(j))]];
+						if (wedgeTex)
+							f.WT(j).N() = texIndex(f.WT(j).N());
+					}
+				}
+				k = ml.eBegin;
+				for (const CEdgeO& se : m.edge) {
+					if (se.IsD())
+						continue;
+					CEdgeO& e = dm.edge[k++];
+					e.ImportData(se);
+					for (int j = 0; j < 2; ++j)
+						e.V(j) = &dm.vert[ml.vBegin + ml.vertRemap[tri::Index(m, se.cV(j))]];
+				}
+			},
+			cb,
+			20,
+			100,
+			"Merging layers...");
+		if (tri::HasFFAdjacency(dm))
+			tri::UpdateTopology<CMeshO>::FaceFace(dm);
 
 		if (deleteLayer) {
 			log("Deleted %d merged layers", toBeDeletedList.size());
@@ -457,39 +643,84 @@ std::map<std::string, QVariant> FilterLayerPlugin::applyFilter(
 		CMeshO&    cm           = md.mm()->cm;
 		bool removeSourceMesh = par.getBool("delete_source_mesh");
 		md.mm()->updateDataMask(MeshModel::MM_FACEFACETOPO);
-		std::vector<std::pair<int, CMeshO::FacePointer>> connectedCompVec;
-		int numCC = tri::Clean<CMeshO>::ConnectedComponents(cm, connectedCompVec);
-		log("Found %i Connected Components", numCC);
-		tri::UpdateSelection<CMeshO>::FaceClear(cm);
-		tri::UpdateSelection<CMeshO>::VertexClear(cm);
-
-		for (size_t i = 0; i < connectedCompVec.size(); ++i) {
-			// select verts and faces of ith connected component
-			connectedCompVec[i].second->SetS();
-			tri::UpdateSelection<CMeshO>::FaceConnectedFF(cm /*,true*/);
-			tri::UpdateSelection<CMeshO>::VertexFromFaceLoose(cm);
-
-			// create a new mesh from the selection
-			MeshModel* destModel = md.addNewMesh("", QString("CC %1").arg(i), true);
-			destModel->updateDataMask(currentModel);
-			tri::Append<CMeshO, CMeshO>::Mesh(destModel->cm, cm, true);
-
-			// clear selection from source mesh and from newly created mesh
-			tri::UpdateSelection<CMeshO>::FaceClear(cm);
-			tri::UpdateSelection<CMeshO>::VertexClear(cm);
-			tri::UpdateSelection<CMeshO>::FaceClear(destModel->cm);
-			tri::UpdateSelection<CMeshO>::VertexClear(destModel->cm);
-
-			// append any textures... (todo: append only the ACTUALLY USED ones)
-			for (const std::string& txt : cm.textures) {
-				destModel->addTexture(txt, md.mm()->getTexture(txt));
-			}
 
-			// init new layer
-			destModel->updateBoxAndNormals();
-			destModel->cm.Tr = currentModel->cm.Tr;
+		// label the faces with a visit across the FF adjacency: the faces of
+		// each component end up contiguous in compFaces
+		std::vector<size_t> compFaces;
+		std::vector<size_t> faceOffsets(1, 0);
+		std::vector<bool>   visited(cm.face.size(), false);
+		compFaces.reserve(cm.fn);
+		for (size_t seed = 0; seed < cm.face.size(); ++seed) {
+			if (cm.face[seed].IsD() || visited[seed])
+				continue;
+			visited[seed] = true;
+			compFaces.push_back(seed);
+			for (size_t k = faceOffsets.back(); k < compFaces.size(); ++k) {
+				CFaceO& f = cm.face[compFaces[k]];
+				for (int j = 0; j < 3; ++j) {
+					if (face::IsBorder(f, j))
+						continue;
+					size_t adj = tri::Index(cm, f.FFp(j));
+					if (!visited[adj]) {
+						visited[adj] = true;
+						compFaces.push_back(adj);
+					}
+				}
+			}
+			faceOffsets.push_back(compFaces.size());
+		}
+		const size_t numCC = faceOffsets.size() - 1;
+		log("Found %i Connected Components", (int) numCC);
+
+		// vertex indices of each component; a vertex shared by two components
+		// (through a non manifold vertex) goes in both of them. corners holds
+		// the index of each face vertex in the vertices of its component
+		std::vector<size_t> compVerts;
+		std::vector<size_t> vertOffsets(1, 0);
+		std::vector<int>    corners(3 * compFaces.size());
+		std::vector<int>    vertComp(cm.vert.size(), -1);
+		std::vector<int>    vertLocal(cm.vert.size(), -1);
+		compVerts.reserve(cm.vn);
+		for (size_t c = 0; c < numCC; ++c) {
+			for (size_t k = faceOffsets[c]; k < faceOffsets[c + 1]; ++k) {
+				const CFaceO& f = cm.face[compFaces[k]];
+				for (int j = 0; j < 3; ++j) {
+					size_t vi = tri::Index(cm, f.cV(j));
+					if (vertComp[vi] != (int) c) {
+						vertComp[vi]  = c;
+						vertLocal[vi] = compVerts.size() - vertOffsets[c];
+						compVerts.push_back(vi);
+					}
+					corners[3 * k + j] = vertLocal[vi];
+				}
+			}
+			vertOffsets.push_back(compVerts.size());
+		}
 
+		// layers are added by this thread, then filled concurrently
+		std::vector<MeshModel*> parts(numCC);
+		for (size_t i = 0; i < numCC; ++i) {
+			parts[i] = md.addNewMesh("", QString("CC %1").arg(i), true);
+			parts[i]->updateDataMask(currentModel);
 		}
+		meshlab::parallelFor(
+			numCC,
+			[&](size_t i, unsigned int) {
+				copyMeshPart(
+					*currentModel,
+					&compFaces[faceOffsets[i]],
+					faceOffsets[i + 1] - faceOffsets[i],
+					&compVerts[vertOffsets[i]],
+					vertOffsets[i + 1] - vertOffsets[i],
+					&corners[3 * faceOffsets[i]],
+					*parts[i]);
+				parts[i]->updateBoxAndNormals();
+			},
+			cb,
+			0,
+			100,
+			"Splitting connected components");
+
 		if (removeSourceMesh)
 			md.delMesh(currentModel->id());
 	} break;
@@ -352,7 +352,7 @@ void FilterMeshBooleans::booleanOperation(
 	else {
 		// everything ok, create new mesh into md
 		MeshModel* mesh = md.addNewMesh("", name);
-		mesh->cm        = meshlab::meshFromMatrices(VR, FR);
+		meshlab::meshFromMatrices(mesh->cm, VR, FR);
 
 		// if transfer option enabled
 		if (transfFaceColor || transfFaceQuality)
@@ -249,6 +249,28 @@ int ExtraMeshFilterPlugin::getRequirements(const QAction* filter)
 	}
 }
 
+std::size_t ExtraMeshFilterPlugin::estimatedPeakMemory(
+		const QAction* filter,
+		const RichParameterList& par,
+		const MeshDocument& md) const
+{
+	switch (ID(filter)){
+	case FP_LOOP_SS:
+	case FP_BUTTERFLY_SS:
+	case FP_MIDPOINT:
+	case FP_REFINE_LS3_LOOP: {
+		// in the worst case (uniform refinement) each iteration splits every
+		// face in four, and the mesh grows by the same factor
+		std::size_t mem = md.mm()->memoryFootprint();
+		for (int i = 0; i < par.getInt("Iterations"); ++i)
+			mem *= 4;
+		return mem;
+	}
+	default:
+		return FilterPlugin::estimatedPeakMemory(filter, par, md);
+	}
+}
+
 QString ExtraMeshFilterPlugin::pythonFilterName(ActionIDType f) const
 {
 	switch (f) {
@@ -475,6 +497,7 @@ RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * actio
 		parlst.addParam(RichBool ("QualityWeight",lastq_QualityWeight,"Weighted Simplification","Use the Per-Vertex quality as a weighting factor for the simplification. The weight is used as a error amplification value, so a vertex with a high quality value will not be simplified and a portion of the mesh with low quality values will be aggressively simplified."));
 		parlst.addParam(RichBool ("AutoClean",true,"Post-simplification cleaning","After the simplification an additional set of steps is performed to clean the mesh (unreferenced vertices, bad faces, etc)"));
 		parlst.addParam(RichBool ("Selected",m.cm.sfn>0,"Simplify only selected faces","The simplification is applied only to the selected set of faces.\n Take care of the target number of faces!"));
+		parlst.addParam(RichBool ("Parallel",false,"Parallel simplification","The mesh is split in spatial blocks that are simplified concurrently, using all the available cores; a final pass simplifies the seams between the blocks. Much faster on huge meshes, the result is slightly different from the serial one. Ignored when simplifying only the selected faces."));
 		break;
 
 	case FP_QUADRIC_TEXCOORD_SIMPLIFICATION:
@@ -1000,7 +1023,10 @@ std::map<std::string, QVariant> ExtraMeshFilterPlugin::applyFilter(
 		pp.QualityQuadricWeight=lastq_PlanarWeight = par.getFloat("PlanarWeight");
 		lastq_Selected = par.getBool("Selected");
 
-		QuadricSimplification(m.cm,TargetFaceNum,lastq_Selected,pp,  cb);
+		if (par.getBool("Parallel") && !lastq_Selected)
+			ParallelQuadricSimplification(m.cm,TargetFaceNum,pp,cb);
+		else
+			QuadricSimplification(m.cm,TargetFaceNum,lastq_Selected,pp,  cb);
 
 		if(par.getBool("AutoClean"))
 		{
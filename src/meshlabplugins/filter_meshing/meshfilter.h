@@ -100,6 +100,7 @@ public:
 	int postCondition(const QAction *filter) const;
 	int getPreConditions(const QAction *filter) const;
 	int getRequirements(const QAction* filter);
+	std::size_t estimatedPeakMemory(const QAction* filter, const RichParameterList& par, const MeshDocument& md) const;
 	FilterArity filterArity(const QAction *) const {return SINGLE_MESH;}
 protected:
 
@@ -22,6 +22,12 @@
 #include "meshfilter.h"
 #include "quadric_simp.h"
 
+#include <array>
+#include <atomic>
+#include <utility>
+
+#include <common/utilities/parallel.h>
+
 using namespace vcg;
 using namespace std;
 
@@ -144,3 +150,267 @@ void QuadricTexSimplification(CMeshO &m,int  TargetFaceNum, bool Selected, tri::
   tri::QuadricTexHelper<CMeshO>::TDp()=nullptr;
 
 }
+
+
+/*
+ * Parallel quadric simplification.
+ *
+ * The faces of the mesh are split in spatial blocks (a kd-tree split on the
+ * face barycenters, so that all the blocks have the same number of faces).
+ * The vertices shared by faces of different blocks are locked (not writable).
+ * Each block is copied in a separate mesh and simplified concurrently with
+ * the others, proportionally to its size. The simplified blocks are then
+ * merged back in the original mesh (the locked vertices are the original
+ * ones, so the seams are stitched without any search) and a final serial
+ * pass on the whole mesh simplifies the seams down to the target.
+ */
+
+namespace {
+
+// Number of simplification sessions that can run concurrently (see BlockQHelper)
+const int MAX_PARALLEL_SESSIONS = 16;
+
+// Blocks smaller than this are not split anymore
+const size_t MIN_BLOCK_FACES = 50000;
+
+struct SimplificationBlock
+{
+  std::vector<int> faces;    // indices of the faces of the original mesh
+  CMeshO mesh;               // simplified faces of the block
+  std::vector<int> lockedVert; // for each vertex of mesh, its index in the original mesh if locked, -1 otherwise
+  int targetFaceNum;
+};
+
+void enableOptionalComponents(CMeshO &dst, const CMeshO &src)
+{
+  if (src.vert.IsTexCoordEnabled()) dst.vert.EnableTexCoord();
+  if (src.vert.IsCurvatureDirEnabled()) dst.vert.EnableCurvatureDir();
+  if (src.vert.IsRadiusEnabled()) dst.vert.EnableRadius();
+  if (src.face.IsQualityEnabled()) dst.face.EnableQuality();
+  if (src.face.IsColorEnabled()) dst.face.EnableColor();
+  if (src.face.IsCurvatureDirEnabled()) dst.face.EnableCurvatureDir();
+  if (src.face.IsWedgeTexCoordEnabled()) dst.face.EnableWedgeTexCoord();
+}
+
+// Copies the given faces of src, with the vertices they reference, in the empty mesh dst.
+// srcVert is filled with the index in src of each vertex of dst.
+void copyFaces(const CMeshO &src, const std::vector<int> &faces, CMeshO &dst, std::vector<int> &srcVert)
+{
+  enableOptionalComponents(dst, src);
+  srcVert.clear();
+  srcVert.reserve(faces.size());
+  for (int f : faces)
+    for (int j = 0; j < 3; ++j)
+      srcVert.push_back(tri::Index(src, src.face[f].cV(j)));
+  std::sort(srcVert.begin(), srcVert.end());
+  srcVert.erase(std::unique(srcVert.begin(), srcVert.end()), srcVert.end());
+
+  tri::Allocator<CMeshO>::AddVertices(dst, srcVert.size());
+  for (size_t i = 0; i < srcVert.size(); ++i)
+    dst.vert[i].ImportData(src.vert[srcVert[i]]);
+  tri::Allocator<CMeshO>::AddFaces(dst, faces.size());
+  for (size_t k = 0; k < faces.size(); ++k)
+  {
+    const CFaceO &sf = src.face[faces[k]];
+    dst.face[k].ImportData(sf);
+    for (int j = 0; j < 3; ++j)
+    {
+      int vi = std::lower_bound(srcVert.begin(), srcVert.end(), (int) tri::Index(src, sf.cV(j))) - srcVert.begin();
+      dst.face[k].V(j) = &dst.vert[vi];
+    }
+  }
+}
+
+// Recursively splits the faces in [begin, end) along the longest axis of their
+// barycenters, until depth is zero.
+void splitBlocks(const CMeshO &m, std::vector<int> &faces, size_t begin, size_t end, int depth, std::vector<std::pair<size_t, size_t> > &ranges)
+{
+  if (depth == 0)
+  {
+    ranges.push_back(std::make_pair(begin, end));
+    return;
+  }
+  // the sum of the vertices is used in place of the barycenter, the order is the same
+  auto bary = [&](int f) {
+    return m.face[f].cP(0) + m.face[f].cP(1) + m.face[f].cP(2);
+  };
+  Box3m box;
+  for (size_t i = begin; i < end; ++i)
+    box.Add(bary(faces[i]));
+  int axis = box.MaxDim();
+  size_t mid = (begin + end) / 2;
+  std::nth_element(faces.begin() + begin, faces.begin() + mid, faces.begin() + end,
+      [&](int a, int b) { return bary(a)[axis] < bary(b)[axis]; });
+  splitBlocks(m, faces, begin, mid, depth - 1, ranges);
+  splitBlocks(m, faces, mid, end, depth - 1, ranges);
+}
+
+template <int SLOT>
+void simplifyBlock(SimplificationBlock &block, const CMeshO &m, const std::vector<int> &vertBlock, tri::TriEdgeCollapseQuadricParameter pp, const std::atomic<bool> &abort)
+{
+  CMeshO sub;
+  std::vector<int> srcVert;
+  copyFaces(m, block.faces, sub, srcVert);
+  std::vector<int>().swap(block.faces);
+  for (size_t i = 0; i < srcVert.size(); ++i)
+  {
+    if (vertBlock[srcVert[i]] == -2) sub.vert[i].ClearW();
+    else sub.vert[i].SetW();
+  }
+
+  // the seams between the blocks are borders of sub (Init recomputes the
+  // border flags), so they get the boundary quadrics and, with
+  // FastPreserveBoundary, their W flag is cleared again; the lock does not
+  // depend on that: the vertices of a seam edge are all shared by two blocks,
+  // and vertices without the W flag have no quadric and are never collapsed
+  sub.vert.EnableVFAdjacency();
+  sub.face.EnableVFAdjacency();
+  sub.vert.EnableMark();
+  tri::UpdateTopology<CMeshO>::VertexFace(sub);
+
+  math::Quadric<double> QZero;
+  QZero.SetZero();
+  tri::QuadricTemp TD(sub.vert,QZero);
+  tri::BlockQHelper<SLOT>::TDp()=&TD;
+
+  vcg::LocalOptimization<CMeshO> DeciSession(sub,&pp);
+  DeciSession.Init<tri::BlockTriEdgeCollapse<SLOT> >();
+  DeciSession.SetTargetSimplices(block.targetFaceNum);
+  DeciSession.SetTimeBudget(0.1f);
+  while( !abort && DeciSession.DoOptimization() && sub.fn>block.targetFaceNum )
+    ;
+  DeciSession.Finalize<tri::BlockTriEdgeCollapse<SLOT> >();
+  tri::BlockQHelper<SLOT>::TDp()=nullptr;
+
+  // keep only a compact copy of the simplified block
+  std::vector<int> liveFaces;
+  liveFaces.reserve(sub.fn);
+  for (size_t i = 0; i < sub.face.size(); ++i)
+    if (!sub.face[i].IsD()) liveFaces.push_back(i);
+  std::vector<int> subVert;
+  copyFaces(sub, liveFaces, block.mesh, subVert);
+  block.lockedVert.resize(subVert.size());
+  for (size_t i = 0; i < subVert.size(); ++i)
+  {
+    int orig = srcVert[subVert[i]];
+    block.lockedVert[i] = (vertBlock[orig] == -2) ? orig : -1;
+  }
+}
+
+typedef void (*BlockSimplifier)(SimplificationBlock &, const CMeshO &, const std::vector<int> &, tri::TriEdgeCollapseQuadricParameter, const std::atomic<bool> &);
+
+template <int... I>
+std::array<BlockSimplifier, sizeof...(I)> blockSimplifiers(std::integer_sequence<int, I...>)
+{
+  return {{ &simplifyBlock<I>... }};
+}
+
+} // namespace
+
+void ParallelQuadricSimplification(CMeshO &m,int  TargetFaceNum, tri::TriEdgeCollapseQuadricParameter &pp, CallBackPos *cb)
+{
+  unsigned int nThreads = meshlab::threadCount(MAX_PARALLEL_SESSIONS);
+  int depth = 0;
+  while ((1u << depth) < 4 * nThreads && (size_t(m.fn) >> (depth + 1)) >= MIN_BLOCK_FACES)
+    ++depth;
+  if (nThreads == 1 || depth == 0 || TargetFaceNum >= m.fn)
+  {
+    QuadricSimplification(m, TargetFaceNum, false, pp, cb);
+    return;
+  }
+
+  cb(1,"Splitting the mesh in blocks");
+  std::vector<int> faces;
+  faces.reserve(m.fn);
+  for (size_t i = 0; i < m.face.size(); ++i)
+    if (!m.face[i].IsD()) faces.push_back(i);
+  std::vector<std::pair<size_t, size_t> > ranges;
+  splitBlocks(m, faces, 0, faces.size(), depth, ranges);
+
+  // vertBlock: block of each vertex, -1 if unreferenced, -2 if shared by more blocks (locked)
+  std::vector<int> vertBlock(m.vert.size(), -1);
+  std::vector<SimplificationBlock> blocks(ranges.size());
+  for (size_t b = 0; b < ranges.size(); ++b)
+  {
+    blocks[b].faces.assign(faces.begin() + ranges[b].first, faces.begin() + ranges[b].second);
+    blocks[b].targetFaceNum = (int) ((double) blocks[b].faces.size() * TargetFaceNum / m.fn);
+    for (int f : blocks[b].faces)
+      for (int j = 0; j < 3; ++j)
+      {
+        int &vb = vertBlock[tri::Index(m, m.face[f].cV(j))];
+        if (vb == -1) vb = b;
+        else if (vb != (int) b) vb = -2;
+      }
+  }
+  std::vector<int>().swap(faces);
+
+  // PreserveBoundary keeps the vertices it locks in a static list, shared by
+  // all the threads: FastPreserveBoundary just clears their W flag
+  tri::TriEdgeCollapseQuadricParameter blockpp = pp;
+  if (blockpp.PreserveBoundary)
+  {
+    blockpp.FastPreserveBoundary = true;
+    blockpp.PreserveBoundary = false;
+  }
+  if (blockpp.NormalCheck) blockpp.NormalThrRad = M_PI/4.0;
+
+  // simplification of the blocks; the callback is invoked only by this thread
+  static const std::array<BlockSimplifier, MAX_PARALLEL_SESSIONS> simplifiers =
+      blockSimplifiers(std::make_integer_sequence<int, MAX_PARALLEL_SESSIONS>());
+  std::atomic<bool> abort(false);
+  meshlab::parallelFor(blocks.size(), [&](size_t b, unsigned int slot) {
+    simplifiers[slot](blocks[b], m, vertBlock, blockpp, abort);
+  }, cb, 5, 90, "Simplifying blocks...", nThreads, &abort);
+
+  // merge: the faces and the vertices owned by a single block are replaced
+  // by the simplified ones; locked and unreferenced vertices are kept
+  cb(90,"Merging blocks");
+  for (size_t i = 0; i < m.face.size(); ++i)
+    if (!m.face[i].IsD()) tri::Allocator<CMeshO>::DeleteFace(m, m.face[i]);
+  for (size_t i = 0; i < m.vert.size(); ++i)
+    if (!m.vert[i].IsD() && vertBlock[i] >= 0) tri::Allocator<CMeshO>::DeleteVertex(m, m.vert[i]);
+  std::vector<int>().swap(vertBlock);
+
+  size_t newVert = 0, newFace = 0;
+  for (const SimplificationBlock &block : blocks)
+  {
+    newFace += block.mesh.face.size();
+    for (int l : block.lockedVert)
+      if (l == -1) ++newVert;
+  }
+  size_t firstVert = m.vert.size();
+  size_t firstFace = m.face.size();
+  tri::Allocator<CMeshO>::AddVertices(m, newVert);
+  tri::Allocator<CMeshO>::AddFaces(m, newFace);
+  size_t vi = firstVert, fi = firstFace;
+  std::vector<CVertexO*> vertMap;
+  for (SimplificationBlock &block : blocks)
+  {
+    vertMap.resize(block.mesh.vert.size());
+    for (size_t i = 0; i < block.mesh.vert.size(); ++i)
+    {
+      if (block.lockedVert[i] >= 0)
+        vertMap[i] = &m.vert[block.lockedVert[i]];
+      else
+      {
+        m.vert[vi].ImportData(block.mesh.vert[i]);
+        m.vert[vi].SetW();
+        vertMap[i] = &m.vert[vi++];
+      }
+    }
+    for (size_t i = 0; i < block.mesh.face.size(); ++i, ++fi)
+    {
+      m.face[fi].ImportData(block.mesh.face[i]);
+      for (int j = 0; j < 3; ++j)
+        m.face[fi].V(j) = vertMap[tri::Index(block.mesh, block.mesh.face[i].V(j))];
+    }
+  }
+  blocks.clear();
+
+  // final pass, mostly on the seams, that were left untouched
+  tri::Allocator<CMeshO>::CompactEveryVector(m);
+  tri::UpdateTopology<CMeshO>::VertexFace(m);
+  tri::UpdateFlags<CMeshO>::FaceBorderFromVF(m);
+  if (m.fn > TargetFaceNum)
+    QuadricSimplification(m, TargetFaceNum, false, pp, cb);
+}
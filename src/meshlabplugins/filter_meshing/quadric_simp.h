@@ -58,8 +58,30 @@ public:
             inline MyTriEdgeCollapseQTex(  const VertexPair &p, int i,BaseParameterClass *pp) :TECQ(p,i,pp){}
 };
 
+// The edge collapse classes keep some state in static members (the quadrics
+// in the helper, the global mark in vcg::tri::TriEdgeCollapse), so two
+// simplification sessions using the same class cannot run at the same time.
+// The parallel simplification uses a different SLOT for each concurrent session.
+template <int SLOT>
+class BlockQHelper : public QHelper
+{
+public:
+  static math::Quadric<double> &Qd(CVertexO &v) {return TD()[v];}
+  static math::Quadric<double> &Qd(CVertexO *v) {return TD()[*v];}
+  static QuadricTemp* &TDp() {static QuadricTemp *td; return td;}
+  static QuadricTemp &TD() {return *TDp();}
+};
+
+template <int SLOT>
+class BlockTriEdgeCollapse: public vcg::tri::TriEdgeCollapseQuadric< CMeshO, VertexPair, BlockTriEdgeCollapse<SLOT>, BlockQHelper<SLOT> > {
+public:
+  typedef  vcg::tri::TriEdgeCollapseQuadric< CMeshO, VertexPair, BlockTriEdgeCollapse<SLOT>, BlockQHelper<SLOT> > TECQ;
+  inline BlockTriEdgeCollapse(  const VertexPair &p, int i, BaseParameterClass *pp) :TECQ(p,i,pp){}
+};
+
 } // end namespace tri
 } // end namespace vcg
 void QuadricSimplification   (CMeshO &m,int  TargetFaceNum,    bool Selected, vcg::tri::TriEdgeCollapseQuadricParameter &pp,    vcg::CallBackPos *cb);
+void ParallelQuadricSimplification(CMeshO &m,int  TargetFaceNum, vcg::tri::TriEdgeCollapseQuadricParameter &pp,    vcg::CallBackPos *cb);
 void QuadricTexSimplification(CMeshO &m,int  TargetFaceNum,    bool Selected, vcg::tri::TriEdgeCollapseQuadricTexParameter &pp, vcg::CallBackPos *cb);
 
@@ -57,6 +57,8 @@ class APSS : public MlsSurface<_MeshType>
 public:
 	APSS(const MeshType& m) : Base(m) { mSphericalParameter = 1; }
 
+	virtual APSS* clone() const { return new APSS(*this); }
+
 	virtual Scalar     potential(const VectorType& x, int* errorMask = 0) const;
 	virtual VectorType gradient(const VectorType& x, int* errorMask = 0) const;
 	virtual MatrixType hessian(const VectorType& x, int* errorMask) const;
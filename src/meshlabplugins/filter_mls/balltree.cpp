@@ -26,48 +26,51 @@
 namespace GaelMls {
 
 template<typename _Scalar>
-BallTree<_Scalar>::BallTree(const vcg::ConstDataWrapper<VectorType>& points, const vcg::ConstDataWrapper<Scalar>& radii)
-    : mPoints(points), mRadii(radii), mRadiusScale(1.), mTreeIsUptodate(false)
+BallTree<_Scalar>::BallTree(const vcg::ConstDataWrapper<VectorType>& points, const vcg::ConstDataWrapper<Scalar>& radii, Scalar radiusScale)
+    : mPoints(points), mRadii(radii), mRadiusScale(radiusScale)
 {
-    mRootNode = 0;
     mMaxTreeDepth = 12;
     mTargetCellSize = 24;
+    build();
 }
 
 template<typename _Scalar>
 void BallTree<_Scalar>::computeNeighbors(const VectorType& x, Neighborhood<Scalar>* pNei) const
 {
-    if (!mTreeIsUptodate)
-        const_cast<BallTree*>(this)->rebuild();
-
     pNei->clear();
-    mQueryPosition = x;
-    queryNode(*mRootNode, pNei);
-}
+    if (mNodes.empty())
+        return;
 
-template<typename _Scalar>
-void BallTree<_Scalar>::queryNode(Node& node, Neighborhood<Scalar>* pNei) const
-{
-    if (node.leaf)
+    // the balls overlapping a split plane are stored in both children,
+    // so we only need to go down to the leaf containing x
+    unsigned int nodeId = 0;
+    while (!mNodes[nodeId].leaf)
     {
-        for (unsigned int i=0 ; i<node.size ; ++i)
-        {
-            int id = node.indices[i];
-            Scalar d2 = vcg::SquaredNorm(mQueryPosition - mPoints[id]);
-            Scalar r = mRadiusScale * mRadii[id];
-            if (d2<r*r)
-                pNei->insert(id, d2);
-        }
+        const Node& node = mNodes[nodeId];
+        nodeId = node.start + ((x[node.dim] - node.splitValue < 0) ? 0 : 1);
     }
-    else
+
+    const Node& leaf = mNodes[nodeId];
+    const unsigned int* indices = mIndices.data() + leaf.start;
+    for (unsigned int i=0 ; i<leaf.size ; ++i)
     {
-        if (mQueryPosition[node.dim] - node.splitValue < 0)
-            queryNode(*node.children[0], pNei);
-        else
-            queryNode(*node.children[1], pNei);
+        int id = indices[i];
+        Scalar d2 = vcg::SquaredNorm(x - mPoints[id]);
+        Scalar r = mRadiusScale * mRadii[id];
+        if (d2<r*r)
+            pNei->insert(id, d2);
     }
 }
 
+template<typename _Scalar>
+void BallTree<_Scalar>::computeNeighbors(const std::vector<VectorType>& queries, std::vector<Neighborhood<Scalar> >& neighborhoods) const
+{
+    neighborhoods.resize(queries.size());
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int i=0 ; i<int(queries.size()) ; ++i)
+        computeNeighbors(queries[i], &neighborhoods[i]);
+}
+
 template <typename Scalar>
 inline vcg::Point3<Scalar> CwiseAdd(vcg::Point3<Scalar> const & p1, Scalar s)
 {
@@ -75,11 +78,13 @@ inline vcg::Point3<Scalar> CwiseAdd(vcg::Point3<Scalar> const & p1, Scalar s)
 }
 
 template<typename _Scalar>
-void BallTree<_Scalar>::rebuild(void)
+void BallTree<_Scalar>::build()
 {
-        delete mRootNode;
+        mNodes.clear();
+        mIndices.clear();
+        if (mPoints.size() == 0)
+            return;
 
-        mRootNode = new Node();
         IndexArray indices(mPoints.size());
         AxisAlignedBoxType aabb;
         aabb.Set(mPoints[0]);
@@ -87,16 +92,16 @@ void BallTree<_Scalar>::rebuild(void)
         {
                 indices[i] = i;
                 aabb.Add(mPoints[i],mRadii[i]*mRadiusScale);
-//				aabb.min = Min(aabb.min, CwiseAdd(mPoints[i], -mRadii[i]*mRadiusScale));
-//				aabb.max = Max(aabb.max, CwiseAdd(mPoints[i],  mRadii[i]*mRadiusScale));
         }
-        buildNode(*mRootNode, indices, aabb, 0);
+        mNodes.push_back(Node());
+        buildNode(0, indices, aabb, 0);
 
-        mTreeIsUptodate = true;
+        mNodes.shrink_to_fit();
+        mIndices.shrink_to_fit();
 }
 
 template<typename _Scalar>
-void BallTree<_Scalar>::split(const IndexArray& indices, const AxisAlignedBoxType& aabbLeft, const AxisAlignedBoxType& aabbRight, IndexArray& iLeft, IndexArray& iRight)
+void BallTree<_Scalar>::split(const IndexArray& indices, const AxisAlignedBoxType& aabbLeft, const AxisAlignedBoxType& aabbRight, IndexArray& iLeft, IndexArray& iRight) const
 {
     for (std::vector<int>::const_iterator it=indices.begin(), end=indices.end() ; it!=end ; ++it)
     {
@@ -110,7 +115,7 @@ void BallTree<_Scalar>::split(const IndexArray& indices, const AxisAlignedBoxTyp
 }
 
 template<typename _Scalar>
-void BallTree<_Scalar>::buildNode(Node& node, std::vector<int>& indices, AxisAlignedBoxType aabb, int level)
+void BallTree<_Scalar>::buildNode(unsigned int nodeId, IndexArray& indices, AxisAlignedBoxType aabb, int level)
 {
     Scalar avgradius = 0.;
     for (std::vector<int>::const_iterator it=indices.begin(), end=indices.end() ; it!=end ; ++it)
@@ -121,44 +126,40 @@ void BallTree<_Scalar>::buildNode(Node& node, std::vector<int>& indices, AxisAli
         || avgradius*0.9 > std::max(std::max(diag.X(), diag.Y()), diag.Z())
         || int(level)>=mMaxTreeDepth)
     {
+        // note: mNodes may be reallocated by the children, never keep references across buildNode calls
+        Node& node = mNodes[nodeId];
         node.leaf = true;
-        node.size = indices.size();
-        node.indices = new unsigned int[node.size];
-        for (unsigned int i=0 ; i<node.size ; ++i)
-            node.indices[i] = indices[i];
+        node.start = (unsigned int) mIndices.size();
+        node.size = (unsigned int) indices.size();
+        mIndices.insert(mIndices.end(), indices.begin(), indices.end());
         return;
     }
 
     unsigned int dim = diag.MaxCoeffId();
-    node.dim = dim;
-    node.splitValue = Scalar(0.5*(aabb.max[dim] + aabb.min[dim]));
-    node.leaf = 0;
+    Scalar splitValue = Scalar(0.5*(aabb.max[dim] + aabb.min[dim]));
+    unsigned int firstChild = (unsigned int) mNodes.size();
+    {
+        Node& node = mNodes[nodeId];
+        node.dim = dim;
+        node.splitValue = splitValue;
+        node.leaf = false;
+        node.start = firstChild;
+        node.size = 0;
+    }
+    mNodes.resize(mNodes.size() + 2);
 
     AxisAlignedBoxType aabbLeft=aabb, aabbRight=aabb;
-    aabbLeft.max[dim] = node.splitValue;
-    aabbRight.min[dim] = node.splitValue;
+    aabbLeft.max[dim] = splitValue;
+    aabbRight.min[dim] = splitValue;
 
     std::vector<int> iLeft, iRight;
     split(indices, aabbLeft, aabbRight, iLeft,iRight);
 
     // we don't need the index list anymore
-    indices.clear();
+    IndexArray().swap(indices);
 
-    {
-        // left child
-        //mNodes.resize(mNodes.size()+1);
-        Node* pChild = new Node();
-        node.children[0] = pChild;
-        buildNode(*pChild, iLeft, aabbLeft, level+1);
-    }
-
-    {
-        // right child
-        //mNodes.resize(mNodes.size()+1);
-        Node* pChild = new Node();
-        node.children[1] = pChild;
-        buildNode(*pChild, iRight, aabbRight, level+1);
-    }
+    buildNode(firstChild, iLeft, aabbLeft, level+1);
+    buildNode(firstChild+1, iRight, aabbRight, level+1);
 }
 
 template class BallTree<float>;
@@ -30,27 +30,42 @@
 
 namespace GaelMls {
 
+/** The result of a neighborhood query: the indices of the points whose ball contains
+ * the query point, together with their squared distance to it.
+ * The entries are stored in a single flat array which is reused across queries.
+ */
 template<typename _Scalar>
 class Neighborhood
 {
     public:
         typedef _Scalar Scalar;
 
-        int index(int i) const { return mIndices.at(i); }
-        Scalar squaredDistance(int i) const { return mSqDists.at(i); }
+        int index(int i) const { return mEntries[i].index; }
+        Scalar squaredDistance(int i) const { return mEntries[i].sqDist; }
 
-        void clear() { mIndices.clear(); mSqDists.clear(); }
-        void resize(int size) { mIndices.resize(size); mSqDists.resize(size); }
-        void reserve(int size) { mIndices.reserve(size); mSqDists.reserve(size); }
-        int size() { return mIndices.size(); }
+        void clear() { mEntries.clear(); }
+        void resize(int size) { mEntries.resize(size); }
+        void reserve(int size) { mEntries.reserve(size); }
+        int size() const { return int(mEntries.size()); }
 
-        void insert(int id, Scalar d2) { mIndices.push_back(id); mSqDists.push_back(d2); }
+        void insert(int id, Scalar d2) { mEntries.push_back(Entry{id, d2}); }
 
     protected:
-        std::vector<int> mIndices;
-        std::vector<Scalar> mSqDists;
+        struct Entry
+        {
+            int index;
+            Scalar sqDist;
+        };
+        std::vector<Entry> mEntries;
 };
 
+/** A kd-tree of balls (point + radius * radiusScale), built once at construction.
+ *
+ * The nodes are stored in one contiguous array (the two children of an inner node are
+ * adjacent), and the leaves reference ranges of a single index array.
+ * Once built, the tree is never modified: all the queries are const and re-entrant,
+ * therefore the same tree can be shared by several threads.
+ */
 template<typename _Scalar>
 class BallTree
 {
@@ -58,48 +73,37 @@ class BallTree
         typedef _Scalar Scalar;
         typedef vcg::Point3<Scalar> VectorType;
 
-        BallTree(const vcg::ConstDataWrapper<VectorType>& points, const vcg::ConstDataWrapper<Scalar>& radii);
+        BallTree(const vcg::ConstDataWrapper<VectorType>& points, const vcg::ConstDataWrapper<Scalar>& radii, Scalar radiusScale = 1.);
 
+        /** Computes the neighbors of \a x, i.e. the points whose ball contains x */
         void computeNeighbors(const VectorType& x, Neighborhood<Scalar>* pNei) const;
 
-        void setRadiusScale(Scalar v) { mRadiusScale = v; mTreeIsUptodate = false; }
+        /** Computes the neighborhoods of all the \a queries, in parallel when OpenMP is available */
+        void computeNeighbors(const std::vector<VectorType>& queries, std::vector<Neighborhood<Scalar> >& neighborhoods) const;
+
+        Scalar radiusScale() const { return mRadiusScale; }
 
     protected:
 
         struct Node
         {
-            ~Node()
-            {
-                if (!leaf)
-                {
-                    delete children[0];
-                    delete children[1];
-                }
-                else
-                {
-                    delete[] indices;
-                }
-            }
             Scalar splitValue;
-            unsigned char dim:2;
-            unsigned char leaf:1;
-            union {
-                Node* children[2];
-                struct {
-                    unsigned int* indices;
-                    unsigned int size;
-                };
-            };
+            unsigned char dim;
+            bool leaf;
+            // inner node: index of the first child in mNodes (the second one follows it)
+            // leaf: index of the first point index in mIndices
+            unsigned int start;
+            // leaf: number of point indices
+            unsigned int size;
         };
 
         typedef std::vector<int> IndexArray;
         typedef vcg::Box3<Scalar> AxisAlignedBoxType;
 
-        void rebuild();
+        void build();
         void split(const IndexArray& indices, const AxisAlignedBoxType& aabbLeft, const AxisAlignedBoxType& aabbRight,
-                            IndexArray& iLeft, IndexArray& iRight);
-        void buildNode(Node& node, std::vector<int>& indices, AxisAlignedBoxType aabb, int level);
-        void queryNode(Node& node, Neighborhood<Scalar>* pNei) const;
+                            IndexArray& iLeft, IndexArray& iRight) const;
+        void buildNode(unsigned int nodeId, IndexArray& indices, AxisAlignedBoxType aabb, int level);
 
     protected:
         vcg::ConstDataWrapper<VectorType> mPoints;
@@ -108,10 +112,9 @@ class BallTree
 
         int mMaxTreeDepth;
         int mTargetCellSize;
-        mutable bool mTreeIsUptodate;
-        mutable VectorType mQueryPosition;
 
-        Node* mRootNode;
+        std::vector<Node> mNodes;
+        std::vector<unsigned int> mIndices;
 };
 
 }
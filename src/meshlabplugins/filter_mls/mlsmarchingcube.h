@@ -28,8 +28,14 @@
 #include <vcg/space/box3.h>
 #include <common/ml_document/mesh_model.h>
 #include <map>
+#include <memory>
+#include <vector>
 #include "mlssurface.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace vcg {
 namespace tri {
 
@@ -119,6 +125,17 @@ public:
         int countSubSlice = 0;
         int totalSubSlices = nofBlocks[2] * nofBlocks[1] * nofCells[0];
 
+        // the grid is filled in parallel: the surface caches its last query,
+        // therefore each thread evaluates its own clone (sharing the ball tree)
+        surface.buildBallTree();
+        int nThreads = 1;
+#ifdef _OPENMP
+        nThreads = omp_get_max_threads();
+#endif
+        std::vector<std::unique_ptr<SurfaceType> > surfaces(nThreads);
+        for (int t=1 ; t<nThreads ; ++t)
+            surfaces[t].reset(surface.clone());
+
         extractor.Initialize();
         // for each macro block
         vcg::Point3i bi; // block id
@@ -139,17 +156,25 @@ public:
             vcg::Point3i ci; // local cell id
 
             // for each corners...
-            for (ci[0]=0 ; ci[0]<mGridSize[0] ; ++ci[0])
+            for (int x=0 ; x<mGridSize[0] ; ++x)
             {
                 if (cb)
                     cb((100*(++countSubSlice))/totalSubSlices, "Marching cube...");
-                for (ci[1]=0 ; ci[1]<mGridSize[1] ; ++ci[1])
-                for (ci[2]=0 ; ci[2]<mGridSize[2] ; ++ci[2])
+                const int sliceSize = mGridSize[1]*mGridSize[2];
+                #pragma omp parallel for schedule(dynamic, 16)
+                for (int yz=0 ; yz<sliceSize ; ++yz)
                 {
-                    GridElement& el = mCache[(ci[2]*mMaxBlockSize + ci[1])*mMaxBlockSize + ci[0]];
-                    el.position = origin + VectorType(ci[0],ci[1],ci[2]) * step;
-                    el.value = mpSurface->potential(el.position);
-                    if (!mpSurface->isInDomain(el.position))
+                    int t = 0;
+#ifdef _OPENMP
+                    t = omp_get_thread_num();
+#endif
+                    const SurfaceType* s = (t==0) ? mpSurface : surfaces[t].get();
+                    int y = yz / mGridSize[2];
+                    int z = yz % mGridSize[2];
+                    GridElement& el = mCache[(z*mMaxBlockSize + y)*mMaxBlockSize + x];
+                    el.position = origin + VectorType(x,y,z) * step;
+                    el.value = s->potential(el.position);
+                    if (!s->isInDomain(el.position))
                         el.value = invalidValue;
                 }
             }
@@ -25,6 +25,12 @@
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
+#include <memory>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "mlsmarchingcube.h"
 #include <vcg/complex/algorithms/clean.h>
@@ -48,6 +54,55 @@ typedef Histogram<Scalarm> Histogramm;
 
 enum { CT_MEAN = 0, CT_GAUSS = 1, CT_K1 = 2, CT_K2 = 3, CT_APSS = 4 };
 
+namespace {
+
+/**
+ * Projects the vertices of m onto the MLS surface (and sets their normal).
+ * If selectionOnly is true, only the selected vertices are projected.
+ *
+ * The vertices are processed in blocks: each block is projected in parallel, every thread
+ * using its own clone of the surface (the ball tree is shared), and the callback is invoked
+ * between two blocks by the calling thread only.
+ */
+void projectVertices(
+	MlsSurface<CMeshO>* mls,
+	CMeshO&             m,
+	bool                selectionOnly,
+	int                 progressStart,
+	int                 progressRange,
+	vcg::CallBackPos*   cb)
+{
+	const int blockSize = 8192;
+
+	mls->buildBallTree();
+	int nThreads = 1;
+#ifdef _OPENMP
+	nThreads = omp_get_max_threads();
+#endif
+	std::vector<std::unique_ptr<MlsSurface<CMeshO>>> surfaces(nThreads);
+	for (int t = 1; t < nThreads; ++t)
+		surfaces[t].reset(mls->clone());
+
+	const int n = (int) m.vert.size();
+	for (int start = 0; start < n; start += blockSize) {
+		cb(progressStart + int(progressRange * (long long) start / n), "MLS projection...");
+		const int end = std::min(start + blockSize, n);
+#pragma omp parallel for schedule(dynamic, 64)
+		for (int i = start; i < end; ++i) {
+			int t = 0;
+#ifdef _OPENMP
+			t = omp_get_thread_num();
+#endif
+			const MlsSurface<CMeshO>* surface = (t == 0) ? mls : surfaces[t].get();
+			CVertexO& v = m.vert[i];
+			if (!v.IsD() && ((!selectionOnly) || v.IsS()))
+				v.P() = surface->project(v.P(), &v.N());
+		}
+	}
+}
+
+} // namespace
+
 MlsPlugin::MlsPlugin()
 {
 	typeList = {
@@ -550,12 +605,7 @@ void MlsPlugin::computeProjection(
 				cb);
 		}
 		// project all vertices onto the MLS surface
-		for (unsigned int i = 0; i < mesh->cm.vert.size(); i++) {
-			cb(1 + 98 * i / mesh->cm.vert.size(), "MLS projection...");
-
-			if ((!selectionOnly) || (mesh->cm.vert[i].IsS()))
-				mesh->cm.vert[i].P() = mls->project(mesh->cm.vert[i].P(), &mesh->cm.vert[i].N());
-		}
+		projectVertices(mls, mesh->cm, selectionOnly, 1, 98, cb);
 	}
 
 	log("Successfully projected %i vertices", mesh->cm.vn);
@@ -663,10 +713,7 @@ void MlsPlugin::computeMarchingCubes(
 	walker.BuildMesh<MlsMarchingCubes>(mesh->cm, *mls, mc, cb);
 
 	// accurate projection
-	for (unsigned int i = 0; i < mesh->cm.vert.size(); i++) {
-		cb(1 + 98 * i / mesh->cm.vert.size(), "MLS projection...");
-		mesh->cm.vert[i].P() = mls->project(mesh->cm.vert[i].P(), &mesh->cm.vert[i].N());
-	}
+	projectVertices(mls, mesh->cm, false, 1, 98, cb);
 
 	// extra zero detection and removal
 	{
@@ -27,6 +27,7 @@
 #include "balltree.h"
 #include <Eigen/Dense>
 #include <iostream>
+#include <memory>
 #include <vcg/math/matrix33.h>
 #include <vcg/space/box3.h>
 #include <vcg/complex/allocate.h>
@@ -69,7 +70,6 @@ public:
 		mFilterScale                = 4.0;
 		mMaxNofProjectionIterations = 20;
 		mProjectionAccuracy         = (Scalar) 1e-4;
-		mBallTree                   = 0;
 		mGradientHint               = MLS_DERIVATIVE_ACCURATE;
 		mHessianHint                = MLS_DERIVATIVE_ACCURATE;
 
@@ -80,6 +80,17 @@ public:
 
 	virtual ~MlsSurface() {}
 
+	/** \returns a copy of this surface with its own query caches.
+	 *
+	 * The evaluation functions (potential(), project(), ...) are not re-entrant because they
+	 * cache the last neighborhood: each thread must work on its own clone. The clones share the
+	 * same (immutable) ball tree, which should be built with buildBallTree() before cloning.
+	 */
+	virtual MlsSurface* clone() const = 0;
+
+	/** builds the spatial search structure, if not already done */
+	void buildBallTree();
+
 	/** \returns the value of the reconstructed scalar field at point \a x */
 	virtual Scalar potential(const VectorType& x, int* errorMask = 0) const = 0;
 
@@ -195,7 +206,7 @@ protected:
 	int               mGradientHint;
 	int               mHessianHint;
 
-	BallTree<Scalar>* mBallTree;
+	std::shared_ptr<const BallTree<Scalar>> mBallTree;
 
 	int    mMaxNofProjectionIterations;
 	Scalar mFilterScale;
@@ -61,8 +61,8 @@ void MlsSurface<_MeshType>::setFilterScale(Scalar v)
 {
 	mFilterScale          = v;
 	mCachedQueryPointIsOK = false;
-	if (mBallTree)
-		mBallTree->setRadiusScale(mFilterScale);
+	// the radius scale is baked into the tree: it will be rebuilt by the next query
+	mBallTree.reset();
 }
 
 template<typename _MeshType>
@@ -93,13 +93,18 @@ void MlsSurface<_MeshType>::setHessianHint(int h)
 	mCachedQueryPointIsOK = false;
 }
 
+template<typename _MeshType>
+void MlsSurface<_MeshType>::buildBallTree()
+{
+	if (!mBallTree)
+		mBallTree = std::make_shared<const BallTree<Scalar>>(positions(), radii(), mFilterScale);
+}
+
 template<typename _MeshType>
 void MlsSurface<_MeshType>::computeNeighborhood(const VectorType& x, bool computeDerivatives) const
 {
-	if (!mBallTree) {
-		const_cast<BallTree<Scalar>*&>(mBallTree) = new BallTree<Scalar>(positions(), radii());
-		const_cast<BallTree<Scalar>*>(mBallTree)->setRadiusScale(mFilterScale);
-	}
+	if (!mBallTree)
+		const_cast<MlsSurface*>(this)->buildBallTree();
 	mBallTree->computeNeighbors(x, &mNeighborhood);
 	size_t nofSamples = mNeighborhood.size();
 
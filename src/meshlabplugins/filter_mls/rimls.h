@@ -63,6 +63,8 @@ class RIMLS : public MlsSurface<_MeshType>
 			mMaxRefittingIters = 3;
 		}
 
+		virtual RIMLS* clone() const { return new RIMLS(*this); }
+
 		virtual Scalar potential(const VectorType& x, int* errorMask = 0) const;
 		virtual VectorType gradient(const VectorType& x, int* errorMask = 0) const;
 		virtual MatrixType hessian(const VectorType& x, int* errorMask = 0) const;
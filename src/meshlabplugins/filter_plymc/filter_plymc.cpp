@@ -26,10 +26,158 @@
 #include <vcg/complex/algorithms/smooth.h>
 #include <vcg/complex/algorithms/create/plymc/plymc.h>
 #include <vcg/complex/algorithms/create/plymc/simplemeshprovider.h>
-#include <QTemporaryFile>
+
+#include <common/utilities/parallel.h>
+
+#include <algorithm>
+#include <memory>
 
 using namespace vcg;
 
+namespace {
+
+/**
+ * @brief The InMemoryMeshProvider class gives to PlyMC the meshes to merge
+ * directly from memory, in place of the SimpleMeshProvider that loads them
+ * from files. The meshes must be fully preprocessed and already moved in the
+ * voxel space of the whole volume, with their bounding boxes left in world
+ * coordinates, as PlyMC::InitMesh leaves them: Find gives them as already
+ * initialized, so that they are only read by the PlyMC instances that merge
+ * different sub-volumes concurrently.
+ */
+class InMemoryMeshProvider
+{
+public:
+	void addMesh(const std::shared_ptr<SMesh>& m, const std::string& name)
+	{
+		meshes.push_back(m);
+		names.push_back(name);
+		fullBox.Add(m->bbox);
+	}
+
+	int size() const {return meshes.size();}
+	int getCacheSize() const {return meshes.size();}
+	int setCacheSize(size_t) {return meshes.size();}
+	vcg::Box3f bb(int i) const {return meshes[i]->bbox;}
+	vcg::Box3f fullBB() const {return fullBox;}
+	vcg::Matrix44f Tr(int) const {vcg::Matrix44f id; id.SetIdentity(); return id;}
+	std::string MeshName(int i) const {return names[i];}
+	float W(int) const {return 1.0f;}
+	void Clear() {meshes.clear(); names.clear(); fullBox.SetNull();}
+	bool InitBBox() {return true;}
+
+	// the mesh is always already loaded and initialized
+	bool Find(int i, SMesh*& sm)
+	{
+		sm = meshes[i].get();
+		return true;
+	}
+
+private:
+	std::vector<std::shared_ptr<SMesh>> meshes;
+	std::vector<std::string> names;
+	vcg::Box3f fullBox;
+};
+
+/**
+ * @brief The SubVolumePlyMC class merges a single sub-volume (p.IPosS) and
+ * returns the extracted mesh, while PlyMC::Process saves it in a PLY file.
+ * The steps are the ones of PlyMC::Process.
+ */
+class SubVolumePlyMC : public tri::PlyMC<SMesh, InMemoryMeshProvider>
+{
+public:
+	typedef decltype(VV) VolumeType;
+
+	/**
+	 * @brief Initializes v as the sub-volume pos of the grid that
+	 * PlyMC::Process builds for the meshes contained in fullBB.
+	 */
+	static void initVolume(VolumeType& v, const Parameter& p, vcg::Box3f fullBB, Point3i pos)
+	{
+		fullBB.Offset(fullBB.Diag() * 0.1);
+		Point3f voxdim = fullBB.max - fullBB.min;
+		long long cells;
+		if (p.NCell > 0)
+			cells = (long long) p.NCell * 1000;
+		else
+			cells = (long long) (voxdim[0] / p.VoxSize) * (long long) (voxdim[1] / p.VoxSize) *
+					(long long) (voxdim[2] / p.VoxSize);
+		v.Init(cells, fullBB, p.IDiv, pos);
+	}
+
+	/**
+	 * @brief Merges the sub-volume p.IPosS into me, in world coordinates.
+	 * Returns false if the sub-volume contains no surface.
+	 */
+	bool process(MCMesh& me)
+	{
+		p.IPos = p.IPosS;
+		initVolume(VV, p, MP.fullBB(), p.IPos);
+		if (p.WideSize > 0)
+			p.WideNum = p.WideSize / VV.voxel.Norm();
+		if (p.QualitySmoothAbs == 0)
+			p.QualitySmoothAbs = p.QualitySmoothVox * VV.voxel.Norm();
+
+		bool res = false;
+		for (int i = 0; i < MP.size(); ++i) {
+			SMesh* sm;
+			if (MP.bb(i).Collide(VV.SubBoxSafe) && MP.Find(i, sm))
+				res |= AddMeshToVolumeM(*sm, MP.MeshName(i), MP.W(i));
+		}
+		if (!res)
+			return false;
+
+		if (p.OffsetFlag)
+			VV.Offset(p.OffsetThr);
+		for (int i = 0; i < p.RefillNum; ++i)
+			VV.Refill(3, 6);
+		for (int i = 0; i < p.SmoothNum; ++i) {
+			VolumeType sm;
+			sm.Init(VV);
+			sm.CopySmooth(VV, 1, p.QualitySmoothAbs);
+			VV = sm;
+			VV.Refill(3, 6);
+		}
+
+		typedef tri::TrivialWalker<MCMesh, VolumeType> Walker;
+		typedef tri::MarchingCubes<MCMesh, Walker>     MarchingCubes;
+		Walker walker;
+		MarchingCubes mc(me, walker);
+		walker.SetExtractionBox(VV.SubPartSafe);
+		walker.BuildMesh(me, VV, mc, 0);
+
+		// the vertices out of the sub-volume belong to its neighbours
+		Box3f subPart;
+		subPart.Import(VV.SubPart);
+		for (MCMesh::VertexIterator vi = me.vert.begin(); vi != me.vert.end(); ++vi) {
+			if (!subPart.IsIn(vi->P()))
+				tri::Allocator<MCMesh>::DeleteVertex(me, *vi);
+			VV.DeInterize(vi->P());
+		}
+		for (MCMesh::FaceIterator fi = me.face.begin(); fi != me.face.end(); ++fi) {
+			if (fi->V(0)->IsD() || fi->V(1)->IsD() || fi->V(2)->IsD())
+				tri::Allocator<MCMesh>::DeleteFace(me, *fi);
+			else
+				std::swap(fi->V1(0), fi->V2(0));
+		}
+		if (me.vn == 0 && me.fn == 0)
+			return false;
+
+		if (p.SimplificationFlag) {
+			me.face.EnableVFAdjacency();
+			tri::MCSimplify<MCMesh>(me, VV.voxel[0] / 4.0);
+			tri::Allocator<MCMesh>::CompactFaceVector(me);
+			me.face.EnableFFAdjacency();
+			tri::Clean<MCMesh>::RemoveTVertexByFlip(me, 20, true);
+			tri::Clean<MCMesh>::RemoveFaceFoldByFlip(me);
+		}
+		return true;
+	}
+};
+
+}
+
 // Constructor usually performs only two simple tasks of filling the two lists
 //  - typeList: with all the possible id of the filtering actions
 //  - actionList with the corresponding actions. If you want to add icons to your filtering actions you can do here by construction the QActions accordingly
@@ -114,6 +262,7 @@ RichParameterList PlyMCPlugin::initParameterList(const QAction *action,const Mes
 	case FP_PLYMC :
 		parlst.addParam(RichPercentage("voxSize",m.cm.bbox.Diag()/100.0,0,m.cm.bbox.Diag(),"Voxel Side", "VoxelSide"));
 		parlst.addParam(    RichInt("subdiv",1,"SubVol Splitting","The level of recursive splitting of the subvolume reconstruction process. A value of '3' means that a 3x3x3 regular space subdivision is created and the reconstruction process generate 8 matching meshes. It is useful for reconsruction objects at a very high resolution. Default value (1) means no splitting."));
+		parlst.addParam(    RichInt("maxConcurrentSubVolumes",2,"Concurrent SubVolumes","How many subvolumes are reconstructed at the same time, each one by its own thread. Every subvolume being reconstructed keeps its whole voxel grid in memory: raise it only if there is enough memory for that many grids."));
 		parlst.addParam(  RichFloat("geodesic",2.0,"Geodesic Weighting","The influence of each range map is weighted with its geodesic distance from the borders. In this way when two (or more ) range maps overlaps their contribution blends smoothly hiding possible misalignments. "));
 		parlst.addParam(   RichBool("openResult",true,"Show Result","if not checked the result is only saved into the current directory"));
 		parlst.addParam(    RichInt("smoothNum",1,"Volume Laplacian iter","How many volume smoothing step are performed to clean out the eventually noisy borders"));
@@ -143,25 +292,10 @@ std::map<std::string, QVariant> PlyMCPlugin::applyFilter(
 	{
 		srand(time(NULL));
 		
-		//check if folder is writable
-		QTemporaryFile file("./_tmp_XXXXXX.tmp");
-		if (!file.open()) 
-		{
-			log("ERROR - current folder is not writable. VCG Merging needs to save intermediate files in the current working folder. Project and meshes must be in a write-enabled folder. Please save your data in a suitable folder before applying.");
-			throw MLException("current folder is not writable.<br> VCG Merging needs to save intermediate files in the current working folder.<br> Project and meshes must be in a write-enabled folder.<br> Please save your data in a suitable folder before applying.");
-		}
-		
-		tri::PlyMC<SMesh,SimpleMeshProvider<SMesh> > pmc;
-		pmc.MP.setCacheSize(64);
-		tri::PlyMC<SMesh,SimpleMeshProvider<SMesh> >::Parameter &p = pmc.p;
-		
+		SubVolumePlyMC::Parameter p;
 		int subdiv=par.getInt("subdiv");
 		
 		p.IDiv=Point3i(subdiv,subdiv,subdiv);
-		p.IPosS=Point3i(0,0,0);
-		p.IPosE[0]=p.IDiv[0]-1; p.IPosE[1]=p.IDiv[1]-1; p.IPosE[2]=p.IDiv[2]-1;
-		printf("AutoComputing all subVolumes on a %ix%ix%i\n",p.IDiv[0],p.IDiv[1],p.IDiv[2]);
-		
 		p.VoxSize=par.getAbsPerc("voxSize");
 		p.QualitySmoothVox = par.getFloat("geodesic");
 		p.SmoothNum = par.getInt("smoothNum");
@@ -170,61 +304,112 @@ std::map<std::string, QVariant> PlyMCPlugin::applyFilter(
 		p.FullyPreprocessedFlag=true;
 		p.MergeColor=p.VertSplatFlag=par.getBool("mergeColor");
 		p.SimplificationFlag = par.getBool("simplification");
+		
+		// preprocessing of the visible layers, done concurrently
+		std::vector<MeshModel*> visibleMeshes;
 		for(MeshModel& mm: md.meshIterator())
 		{
 			if(mm.isVisible())
 			{
-				SMesh sm;
 				mm.updateDataMask(MeshModel::MM_FACEQUALITY);
-				tri::Append<SMesh,CMeshO>::Mesh(sm, mm.cm/*,false,p.VertSplatFlag*/); // note the last parameter of the append to prevent removal of unreferenced vertices...
-				tri::UpdatePosition<SMesh>::Matrix(sm, Matrix44f::Construct(mm.cm.Tr),true);
-				tri::UpdateBounding<SMesh>::Box(sm);
-				tri::UpdateNormal<SMesh>::NormalizePerVertex(sm);
-				tri::UpdateTopology<SMesh>::VertexFace(sm);
-				tri::UpdateFlags<SMesh>::VertexBorderFromNone(sm);
-				tri::Geodesic<SMesh>::DistanceFromBorder(sm);
-				for(int i=0;i<par.getInt("normalSmooth");++i)
-					tri::Smooth<SMesh>::FaceNormalLaplacianVF(sm);
-				//QString mshTmpPath=QDir::tempPath()+QString("/")+QString(mm->shortName())+QString(".vmi");
-				QString mshTmpPath=QString("__TMP")+QString(mm.shortName())+QString(".vmi");
-				qDebug("Saving tmp file %s",qUtf8Printable(mshTmpPath));
-				int retVal = tri::io::ExporterVMI<SMesh>::Save(sm,qUtf8Printable(mshTmpPath) );
-				if(retVal!=0)
-				{
-					qDebug("Failed to write vmi temp file %s",qUtf8Printable(mshTmpPath));
-
-					log("ERROR - Failed to write vmi temp file %s", qUtf8Printable(mshTmpPath));
-					throw MLException("Failed to write vmi temp file " + mshTmpPath);
-				}
-				pmc.MP.AddSingleMesh(qUtf8Printable(mshTmpPath));
-				log("Preprocessing mesh %s",qUtf8Printable(mm.shortName()));
+				visibleMeshes.push_back(&mm);
 			}
 		}
-		
-		if(pmc.Process(cb)==false)
-		{
-			throw MLException(pmc.errorMessage.c_str());
+		std::vector<std::shared_ptr<SMesh>> smeshes(visibleMeshes.size());
+		int normalSmooth = par.getInt("normalSmooth");
+		meshlab::parallelFor(visibleMeshes.size(), [&](size_t i, unsigned int) {
+			MeshModel& mm = *visibleMeshes[i];
+			std::shared_ptr<SMesh> sm = std::make_shared<SMesh>();
+			tri::Append<SMesh,CMeshO>::Mesh(*sm, mm.cm/*,false,p.VertSplatFlag*/); // note the last parameter of the append to prevent removal of unreferenced vertices...
+			tri::UpdatePosition<SMesh>::Matrix(*sm, Matrix44f::Construct(mm.cm.Tr),true);
+			tri::UpdateBounding<SMesh>::Box(*sm);
+			tri::UpdateNormal<SMesh>::NormalizePerVertex(*sm);
+			tri::UpdateTopology<SMesh>::VertexFace(*sm);
+			tri::UpdateFlags<SMesh>::VertexBorderFromNone(*sm);
+			tri::Geodesic<SMesh>::DistanceFromBorder(*sm);
+			for(int k=0;k<normalSmooth;++k)
+				tri::Smooth<SMesh>::FaceNormalLaplacianVF(*sm);
+			// AddMeshToVolumeM sets the face quality with this same
+			// expression: the concurrent instances find it already set
+			for(SMesh::FaceType& f : sm->face)
+				f.Q()=(f.V(0)->Q()+f.V(1)->Q()+f.V(2)->Q())/3.0f;
+			smeshes[i] = sm;
+		}, cb, 0, 15, "Preprocessing meshes");
+
+		InMemoryMeshProvider provider;
+		for (size_t i = 0; i < visibleMeshes.size(); ++i) {
+			provider.addMesh(smeshes[i], qUtf8Printable(visibleMeshes[i]->shortName()));
+			log("Preprocessing mesh %s",qUtf8Printable(visibleMeshes[i]->shortName()));
 		}
-		
-		
+
+		// all the sub-volumes share the grid of the whole volume: the meshes
+		// are moved in its voxel space once, here, instead of by the
+		// PlyMC::InitMesh of each instance
+		SubVolumePlyMC::VolumeType grid;
+		SubVolumePlyMC::initVolume(grid, p, provider.fullBB(), Point3i(0,0,0));
+		meshlab::parallelFor(smeshes.size(), [&](size_t i, unsigned int) {
+			for(SMesh::VertexType& v : smeshes[i]->vert)
+				grid.Interize(v.P());
+		}, cb, 15, 20, "Preprocessing meshes");
+		smeshes.clear();
+
+		// each sub-volume is merged by its own PlyMC instance, concurrently
+		// with (at most maxConcurrentSubVolumes - 1) others; an instance is
+		// destroyed, freeing its volume, as soon as its sub-volume is done
+		int nSubVolumes = subdiv * subdiv * subdiv;
+		unsigned int maxConcurrent = std::max(par.getInt("maxConcurrentSubVolumes"), 1);
+		std::vector<std::unique_ptr<SubVolumePlyMC::MCMesh>> results(nSubVolumes);
+		std::vector<std::string> names(nSubVolumes);
+		meshlab::parallelFor(nSubVolumes, [&](size_t i, unsigned int) {
+			Point3i pos(i / (subdiv * subdiv), (i / subdiv) % subdiv, i % subdiv);
+			std::unique_ptr<SubVolumePlyMC> pmc(new SubVolumePlyMC());
+			pmc->MP = provider;
+			pmc->p = p;
+			pmc->p.IPosS = pos;
+			pmc->p.IPosE = pos;
+			std::unique_ptr<SubVolumePlyMC::MCMesh> me(new SubVolumePlyMC::MCMesh());
+			if(!pmc->process(*me))
+				return;
+			names[i] = p.basename;
+			if(p.IDiv!=Point3i(1,1,1))
+			{
+				std::string subvoltag;
+				pmc->VV.GetSubVolumeTag(subvoltag);
+				names[i] += subvoltag;
+			}
+			names[i] += p.SimplificationFlag ? ".d.ply" : ".ply";
+			results[i] = std::move(me);
+		}, cb, 20, 90, "Merging sub-volumes", maxConcurrent);
+		provider.Clear();
+
 		if(par.getBool("openResult"))
 		{
-			for(size_t i=0;i<p.OutNameVec.size();++i)
-			{std::string name;
-				if(!p.SimplificationFlag) name = p.OutNameVec[i].c_str();
-				else name = p.OutNameSimpVec[i].c_str();
-				
-				MeshModel *mp=md.addNewMesh("",name.c_str(),true);  // created mesh is the current one, if multiple meshes are created last mesh is the current one
-				int loadMask=-1;
-				tri::io::ImporterPLY<CMeshO>::Open(mp->cm,name.c_str(),loadMask);
+			for(int i=0;i<nSubVolumes;++i)
+			{
+				if(!results[i])
+					continue;
+				MeshModel *mp=md.addNewMesh("",QString::fromStdString(names[i]),true);  // created mesh is the current one, if multiple meshes are created last mesh is the current one
 				if(p.MergeColor) mp->updateDataMask(MeshModel::MM_VERTCOLOR);
 				mp->updateDataMask(MeshModel::MM_VERTQUALITY);
+				tri::Append<CMeshO,SubVolumePlyMC::MCMesh>::MeshCopy(mp->cm,*results[i]);
 				mp->updateBoxAndNormals();
+				results[i].reset();
+			}
+		}
+		else
+		{
+			// the result is only saved in the current folder
+			int saveMask=tri::io::Mask::IOM_VERTQUALITY;
+			if(p.MergeColor) saveMask|=tri::io::Mask::IOM_VERTCOLOR;
+			for(int i=0;i<nSubVolumes;++i)
+			{
+				if(!results[i])
+					continue;
+				if(tri::io::ExporterPLY<SubVolumePlyMC::MCMesh>::Save(*results[i],names[i].c_str(),saveMask)!=0) {
+					throw MLException("Unable to save " + QString::fromStdString(names[i]) + " in the current folder.");
+				}
 			}
 		}
-		
-		for(int i=0;i<pmc.MP.size();++i)
-			QFile::remove(pmc.MP.MeshName(i).c_str());
 	} break;
 	case FP_MC_SIMPLIFY:
 	{
@@ -254,67 +254,150 @@ public:
 }; // end class RedetailSampler
 
 //--------------------------------------------------------------------
-// simple sampler to calculate
-// it is very similar to the hausdorff sampler, but more immediate to use
-class SimpleDistanceSampler
+// Statistics of a set of (signed) distances.
+// The partial statistics of disjoint sets of samples can be merged,
+// so that each chunk of samples can be processed independently.
+struct DistanceStats
+{
+	int    n_samples = 0;
+	double min_dist  = std::numeric_limits<double>::max();
+	double max_dist  = std::numeric_limits<double>::lowest();
+	double sum_dist  = 0;
+	double sum_sq_dist = 0;   /// sum of the squared distances, used for the RMS
+
+	void add(double d)
+	{
+		if (d > max_dist) max_dist = d;
+		if (d < min_dist) min_dist = d;
+		sum_dist += d;
+		sum_sq_dist += d*d;
+		n_samples++;
+	}
+
+	void merge(const DistanceStats& ds)
+	{
+		if (ds.max_dist > max_dist) max_dist = ds.max_dist;
+		if (ds.min_dist < min_dist) min_dist = ds.min_dist;
+		sum_dist += ds.sum_dist;
+		sum_sq_dist += ds.sum_sq_dist;
+		n_samples += ds.n_samples;
+	}
+};
+
+//--------------------------------------------------------------------
+// Parallel sampling driver.
+// Calls computeSample(i, stats) for each i in [0, n): computeSample must be re-entrant,
+// it computes the distance of the i-th sample and adds it to the given stats.
+// The samples are processed in fixed size chunks whose stats are merged in order,
+// so the result does not depend on the number of threads.
+// The callback is invoked only by the calling thread.
+template <class ComputeSampleFunctor>
+DistanceStats ParallelDistanceSampling(int n, ComputeSampleFunctor computeSample, CallBackPos* cb, const char* msg)
+{
+	const int chunkSize = 1024;
+	const int chunksPerStep = 64;
+
+	DistanceStats stats;
+	std::vector<DistanceStats> chunkStats(chunksPerStep);
+	for (int stepStart = 0; stepStart < n; stepStart += chunkSize * chunksPerStep)
+	{
+		if (cb) cb(int(100.0 * stepStart / n), msg);
+		const int stepChunks = std::min(chunksPerStep, (n - stepStart + chunkSize - 1) / chunkSize);
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int c = 0; c < stepChunks; ++c)
+		{
+			chunkStats[c] = DistanceStats();
+			const int begin = stepStart + c * chunkSize;
+			const int end = std::min(begin + chunkSize, n);
+			for (int i = begin; i < end; ++i)
+				computeSample(i, chunkStats[c]);
+		}
+
+		for (int c = 0; c < stepChunks; ++c)
+			stats.merge(chunkStats[c]);
+	}
+	return stats;
+}
+
+//--------------------------------------------------------------------
+// Closest point queries on a mesh (or on a point cloud, if the mesh has no faces).
+// The grid is read-only once built and the faces are not marked during the search,
+// so Closest() can be called concurrently by several threads.
+class ClosestPointQuery
 {
 	typedef GridStaticPtr<CMeshO::FaceType, CMeshO::ScalarType > MetroMeshFaceGrid;
 	typedef GridStaticPtr<CMeshO::VertexType, CMeshO::ScalarType > MetroMeshVertexGrid;
 
 public:
+	ClosestPointQuery(CMeshO* _m) : m(_m)
+	{
+		useVertexSampling = (m->fn == 0); // if no faces, we can only use points
+		if (useVertexSampling)
+			unifGridVert.Set(m->vert.begin(), m->vert.end());
+		else
+			unifGridFace.Set(m->face.begin(), m->face.end());
+	}
 
-	SimpleDistanceSampler(CMeshO* _m, bool signedDist, double maxd) :markerFunctor(_m)
+	// returns false if there is no point of the mesh closer than maxDist
+	bool Closest(const CMeshO::CoordType& startPt, CMeshO::ScalarType maxDist, CMeshO::ScalarType& dist,
+				 CMeshO::CoordType& closestPt, CMeshO::CoordType& closestNm)
 	{
-		m = _m;
-		useSigned = signedDist;
-		maxDistABS = maxd;
-		init();
+		dist = maxDist;
+		if (useVertexSampling)
+		{
+			CMeshO::VertexType* nearestV = tri::GetClosestVertex<CMeshO, MetroMeshVertexGrid>(*m, unifGridVert, startPt, maxDist, dist);
+			if (nearestV == NULL || dist == maxDist) return false;
+			closestPt = nearestV->cP();
+			closestNm = nearestV->cN();
+		}
+		else
+		{
+			vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
+			tri::EmptyTMark<CMeshO> noMarker;
+			CMeshO::FaceType* nearestF = unifGridFace.GetClosest(PDistFunct, noMarker, startPt, maxDist, dist, closestPt);
+			if (nearestF == NULL || dist == maxDist) return false;
+			closestNm = nearestF->cN();
+		}
+		return true;
 	}
 
 	CMeshO *m;           /// the reference mesh
+	bool useVertexSampling;
 
+private:
 	MetroMeshVertexGrid   unifGridVert;
 	MetroMeshFaceGrid     unifGridFace;
+};
 
-	bool useVertexSampling;
-	CMeshO::ScalarType dist_upper_bound;  // samples that have a distance beyond this threshold distance are not considered.
-	tri::FaceTmark<CMeshO> markerFunctor;
+//--------------------------------------------------------------------
+// simple sampler to calculate
+// it is very similar to the hausdorff sampler, but more immediate to use
+class SimpleDistanceSampler
+{
+public:
+
+	SimpleDistanceSampler(CMeshO* _m, bool signedDist, double maxd) : query(_m)
+	{
+		m = _m;
+		useSigned = signedDist;
+		maxDistABS = maxd;
+	}
+
+	CMeshO *m;           /// the reference mesh
+	ClosestPointQuery query;
 
 	bool useSigned;
 	double maxDistABS;
 
 	// distance data
-	int  n_total_samples;
-	double          min_dist;
-	double          max_dist;
-	double          mean_dist;
-	double          RMS_dist;   /// from the wikipedia definition RMS DIST is sqrt(Sum(distances^2)/n), here we store Sum(distances^2)
-
-	float getMeanDist() const { return mean_dist / n_total_samples; }
-	float getMinDist() const  { return min_dist; }
-	float getMaxDist() const  { return max_dist; }
-	float getRMSDist() const  { return sqrt(RMS_dist / n_total_samples); }
-
-	void init()
-	{
-		if (m->fn == 0) // if no faces, we can only use points
-		{
-			useVertexSampling = true;
-			unifGridVert.Set(m->vert.begin(), m->vert.end());
-		}
-		else 
-		{
-			useVertexSampling = false;
-			unifGridFace.Set(m->face.begin(), m->face.end());
-			markerFunctor.SetMesh(m);
-		}
+	DistanceStats stats;
 
-		min_dist = std::numeric_limits<double>::max();
-		max_dist = std::numeric_limits<double>::min();
-		mean_dist = 0;
-		RMS_dist = 0;
-		n_total_samples = 0;
-	}
+	float getMeanDist() const { return stats.sum_dist / stats.n_samples; }
+	float getMinDist() const  { return stats.min_dist; }
+	float getMaxDist() const  { return stats.max_dist; }
+	float getRMSDist() const  { return sqrt(stats.sum_sq_dist / stats.n_samples); }
+	int   getNumSamples() const { return stats.n_samples; }
 
 	void AddVert(CMeshO::VertexType &p)
 	{
@@ -322,49 +405,149 @@ public:
 	}
 
 	float AddSample(const CMeshO::CoordType &startPt, const CMeshO::CoordType &startN)
+	{
+		float dist;
+		if (ComputeDistance(startPt, dist))
+			stats.add(dist);
+		return dist;
+	}
+
+	// stores in the quality of each vertex of mv its distance from the reference mesh; the vertices are processed in parallel
+	void AddAllVertices(CMeshO& mv, CallBackPos* cb = 0)
+	{
+		stats.merge(ParallelDistanceSampling(int(mv.vert.size()), [&](int i, DistanceStats& ds) {
+			CMeshO::VertexType& v = mv.vert[i];
+			if (v.IsD()) return;
+			float dist;
+			if (ComputeDistance(v.cP(), dist))
+				ds.add(dist);
+			v.Q() = dist;
+		}, cb, "Computing distances"));
+	}
+
+	// re-entrant: returns false (and a distance equal to twice the max distance) if the reference mesh is too far
+	bool ComputeDistance(const CMeshO::CoordType &startPt, float& dist)
 	{
 		// the results
 		CMeshO::CoordType closestPt;
 		CMeshO::CoordType closestNm;
-		CMeshO::ScalarType dist = dist_upper_bound;
+		CMeshO::ScalarType d;
 
 		// compute distance between startPt and the mesh S2
-		CMeshO::FaceType   *nearestF = 0;
-		CMeshO::VertexType *nearestV = 0;
-		vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
-
-		if (useVertexSampling)
+		if (!query.Closest(startPt, maxDistABS, d, closestPt, closestNm))
 		{
-			nearestV = tri::GetClosestVertex<CMeshO, MetroMeshVertexGrid>(*m, unifGridVert, startPt, maxDistABS, dist);
-			if (nearestV == NULL) return (maxDistABS*2.0);
-
-			closestPt = nearestV->P();
-			closestNm = nearestV->N();
-		}
-		else
-		{
-			nearestF = unifGridFace.GetClosest(PDistFunct, markerFunctor, startPt, maxDistABS, dist, closestPt);
-			if (nearestF == NULL) return (maxDistABS*2.0);
-
-			closestNm = nearestF->N();
+			dist = maxDistABS*2.0;
+			return false;
 		}
 
 		// check sign of distance
 		if ((useSigned) && (((startPt - closestPt).Normalize()*(closestNm)) < 0.0))
 		{
-			dist = -dist;
+			d = -d;
 		}
+		dist = d;
+		return true;
+	}
+};
 
-		if (dist > max_dist) max_dist = dist;
-		if (dist < min_dist) min_dist = dist;
+//--------------------------------------------------------------------
+// Hausdorff sampler that computes the distances in parallel.
+// It has the same interface of vcg::tri::HausdorffSampler, but the samples generated by the
+// SurfaceSampling algorithms are only collected: the distances are computed by Compute().
+class ParallelHausdorffSampler
+{
+public:
+	ParallelHausdorffSampler(CMeshO* _m) : query(_m), samplePtMesh(0), closestPtMesh(0)
+	{
+		dist_upper_bound = _m->bbox.Diag();
+		hist.SetRange(0.0, _m->bbox.Diag()/100.0, 100);
+	}
 
-		mean_dist += dist;	       
-		RMS_dist += dist*dist;     
-		n_total_samples++;
+	ClosestPointQuery query;
+	CMeshO *samplePtMesh;   /// if not null, the valid samples are added to this mesh
+	CMeshO *closestPtMesh;  /// if not null, the closest points of the valid samples are added to this mesh
+	CMeshO::ScalarType dist_upper_bound;  // samples that have a distance beyond this threshold distance are not considered.
 
-		return dist;
+	std::vector<CMeshO::CoordType> samplePos;
+	std::vector<CMeshO::CoordType> sampleNrm;
+
+	DistanceStats stats;
+	Histogramf hist;
+	int n_total_samples = 0;
+
+	float getMeanDist() const { return stats.sum_dist / stats.n_samples; }
+	float getMinDist() const  { return stats.min_dist; }
+	float getMaxDist() const  { return stats.max_dist; }
+	float getRMSDist() const  { return sqrt(stats.sum_sq_dist / stats.n_samples); }
+	const Histogramf &GetHist() const { return hist; }
+
+	void init(CMeshO *_sampleMesh=0, CMeshO *_closestMesh=0)
+	{
+		samplePtMesh = _sampleMesh;
+		closestPtMesh = _closestMesh;
+	}
+
+	void AddVert(const CMeshO::VertexType &p)
+	{
+		samplePos.push_back(p.cP());
+		sampleNrm.push_back(p.cN());
+	}
+
+	void AddFace(const CMeshO::FaceType &f, CMeshO::CoordType interp)
+	{
+		samplePos.push_back(f.cP(0)*interp[0] + f.cP(1)*interp[1] + f.cP(2)*interp[2]);
+		sampleNrm.push_back(f.cN());
+	}
+
+	// computes the distances of all the collected samples
+	void Compute(CallBackPos* cb = 0)
+	{
+		const int n = int(samplePos.size());
+		const bool saveSamples = (samplePtMesh != 0 || closestPtMesh != 0);
+		std::vector<CMeshO::CoordType> closest(saveSamples ? n : 0);
+		std::vector<CMeshO::ScalarType> dist(n);
+		std::vector<char> valid(n, 0);
+
+		stats.merge(ParallelDistanceSampling(n, [&](int i, DistanceStats& ds) {
+			CMeshO::CoordType closestPt, closestNm;
+			CMeshO::ScalarType d;
+			if (!query.Closest(samplePos[i], dist_upper_bound, d, closestPt, closestNm))
+				return;
+			ds.add(d);
+			dist[i] = d;
+			valid[i] = 1;
+			if (saveSamples)
+				closest[i] = closestPt;
+		}, cb, "Computing Hausdorff distance"));
+		n_total_samples = stats.n_samples;
+
+		// the histogram is filled in sample order, as the serial sampler does,
+		// so its running sums do not depend on how the chunks were scheduled
+		for (int i = 0; i < n; ++i)
+			if (valid[i])
+				hist.Add(std::fabs(dist[i]));
+
+		if (saveSamples)
+		{
+			for (int i = 0; i < n; ++i)
+			{
+				if (!valid[i]) continue;
+				if (samplePtMesh)
+				{
+					CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertex(*samplePtMesh, samplePos[i], sampleNrm[i]);
+					vi->Q() = dist[i];
+				}
+				if (closestPtMesh)
+				{
+					CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertex(*closestPtMesh, closest[i], sampleNrm[i]);
+					vi->Q() = dist[i];
+				}
+			}
+		}
+		samplePos.clear();
+		sampleNrm.clear();
 	}
-}; 
+};
 
 //--------------------------------------------------------------------
 
@@ -1179,7 +1362,7 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		
 		MeshModel *samplePtMesh =0;
 		MeshModel *closestPtMesh =0;
-		vcg::tri::HausdorffSampler<CMeshO> hs(&(mm1->cm));
+		ParallelHausdorffSampler hs(&(mm1->cm));
 		if(saveSampleFlag)
 		{
 			closestPtMesh=md.addNewMesh("","Hausdorff Closest Points", false); // the new mesh is NOT the current one (byproduct of measurement)
@@ -1196,11 +1379,12 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		qDebug("Max sampling distance %f on a bbox diag of %f",distUpperBound,mm1->cm.bbox.Diag());
 		
 		if(sampleVert)
-			tri::SurfaceSampling<CMeshO,vcg::tri::HausdorffSampler<CMeshO> >::VertexUniform(mm0->cm,hs,par.getInt("SampleNum"));
+			tri::SurfaceSampling<CMeshO,ParallelHausdorffSampler>::VertexUniform(mm0->cm,hs,par.getInt("SampleNum"));
 		if(sampleEdge)
-			tri::SurfaceSampling<CMeshO,vcg::tri::HausdorffSampler<CMeshO> >::EdgeUniform(mm0->cm,hs,par.getInt("SampleNum"),sampleFauxEdge);
+			tri::SurfaceSampling<CMeshO,ParallelHausdorffSampler>::EdgeUniform(mm0->cm,hs,par.getInt("SampleNum"),sampleFauxEdge);
 		if(sampleFace)
-			tri::SurfaceSampling<CMeshO,vcg::tri::HausdorffSampler<CMeshO> >::Montecarlo(mm0->cm,hs,par.getInt("SampleNum"));
+			tri::SurfaceSampling<CMeshO,ParallelHausdorffSampler>::Montecarlo(mm0->cm,hs,par.getInt("SampleNum"));
+		hs.Compute(cb);
 		
 		// the meshes have to return to their original position
 		if (mm0->cm.Tr != Matrix44m::Identity())
@@ -1264,7 +1448,7 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		
 		SimpleDistanceSampler ds(&(mm1->cm), useSigned, maxDistABS);
 		
-		tri::SurfaceSampling<CMeshO, SimpleDistanceSampler>::AllVertex(mm0->cm, ds);
+		ds.AddAllVertices(mm0->cm, cb);
 		
 		// the meshes have to return to their original position
 		if (mm0->cm.Tr != Matrix44m::Identity())
@@ -240,10 +240,16 @@ int Octree< Real >::init( OrientedPointStream< Real >& pointStream , LocalDepth
 	{
 		std::vector< int > nodeToIndexMap;
 		Point3D< Real > p , n;
-		OrientedPoint3D< Real > _p;
-		Data _d;
-		while( ( sampleData ? pointStreamWithData.nextPoint( _p , _d ) : pointStream.nextPoint( _p ) ) )
+		// Points are pulled from the stream in blocks, so that streams backed by
+		// contiguous arrays can fill them without a virtual call per point
+		const int BlockSize = 4096;
+		std::vector< OrientedPoint3D< Real > > _points( BlockSize );
+		std::vector< Data > _data( sampleData ? BlockSize : 0 );
+		int blockCount;
+		while( ( blockCount = ( sampleData ? pointStreamWithData.nextPoints( &_points[0] , &_data[0] , BlockSize ) : pointStream.nextPoints( &_points[0] , BlockSize ) ) )>0 )
+		for( int b=0 ; b<blockCount ; b++ )
 		{
+			const OrientedPoint3D< Real >& _p = _points[b];
 			p = Point3D< Real >(_p.p) , n = Point3D< Real >(_p.n);
 			Real len = (Real)Length( n );
 			if( !_InBounds(p) ){ outOfBoundPoints++ ; continue; }
@@ -280,7 +286,7 @@ int Octree< Real >::init( OrientedPointStream< Real >& pointStream , LocalDepth
 				if( sampleData ) sampleData->resize( idx+1 );
 			}
 			samples[idx].sample += ProjectiveData< OrientedPoint3D< Real > , Real >( OrientedPoint3D< Real >( p * weight , n * weight ) , weight );
-			if( sampleData ) (*sampleData)[ idx ] += ProjectiveData< Data , Real >( _d * weight , weight );
+			if( sampleData ) (*sampleData)[ idx ] += ProjectiveData< Data , Real >( _data[b] * weight , weight );
 			pointCount++;
 		}
 		pointStream.reset();
@@ -26,10 +26,6 @@
 #include <Psapi.h>
 #endif
 
-#include <QDir>
-#include <QTemporaryDir>
-#include <QTemporaryFile>
-
 #include <thread>
 
 #include "filter_screened_poisson.h"
@@ -118,27 +114,8 @@ std::map<std::string, QVariant> FilterScreenedPoissonPlugin::applyFilter(
 		unsigned int& /*postConditionMask*/,
 		vcg::CallBackPos* cb)
 {
-	bool currDirChanged=false;
-	QDir currDir = QDir::current();
-
+	std::map<std::string, QVariant> outputValues;
 	if (ID(filter) == FP_SCREENED_POISSON) {
-		//Using tmp dir
-		QTemporaryDir tmpdir;
-		QTemporaryFile file(tmpdir.path());
-		if (!file.open()) { //if a file cannot be created in the tmp folder
-			log("Warning - tmp folder is not writable.");
-
-			QTemporaryFile file2("./_tmp_XXXXXX.tmp"); //try to create a file in the meshlab folder
-			if (!file2.open()){ //if a file cannot be created in the tmp and in the meshlab folder, we cannot run the filter
-				log("Warning - current folder is not writable. Screened Poisson Merging needs to save intermediate files in the tmp working folder. Project and meshes must be in a write-enabled folder. Please save your data in a suitable folder before applying.");
-				throw MLException("current and tmp folder are not writable.<br> Screened Poisson Merging needs to save intermediate files in the current working folder.<br> Project and meshes must be in a write-enabled folder.<br> Please save your data in a suitable folder before applying.");
-			}
-		}
-		else { //if the tmp folder is writable, we will use it
-			currDirChanged=true;
-			QDir::setCurrent(tmpdir.path());
-		}
-
 		PoissonParam<Scalarm> pp;
 		pp.MaxDepthVal = params.getInt("depth");
 		pp.FullDepthVal = params.getInt("fullDepth");
@@ -184,31 +161,41 @@ std::map<std::string, QVariant> FilterScreenedPoissonPlugin::applyFilter(
 		if(goodColor)
 			pm->updateDataMask(MeshModel::MM_VERTCOLOR);
 
+		std::vector<CMeshO*> meshes;
+		Box3m bb;
 		if(params.getBool("visibleLayer")) {
-			Box3m bb;
 			MeshModel *_mm=md.nextVisibleMesh();
 			while(_mm != nullptr){
+				meshes.push_back(&_mm->cm);
 				bb.Add(_mm->cm.Tr,_mm->cm.bbox);
 				_mm=md.nextVisibleMesh(_mm);
 			}
-
-			MeshDocumentPointStream<Scalarm> documentStream(md);
-			_Execute<Scalarm,2,BOUNDARY_NEUMANN,PlyColorAndValueVertex<Scalarm> >(&documentStream,bb,pm->cm,pp,cb);
 		}
 		else {
-			MeshModelPointStream<Scalarm> meshStream(md.mm()->cm);
-			_Execute<Scalarm,2,BOUNDARY_NEUMANN,PlyColorAndValueVertex<Scalarm> >(&meshStream,md.mm()->cm.bbox,pm->cm,pp,cb);
+			meshes.push_back(&md.mm()->cm);
+			bb = md.mm()->cm.bbox;
 		}
+
+		PoissonStats stats;
+		{
+			MeshArrayPointStream<Scalarm> pointStream(meshes, goodColor);
+			_Execute<Scalarm,2,BOUNDARY_NEUMANN,PlyColorAndValueVertex<Scalarm> >(pointStream,bb,pm->cm,pp,cb,&stats);
+		}
+		for (const auto& phase : stats.phaseTimes)
+			log("%s: %.2f sec", phase.first.c_str(), phase.second);
+		log("Reconstruction done in %.2f sec, octree peak memory %.1f MB, process peak memory %.1f MB",
+			stats.totalTime, stats.treeMemoryMB, stats.peakMemoryMB);
+		outputValues["reconstruction_time"] = stats.totalTime;
+		outputValues["peak_memory_mb"] = stats.peakMemoryMB;
+
 		pm->updateBoxAndNormals();
 		md.setVisible(pm->id(),true);
 		md.setCurrentMesh(pm->id());
-		if(currDirChanged)
-			QDir::setCurrent(currDir.path());
 	}
 	else {
 		wrongActionCalled(filter);
 	}
-	return std::map<std::string, QVariant>();
+	return outputValues;
 }
 
 RichParameterList FilterScreenedPoissonPlugin::initParameterList(
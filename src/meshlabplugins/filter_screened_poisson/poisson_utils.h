@@ -26,8 +26,13 @@
 #ifdef WIN32
 #include <windows.h>
 #include <Psapi.h>
+#else
+#include <sys/resource.h>
 #endif
 #include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
 #include "Src/MyTime.h"
 #include "Src/MarchingCubes.h"
 #include "Src/Octree.h"
@@ -79,16 +84,51 @@ inline double to_seconds( const FILETIME& ft )
 	const double high_to_sec=low_to_sec*4294967296.0;
 	return ft.dwLowDateTime*low_to_sec+ft.dwHighDateTime*high_to_sec;
 }
+#else // !_WIN32 && !_WIN64
+inline double PeakMemoryUsageMB( void )
+{
+	struct rusage usage;
+	if( getrusage( RUSAGE_SELF , &usage ) ) return 0;
+#ifdef __APPLE__
+	return ( (double)usage.ru_maxrss )/(1<<20); // bytes
+#else
+	return ( (double)usage.ru_maxrss )/(1<<10); // kilobytes
+#endif
+}
 #endif // _WIN32 || _WIN64
 
+/**
+ * Timing and memory figures of a run of _Execute: the time spent in each
+ * phase of the reconstruction, the peak memory used by the octree and the
+ * peak resident memory of the whole process (all in MB).
+ */
+struct PoissonStats
+{
+	std::vector< std::pair< std::string , double > > phaseTimes;
+	double totalTime = 0;
+	double treeMemoryMB = 0;
+	double peakMemoryMB = 0;
+};
+
 template< class Real >
 struct OctreeProfiler
 {
 	Octree< Real >& tree;
 	double t;
+	PoissonStats* stats;
 
-	OctreeProfiler( Octree< Real >& t ) : tree(t) { ; }
+	OctreeProfiler( Octree< Real >& t , PoissonStats* s=NULL ) : tree(t) , stats(s) { ; }
 	void start( void ){ t = Time() , tree.resetLocalMemoryUsage(); }
+	// stores the time elapsed since start() in the stats, using the header
+	// (stripped of the padding) as name of the phase
+	void record( const char* header ) const
+	{
+		if( !stats || !header ) return;
+		std::string phase( header );
+		size_t b = phase.find_first_not_of( "# " ) , e = phase.find_last_not_of( ": \n" );
+		if( b==std::string::npos ) return;
+		stats->phaseTimes.push_back( std::make_pair( phase.substr( b , e-b+1 ) , Time()-t ) );
+	}
 	void print( const char* header ) const
 	{
 		tree.memoryUsage();
@@ -103,6 +143,7 @@ struct OctreeProfiler
 	void dumpOutput( const char* header ) const
 	{
 		tree.memoryUsage();
+		record( header );
 #if defined( _WIN32 ) || defined( _WIN64 )
 		if( header ) DumpOutput( "%s %9.1f (s), %9.1f (MB) / %9.1f (MB) / %9.1f (MB)\n" , header , Time()-t , tree.localMemoryUsage() , tree.maxMemoryUsage() , PeakMemoryUsageMB() );
 		else         DumpOutput(    "%9.1f (s), %9.1f (MB) / %9.1f (MB) / %9.1f (MB)\n" ,          Time()-t , tree.localMemoryUsage() , tree.maxMemoryUsage() , PeakMemoryUsageMB() );
@@ -114,6 +155,7 @@ struct OctreeProfiler
 	void dumpOutput2( std::vector< char* >& comments , const char* header ) const
 	{
 		tree.memoryUsage();
+		record( header );
 #if defined( _WIN32 ) || defined( _WIN64 )
 		if( header ) DumpOutput2( comments , "%s %9.1f (s), %9.1f (MB) / %9.1f (MB) / %9.1f (MB)\n" , header , Time()-t , tree.localMemoryUsage() , tree.maxMemoryUsage() , PeakMemoryUsageMB() );
 		else         DumpOutput2( comments ,    "%9.1f (s), %9.1f (MB) / %9.1f (MB) / %9.1f (MB)\n" ,          Time()-t , tree.localMemoryUsage() , tree.maxMemoryUsage() , PeakMemoryUsageMB() );
@@ -183,106 +225,240 @@ public:
 	}
 };
 
+/**
+ * Oriented point stream that reads the points straight from the vertex
+ * vectors of one or more (compact) meshes, applying the transformation matrix
+ * of their mesh and the one given to transform while the octree pulls them
+ * in blocks through nextPoints. Nothing is copied: the colors are read from
+ * the vertices too, and only if useColor is set.
+ */
 template< class Real >
-class MeshModelPointStream : public OrientedPointStreamWithData< Real, Point3m >
+class MeshArrayPointStream : public OrientedPointStreamWithData< Real , Point3D< Real > >
 {
-	CMeshO &_m;
-	size_t _curPos;
+	std::vector< const CMeshO* > _meshes;
+	std::vector< XForm4x4< Real > > _xForms;       // per mesh, for the points
+	std::vector< XForm3x3< Real > > _normalXForms; // per mesh, for the normals
+	bool _useColor;
+	size_t _size;
+	size_t _curMesh , _curVert;
+
+	// skips the meshes already read; returns false at the end of the stream
+	bool _advance( void )
+	{
+		while( _curMesh<_meshes.size() && _curVert>=(size_t)_meshes[_curMesh]->vn ) _curMesh++ , _curVert = 0;
+		return _curMesh<_meshes.size();
+	}
+	void _get( OrientedPoint3D< Real >& pt ) const
+	{
+		const CVertexO& v = _meshes[_curMesh]->vert[_curVert];
+		pt.p = _xForms      [_curMesh] * Point3D< Real >( v.cP()[0] , v.cP()[1] , v.cP()[2] );
+		pt.n = _normalXForms[_curMesh] * Point3D< Real >( v.cN()[0] , v.cN()[1] , v.cN()[2] );
+	}
+	void _get( Point3D< Real >& d ) const
+	{
+		if( !_useColor ) { d = Point3D< Real >(); return; }
+		const vcg::Color4b& c = _meshes[_curMesh]->vert[_curVert].cC();
+		d = Point3D< Real >( Real( c[0] ) , Real( c[1] ) , Real( c[2] ) );
+	}
 public:
-	MeshModelPointStream(  CMeshO &m):_m(m),_curPos(0)
+	MeshArrayPointStream( const std::vector< CMeshO* >& meshes , bool useColor ) : _useColor(useColor) , _size(0) , _curMesh(0) , _curVert(0)
 	{
-		vcg::tri::RequireCompactness(m);
+		for( size_t i=0 ; i<meshes.size() ; i++ ) {
+			vcg::tri::RequireCompactness( *meshes[i] );
+			_meshes.push_back( meshes[i] );
+			_size += meshes[i]->vn;
+		}
+		transform( XForm4x4< Real >::Identity() );
+		qDebug("TotalSize %lu",size());
 	}
 
-	~MeshModelPointStream( void ){}
+	~MeshArrayPointStream( void ){}
 
-	void reset( void ) { _curPos =0;}
+	size_t size( void ) const { return _size; }
+	bool useColor( void ) const { return _useColor; }
 
-	bool nextPoint( OrientedPoint3D< Real >& pt, Point3m &d)
+	/// Sets the transformation applied to the points and the normals, after the one of their mesh.
+	void transform( const XForm4x4< Real >& xForm )
 	{
-		if(_curPos>=(unsigned int)_m.vn)
-			return false;
-		Point3m &nn = _m.vert[_curPos].N();
-		Point3m tp = _m.Tr * _m.vert[_curPos].P();
-		Point4m np = _m.Tr *  Point4m(nn[0],nn[1],nn[2],0);
-
-		pt.p[0] = tp[0];
-		pt.p[1] = tp[1];
-		pt.p[2] = tp[2];
-		pt.n[0] = np[0];
-		pt.n[1] = np[1];
-		pt.n[2] = np[2];
-
-		d[0]=Real(_m.vert[_curPos].C()[0]);
-		d[1]=Real(_m.vert[_curPos].C()[1]);
-		d[2]=Real(_m.vert[_curPos].C()[2]);
-
-		++_curPos;
+		XForm3x3< Real > normalXForm;
+		for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) normalXForm(i,j) = xForm(i,j);
+		normalXForm = normalXForm.transpose().inverse();
+		_xForms.resize( _meshes.size() );
+		_normalXForms.resize( _meshes.size() );
+		for( size_t m=0 ; m<_meshes.size() ; m++ ) {
+			// the xForms are stored by column; the normals are only rotated by
+			// the matrix of the mesh, as vcg::tri::UpdatePosition::Matrix does
+			const Matrix44m& tr = _meshes[m]->Tr;
+			XForm4x4< Real > meshXForm;
+			XForm3x3< Real > meshNormalXForm;
+			for( int i=0 ; i<4 ; i++ ) for( int j=0 ; j<4 ; j++ ) meshXForm(j,i) = Real( tr.ElementAt(i,j) );
+			for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) meshNormalXForm(j,i) = Real( tr.ElementAt(i,j) );
+			_xForms[m] = xForm * meshXForm;
+			_normalXForms[m] = normalXForm * meshNormalXForm;
+		}
+	}
+
+	void reset( void ) { _curMesh = 0 , _curVert = 0; }
+
+	bool nextPoint( OrientedPoint3D< Real >& pt )
+	{
+		if( !_advance() ) return false;
+		_get( pt );
+		++_curVert;
+		return true;
+	}
+
+	bool nextPoint( OrientedPoint3D< Real >& pt , Point3D< Real >& d )
+	{
+		if( !_advance() ) return false;
+		_get( pt ) , _get( d );
+		++_curVert;
 		return true;
 	}
+
+	int nextPoints( OrientedPoint3D< Real >* pts , int count )
+	{
+		int c = 0;
+		for( ; c<count && _advance() ; c++ , _curVert++ ) _get( pts[c] );
+		return c;
+	}
+
+	int nextPoints( OrientedPoint3D< Real >* pts , Point3D< Real >* d , int count )
+	{
+		int c = 0;
+		for( ; c<count && _advance() ; c++ , _curVert++ ) _get( pts[c] ) , _get( d[c] );
+		return c;
+	}
 };
 
-template< class Real >
-class MeshDocumentPointStream : public OrientedPointStreamWithData< Real, Point3m >
+/**
+ * CoredMeshData that keeps the extracted isosurface in memory and writes it
+ * into a CMeshO, instead of spilling it to temporary files like
+ * CoredFileMeshData does.
+ * Vertices are appended in the order the octree numbers them (the octree
+ * already serializes those calls), while polygons are collected in
+ * per-thread buffers, so that the marching cubes threads never contend on a
+ * lock. flush() then moves everything into the mesh with a single allocation
+ * of vertices and faces.
+ */
+template< class Vertex >
+class CMeshOCoredMeshData : public CoredMeshData< Vertex >
 {
-	MeshDocument &_md;
-	MeshModel *_curMesh;
-	size_t _curPos;
-	size_t _totalSize;
+	CMeshO& _m;
+	std::vector< Vertex > _points;
+	std::vector< std::vector< int > > _triangles; // per thread, 3 indices per triangle
+	size_t _pointIndex , _bufferIndex , _triangleIndex;
 public:
-	MeshDocumentPointStream(  MeshDocument &md):_md(md),_curMesh(0),_curPos(0)
+	CMeshOCoredMeshData( CMeshO& m , int threads ) :
+		_m(m) , _triangles( std::max( threads , 1 ) ) , _pointIndex(0) , _bufferIndex(0) , _triangleIndex(0)
 	{
-		_totalSize=0;
-		MeshModel *m=0;
-		do {
-			m=_md.nextVisibleMesh(m);
-			if(m!=0) {
-				vcg::tri::RequireCompactness(m->cm);
-				_totalSize+=m->cm.vn;
-			}
-		} while(m);
-		qDebug("TotalSize %lu",_totalSize);
 	}
 
-	~MeshDocumentPointStream( void ){}
+	void resetIterator( void ) { _pointIndex = _bufferIndex = _triangleIndex = 0; }
 
-	void reset( void ) { _curPos =0; _curMesh=0;}
+	int addOutOfCorePoint( const Vertex& p )
+	{
+		_points.push_back( p );
+		return int( _points.size() )-1;
+	}
+	int addOutOfCorePoint_s( const Vertex& p )
+	{
+		int idx;
+#pragma omp critical (CMeshOCoredMeshData_addOutOfCorePoint_s)
+		idx = addOutOfCorePoint( p );
+		return idx;
+	}
 
-	bool nextPoint( OrientedPoint3D< Real >& pt, Point3m &d )
+	/// Indices count the in-core points first, then the out-of-core ones.
+	int addPolygon_s( const std::vector< int >& polygon )
 	{
-		Point3m nn(0,0,0);
-		//    do
-		{
-			if((_curMesh==0) || (_curPos >= (std::size_t)_curMesh->cm.vn) ) {
-				_curMesh = _md.nextVisibleMesh(_curMesh);
-				_curPos = 0;
-			}
+		assert( omp_get_thread_num()<(int)_triangles.size() );
+		std::vector< int >& triangles = _triangles[ omp_get_thread_num() ];
+		for( size_t i=2 ; i<polygon.size() ; i++ ) {
+			triangles.push_back( polygon[0] );
+			triangles.push_back( polygon[i-1] );
+			triangles.push_back( polygon[i] );
+		}
+		return (int)polygon.size();
+	}
+	int addPolygon_s( const std::vector< CoredVertexIndex >& vertices )
+	{
+		std::vector< int > polygon( vertices.size() );
+		for( size_t i=0 ; i<vertices.size() ; i++ )
+			polygon[i] = vertices[i].inCore ? vertices[i].idx : vertices[i].idx + int( this->inCorePoints.size() );
+		return addPolygon_s( polygon );
+	}
 
-			if(_curMesh==0)
-				return false;
-			if(_curPos < (std::size_t)_curMesh->cm.vn) {
-				nn = _curMesh->cm.vert[_curPos].N();
-				Point3m tp = _curMesh->cm.Tr * _curMesh->cm.vert[_curPos].P();
-				Point4m np = _curMesh->cm.Tr *  Point4m(nn[0],nn[1],nn[2],0);
-				//        Point3m tp = _curMesh->cm.vert[_curPos].P();
-				//        Point3m np = nn;
-				pt.p[0] = tp[0];
-				pt.p[1] = tp[1];
-				pt.p[2] = tp[2];
-				pt.n[0] = np[0];
-				pt.n[1] = np[1];
-				pt.n[2] = np[2];
-				d[0]=Real(_curMesh->cm.vert[_curPos].C()[0]);
-				d[1]=Real(_curMesh->cm.vert[_curPos].C()[1]);
-				d[2]=Real(_curMesh->cm.vert[_curPos].C()[2]);
-
-				++_curPos;
-			}
+	int nextOutOfCorePoint( Vertex& p )
+	{
+		if( _pointIndex>=_points.size() ) return 0;
+		p = _points[ _pointIndex++ ];
+		return 1;
+	}
+	int nextPolygon( std::vector< CoredVertexIndex >& vertices )
+	{
+		while( _bufferIndex<_triangles.size() && _triangleIndex>=_triangles[_bufferIndex].size() )
+			_bufferIndex++ , _triangleIndex = 0;
+		if( _bufferIndex>=_triangles.size() ) return 0;
+		vertices.resize( 3 );
+		for( int i=0 ; i<3 ; i++ ) {
+			int idx = _triangles[_bufferIndex][ _triangleIndex++ ];
+			vertices[i].inCore = idx<int( this->inCorePoints.size() );
+			vertices[i].idx = vertices[i].inCore ? idx : idx - int( this->inCorePoints.size() );
 		}
-		assert(nn!=Point3m(0,0,0));
-		return true;
+		return 1;
+	}
+
+	int outOfCorePointCount( void ) { return int( _points.size() ); }
+	int polygonCount( void )
+	{
+		size_t count = 0;
+		for( const std::vector< int >& t : _triangles ) count += t.size()/3;
+		return int( count );
 	}
 
+	/// Adds the collected vertices, transformed by iXForm, and faces to the
+	/// mesh, then releases the buffers.
+	template< class Real >
+	void flush( const XForm4x4< Real >& iXForm , int threads )
+	{
+		const int inCoreCount = int( this->inCorePoints.size() );
+		const int vertexCount = inCoreCount + int( _points.size() );
+		std::vector< size_t > faceOffsets( _triangles.size()+1 , 0 );
+		for( size_t t=0 ; t<_triangles.size() ; t++ )
+			faceOffsets[t+1] = faceOffsets[t] + _triangles[t].size()/3;
+
+		const size_t v0 = _m.vert.size() , f0 = _m.face.size();
+		vcg::tri::Allocator< CMeshO >::AddVertices( _m , vertexCount );
+		vcg::tri::Allocator< CMeshO >::AddFaces( _m , faceOffsets.back() );
+
+#pragma omp parallel for num_threads( threads )
+		for( int i=0 ; i<vertexCount ; i++ ) {
+			const Vertex& pt = i<inCoreCount ? this->inCorePoints[i] : _points[i-inCoreCount];
+			Point3D< Real > pp = iXForm*pt.point;
+			CVertexO& v = _m.vert[v0+i];
+			v.P() = Point3m( pp[0] , pp[1] , pp[2] );
+			v.Q() = pt.value;
+			v.C()[0] = pt.color[0];
+			v.C()[1] = pt.color[1];
+			v.C()[2] = pt.color[2];
+		}
+		for( size_t t=0 ; t<_triangles.size() ; t++ ) {
+			const std::vector< int >& triangles = _triangles[t];
+			const size_t fBegin = f0 + faceOffsets[t];
+#pragma omp parallel for num_threads( threads )
+			for( int j=0 ; j<int( triangles.size()/3 ) ; j++ ) {
+				CFaceO& f = _m.face[fBegin+j];
+				for( int k=0 ; k<3 ; k++ )
+					f.V(k) = &_m.vert[ v0 + triangles[3*j+k] ];
+			}
+		}
+
+		std::vector< Vertex >().swap( _points );
+		std::vector< std::vector< int > >( _triangles.size() ).swap( _triangles );
+		this->inCorePoints.clear();
+		resetIterator();
+	}
 };
 
 template< class Real>
@@ -303,15 +479,14 @@ XForm4x4<Real> GetPointStreamScale(vcg::Box3<Real> &bb, float expFact)
 
 template< class Real , int Degree , BoundaryType BType , class Vertex >
 int _Execute(
-		OrientedPointStream< Real > *pointStream,
+		MeshArrayPointStream< Real > &pointStream,
 		Box3m bb, CMeshO &pm,
 		PoissonParam<Real> &pp,
-		vcg::CallBackPos* cb)
+		vcg::CallBackPos* cb,
+		PoissonStats* stats = NULL)
 {
 	typedef typename Octree< Real >::template DensityEstimator< WEIGHT_DEGREE > DensityEstimator;
 	typedef typename Octree< Real >::template InterpolationInfo< false > InterpolationInfo;
-	typedef OrientedPointStreamWithData< Real , Point3D< Real > > PointStreamWithData;
-	typedef TransformedOrientedPointStreamWithData< Real , Point3D< Real > > XPointStreamWithData;
 	Reset< Real >();
 	std::vector< char* > comments;
 
@@ -322,7 +497,7 @@ int _Execute(
 
 	OctNode< TreeNodeData >::SetAllocator(MEMORY_ALLOCATOR_BLOCK_SIZE);
 	Octree< Real > tree;
-	OctreeProfiler< Real > profiler( tree );
+	OctreeProfiler< Real > profiler( tree , stats );
 	tree.threads = pp.ThreadsVal;
 	if( pp.MaxSolveDepthVal<0 ) pp.MaxSolveDepthVal = pp.MaxDepthVal;
 
@@ -363,9 +538,11 @@ int _Execute(
 		//			else                                    pointStream = new  ASCIIOrientedPointStream< Real >( In.value );
 		//		}
 		//		delete[] ext;
-		sampleData = new std::vector< ProjectiveData< Point3D< Real > , Real > >();
-		XPointStreamWithData _pointStream( xForm , ( PointStreamWithData& )*pointStream );
-		pointCount = tree.template init< Point3D< Real > >( _pointStream , pp.MaxDepthVal , pp.ConfidenceFlag , *samples , sampleData );
+		if( pointStream.useColor() ) sampleData = new std::vector< ProjectiveData< Point3D< Real > , Real > >();
+		// the transformation in the unit cube is composed with the one of each
+		// mesh, and applied while the tree reads the points
+		pointStream.transform( xForm );
+		pointCount = tree.template init< Point3D< Real > >( pointStream , pp.MaxDepthVal , pp.ConfidenceFlag , *samples , sampleData );
 
 		#pragma omp parallel for num_threads( pp.ThreadsVal )
 		for( int i=0 ; i<(int)samples->size() ; i++ )
@@ -451,7 +628,7 @@ int _Execute(
 		}
 	}
 
-	CoredFileMeshData< Vertex > mesh;
+	CMeshOCoredMeshData< Vertex > mesh( pm , pp.ThreadsVal );
 
 	{
 		profiler.start();
@@ -488,39 +665,9 @@ int _Execute(
 	//        FreePointer( solution );
 
 	cb(90,"Creating Mesh");
-	mesh.resetIterator();
-	//int vm = mesh.outOfCorePointCount()+mesh.inCorePoints.size();
-	for(auto pt=mesh.inCorePoints.begin();pt!=mesh.inCorePoints.end();++pt) {
-		Point3D<Real> pp = iXForm*pt->point;
-		vcg::tri::Allocator<CMeshO>::AddVertex(pm,Point3m(pp[0],pp[1],pp[2]));
-		pm.vert.back().Q() = pt->value;
-		pm.vert.back().C()[0] = pt->color[0];
-		pm.vert.back().C()[1] = pt->color[1];
-		pm.vert.back().C()[2] = pt->color[2];
-	}
-	for (int ii=0; ii < mesh.outOfCorePointCount(); ii++) {
-		Vertex pt;
-		mesh.nextOutOfCorePoint(pt);
-		Point3D<Real> pp = iXForm*pt.point;
-		vcg::tri::Allocator<CMeshO>::AddVertex(pm,Point3m(pp[0],pp[1],pp[2]));
-		pm.vert.back().Q() = pt.value;
-		pm.vert.back().C()[0] = pt.color[0];
-		pm.vert.back().C()[1] = pt.color[1];
-		pm.vert.back().C()[2] = pt.color[2];
-	}
-
-	std::vector< CoredVertexIndex > polygon;
-	while(mesh.nextPolygon( polygon )) {
-		assert(polygon.size()==3);
-		int indV[3];
-		for( int i=0 ; i<int(polygon.size()) ; i++ ) {
-			if( polygon[i].inCore )
-				indV[i] = polygon[i].idx;
-			else
-				indV[i]= polygon[i].idx + int( mesh.inCorePoints.size() );
-		}
-		vcg::tri::Allocator<CMeshO>::AddFace(pm, &pm.vert[indV[0]], &pm.vert[indV[1]], &pm.vert[indV[2]]);
-	}
+	profiler.start();
+	mesh.flush( iXForm , pp.ThreadsVal );
+	profiler.dumpOutput2( comments , "#        Created mesh:" );
 	cb(100,"Done");
 
 	//if( colorData ) delete colorData , colorData = NULL;
@@ -528,6 +675,11 @@ int _Execute(
 
 	if( density ) delete density , density = NULL;
 	DumpOutput2( comments , "#          Total Solve: %9.1f (s), %9.1f (MB)\n" , Time()-startTime , tree.maxMemoryUsage() );
+	if( stats ) {
+		stats->totalTime = Time()-startTime;
+		stats->treeMemoryMB = tree.maxMemoryUsage();
+		stats->peakMemoryMB = PeakMemoryUsageMB();
+	}
 
 	return 1;
 }
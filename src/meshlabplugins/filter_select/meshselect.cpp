@@ -29,6 +29,8 @@
 #include <vcg/complex/algorithms/stat.h>
 #include <vcg/space/colorspace.h>
 
+#include <common/utilities/self_intersections.h>
+
 #include <QCoreApplication>
 
 using namespace vcg;
@@ -546,11 +548,12 @@ std::map<std::string, QVariant> SelectionFilterPlugin::applyFilter(
 	const RichParameterList& par,
 	MeshDocument&            md,
 	unsigned int& /*postConditionMask*/,
-	vcg::CallBackPos* /*cb*/)
+	vcg::CallBackPos* cb)
 {
-	MeshModel&             m = *(md.mm());
-	CMeshO::FaceIterator   fi;
-	CMeshO::VertexIterator vi;
+	std::map<std::string, QVariant> outputValues;
+	MeshModel&                      m = *(md.mm());
+	CMeshO::FaceIterator            fi;
+	CMeshO::VertexIterator          vi;
 
 	switch (ID(action)) {
 	case FP_SELECT_DELETE_VERT: {
@@ -847,12 +850,10 @@ std::map<std::string, QVariant> SelectionFilterPlugin::applyFilter(
 		break;
 
 	case CP_SELFINTERSECT_SELECT: {
-		std::vector<CFaceO*> IntersFace;
-		tri::Clean<CMeshO>::SelfIntersections(m.cm, IntersFace);
-		tri::UpdateSelection<CMeshO>::FaceClear(m.cm);
-		std::vector<CFaceO*>::iterator fpi;
-		for (fpi = IntersFace.begin(); fpi != IntersFace.end(); ++fpi)
-			(*fpi)->SetS();
+		meshlab::SelfIntersectionFinder finder(m.cm);
+		unsigned int selected = finder.selectIntersectingFaces(cb);
+		log("Selected %d self intersecting faces", selected);
+		outputValues["selected_faces"] = selected;
 	} break;
 
 	case FP_SELECT_FACES_BY_EDGE: {
@@ -873,7 +874,7 @@ std::map<std::string, QVariant> SelectionFilterPlugin::applyFilter(
 
 	default: wrongActionCalled(action);
 	}
-	return std::map<std::string, QVariant>();
+	return outputValues;
 }
 
 FilterPlugin::FilterClass SelectionFilterPlugin::getClass(const QAction* action) const
@@ -922,7 +923,6 @@ int SelectionFilterPlugin::getRequirements(const QAction* action)
 	case FP_SELECT_CONNECTED: return MeshModel::MM_FACEFACETOPO;
 
 	case CP_SELECT_TEXBORDER: return MeshModel::MM_FACEFACETOPO;
-	case CP_SELFINTERSECT_SELECT: return MeshModel::MM_FACEMARK | MeshModel::MM_FACEFACETOPO;
 
 	case FP_SELECT_UGLY: return MeshModel::MM_VERTFACETOPO;
 
@@ -22,6 +22,7 @@
 ****************************************************************************/
 
 #include "baseio.h"
+#include "load_obj.h"
 #include "load_project.h"
 #include "save_project.h"
 
@@ -29,7 +30,6 @@
 
 #include <wrap/io_trimesh/import_ply.h>
 #include <wrap/io_trimesh/import_stl.h>
-#include <wrap/io_trimesh/import_obj.h>
 #include <wrap/io_trimesh/import_off.h>
 #include <wrap/io_trimesh/import_ptx.h>
 #include <wrap/io_trimesh/import_fbx.h>
@@ -246,29 +246,11 @@ void BaseMeshIOPlugin::open(const QString &formatName, const QString &fileName,
 	}
 	else if ((formatName.toUpper() == tr("OBJ")) || (formatName.toUpper() == tr("QOBJ")))
 	{
-		tri::io::ImporterOBJ<CMeshO>::Info oi;
-		oi.cb = cb;
-		if (!tri::io::ImporterOBJ<CMeshO>::LoadMask(filename.c_str(), oi)){
-			throw MLException("Error while loading OBJ mask.");
-		}
-		m.enable(oi.mask);
-
-		int result = tri::io::ImporterOBJ<CMeshO>::Open(m.cm, filename.c_str(), oi);
-		if (result != tri::io::ImporterOBJ<CMeshO>::E_NOERROR)
-		{
-			if (result & tri::io::ImporterOBJ<CMeshO>::E_NON_CRITICAL_ERROR) {
-				reportWarning(errorMsgFormat.arg(fileName, tri::io::ImporterOBJ<CMeshO>::ErrorMsg(result)));
-			}
-			else {
-				throw MLException(errorMsgFormat.arg(fileName, tri::io::ImporterOBJ<CMeshO>::ErrorMsg(result)));
-			}
-		}
-
-//		if (oi.mask & tri::io::Mask::IOM_WEDGNORMAL)
-//			normalsUpdated = true;
-		m.enable(oi.mask);
+		// single pass import: no LoadMask pre-scan of the whole file
+		QString warnings = loadOBJ(fileName, m, mask, cb);
+		if (!warnings.isEmpty())
+			reportWarning(errorMsgFormat.arg(fileName, warnings));
 		if (m.hasDataMask(MeshModel::MM_POLYGONAL)) qDebug("Mesh is Polygonal!");
-		mask = oi.mask;
 	}
 	else if (formatName.toUpper() == tr("PTX"))
 	{
@@ -0,0 +1,646 @@
+#include "load_obj.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <common/mlexception.h>
+
+namespace {
+
+/**
+ * Powers of ten that are exactly representable as double.
+ */
+const double exactPowersOfTen[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline void skipSpaces(const char*& p, const char* end)
+{
+	while (p < end && isSpace(*p))
+		++p;
+}
+
+inline const char* tokenEnd(const char* p, const char* end)
+{
+	while (p < end && !isSpace(*p))
+		++p;
+	return p;
+}
+
+/**
+ * Parses a real number, and moves p after it.
+ * Numbers with at most 15 significant digits and an exponent in [-22, 22]
+ * (that is, almost every number written in an OBJ file) are converted
+ * exactly with just a multiplication or a division; all the others are
+ * given to QByteArray::toDouble, which is locale independent.
+ */
+bool parseReal(const char*& p, const char* end, double& value)
+{
+	const char* begin    = p;
+	bool        negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int      digits   = 0;
+	int      exponent = 0;
+	bool     anyDigit = false;
+	bool     fastPath = true;
+	for (; p < end && isDigit(*p); ++p) {
+		anyDigit = true;
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0)
+				++digits;
+		}
+		else {
+			++exponent;
+			fastPath = false;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (++p; p < end && isDigit(*p); ++p) {
+			anyDigit = true;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0)
+					++digits;
+				--exponent;
+			}
+			else {
+				fastPath = false;
+			}
+		}
+	}
+	if (anyDigit && p < end && (*p == 'e' || *p == 'E')) {
+		const char* e           = p + 1;
+		bool        negativeExp = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negativeExp = (*e == '-');
+			++e;
+		}
+		if (e < end && isDigit(*e)) {
+			int exp = 0;
+			for (; e < end && isDigit(*e); ++e) {
+				if (exp < 10000)
+					exp = exp * 10 + (*e - '0');
+			}
+			exponent += negativeExp ? -exp : exp;
+			p = e;
+		}
+	}
+
+	if (anyDigit && fastPath && digits <= 15 && exponent >= -22 && exponent <= 22) {
+		if (p < end && !isSpace(*p))
+			return false;
+		double v = (double) mantissa;
+		v        = exponent < 0 ? v / exactPowersOfTen[-exponent] : v * exactPowersOfTen[exponent];
+		value    = negative ? -v : v;
+		return true;
+	}
+
+	// slow path: long mantissas, huge exponents, nan, inf...
+	p       = tokenEnd(begin, end);
+	bool ok = false;
+	value   = QByteArray::fromRawData(begin, int(p - begin)).toDouble(&ok);
+	return ok;
+}
+
+/**
+ * Parses an integer, and moves p after it. It does not skip spaces, and it
+ * stops at the first non digit character.
+ */
+bool parseInt(const char*& p, const char* end, int& value)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+	if (p == end || !isDigit(*p))
+		return false;
+	int64_t v = 0;
+	for (; p < end && isDigit(*p); ++p) {
+		if (v < INT32_MAX)
+			v = v * 10 + (*p - '0');
+	}
+	if (v > INT32_MAX)
+		return false;
+	value = negative ? -int(v) : int(v);
+	return true;
+}
+
+struct ObjMaterial
+{
+	vcg::Color4b color = vcg::Color4b(vcg::Color4b::White);
+	int          texture = -1;
+};
+
+/**
+ * The parser fills a set of plain arrays, that are moved to the mesh when the
+ * whole file has been read: the optional per element arrays (e.g. colors)
+ * are created only when the first element that has that attribute is read.
+ */
+class ObjParser
+{
+public:
+	ObjParser(const QString& fileName) : objDir(QFileInfo(fileName).absoluteDir()) {}
+
+	void parse(const char* data, qint64 size, vcg::CallBackPos* cb)
+	{
+		const qint64 progressStep = 1 << 24;
+		qint64       nextProgress = progressStep;
+
+		const char* p   = data;
+		const char* end = data + size;
+		while (p < end) {
+			const char* lineEnd = (const char*) memchr(p, '\n', end - p);
+			if (lineEnd == nullptr)
+				lineEnd = end;
+			++lineNumber;
+			parseLine(p, lineEnd);
+			p = lineEnd + 1;
+
+			if (cb != nullptr && p - data >= nextProgress) {
+				cb(int(90.0 * (p - data) / size), "Loading OBJ...");
+				nextProgress += progressStep;
+			}
+		}
+	}
+
+	int fill(MeshModel& m)
+	{
+		const size_t nVerts = positions.size();
+		checkIndices(faceVerts, nVerts, false, "vertex");
+		checkIndices(wedgeTexCoords, texCoords.size(), true, "texture coordinate");
+		checkIndices(wedgeNormals, normals.size(), true, "normal");
+
+		int mask = vcg::tri::io::Mask::IOM_VERTCOORD;
+		if (!vertColors.empty())
+			mask |= vcg::tri::io::Mask::IOM_VERTCOLOR;
+		if (everyVertexHasNormal())
+			mask |= vcg::tri::io::Mask::IOM_VERTNORMAL;
+		if (!wedgeTexCoords.empty())
+			mask |= vcg::tri::io::Mask::IOM_WEDGTEXCOORD;
+		if (!faceMaterials.empty())
+			mask |= vcg::tri::io::Mask::IOM_FACECOLOR;
+		if (!faceFaux.empty())
+			mask |= vcg::tri::io::Mask::IOM_BITPOLYGONAL;
+		if (!faceVerts.empty())
+			mask |= vcg::tri::io::Mask::IOM_FACEINDEX;
+		if (!edgeVerts.empty())
+			mask |= vcg::tri::io::Mask::IOM_EDGEINDEX;
+		m.enable(mask);
+
+		CMeshO& cm = m.cm;
+		cm.textures.insert(cm.textures.end(), textures.begin(), textures.end());
+
+		if (nVerts > 0) {
+			// the colors of the file are either all in [0, 1] or all in [0, 255]
+			const float colorScale = maxColorComponent > 1 ? 1 : 255;
+			CMeshO::VertexIterator vi = vcg::tri::Allocator<CMeshO>::AddVertices(cm, nVerts);
+			for (size_t i = 0; i < nVerts; ++i, ++vi) {
+				vi->P() = positions[i];
+				if (!vertColors.empty()) {
+					const vcg::Point3f& c = vertColors[i];
+					if (c[0] < 0)
+						vi->C() = vcg::Color4b(vcg::Color4b::White);
+					else
+						vi->C() = vcg::Color4b(
+							toByte(c[0] * colorScale), toByte(c[1] * colorScale), toByte(c[2] * colorScale), 255);
+				}
+			}
+			if (faceVerts.empty() && normals.size() == nVerts) {
+				for (size_t i = 0; i < nVerts; ++i)
+					cm.vert[i].N() = normals[i];
+			}
+		}
+
+		const size_t nFaces = faceVerts.size() / 3;
+		if (nFaces > 0) {
+			CMeshO::FaceIterator fi = vcg::tri::Allocator<CMeshO>::AddFaces(cm, nFaces);
+			for (size_t i = 0; i < nFaces; ++i, ++fi) {
+				const ObjMaterial* mat = nullptr;
+				if (!faceMaterials.empty() && faceMaterials[i] >= 0)
+					mat = &materials[faceMaterials[i]];
+				for (int k = 0; k < 3; ++k) {
+					const size_t w = 3 * i + k;
+					fi->V(k)       = &cm.vert[faceVerts[w]];
+					if (!wedgeNormals.empty() && wedgeNormals[w] >= 0)
+						fi->V(k)->N() = normals[wedgeNormals[w]];
+					if (!wedgeTexCoords.empty()) {
+						if (wedgeTexCoords[w] >= 0)
+							fi->WT(k).P() = CFaceO::TexCoordType::PointType::Construct(texCoords[wedgeTexCoords[w]]);
+						else
+							fi->WT(k).P() = CFaceO::TexCoordType::PointType(0, 0);
+						fi->WT(k).N() = mat != nullptr ? mat->texture : -1;
+					}
+					if (!faceFaux.empty() && (faceFaux[i] & (1 << k)))
+						fi->SetF(k);
+				}
+				if (!faceMaterials.empty())
+					fi->C() = mat != nullptr ? mat->color : vcg::Color4b(vcg::Color4b::White);
+			}
+		}
+
+		const size_t nEdges = edgeVerts.size() / 2;
+		if (nEdges > 0) {
+			checkIndices(edgeVerts, nVerts, false, "vertex");
+			CMeshO::EdgeIterator ei = vcg::tri::Allocator<CMeshO>::AddEdges(cm, nEdges);
+			for (size_t i = 0; i < nEdges; ++i, ++ei) {
+				ei->V(0) = &cm.vert[edgeVerts[2 * i]];
+				ei->V(1) = &cm.vert[edgeVerts[2 * i + 1]];
+			}
+		}
+		return mask;
+	}
+
+	QString warnings() const
+	{
+		QString w = warningString;
+		if (skippedFaces > 0)
+			w += QString("%1 faces with less than 3 vertices have been skipped.\n").arg(skippedFaces);
+		return w;
+	}
+
+private:
+	void parseLine(const char* p, const char* end)
+	{
+		skipSpaces(p, end);
+		if (p == end || *p == '#')
+			return;
+		const char* keyEnd = tokenEnd(p, end);
+		const size_t len   = keyEnd - p;
+		const char* args   = keyEnd;
+		skipSpaces(args, end);
+
+		if (len == 1 && p[0] == 'v')
+			parseVertex(args, end);
+		else if (len == 1 && p[0] == 'f')
+			parseFace(args, end);
+		else if (len == 2 && p[0] == 'v' && p[1] == 'n')
+			parseNormal(args, end);
+		else if (len == 2 && p[0] == 'v' && p[1] == 't')
+			parseTexCoord(args, end);
+		else if (len == 1 && p[0] == 'l')
+			parseLineElement(args, end);
+		else if (len == 6 && memcmp(p, "usemtl", 6) == 0)
+			useMaterial(trimmed(args, end));
+		else if (len == 6 && memcmp(p, "mtllib", 6) == 0)
+			loadMaterialLibrary(trimmed(args, end));
+		// other elements (groups, smoothing groups, free form curves...)
+		// are ignored
+	}
+
+	void parseVertex(const char* p, const char* end)
+	{
+		double v[7];
+		int    n = parseReals(p, end, v, 7);
+		if (n < 3)
+			error("a vertex must have at least 3 coordinates");
+		positions.push_back(Point3m(v[0], v[1], v[2]));
+
+		// 'v x y z r g b': vertex colors, as floats in [0, 1] or in [0, 255];
+		// the range is decided for the whole file when the mesh is filled
+		if (n >= 6) {
+			if (vertColors.empty())
+				vertColors.resize(positions.size() - 1, NO_COLOR);
+			vertColors.push_back(vcg::Point3f(v[3], v[4], v[5]));
+			maxColorComponent = std::max({maxColorComponent, v[3], v[4], v[5]});
+		}
+		else if (!vertColors.empty()) {
+			vertColors.push_back(NO_COLOR);
+		}
+	}
+
+	void parseNormal(const char* p, const char* end)
+	{
+		double v[3];
+		if (parseReals(p, end, v, 3) < 3)
+			error("a normal must have 3 coordinates");
+		normals.push_back(Point3m(v[0], v[1], v[2]));
+	}
+
+	void parseTexCoord(const char* p, const char* end)
+	{
+		double v[3];
+		if (parseReals(p, end, v, 3) < 2)
+			error("a texture coordinate must have at least 2 coordinates");
+		texCoords.push_back(Point2m(v[0], v[1]));
+	}
+
+	void parseFace(const char* p, const char* end)
+	{
+		corners.clear();
+		while (p < end) {
+			Corner c;
+			if (!parseInt(p, end, c.v))
+				error("malformed face");
+			if (p < end && *p == '/') {
+				++p;
+				if (p < end && *p != '/') {
+					if (!parseInt(p, end, c.t))
+						error("malformed face");
+					c.t = resolve(c.t, texCoords.size());
+				}
+				if (p < end && *p == '/') {
+					++p;
+					if (!parseInt(p, end, c.n))
+						error("malformed face");
+					c.n = resolve(c.n, normals.size());
+				}
+			}
+			if (p < end && !isSpace(*p))
+				error("malformed face");
+			c.v = resolve(c.v, positions.size());
+			corners.push_back(c);
+			skipSpaces(p, end);
+		}
+
+		if (corners.size() < 3) {
+			++skippedFaces;
+			return;
+		}
+
+		// polygons are triangulated as a fan; the internal edges are faux
+		const size_t nTris = corners.size() - 2;
+		for (size_t k = 1; k <= nTris; ++k) {
+			const Corner* tri[3] = {&corners[0], &corners[k], &corners[k + 1]};
+			for (const Corner* c : tri) {
+				faceVerts.push_back(c->v);
+				if (c->t >= 0 && wedgeTexCoords.empty())
+					wedgeTexCoords.resize(faceVerts.size() - 1, -1);
+				if (!wedgeTexCoords.empty())
+					wedgeTexCoords.push_back(c->t);
+				if (c->n >= 0 && wedgeNormals.empty())
+					wedgeNormals.resize(faceVerts.size() - 1, -1);
+				if (!wedgeNormals.empty())
+					wedgeNormals.push_back(c->n);
+			}
+			if (nTris > 1 && faceFaux.empty())
+				faceFaux.resize(faceVerts.size() / 3 - 1, 0);
+			if (!faceFaux.empty()) {
+				unsigned char faux = 0;
+				if (k > 1)
+					faux |= 1; // edge v0-vk
+				if (k < nTris)
+					faux |= 4; // edge vk+1-v0
+				faceFaux.push_back(faux);
+			}
+			if (currentMaterial >= 0 && faceMaterials.empty())
+				faceMaterials.resize(faceVerts.size() / 3 - 1, -1);
+			if (!faceMaterials.empty())
+				faceMaterials.push_back(currentMaterial);
+		}
+	}
+
+	void parseLineElement(const char* p, const char* end)
+	{
+		int prev = -1;
+		while (p < end) {
+			int v;
+			if (!parseInt(p, end, v))
+				error("malformed line");
+			// texture coordinates of polylines are ignored
+			if (p < end && *p == '/') {
+				int t;
+				++p;
+				parseInt(p, end, t);
+			}
+			v = resolve(v, positions.size());
+			if (prev >= 0) {
+				edgeVerts.push_back(prev);
+				edgeVerts.push_back(v);
+			}
+			prev = v;
+			skipSpaces(p, end);
+		}
+	}
+
+	void useMaterial(const QString& name)
+	{
+		auto it = materialIndices.find(name);
+		if (it == materialIndices.end()) {
+			warningString += "Material " + name + " not found.\n";
+			materialIndices[name] = -1;
+			currentMaterial       = -1;
+		}
+		else {
+			currentMaterial = it->second;
+		}
+	}
+
+	void loadMaterialLibrary(const QString& name)
+	{
+		QFile f(objDir.absoluteFilePath(name));
+		if (!f.open(QIODevice::ReadOnly)) {
+			warningString += "Material library " + name + " not found.\n";
+			return;
+		}
+		const QByteArray content = f.readAll();
+		const char*      p       = content.constData();
+		const char*      end     = p + content.size();
+
+		ObjMaterial* current = nullptr;
+		while (p < end) {
+			const char* lineEnd = (const char*) memchr(p, '\n', end - p);
+			if (lineEnd == nullptr)
+				lineEnd = end;
+			const char* l = p;
+			p             = lineEnd + 1;
+
+			skipSpaces(l, lineEnd);
+			const char*  keyEnd = tokenEnd(l, lineEnd);
+			const size_t len    = keyEnd - l;
+			const char*  args   = keyEnd;
+			skipSpaces(args, lineEnd);
+			double v[3];
+
+			if (len == 6 && memcmp(l, "newmtl", 6) == 0) {
+				QString matName = trimmed(args, lineEnd);
+				auto    it      = materialIndices.find(matName);
+				if (it == materialIndices.end() || it->second < 0) {
+					materialIndices[matName] = int(materials.size());
+					materials.push_back(ObjMaterial());
+				}
+				current = &materials[materialIndices[matName]];
+			}
+			else if (current == nullptr) {
+				continue;
+			}
+			else if (len == 2 && memcmp(l, "Kd", 2) == 0 && parseReals(args, lineEnd, v, 3) == 3) {
+				current->color[0] = toByte(v[0] * 255);
+				current->color[1] = toByte(v[1] * 255);
+				current->color[2] = toByte(v[2] * 255);
+			}
+			else if (len == 1 && l[0] == 'd' && parseReals(args, lineEnd, v, 1) == 1) {
+				current->color[3] = toByte(v[0] * 255);
+			}
+			else if (len == 2 && memcmp(l, "Tr", 2) == 0 && parseReals(args, lineEnd, v, 1) == 1) {
+				current->color[3] = toByte((1 - v[0]) * 255);
+			}
+			else if (len == 6 && memcmp(l, "map_Kd", 6) == 0) {
+				// the texture file is the last token: the previous ones are options
+				const char* last = lineEnd;
+				while (last > args && isSpace(last[-1]))
+					--last;
+				const char* first = last;
+				while (first > args && !isSpace(first[-1]))
+					--first;
+				std::string texture(first, last);
+				auto        it = std::find(textures.begin(), textures.end(), texture);
+				current->texture = int(it - textures.begin());
+				if (it == textures.end())
+					textures.push_back(texture);
+			}
+		}
+	}
+
+	int parseReals(const char* p, const char* end, double* v, int maxValues)
+	{
+		int n = 0;
+		while (p < end && n < maxValues) {
+			if (!parseReal(p, end, v[n]))
+				error("malformed number");
+			++n;
+			skipSpaces(p, end);
+		}
+		return n;
+	}
+
+	/**
+	 * OBJ indices start from 1; negative indices are relative to the end of
+	 * the elements read so far.
+	 */
+	int resolve(int index, size_t count) const
+	{
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+			return int(count) + index;
+		error("index 0 is not valid");
+		return -1;
+	}
+
+	/**
+	 * Indices are checked only at the end of the parse, because an element
+	 * can be referenced before it is defined.
+	 */
+	// true only if the file gives a normal to every vertex; otherwise the normals are
+	// not flagged as loaded, and all of them are computed from the faces
+	bool everyVertexHasNormal() const
+	{
+		if (faceVerts.empty())
+			return !normals.empty() && normals.size() == positions.size();
+		if (wedgeNormals.empty())
+			return false;
+		std::vector<bool> hasNormal(positions.size(), false);
+		for (size_t w = 0; w < faceVerts.size(); ++w)
+			if (wedgeNormals[w] >= 0)
+				hasNormal[faceVerts[w]] = true;
+		return std::find(hasNormal.begin(), hasNormal.end(), false) == hasNormal.end();
+	}
+
+	void checkIndices(const std::vector<int>& indices, size_t count, bool allowMissing, const char* element) const
+	{
+		for (int i : indices) {
+			if (i >= int(count) || (i < 0 && !(allowMissing && i == -1)))
+				throw MLException(QString("Error while loading OBJ: %1 index out of range.").arg(element));
+		}
+	}
+
+	static unsigned char toByte(double v) { return (unsigned char) std::max(0.0, std::min(255.0, v)); }
+
+	static QString trimmed(const char* p, const char* end)
+	{
+		return QString::fromUtf8(p, int(end - p)).trimmed();
+	}
+
+	[[noreturn]] void error(const char* msg) const
+	{
+		throw MLException(QString("Error while loading OBJ at line %1: %2.").arg(lineNumber).arg(msg));
+	}
+
+	struct Corner
+	{
+		int v = -1;
+		int t = -1;
+		int n = -1;
+	};
+
+	QDir   objDir;
+	qint64 lineNumber   = 0;
+	int    skippedFaces = 0;
+	QString warningString;
+
+	// color of the vertices without one, when other vertices have it (white)
+	const vcg::Point3f NO_COLOR = vcg::Point3f(-1, -1, -1);
+
+	std::vector<Point3m>      positions;
+	std::vector<vcg::Point3f> vertColors; // as in the file, NO_COLOR if missing
+	double                    maxColorComponent = 0;
+	std::vector<Point3m>      normals;
+	std::vector<Point2m>      texCoords;
+
+	std::vector<int>           faceVerts;      // 3 per triangle
+	std::vector<int>           wedgeTexCoords; // 3 per triangle, -1 if missing
+	std::vector<int>           wedgeNormals;   // 3 per triangle, -1 if missing
+	std::vector<int>           faceMaterials;  // -1 if missing
+	std::vector<unsigned char> faceFaux;       // bit k set if edge k is faux
+	std::vector<int>           edgeVerts;      // 2 per edge
+
+	std::vector<ObjMaterial>   materials;
+	std::map<QString, int>     materialIndices;
+	std::vector<std::string>   textures;
+	int                        currentMaterial = -1;
+
+	std::vector<Corner> corners;
+};
+
+} // namespace
+
+QString loadOBJ(
+		const QString& fileName,
+		MeshModel& m,
+		int& mask,
+		vcg::CallBackPos* cb)
+{
+	QFile f(fileName);
+	if (!f.open(QIODevice::ReadOnly))
+		throw MLException("Unable to open " + fileName);
+
+	ObjParser parser(fileName);
+	const qint64 size = f.size();
+	if (size > 0) {
+		uchar* mapped = f.map(0, size);
+		if (mapped != nullptr) {
+			parser.parse((const char*) mapped, size, cb);
+			f.unmap(mapped);
+		}
+		else {
+			// mapping not supported (e.g. special files): read the whole file
+			const QByteArray content = f.readAll();
+			parser.parse(content.constData(), content.size(), cb);
+		}
+	}
+	mask = parser.fill(m);
+	return parser.warnings();
+}
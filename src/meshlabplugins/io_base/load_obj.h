@@ -0,0 +1,24 @@
+#ifndef LOAD_OBJ_H
+#define LOAD_OBJ_H
+
+#include <common/ml_document/mesh_model.h>
+
+/**
+ * @brief Loads an OBJ file in a single pass: the attributes contained in the
+ * file (vertex colors, normals, texture coordinates, materials, polygons)
+ * are discovered while parsing, and the optional components of the mesh are
+ * enabled only when the mesh is filled, at the end of the parse.
+ *
+ * The file is memory mapped and parsed directly from the mapped buffer.
+ *
+ * Throws a MLException if the file cannot be read or it is malformed.
+ * Non critical problems (e.g. a missing material library) are returned as
+ * a warning message, empty if everything went fine.
+ */
+QString loadOBJ(
+		const QString& fileName,
+		MeshModel& m,
+		int& mask,
+		vcg::CallBackPos* cb);
+
+#endif // LOAD_OBJ_H
@@ -1,5 +1,8 @@
 #include "load_project.h"
 
+#include <algorithm>
+#include <iterator>
+
 #include <QDir>
 
 #include <wrap/io_trimesh/alnParser.h>
@@ -10,6 +13,23 @@
 #include <common/ml_document/mesh_document.h>
 #include <common/utilities/load_save.h>
 
+namespace {
+
+/**
+ * A layer of the MeshGroup of a MeshLab project: the mesh with id idInFile
+ * of the file-th mesh file loaded by the project.
+ */
+struct MLPMeshEntry
+{
+	QDomNode node;
+	QString label;
+	bool visible;
+	int file;
+	int idInFile;
+};
+
+}
+
 std::vector<MeshModel*> loadALN(
 		const QString& filename,
 		MeshDocument& md,
@@ -22,24 +42,21 @@ std::vector<MeshModel*> loadALN(
 		throw MLException("Unable to open ALN file");
 	}
 	QFileInfo fi(filename);
-	QString curr_path = QDir::currentPath();
-	QDir::setCurrent(fi.absolutePath());
 
+	QStringList meshFiles;
 	for(const RangeMap& rm : rmv) {
-		QString relativeToProj = fi.absoluteDir().absolutePath() + "/" + rm.filename.c_str();
-		try {
-			std::list<MeshModel*> tmp =
-					meshlab::loadMeshWithStandardParameters(relativeToProj, md, cb);
-			md.mm()->cm.Tr.Import(rm.transformation);
-			meshList.insert(meshList.end(), tmp.begin(), tmp.end());
-		}
-		catch (const MLException& e){
-			for (const MeshModel* m : meshList)
-				md.delMesh(m->id());
-			throw e;
+		meshFiles.push_back(fi.absoluteDir().absolutePath() + "/" + rm.filename.c_str());
+	}
+
+	// all the range maps are loaded concurrently
+	std::vector<std::list<MeshModel*>> loaded =
+			meshlab::loadMeshesWithStandardParameters(meshFiles, md, cb);
+	for (unsigned int i = 0; i < rmv.size(); ++i) {
+		for (MeshModel* m : loaded[i]) {
+			m->cm.Tr.Import(rmv[i].transformation);
+			meshList.push_back(m);
 		}
 	}
-	QDir::setCurrent(curr_path);
 	return meshList;
 }
 
@@ -160,7 +177,7 @@ std::vector<MeshModel*> loadMLP(
 		MeshDocument& md,
 		std::vector<MLRenderingData>& rendOpt,
 		std::vector<std::string>& unloadedImgList,
-		vcg::CallBackPos*)
+		vcg::CallBackPos* cb)
 {
 	std::vector<MeshModel*> meshList;
 	unloadedImgList.clear();
@@ -188,19 +205,17 @@ std::vector<MeshModel*> loadMLP(
 	//Devices
 	while (!node.isNull()) {
 		if (QString::compare(node.nodeName(), "MeshGroup") == 0) {
-			QDomNode mesh;
-			QString filen, label;
-			mesh = node.firstChild();
-			while (!mesh.isNull()) {
-				//return true;
-				filen = mesh.attributes().namedItem("filename").nodeValue();
-				label = mesh.attributes().namedItem("label").nodeValue();
-				bool visible = true;
+			// first pass: read the layers, and collect the files to load
+			QStringList meshFiles;
+			std::vector<MLPMeshEntry> entries;
+			for (QDomNode mesh = node.firstChild(); !mesh.isNull(); mesh = mesh.nextSibling()) {
+				MLPMeshEntry entry;
+				entry.node = mesh;
+				QString filen = mesh.attributes().namedItem("filename").nodeValue();
+				entry.label = mesh.attributes().namedItem("label").nodeValue();
+				entry.visible = true;
 				if (mesh.attributes().contains("visible"))
-					visible = (mesh.attributes().namedItem("visible").nodeValue().toInt() == 1);
-				//MeshModel* mm = md.addNewMesh(filen, label);
-
-				//mm->visible = visible;
+					entry.visible = (mesh.attributes().namedItem("visible").nodeValue().toInt() == 1);
 
 				int idInFile = -1;
 				if (mesh.attributes().contains("idInFile")){
@@ -209,27 +224,44 @@ std::vector<MeshModel*> loadMLP(
 				if (idInFile <= 0){
 					//load the file just if it is the first layer contained
 					//in the file (or it is the only one)
-					try {
-						auto tmp = meshlab::loadMeshWithStandardParameters(filen, md);
-						for (auto m : tmp){
-							m->setVisible(visible);
-							m->setLabel(label);
-						}
-						meshList.insert(meshList.end(), tmp.begin(), tmp.end());
-					}
-					catch(const MLException& e) {
-						for (MeshModel* mm : meshList)
-							md.delMesh(mm->id());
-						throw MLException(filen + " mesh file not found.");
-					}
+					meshFiles.push_back(filen);
 				}
+				if (meshFiles.isEmpty())
+					continue;
+				entry.file = meshFiles.size() - 1;
+				entry.idInFile = std::max(idInFile, 0);
+				entries.push_back(entry);
+			}
 
-				QDomNode tr = mesh.firstChildElement("MLMatrix44");
+			// the mesh files are loaded concurrently
+			std::vector<std::list<MeshModel*>> loaded;
+			try {
+				loaded = meshlab::loadMeshesWithStandardParameters(meshFiles, md, cb);
+			}
+			catch(const MLException& e) {
+				for (MeshModel* mm : meshList)
+					md.delMesh(mm->id());
+				QDir::setCurrent(tmpDir.absolutePath());
+				throw e;
+			}
+			for (const std::list<MeshModel*>& l : loaded)
+				meshList.insert(meshList.end(), l.begin(), l.end());
+
+			// second pass: set the properties of each loaded layer
+			for (const MLPMeshEntry& entry : entries) {
+				const std::list<MeshModel*>& fileMeshes = loaded[entry.file];
+				if (entry.idInFile >= (int) fileMeshes.size())
+					continue;
+				MeshModel* mm = *std::next(fileMeshes.begin(), entry.idInFile);
+				mm->setVisible(entry.visible);
+				mm->setLabel(entry.label);
+
+				QDomNode tr = entry.node.firstChildElement("MLMatrix44");
 
 				if (!tr.isNull()) {
 					if (tr.childNodes().size() == 1) {
 						if (!binary) {
-							Scalarm* v = md.mm()->cm.Tr.V();
+							Scalarm* v = mm->cm.Tr.V();
 							const QStringList rows = tr.firstChild().nodeValue().split("\n", Qt::SkipEmptyParts);
 							unsigned int i = 0;
 							for (const QString& row: rows) {
@@ -243,12 +275,12 @@ std::vector<MeshModel*> loadMLP(
 						else {
 							QString str = tr.firstChild().nodeValue();
 							QByteArray value = QByteArray::fromBase64(str.toLocal8Bit());
-							memcpy(md.mm()->cm.Tr.V(), value.data(), sizeof(Matrix44m::ScalarType) * 16);
+							memcpy(mm->cm.Tr.V(), value.data(), sizeof(Matrix44m::ScalarType) * 16);
 						}
 					}
 				}
 
-				QDomNode renderingOpt = mesh.firstChildElement("RenderingOption");
+				QDomNode renderingOpt = entry.node.firstChildElement("RenderingOption");
 				if (!renderingOpt.isNull())
 				{
 					QString value = renderingOpt.firstChild().nodeValue();
@@ -282,8 +314,6 @@ std::vector<MeshModel*> loadMLP(
 					if (data.deserialize(value.toStdString()))
 						rendOpt.push_back(data);
 				}
-
-				mesh = mesh.nextSibling();
 			}
 		}
 		// READ IN POINT CORRESPONDECES INCOMPLETO!!
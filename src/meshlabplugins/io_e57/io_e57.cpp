@@ -22,8 +22,13 @@
 ****************************************************************************/
 #include <QUuid>
 
+#include <atomic>
 #include <cmath>
+#include <exception>
 #include <memory>
+#include <unordered_set>
+
+#include <common/utilities/parallel.h>
 
 #include "io_e57.h"
 
@@ -37,6 +42,13 @@
 #define LOADING_MESH        "Loading mesh..."
 #define DONE_LOADING        "Done!"
 
+#define DECIMATION_VOXEL_SIZE "decimation_voxel_size"
+
+/**
+ * Number of points read from the file at once
+ */
+#define READ_BLOCK_SIZE     (1 << 20)
+
 /**
  * [Macro] Throw MLException in case of failure using E57 functions.
  */
@@ -65,6 +77,24 @@ static inline std::string filenameToString(const QString& fileName) noexcept;
  */
 static inline QString formatImageFilename(const std::string& fileName, const char* format) noexcept;
 
+/**
+ * Store in valid the indices of the valid points of a block, without branches
+ * @param invalidState The invalid state of the points, nullptr if all of them are valid
+ * @param size The number of points of the block
+ * @param valid The indices of the valid points, with room for size elements
+ * @return The number of valid points
+ */
+static inline std::size_t validPoints(const int8_t* invalidState, std::size_t size, std::vector<uint32_t>& valid) noexcept;
+
+/**
+ * Hash of the integer coordinates of a voxel
+ */
+struct VoxelHash {
+    std::size_t operator()(const vcg::Point3i& p) const noexcept {
+        return std::size_t(p[0]) * 73856093u ^ std::size_t(p[1]) * 19349663u ^ std::size_t(p[2]) * 83492791u;
+    }
+};
+
 unsigned int E57IOPlugin::numberMeshesContainedInFile(const QString& format, const QString& fileName, const RichParameterList&) const {
 
     unsigned int count;
@@ -115,61 +145,119 @@ void E57IOPlugin::open(const QString &formatName, const QString &fileName, const
 
     UPDATE_PROGRESS(cb, 1, START_LOADING);
 
-    // Read clouds...
-    int scanIndex = 0;
-    bool columnIndex = false;
+    const Scalarm voxelSize = par.hasParameter(DECIMATION_VOXEL_SIZE) ? par.getFloat(DECIMATION_VOXEL_SIZE) : 0;
 
-    for (auto meshModel: meshModelList) {
+    std::vector<MeshModel*> meshModels{meshModelList.begin(), meshModelList.end()};
+    std::vector<e57::Data3D> scanHeaders(meshModels.size());
+    std::vector<int64_t> scanPoints(meshModels.size(), 0);
+    int64_t totalPoints = 0;
+    bool columnIndex = false;
 
-        int mask = 0;
-        e57::Data3D scanHeader{};
+    // Read the headers of the clouds...
+    for (std::size_t scanIndex = 0; scanIndex < meshModels.size(); scanIndex++) {
 
         int64_t rows = 0, cols = 0;
-        int64_t numberPointSize = 0, numberGroupSize = 0, numberCountSize = 0;
-
-        UPDATE_PROGRESS(cb, (scanIndex * data3DCount) / 100, LOADING_MESH);
+        int64_t numberGroupSize = 0, numberCountSize = 0;
 
         // read 3D data
-        E57_WRAPPER(e57FileReader.ReadData3D(scanIndex, scanHeader), "Error while reading 3D from file!");
+        E57_WRAPPER(e57FileReader.ReadData3D(scanIndex, scanHeaders[scanIndex]), "Error while reading 3D from file!");
 
         // read scan's size information
         E57_WRAPPER(e57FileReader.GetData3DSizes(
-                scanIndex, rows, cols, numberPointSize, numberGroupSize, numberCountSize, columnIndex
+                scanIndex, rows, cols, scanPoints[scanIndex], numberGroupSize, numberCountSize, columnIndex
         ), "Error while reading scan information!");
 
         // If the name is not empty then set a name for the mesh.
-        if (!scanHeader.name.empty()) {
-            meshModel->setLabel(QString::fromStdString(scanHeader.name));
+        if (!scanHeaders[scanIndex].name.empty()) {
+            meshModels[scanIndex]->setLabel(QString::fromStdString(scanHeaders[scanIndex].name));
         }
 
-        try {
+        totalPoints += scanPoints[scanIndex];
+    }
 
-            if (numberPointSize != 0) {
+    E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
+
+    // ...then read the points of the clouds concurrently. A reader cannot be shared between threads,
+    // so each thread reads the file with its own one. Readers are created and destroyed only by this
+    // thread, as the XML parser they initialize and terminate is not thread safe.
+    // The progress is updated only by this thread, too.
+    std::vector<int> masks(meshModels.size(), 0);
+    std::size_t nonEmptyScans = 0;
+    for (int64_t points : scanPoints) {
+        if (points != 0) {
+            nonEmptyScans++;
+        }
+    }
+
+    std::vector<std::unique_ptr<e57::Reader>> fileReaders(meshlab::threadCount(std::max<std::size_t>(nonEmptyScans, 1)));
+    for (std::unique_ptr<e57::Reader>& fileReader : fileReaders) {
+        fileReader.reset(new e57::Reader{filenameToString(fileName)});
+        E57_WRAPPER(fileReader->IsOpen(), "Error while opening E57 file!");
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::atomic<int64_t> pointsRead{0};
+    std::atomic<bool> abort{false};
+
+    auto worker = [&](unsigned int thread) {
+
+        e57::Reader& fileReader = *fileReaders[thread];
+
+        for (std::size_t scanIndex = next++; scanIndex < meshModels.size() && !abort; scanIndex = next++) {
+
+            if (scanPoints[scanIndex] != 0) {
 
                 // Does the mesh have an imageMetaAndImage from which to extract colors?
-                std::pair<e57::Image2D, QImage> imageMetaAndImage = extractMeshImage(e57FileReader, scanIndex, false);
+                std::pair<e57::Image2D, QImage> imageMetaAndImage = extractMeshImage(fileReader, scanIndex, false);
 
                 // Read points from file and load them inside the MeshLab's mesh.
-                loadMesh(*meshModel, mask, scanIndex, numberPointSize, e57FileReader, scanHeader, imageMetaAndImage, par);
+                loadMesh(*meshModels[scanIndex], masks[scanIndex], scanIndex, scanPoints[scanIndex], fileReader,
+                         scanHeaders[scanIndex], imageMetaAndImage, voxelSize, pointsRead);
 
                 // Once the mesh is loaded apply a transformation matrix to translate and rotate the points.
-                translatedAndRotateMesh(meshModel, scanHeader);
+                translatedAndRotateMesh(meshModels[scanIndex], scanHeaders[scanIndex]);
             }
+        }
+    };
 
-            // Put the modified mask into the mask list.
-            maskList.push_back(mask);
+    auto progress = [&]() {
+        UPDATE_PROGRESS(cb, 1 + static_cast<int>((98 * pointsRead) / std::max<int64_t>(totalPoints, 1)), LOADING_MESH);
+    };
 
-            // Increase the scanIndex to get info about the next mesh to parse from the file.
-            scanIndex++;
-        }
-        catch (const std::exception& e) {
-            E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
-            throw MLException{e.what()};
-        }
+    try {
+        meshlab::runThreads(static_cast<unsigned int>(fileReaders.size()), worker, progress, abort);
     }
+    catch (const MLException&) {
+        throw;
+    }
+    catch (const std::exception& e) {
+        throw MLException{e.what()};
+    }
+
+    for (std::unique_ptr<e57::Reader>& fileReader : fileReaders) {
+        fileReader->Close();
+    }
+    fileReaders.clear();
+
+    // Put the modified masks into the mask list.
+    maskList.insert(maskList.end(), masks.begin(), masks.end());
 
     UPDATE_PROGRESS(cb, 100, DONE_LOADING);
-    E57_WRAPPER(e57FileReader.Close(), "Error while closing the E57 file!");
+}
+
+RichParameterList E57IOPlugin::initPreOpenParameter(const QString& format) const {
+
+    RichParameterList parameters;
+
+    if (format.toUpper() == tr(E57_FILE_EXTENSION)) {
+        parameters.addParam(RichFloat(
+                DECIMATION_VOXEL_SIZE, 0, "Decimation voxel size",
+                "If greater than zero, the points of each scan are decimated while loading: only the first "
+                "point that falls in each voxel of this size (in the units of the file) is kept. "
+                "Useful to load huge scans that would not fit in memory."));
+    }
+
+    return parameters;
 }
 
 void E57IOPlugin::translatedAndRotateMesh(MeshModel *meshModel, const e57::Data3D &scanHeader) const {
@@ -407,16 +495,18 @@ void E57IOPlugin::exportMaskCapability(const QString& format, int &capability, i
     capability = defaultBits = mask;
 }
 
-void E57IOPlugin::loadMesh(MeshModel &m, int &mask, int scanIndex, size_t buffSize,
+void E57IOPlugin::loadMesh(MeshModel &m, int &mask, int scanIndex, int64_t numberPointSize,
                            const e57::Reader &fileReader, e57::Data3D &scanHeader,
-                           std::pair<e57::Image2D, QImage> image, const RichParameterList &par) {
+                           std::pair<e57::Image2D, QImage> image, Scalarm voxelSize,
+                           std::atomic<int64_t> &pointsRead) {
 
     using Mask = vcg::tri::io::Mask;
 
     e57::Image2D meshImageHeader = image.first;
     QImage meshImage = image.second;
 
-    // object holding data read from E57 file
+    // object holding a block of data read from E57 file
+    const std::size_t buffSize = static_cast<std::size_t>(std::min<int64_t>(numberPointSize, READ_BLOCK_SIZE));
     vcg::tri::io::E57Data3DPoints data3DPoints{buffSize, scanHeader};
 
     size_t size = 0;
@@ -435,74 +525,116 @@ void E57IOPlugin::loadMesh(MeshModel &m, int &mask, int scanIndex, size_t buffSi
     // set the mask
     m.enable(mask);
 
+    // Without decimation the vertices are allocated at once, the ones left unused by the invalid points
+    // are removed at the end; otherwise the number of points is not known in advance.
+    const bool decimate = voxelSize > 0;
+    std::unordered_set<vcg::Point3i, VoxelHash> occupiedVoxels;
+
+    if (!decimate) {
+        vcg::tri::Allocator<CMeshO>::AddVertices(m.cm, static_cast<std::size_t>(numberPointSize));
+    }
+
+    std::vector<Point3m> coordinates(buffSize);
+    std::vector<uint32_t> valid(buffSize);
+    std::size_t count = 0;
+
     // read the data from the E57 file
     try {
 
         e57::Data3DPointsData_t<Scalarm>& pointsData = data3DPoints.points();
+        CMeshO::VertContainer& vertices = m.cm.vert;
 
         while ((size = dataReader.read()) > 0) {
 
-            for (std::size_t i = 0; i < size; i++) {
+            std::size_t validCount = 0;
 
-                Point3m coordinates;
+            if (data3DPoints.areCoordinatesAvailable()) {
 
-                if (data3DPoints.areCoordinatesAvailable()) {
+                for (std::size_t i = 0; i < size; i++) {
+                    coordinates[i] = Point3m{pointsData.cartesianX[i], pointsData.cartesianY[i], pointsData.cartesianZ[i]};
+                }
 
-                    if (pointsData.cartesianInvalidState == nullptr || pointsData.cartesianInvalidState[i] == 0) {
-                        coordinates[0] = pointsData.cartesianX[i];
-                        coordinates[1] = pointsData.cartesianY[i];
-                        coordinates[2] = pointsData.cartesianZ[i];
-                    }
-                    else {
-                        continue;
-                    }
+                validCount = validPoints(pointsData.cartesianInvalidState, size, valid);
+            }
+            else if (data3DPoints.areSphericalCoordinatesAvailable()) {
+
+                for (std::size_t i = 0; i < size; i++) {
+
+                    const Scalarm range = pointsData.sphericalRange[i];
+                    const Scalarm phi = pointsData.sphericalElevation[i];
+                    const Scalarm theta = pointsData.sphericalAzimuth[i];
+
+                    coordinates[i] = Point3m{
+                        range * std::cos(phi) * std::cos(theta),
+                        range * std::cos(phi) * std::sin(theta),
+                        range * std::sin(phi)
+                    };
                 }
-                else if (data3DPoints.areSphericalCoordinatesAvailable()) {
-                    if (pointsData.sphericalInvalidState == nullptr || pointsData.sphericalInvalidState[i] == 0) {
 
-                        auto range = pointsData.sphericalRange[i];
-                        auto phi = pointsData.sphericalElevation[i];
-                        auto theta = pointsData.sphericalAzimuth[i];
+                validCount = validPoints(pointsData.sphericalInvalidState, size, valid);
+            }
 
-                        coordinates[0] = range * std::cos(phi) * std::cos(theta);
-                        coordinates[1] = range * std::cos(phi) * std::sin(theta);
-                        coordinates[2] = range * std::sin(phi);
+            // Keep only the first point of each voxel.
+            if (decimate) {
 
+                std::size_t keptCount = 0;
+
+                for (std::size_t k = 0; k < validCount; k++) {
+
+                    const Point3m& p = coordinates[valid[k]];
+                    const vcg::Point3i voxel{
+                        static_cast<int>(std::floor(p[0] / voxelSize)),
+                        static_cast<int>(std::floor(p[1] / voxelSize)),
+                        static_cast<int>(std::floor(p[2] / voxelSize))
+                    };
+
+                    if (occupiedVoxels.insert(voxel).second) {
+                        valid[keptCount++] = valid[k];
                     }
-                    else {
-                        continue;
-                    }
-                }
-                else {
-                    continue;
                 }
 
-                auto vertex = vcg::tri::Allocator<CMeshO>::AddVertex(m.cm, coordinates);
+                validCount = keptCount;
+                vcg::tri::Allocator<CMeshO>::AddVertices(m.cm, validCount);
+            }
 
-                // Set the normals.
-                if (data3DPoints.areNormalsAvailable()) {
-                    vertex->N()[0] = pointsData.normalX[i];
-                    vertex->N()[1] = pointsData.normalY[i];
-                    vertex->N()[2] = pointsData.normalZ[i];
-                }
+            // Set the coordinates, then the other attributes of the points.
+            for (std::size_t k = 0; k < validCount; k++) {
+                vertices[count + k].P() = coordinates[valid[k]];
+            }
 
-                // Set the quality.
-                if (data3DPoints.isQualityAvailable()) {
-                    vertex->Q() = pointsData.intensity[i];
+            if (data3DPoints.areNormalsAvailable()) {
+                for (std::size_t k = 0; k < validCount; k++) {
+                    const uint32_t i = valid[k];
+                    vertices[count + k].N() = Point3m{pointsData.normalX[i], pointsData.normalY[i], pointsData.normalZ[i]};
                 }
+            }
 
-                // Set the point color.
-                if (data3DPoints.areColorsAvailable()) {
-                    vertex->C()[0] = pointsData.colorRed[i];
-                    vertex->C()[1] = pointsData.colorGreen[i];
-                    vertex->C()[2] = pointsData.colorBlue[i];
-                    vertex->C()[3] = 0xFF;
+            if (data3DPoints.isQualityAvailable()) {
+                for (std::size_t k = 0; k < validCount; k++) {
+                    vertices[count + k].Q() = pointsData.intensity[valid[k]];
                 }
-                else {
-                    // TODO: extract colors from the image?
+            }
+
+            if (data3DPoints.areColorsAvailable()) {
+                for (std::size_t k = 0; k < validCount; k++) {
+                    const uint32_t i = valid[k];
+                    vertices[count + k].C() = vcg::Color4b{pointsData.colorRed[i], pointsData.colorGreen[i], pointsData.colorBlue[i], 0xFF};
                 }
+            }
+            else {
+                // TODO: extract colors from the image?
+            }
+
+            count += validCount;
+            pointsRead += static_cast<int64_t>(size);
+        }
 
+        // Remove the vertices left unused by the invalid points: there are no faces referring to them.
+        if (!decimate && count < vertices.size()) {
+            for (std::size_t i = count; i < vertices.size(); i++) {
+                vcg::tri::Allocator<CMeshO>::DeleteVertex(m.cm, vertices[i]);
             }
+            vcg::tri::Allocator<CMeshO>::CompactVertexVector(m.cm);
         }
 
         /* If the colors are not available for the mesh use a gray scale */
@@ -536,4 +668,24 @@ static inline QString formatImageFilename(const std::string &fileName, const cha
     return QString{"%1.%s"}.arg(QString::fromStdString(fileName), QString::fromStdString(format));
 }
 
+static inline std::size_t validPoints(const int8_t* invalidState, std::size_t size, std::vector<uint32_t>& valid) noexcept {
+
+    std::size_t count = 0;
+
+    if (invalidState == nullptr) {
+        for (std::size_t i = 0; i < size; i++) {
+            valid[i] = static_cast<uint32_t>(i);
+        }
+        return size;
+    }
+
+    // the index is always written, but kept only if the point is valid
+    for (std::size_t i = 0; i < size; i++) {
+        valid[count] = static_cast<uint32_t>(i);
+        count += (invalidState[i] == 0);
+    }
+
+    return count;
+}
+
 MESHLAB_PLUGIN_NAME_EXPORTER(E57IOPlugin)
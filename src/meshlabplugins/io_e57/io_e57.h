@@ -25,6 +25,8 @@
 
 #include <QObject>
 
+#include <atomic>
+
 #include <common/plugins/interfaces/io_plugin.h>
 #include <common/ml_document/mesh_model.h>
 
@@ -191,6 +193,8 @@ public:
 
 	virtual void exportMaskCapability(const QString &format, int &capability, int &defaultBits) const;
 
+	RichParameterList initPreOpenParameter(const QString& format) const;
+
 	unsigned int numberMeshesContainedInFile(const QString& format, const QString& fileName, const RichParameterList& preParams) const;
 
 	void open(const QString &formatName, const QString &fileName, MeshModel &m,
@@ -214,16 +218,20 @@ private:
 
     /***
      * Load the cloud points read from the E57 file, inside the mesh to display.
+     * The points are read in blocks and converted with one loop per attribute;
+     * the vertices are allocated once, unless the points are decimated.
      * @param m The mesh to display
      * @param mask
      * @param scanIndex Data block index given by the NewData3D
-     * @param buffSize Dimension for buffer size
+     * @param numberPointSize Number of points of the scan
      * @param fileReader The file reader object used to scan the file
-     * @param cb Callback to update the progressbar contained in MeshLab
+     * @param voxelSize If greater than zero, only the first point of each voxel of this size is kept
+     * @param pointsRead Counter of the read points, to update the progressbar contained in MeshLab
      */
-    void loadMesh(MeshModel &m, int &mask, int scanIndex, size_t buffSize,
+    void loadMesh(MeshModel &m, int &mask, int scanIndex, int64_t numberPointSize,
                   const e57::Reader &fileReader, e57::Data3D &scanHeader,
-                  std::pair<e57::Image2D, QImage> image, const RichParameterList &par);
+                  std::pair<e57::Image2D, QImage> image, Scalarm voxelSize,
+                  std::atomic<int64_t> &pointsRead);
 
     /***
      * Read the transform matrix inside the e57::Data3D and apply it to the mesh
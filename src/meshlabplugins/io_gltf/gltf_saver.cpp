@@ -0,0 +1,673 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "gltf_saver.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <common/mlexception.h>
+
+namespace gltf {
+
+namespace {
+
+// glTF enums
+const int GL_BYTE           = 5120;
+const int GL_UNSIGNED_BYTE  = 5121;
+const int GL_UNSIGNED_SHORT = 5123;
+const int GL_UNSIGNED_INT   = 5125;
+const int GL_FLOAT          = 5126;
+const int GL_ARRAY_BUFFER         = 34962;
+const int GL_ELEMENT_ARRAY_BUFFER = 34963;
+const int GL_POINTS    = 0;
+const int GL_TRIANGLES = 4;
+
+const unsigned int VERTEX_CACHE_SIZE = 16;
+// vertices encoded in memory before being written to the file
+const unsigned int WRITE_BLOCK_VERTICES = 1 << 16;
+
+unsigned int align4(unsigned int n)
+{
+	return (n + 3) & ~3u;
+}
+
+void write(QFile& file, const char* data, qint64 size)
+{
+	if (size > 0 && file.write(data, size) != size)
+		throw MLException("Error while writing " + file.fileName() + ": " + file.errorString());
+}
+
+void writePadding(QFile& file, qint64 size, char c = 0)
+{
+	static const char zeros[4] = {0, 0, 0, 0};
+	static const char spaces[4] = {' ', ' ', ' ', ' '};
+	write(file, c == ' ' ? spaces : zeros, size);
+}
+
+void writeUint32(QFile& file, std::uint32_t v)
+{
+	write(file, reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+void encode(char*& dst, T v)
+{
+	std::memcpy(dst, &v, sizeof(T));
+	dst += sizeof(T);
+}
+
+QJsonArray jsonArray(std::initializer_list<double> values)
+{
+	QJsonArray a;
+	for (double v : values)
+		a.append(v);
+	return a;
+}
+
+/**
+ * @brief An image of the glTF file: the bytes of the original texture file
+ * when it is a PNG or JPEG, otherwise the texture encoded as PNG.
+ */
+bool loadTextureImage(
+		const MeshModel& m,
+		const std::string& name,
+		bool reuseTextureFiles,
+		QByteArray& data,
+		QString& mimeType)
+{
+	QImage img = m.getTexture(name);
+	if (img.isNull())
+		return false;
+	if (reuseTextureFiles) {
+		// the file is embedded only if it still looks like the loaded image
+		QFileInfo fi(QDir(m.pathName()).filePath(QString::fromStdString(name)));
+		const QString suffix = fi.suffix().toLower();
+		if (fi.exists() && (suffix == "png" || suffix == "jpg" || suffix == "jpeg") &&
+			QImageReader(fi.absoluteFilePath()).size() == img.size()) {
+			QFile file(fi.absoluteFilePath());
+			if (file.open(QFile::ReadOnly)) {
+				data = file.readAll();
+				mimeType = suffix == "png" ? "image/png" : "image/jpeg";
+				return true;
+			}
+		}
+	}
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+	img.save(&buffer, "PNG");
+	mimeType = "image/png";
+	return true;
+}
+
+}
+
+/**
+ * @brief Saves the mesh in a binary glTF (GLB) file.
+ *
+ * The vertex attributes are interleaved in a single buffer view, encoded
+ * block by block straight from the vertex vector of the mesh to the file.
+ * Vertices are split along the seams of the wedge texture coordinates, and
+ * the faces are split in a primitive for each texture, all sharing the same
+ * vertex accessors.
+ *
+ * @param quantize: positions, normals and texture coordinates are stored as
+ * 16 and 8 bit integers (KHR_mesh_quantization); the positions are
+ * dequantized by the scale and translation of the node.
+ * @param optimizeIndexOrder: the faces are reordered for the post-transform
+ * vertex cache, and the vertices in order of first use.
+ * @param reuseTextureFiles: PNG and JPEG texture files with the same size of
+ * the loaded images are embedded as they are, without encoding the images
+ * again.
+ */
+void saveGLB(
+		const QString& fileName,
+		const MeshModel& m,
+		int mask,
+		bool quantize,
+		bool optimizeIndexOrder,
+		bool reuseTextureFiles,
+		vcg::CallBackPos* cb)
+{
+	using namespace internal;
+	const CMeshO& cm = m.cm;
+	if (cm.VN() == 0)
+		throw MLException("Cannot save an empty mesh.");
+
+	const bool pointCloud = cm.FN() == 0;
+	const bool hasNormals = (mask & vcg::tri::io::Mask::IOM_VERTNORMAL) && m.hasDataMask(MeshModel::MM_VERTNORMAL);
+	const bool hasColors = (mask & vcg::tri::io::Mask::IOM_VERTCOLOR) && m.hasDataMask(MeshModel::MM_VERTCOLOR);
+	const bool wedgeTex = !pointCloud && (mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD) &&
+			m.hasDataMask(MeshModel::MM_WEDGTEXCOORD);
+	const bool vertTex = !wedgeTex && (mask & vcg::tri::io::Mask::IOM_VERTTEXCOORD) &&
+			m.hasDataMask(MeshModel::MM_VERTTEXCOORD);
+	const bool hasTexCoords = wedgeTex || vertTex;
+
+	if (cb)
+		cb(0, "Preparing the glTF buffers");
+
+	// the vertices of the buffer, and the corners of the faces grouped by texture
+	std::vector<OutputVertex> vertices;
+	std::vector<int> textures; // texture of each primitive, -1 if none
+	std::vector<std::vector<unsigned int>> primitiveIndices;
+	if (wedgeTex) {
+		std::vector<const CFaceO*> faces;
+		faces.reserve(cm.FN());
+		for (const CFaceO& f : cm.face)
+			if (!f.IsD())
+				faces.push_back(&f);
+		std::vector<OutputVertex> corners(faces.size() * 3);
+		for (std::size_t i = 0; i < faces.size(); ++i) {
+			for (int j = 0; j < 3; ++j) {
+				const CFaceO::TexCoordType& t = faces[i]->cWT(j);
+				corners[3 * i + j] = OutputVertex {
+					(unsigned int) (faces[i]->cV(j) - &cm.vert[0]), vcg::Point2f(t.U(), 1 - t.V())};
+			}
+		}
+		std::vector<unsigned int> order(corners.size());
+		for (std::size_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+			const OutputVertex& x = corners[a];
+			const OutputVertex& y = corners[b];
+			if (x.v != y.v)
+				return x.v < y.v;
+			if (x.uv.X() != y.uv.X())
+				return x.uv.X() < y.uv.X();
+			return x.uv.Y() < y.uv.Y();
+		});
+		std::vector<unsigned int> cornerVertex(corners.size());
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			const OutputVertex& c = corners[order[i]];
+			if (vertices.empty() || vertices.back().v != c.v || vertices.back().uv != c.uv)
+				vertices.push_back(c);
+			cornerVertex[order[i]] = vertices.size() - 1;
+		}
+
+		std::map<int, std::vector<unsigned int>> byTexture;
+		for (std::size_t i = 0; i < faces.size(); ++i) {
+			int t = faces[i]->cWT(0).N();
+			if (t < 0 || t >= (int) cm.textures.size())
+				t = -1;
+			std::vector<unsigned int>& idx = byTexture[t];
+			for (int j = 0; j < 3; ++j)
+				idx.push_back(cornerVertex[3 * i + j]);
+		}
+		for (auto& p : byTexture) {
+			textures.push_back(p.first);
+			primitiveIndices.push_back(std::move(p.second));
+		}
+	}
+	else {
+		std::vector<unsigned int> vertexIndex(cm.vert.size(), UINT_MAX);
+		vertices.reserve(cm.VN());
+		for (std::size_t i = 0; i < cm.vert.size(); ++i) {
+			if (!cm.vert[i].IsD()) {
+				vertexIndex[i] = vertices.size();
+				vcg::Point2f uv(0, 0);
+				if (vertTex)
+					uv = vcg::Point2f(cm.vert[i].cT().U(), 1 - cm.vert[i].cT().V());
+				vertices.push_back(OutputVertex {(unsigned int) i, uv});
+			}
+		}
+		if (pointCloud) {
+			textures.push_back(-1);
+			primitiveIndices.emplace_back();
+		}
+		else {
+			std::map<int, std::vector<unsigned int>> byTexture;
+			for (const CFaceO& f : cm.face) {
+				if (f.IsD())
+					continue;
+				int t = vertTex ? f.cV(0)->cT().N() : -1;
+				if (t < 0 || t >= (int) cm.textures.size())
+					t = -1;
+				std::vector<unsigned int>& idx = byTexture[t];
+				for (int j = 0; j < 3; ++j)
+					idx.push_back(vertexIndex[f.cV(j) - &cm.vert[0]]);
+			}
+			for (auto& p : byTexture) {
+				textures.push_back(p.first);
+				primitiveIndices.push_back(std::move(p.second));
+			}
+		}
+	}
+
+	if (optimizeIndexOrder && !pointCloud) {
+		if (cb)
+			cb(20, "Optimizing the index order");
+		std::vector<unsigned int> local(vertices.size(), UINT_MAX);
+		std::vector<unsigned int> global;
+		for (std::vector<unsigned int>& indices : primitiveIndices) {
+			global.clear();
+			for (unsigned int& i : indices) {
+				if (local[i] == UINT_MAX) {
+					local[i] = global.size();
+					global.push_back(i);
+				}
+				i = local[i];
+			}
+			tipsify(indices, global.size(), VERTEX_CACHE_SIZE);
+			for (unsigned int& i : indices)
+				i = global[i];
+			for (unsigned int v : global)
+				local[v] = UINT_MAX;
+		}
+		optimizeVertexFetch(vertices, primitiveIndices);
+	}
+
+	// bounding box of the positions
+	vcg::Box3<Scalarm> bbox;
+	for (const OutputVertex& ov : vertices)
+		bbox.Add(cm.vert[ov.v].cP());
+
+	bool quantizeTexCoords = quantize && hasTexCoords;
+	if (quantizeTexCoords) {
+		for (const OutputVertex& ov : vertices) {
+			if (ov.uv.X() < 0 || ov.uv.X() > 1 || ov.uv.Y() < 0 || ov.uv.Y() > 1) {
+				quantizeTexCoords = false;
+				break;
+			}
+		}
+	}
+	// uniform scale, to not distort the normals
+	Scalarm posScale = bbox.Dim()[bbox.MaxDim()] / 65535;
+	if (!(posScale > 0))
+		posScale = 1;
+
+	// layout of the interleaved vertex
+	unsigned int stride = 0;
+	const unsigned int posOffset = stride;
+	stride += quantize ? 8 : 12;
+	const unsigned int normOffset = stride;
+	if (hasNormals)
+		stride += quantize ? 4 : 12;
+	const unsigned int texOffset = stride;
+	if (hasTexCoords)
+		stride += quantizeTexCoords ? 4 : 8;
+	const unsigned int colorOffset = stride;
+	if (hasColors)
+		stride += 4;
+
+	const bool shortIndices = vertices.size() < 65535;
+	const unsigned int indexSize = shortIndices ? 2 : 4;
+
+	// buffer views and accessors
+	QJsonArray bufferViews, accessors, primitives, materials, gltfTextures, images;
+	unsigned int byteLength = 0;
+
+	const unsigned int vertexBytes = vertices.size() * stride;
+	bufferViews.append(QJsonObject {
+		{"buffer", 0}, {"byteOffset", 0}, {"byteLength", (double) vertexBytes},
+		{"byteStride", (int) stride}, {"target", GL_ARRAY_BUFFER}});
+	byteLength = align4(vertexBytes);
+
+	QJsonObject attributes;
+	{
+		QJsonObject pos {
+			{"bufferView", 0}, {"byteOffset", (int) posOffset}, {"count", (double) vertices.size()},
+			{"type", "VEC3"}};
+		if (quantize) {
+			pos["componentType"] = GL_UNSIGNED_SHORT;
+			pos["min"] = jsonArray({0, 0, 0});
+			pos["max"] = jsonArray({
+				std::round(bbox.DimX() / posScale), std::round(bbox.DimY() / posScale),
+				std::round(bbox.DimZ() / posScale)});
+		}
+		else {
+			pos["componentType"] = GL_FLOAT;
+			pos["min"] = jsonArray({(float) bbox.min.X(), (float) bbox.min.Y(), (float) bbox.min.Z()});
+			pos["max"] = jsonArray({(float) bbox.max.X(), (float) bbox.max.Y(), (float) bbox.max.Z()});
+		}
+		attributes["POSITION"] = accessors.size();
+		accessors.append(pos);
+	}
+	if (hasNormals) {
+		QJsonObject norm {
+			{"bufferView", 0}, {"byteOffset", (int) normOffset}, {"count", (double) vertices.size()},
+			{"type", "VEC3"}, {"componentType", quantize ? GL_BYTE : GL_FLOAT}};
+		if (quantize)
+			norm["normalized"] = true;
+		attributes["NORMAL"] = accessors.size();
+		accessors.append(norm);
+	}
+	if (hasTexCoords) {
+		QJsonObject tex {
+			{"bufferView", 0}, {"byteOffset", (int) texOffset}, {"count", (double) vertices.size()},
+			{"type", "VEC2"}, {"componentType", quantizeTexCoords ? GL_UNSIGNED_SHORT : GL_FLOAT}};
+		if (quantizeTexCoords)
+			tex["normalized"] = true;
+		attributes["TEXCOORD_0"] = accessors.size();
+		accessors.append(tex);
+	}
+	if (hasColors) {
+		attributes["COLOR_0"] = accessors.size();
+		accessors.append(QJsonObject {
+			{"bufferView", 0}, {"byteOffset", (int) colorOffset}, {"count", (double) vertices.size()},
+			{"type", "VEC4"}, {"componentType", GL_UNSIGNED_BYTE}, {"normalized", true}});
+	}
+
+	unsigned int indexBytes = 0;
+	for (const std::vector<unsigned int>& indices : primitiveIndices)
+		indexBytes += indices.size() * indexSize;
+	if (!pointCloud) {
+		bufferViews.append(QJsonObject {
+			{"buffer", 0}, {"byteOffset", (double) byteLength}, {"byteLength", (double) indexBytes},
+			{"target", GL_ELEMENT_ARRAY_BUFFER}});
+		byteLength += align4(indexBytes);
+	}
+
+	// the images, with a material for each texture (and one without texture)
+	std::vector<QByteArray> imageData;
+	std::map<int, int> materialIndex;
+	for (int t : textures) {
+		if (materialIndex.count(t) > 0)
+			continue;
+		QJsonObject pbr {{"metallicFactor", 0}};
+		QByteArray data;
+		QString mimeType;
+		if (t >= 0 && loadTextureImage(m, cm.textures[t], reuseTextureFiles, data, mimeType)) {
+			bufferViews.append(QJsonObject {
+				{"buffer", 0}, {"byteOffset", (double) byteLength}, {"byteLength", data.size()}});
+			byteLength += align4(data.size());
+			images.append(QJsonObject {{"bufferView", bufferViews.size() - 1}, {"mimeType", mimeType}});
+			gltfTextures.append(QJsonObject {{"sampler", 0}, {"source", images.size() - 1}});
+			pbr["baseColorTexture"] = QJsonObject {{"index", gltfTextures.size() - 1}};
+			imageData.push_back(std::move(data));
+		}
+		materialIndex[t] = materials.size();
+		materials.append(QJsonObject {{"pbrMetallicRoughness", pbr}});
+	}
+
+	unsigned int indexOffset = 0;
+	for (std::size_t p = 0; p < primitiveIndices.size(); ++p) {
+		QJsonObject primitive {
+			{"attributes", attributes}, {"material", materialIndex[textures[p]]},
+			{"mode", pointCloud ? GL_POINTS : GL_TRIANGLES}};
+		if (!pointCloud) {
+			primitive["indices"] = accessors.size();
+			accessors.append(QJsonObject {
+				{"bufferView", 1}, {"byteOffset", (double) indexOffset},
+				{"count", (double) primitiveIndices[p].size()}, {"type", "SCALAR"},
+				{"componentType", shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT}});
+			indexOffset += primitiveIndices[p].size() * indexSize;
+		}
+		primitives.append(primitive);
+	}
+
+	QJsonObject node {{"mesh", 0}};
+	if (quantize) {
+		node["matrix"] = jsonArray({
+			posScale, 0, 0, 0, 0, posScale, 0, 0, 0, 0, posScale, 0,
+			bbox.min.X(), bbox.min.Y(), bbox.min.Z(), 1});
+	}
+
+	QJsonObject gltf {
+		{"asset", QJsonObject {{"version", "2.0"}, {"generator", "MeshLab"}}},
+		{"scene", 0},
+		{"scenes", QJsonArray {QJsonObject {{"nodes", QJsonArray {0}}}}},
+		{"nodes", QJsonArray {node}},
+		{"meshes", QJsonArray {QJsonObject {{"primitives", primitives}}}},
+		{"materials", materials},
+		{"buffers", QJsonArray {QJsonObject {{"byteLength", (double) byteLength}}}},
+		{"bufferViews", bufferViews},
+		{"accessors", accessors}};
+	if (!images.isEmpty()) {
+		gltf["images"] = images;
+		gltf["textures"] = gltfTextures;
+		gltf["samplers"] = QJsonArray {QJsonObject {
+			{"magFilter", 9729}, {"minFilter", 9987}, {"wrapS", 10497}, {"wrapT", 10497}}};
+	}
+	if (quantize) {
+		gltf["extensionsUsed"] = QJsonArray {"KHR_mesh_quantization"};
+		gltf["extensionsRequired"] = QJsonArray {"KHR_mesh_quantization"};
+	}
+	const QByteArray json = QJsonDocument(gltf).toJson(QJsonDocument::Compact);
+
+	// GLB container: header, JSON chunk and BIN chunk
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly))
+		throw MLException("Cannot open file " + fileName + " for writing: " + file.errorString());
+	const unsigned int jsonLength = align4(json.size());
+	writeUint32(file, 0x46546C67); // "glTF"
+	writeUint32(file, 2);
+	writeUint32(file, 12 + 8 + jsonLength + 8 + byteLength);
+	writeUint32(file, jsonLength);
+	writeUint32(file, 0x4E4F534A); // "JSON"
+	write(file, json.constData(), json.size());
+	writePadding(file, jsonLength - json.size(), ' ');
+	writeUint32(file, byteLength);
+	writeUint32(file, 0x004E4942); // "BIN"
+
+	std::vector<char> block(std::size_t(WRITE_BLOCK_VERTICES) * stride);
+	for (std::size_t begin = 0; begin < vertices.size(); begin += WRITE_BLOCK_VERTICES) {
+		if (cb)
+			cb(40 + int(50 * begin / vertices.size()), "Writing the glTF vertices");
+		const std::size_t end = std::min<std::size_t>(begin + WRITE_BLOCK_VERTICES, vertices.size());
+		std::memset(block.data(), 0, block.size());
+		for (std::size_t i = begin; i < end; ++i) {
+			const CVertexO& v = cm.vert[vertices[i].v];
+			char* base = block.data() + (i - begin) * stride;
+			char* dst = base + posOffset;
+			if (quantize) {
+				for (int k = 0; k < 3; ++k)
+					encode<std::uint16_t>(dst, (std::uint16_t) std::min<Scalarm>(
+							std::round((v.cP()[k] - bbox.min[k]) / posScale), 65535));
+			}
+			else {
+				for (int k = 0; k < 3; ++k)
+					encode<float>(dst, v.cP()[k]);
+			}
+			if (hasNormals) {
+				Point3m n = v.cN();
+				n.Normalize();
+				dst = base + normOffset;
+				for (int k = 0; k < 3; ++k) {
+					if (quantize)
+						encode<std::int8_t>(dst, (std::int8_t) std::max<Scalarm>(std::min<Scalarm>(std::round(n[k] * 127), 127), -127));
+					else
+						encode<float>(dst, n[k]);
+				}
+			}
+			if (hasTexCoords) {
+				dst = base + texOffset;
+				for (int k = 0; k < 2; ++k) {
+					if (quantizeTexCoords)
+						encode<std::uint16_t>(dst, (std::uint16_t) std::round(vertices[i].uv[k] * 65535));
+					else
+						encode<float>(dst, vertices[i].uv[k]);
+				}
+			}
+			if (hasColors) {
+				dst = base + colorOffset;
+				for (int k = 0; k < 4; ++k)
+					encode<std::uint8_t>(dst, v.cC()[k]);
+			}
+		}
+		write(file, block.data(), (end - begin) * stride);
+	}
+	writePadding(file, align4(vertexBytes) - vertexBytes);
+
+	if (cb)
+		cb(90, "Writing the glTF indices");
+	for (const std::vector<unsigned int>& indices : primitiveIndices) {
+		if (shortIndices) {
+			std::vector<std::uint16_t> shorts(indices.begin(), indices.end());
+			write(file, reinterpret_cast<const char*>(shorts.data()), shorts.size() * 2);
+		}
+		else {
+			static_assert(sizeof(unsigned int) == 4, "32 bit indices are written as they are");
+			write(file, reinterpret_cast<const char*>(indices.data()), indices.size() * 4);
+		}
+	}
+	if (!pointCloud)
+		writePadding(file, align4(indexBytes) - indexBytes);
+
+	for (const QByteArray& data : imageData) {
+		write(file, data.constData(), data.size());
+		writePadding(file, align4(data.size()) - data.size());
+	}
+	if (cb)
+		cb(100, "GLB file saved");
+}
+
+namespace internal {
+
+/**
+ * @brief Reorders the triangles for the post-transform vertex cache, with the
+ * Tipsify algorithm (Sander, Nehab, Barczak, "Fast Triangle Reordering for
+ * Vertex Locality and Reduced Overdraw", 2007): triangles are emitted fanning
+ * around a vertex, and the next fanning vertex is chosen among the ones of
+ * the last triangles that are still in the cache.
+ *
+ * @param indices: the indices of the triangles, all lower than nVertices
+ */
+void tipsify(
+		std::vector<unsigned int>& indices,
+		unsigned int nVertices,
+		unsigned int cacheSize)
+{
+	const unsigned int nTriangles = indices.size() / 3;
+
+	// triangles adjacent to each vertex
+	std::vector<unsigned int> adjBegin(nVertices + 1, 0);
+	for (unsigned int i : indices)
+		++adjBegin[i + 1];
+	for (unsigned int v = 0; v < nVertices; ++v)
+		adjBegin[v + 1] += adjBegin[v];
+	std::vector<unsigned int> adj(indices.size());
+	{
+		std::vector<unsigned int> fill(adjBegin.begin(), adjBegin.end() - 1);
+		for (unsigned int i = 0; i < indices.size(); ++i)
+			adj[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<unsigned int> live(nVertices);
+	for (unsigned int v = 0; v < nVertices; ++v)
+		live[v] = adjBegin[v + 1] - adjBegin[v];
+	std::vector<unsigned int> cacheTime(nVertices, 0);
+	std::vector<bool> emitted(nTriangles, false);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	unsigned int time = cacheSize + 1;
+	unsigned int cursor = 0;
+
+	auto skipDeadEnd = [&]() -> int {
+		while (!deadEnd.empty()) {
+			unsigned int d = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[d] > 0)
+				return d;
+		}
+		while (cursor < nVertices) {
+			if (live[cursor] > 0)
+				return cursor;
+			++cursor;
+		}
+		return -1;
+	};
+
+	int fanning = skipDeadEnd();
+	while (fanning >= 0) {
+		candidates.clear();
+		for (unsigned int a = adjBegin[fanning]; a < adjBegin[fanning + 1]; ++a) {
+			const unsigned int t = adj[a];
+			if (emitted[t])
+				continue;
+			emitted[t] = true;
+			for (int j = 0; j < 3; ++j) {
+				const unsigned int v = indices[3 * t + j];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--live[v];
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+		}
+
+		// the candidate that will be in the cache after fanning around it,
+		// and entered the cache earliest
+		int next = -1;
+		int best = -1;
+		for (unsigned int v : candidates) {
+			if (live[v] == 0)
+				continue;
+			int priority = 0;
+			if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = time - cacheTime[v];
+			if (priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+		fanning = next >= 0 ? next : skipDeadEnd();
+	}
+	indices.swap(output);
+}
+
+/**
+ * @brief Renumbers the vertices in order of first use by the primitives, so
+ * that the vertices are fetched almost sequentially. Vertices not used by
+ * any primitive are kept at the end.
+ */
+void optimizeVertexFetch(
+		std::vector<OutputVertex>& vertices,
+		std::vector<std::vector<unsigned int>>& primitiveIndices)
+{
+	std::vector<unsigned int> remap(vertices.size(), UINT_MAX);
+	std::vector<OutputVertex> sorted;
+	sorted.reserve(vertices.size());
+	for (std::vector<unsigned int>& indices : primitiveIndices) {
+		for (unsigned int& i : indices) {
+			if (remap[i] == UINT_MAX) {
+				remap[i] = sorted.size();
+				sorted.push_back(vertices[i]);
+			}
+			i = remap[i];
+		}
+	}
+	for (unsigned int v = 0; v < vertices.size(); ++v)
+		if (remap[v] == UINT_MAX)
+			sorted.push_back(vertices[v]);
+	vertices.swap(sorted);
+}
+
+}
+
+}
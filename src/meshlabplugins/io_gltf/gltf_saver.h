@@ -0,0 +1,66 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#ifndef GLTF_SAVER_H
+#define GLTF_SAVER_H
+
+#include <common/ml_document/mesh_model.h>
+
+namespace gltf {
+
+void saveGLB(
+		const QString& fileName,
+		const MeshModel& m,
+		int mask,
+		bool quantize,
+		bool optimizeIndexOrder,
+		bool reuseTextureFiles,
+		vcg::CallBackPos* cb = nullptr);
+
+namespace internal {
+
+/**
+ * @brief A vertex of the glTF buffer: a vertex of the mesh, split along the
+ * seams of the wedge texture coordinates.
+ */
+struct OutputVertex
+{
+	unsigned int v;  // index of the vertex in m.cm.vert
+	vcg::Point2f uv; // texture coordinate, with the glTF (top-left) origin
+};
+
+void tipsify(
+		std::vector<unsigned int>& indices,
+		unsigned int nVertices,
+		unsigned int cacheSize);
+
+void optimizeVertexFetch(
+		std::vector<OutputVertex>& vertices,
+		std::vector<std::vector<unsigned int>>& primitiveIndices);
+
+}
+
+}
+
+#endif // GLTF_SAVER_H
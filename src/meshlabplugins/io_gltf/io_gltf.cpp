@@ -26,6 +26,7 @@
 #include "io_gltf.h"
 
 #include "gltf_loader.h"
+#include "gltf_saver.h"
 
 QString IOglTFPlugin::pluginName() const
 {
@@ -45,7 +46,9 @@ std::list<FileFormat> IOglTFPlugin::importFormats() const
 */
 std::list<FileFormat> IOglTFPlugin::exportFormats() const
 {
-	return {};
+	return {
+		FileFormat("Binary GL Transmission Format 2.0", tr("GLB")),
+	};
 }
 
 /*
@@ -53,14 +56,46 @@ std::list<FileFormat> IOglTFPlugin::exportFormats() const
 	otherwise it returns 0 if the file format is unknown
 */
 void IOglTFPlugin::exportMaskCapability(
-		const QString&,
+		const QString& format,
 		int &capability,
 		int &defaultBits) const
 {
+	if (format.toUpper() == tr("GLB")){
+		capability = defaultBits =
+				vcg::tri::io::Mask::IOM_VERTNORMAL | vcg::tri::io::Mask::IOM_VERTCOLOR |
+				vcg::tri::io::Mask::IOM_VERTTEXCOORD | vcg::tri::io::Mask::IOM_WEDGTEXCOORD;
+		return;
+	}
 	capability=defaultBits=0;
 	return;
 }
 
+RichParameterList IOglTFPlugin::initSaveParameter(
+		const QString& format,
+		const MeshModel&) const
+{
+	RichParameterList parameters;
+	if (format.toUpper() == tr("GLB")){
+		parameters.addParam(RichBool(
+				"quantize", false, "Quantize attributes",
+				"If true, positions and texture coordinates are stored as 16 bit "
+				"integers and normals as 8 bit integers (KHR_mesh_quantization "
+				"extension). The file is about half the size, but viewers must "
+				"support the extension."));
+		parameters.addParam(RichBool(
+				"optimize_index_order", true, "Optimize index order",
+				"If true, faces are reordered to make a better use of the vertex "
+				"cache of the GPU, and vertices are reordered in order of first use."));
+		parameters.addParam(RichBool(
+				"reuse_texture_files", false, "Reuse texture files",
+				"If true, PNG and JPEG texture files are embedded as they are, "
+				"instead of being encoded again from the loaded images, when they "
+				"have the same size of the loaded images. Enable it only if the "
+				"textures have not been modified since they were loaded."));
+	}
+	return parameters;
+}
+
 RichParameterList IOglTFPlugin::initPreOpenParameter(
 		const QString& format) const
 {
@@ -150,13 +185,23 @@ void IOglTFPlugin::open(
 
 void IOglTFPlugin::save(
 		const QString& fileFormat,
-		const QString&,
-		MeshModel&,
-		const int ,
-		const RichParameterList&,
-		vcg::CallBackPos*)
+		const QString& fileName,
+		MeshModel& m,
+		const int mask,
+		const RichParameterList& params,
+		vcg::CallBackPos* cb)
 {
-	wrongSaveFormat(fileFormat);
+	if (fileFormat.toUpper() == tr("GLB")){
+		gltf::saveGLB(
+				fileName, m, mask,
+				params.getBool("quantize"),
+				params.getBool("optimize_index_order"),
+				params.getBool("reuse_texture_files"),
+				cb);
+	}
+	else {
+		wrongSaveFormat(fileFormat);
+	}
 }
 
 MESHLAB_PLUGIN_NAME_EXPORTER(IOglTFPlugin)
@@ -44,6 +44,10 @@ public:
 			int& capability,
 			int& defaultBits) const;
 
+	RichParameterList initSaveParameter(
+			const QString& format,
+			const MeshModel& m) const;
+
 	RichParameterList initPreOpenParameter(
 			const QString& format) const;
 
@@ -21,6 +21,16 @@
 *                                                                           *
 ****************************************************************************/
 #include <Qt>
+#include <QByteArray>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <common/utilities/parallel.h>
 
 #include "io_txt.h"
 
@@ -28,7 +38,7 @@
 
 using namespace vcg;
 
-bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError);
+bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError, bool recenter, CallBackPos *cb);
 
 RichParameterList TxtIOPlugin::initPreOpenParameter(const QString &format) const
 {
@@ -57,11 +67,12 @@ RichParameterList TxtIOPlugin::initPreOpenParameter(const QString &format) const
             parlst.addParam(RichEnum("separator", 0, separator,"Separator","The separator between individual values in the point(s) description."));
             parlst.addParam(RichEnum("rgbmode", 0, rgbmode,"Color format","Colors may be specified in the [0-255] or [0.0-1.0] interval."));
             parlst.addParam(RichEnum("onerror", 0, onerror, "On Parsing Error", "When a line is not properly parsed, it is possible to 'skip' it and continue with the following lines, or 'stop' importing at that point"));
+            parlst.addParam(RichBool("recenter", false, "Recenter coordinates", "If true, the rounded coordinates of the first point are subtracted from all the points and stored in the transformation matrix of the layer. The coordinates are read in double precision, so large (e.g. georeferenced) coordinates keep their precision"));
     }
     return parlst;
 }
 
-void TxtIOPlugin::open(const QString &formatName, const QString &fileName, MeshModel &m, int& mask, const RichParameterList &parlst, CallBackPos * /*cb*/)
+void TxtIOPlugin::open(const QString &formatName, const QString &fileName, MeshModel &m, int& mask, const RichParameterList &parlst, CallBackPos *cb)
 {
 	if(formatName.toUpper() == tr("TXT")) {
 		int rowToSkip = parlst.getInt("rowToSkip");
@@ -69,6 +80,7 @@ void TxtIOPlugin::open(const QString &formatName, const QString &fileName, MeshM
 		int dataFormat = parlst.getEnum("strformat");
 		int rgbMode = parlst.getEnum("rgbmode");
 		int onError = parlst.getEnum("onerror");
+		bool recenter = parlst.getBool("recenter");
 
 		if(!(dataFormat==0) && !(dataFormat==6) && !(dataFormat==10))
 			mask |= vcg::tri::io::Mask::IOM_VERTQUALITY;
@@ -79,7 +91,7 @@ void TxtIOPlugin::open(const QString &formatName, const QString &fileName, MeshM
 
 		m.enable(mask);
 
-		if (!parseTXT(fileName, m.cm, rowToSkip, dataSeparator, dataFormat, rgbMode, onError))
+		if (!parseTXT(fileName, m.cm, rowToSkip, dataSeparator, dataFormat, rgbMode, onError, recenter, cb))
 			throw MLException("Error while opening TXT file.");
 	}
 	else {
@@ -124,496 +136,357 @@ void TxtIOPlugin::exportMaskCapability(const QString & /*format*/, int &capabili
 }
  
 
-bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError)
+namespace {
+
+// roles of the values of a point
+enum TxtValue { TXT_X, TXT_Y, TXT_Z, TXT_Q, TXT_R, TXT_G, TXT_B, TXT_NX, TXT_NY, TXT_NZ, TXT_VALUE_NUMBER };
+
+// the values of a line for each point format, in the order of the "strformat" parameter
+const std::vector<std::vector<int>> txtFormats = {
+	{TXT_X, TXT_Y, TXT_Z},
+	{TXT_X, TXT_Y, TXT_Z, TXT_Q},
+	{TXT_X, TXT_Y, TXT_Z, TXT_Q, TXT_R, TXT_G, TXT_B},
+	{TXT_X, TXT_Y, TXT_Z, TXT_Q, TXT_NX, TXT_NY, TXT_NZ},
+	{TXT_X, TXT_Y, TXT_Z, TXT_Q, TXT_R, TXT_G, TXT_B, TXT_NX, TXT_NY, TXT_NZ},
+	{TXT_X, TXT_Y, TXT_Z, TXT_Q, TXT_NX, TXT_NY, TXT_NZ, TXT_R, TXT_G, TXT_B},
+	{TXT_X, TXT_Y, TXT_Z, TXT_R, TXT_G, TXT_B},
+	{TXT_X, TXT_Y, TXT_Z, TXT_R, TXT_G, TXT_B, TXT_Q},
+	{TXT_X, TXT_Y, TXT_Z, TXT_R, TXT_G, TXT_B, TXT_Q, TXT_NX, TXT_NY, TXT_NZ},
+	{TXT_X, TXT_Y, TXT_Z, TXT_R, TXT_G, TXT_B, TXT_NX, TXT_NY, TXT_NZ, TXT_Q},
+	{TXT_X, TXT_Y, TXT_Z, TXT_NX, TXT_NY, TXT_NZ},
+	{TXT_X, TXT_Y, TXT_Z, TXT_NX, TXT_NY, TXT_NZ, TXT_R, TXT_G, TXT_B, TXT_Q},
+	{TXT_X, TXT_Y, TXT_Z, TXT_NX, TXT_NY, TXT_NZ, TXT_Q, TXT_R, TXT_G, TXT_B}};
+
+// the data of each thread is at least this long
+const std::size_t MIN_CHUNK_BYTES = 1 << 20;
+
+/**
+ * A line-aligned part of the file, whose points are stored in the vertices
+ * [firstVertex, firstVertex + points).
+ */
+struct TxtChunk
 {
-    QFile impFile(filename);
-    int ii;
-
-    if(impFile.open(QIODevice::ReadOnly))
-    {
-        QString freshLine;
-        QStringList tokenizedLine;
-        QString separator;
-        float XX,YY,ZZ;
-        float NX,NY,NZ;
-        float RR,GG,BB;
-        float Qual;
-        bool parseOK[10];
-
-        //skipping first rowToSkip lines,because it's the header
-        for(ii=0; ii<rowToSkip; ii++)
-        {
-            if(!impFile.atEnd())
-                freshLine = QString(impFile.readLine()).simplified();
-            else
-            {
-                impFile.close();
-                return false;
-            }
-        }
-
-        switch(dataSeparator)
-        {
-            case 0: separator = ";"; break;
-            case 1: separator = ","; break;
-            case 2: separator = " "; break;
-        }
-
-        //now, the data
-        while(!impFile.atEnd())
-        {
-            // reading and tokenizing
-            freshLine = QString(impFile.readLine()).simplified();
-            tokenizedLine = freshLine.split(separator, Qt::SkipEmptyParts);
-
-            switch(dataFormat)
-            {
-                case 0: // X Y Z
-                    {
-                        // number of token mismatch
-						if (tokenizedLine.size()<3)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							if (parseOK[0] && parseOK[1] && parseOK[2])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 1: // X Y Z Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<4)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 2: // X Y Z Reflectance R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<7)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							RR = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							GG = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							BB = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5] && parseOK[6])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 3: // X Y Z Reflectance Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<7)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NX = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NY = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							NZ = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5] && parseOK[6])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 4: // X Y Z Reflectance R G B Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							RR = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							GG = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							BB = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							NX = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							NY = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							NZ = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 5: // X Y Z Reflectance Nx Ny Nz R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							Qual = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NX = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NY = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							NZ = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							RR = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							GG = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							BB = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 6: // X Y Z R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<6)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 7: // X Y Z R G B Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<7)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							Qual = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5] && parseOK[6])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 8: // X Y Z R G B Reflectance Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							Qual = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							NX = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							NY = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							NZ = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 9: // X Y Z R G B Nx Ny Nz Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							RR = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							GG = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							BB = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							NX = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							NY = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							NZ = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							Qual = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 10: // X Y Z Nx Ny Nz
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<6)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							NX = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NY = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NZ = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4] && parseOK[5])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 11: // X Y Z Nx Ny Nz R G B Reflectance
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							NX = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NY = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NZ = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							RR = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							GG = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							BB = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							Qual = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-                case 12: // X Y Z Nx Ny Nz Reflectance R G B
-                    {
-                        // number of token mismatch
-                        if(tokenizedLine.size()<10)
-						{
-							if (onError == 1){ impFile.close(); return true; }
-						}
-						else
-						{
-							XX = tokenizedLine.at(0).toFloat(&(parseOK[0]));
-							YY = tokenizedLine.at(1).toFloat(&(parseOK[1]));
-							ZZ = tokenizedLine.at(2).toFloat(&(parseOK[2]));
-							NX = tokenizedLine.at(3).toFloat(&(parseOK[3]));
-							NY = tokenizedLine.at(4).toFloat(&(parseOK[4]));
-							NZ = tokenizedLine.at(5).toFloat(&(parseOK[5]));
-							Qual = tokenizedLine.at(6).toFloat(&(parseOK[6]));
-							RR = tokenizedLine.at(7).toFloat(&(parseOK[7]));
-							GG = tokenizedLine.at(8).toFloat(&(parseOK[8]));
-							BB = tokenizedLine.at(9).toFloat(&(parseOK[9]));
-
-							if (rgbMode == 1) //[0.0-1.0]
-							{
-								RR *= 255; GG *= 255; BB *= 255;
-							}
-							if (parseOK[0] && parseOK[1] && parseOK[2] && parseOK[3] && parseOK[4]
-								&& parseOK[5] && parseOK[6] && parseOK[7] && parseOK[8] && parseOK[9])    // no parsing error
-							{
-								CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(m, 1);
-								(*vi).P().Import(Point3f(XX, YY, ZZ));
-								(*vi).Q() = Qual;
-								(*vi).C() = Color4b(RR, GG, BB, 255);
-								(*vi).N().Import(Point3f(NX, NY, NZ));
-							}
-							else
-								if (onError == 1){ impFile.close(); return true; }
-						}
-                    }
-                    break;
-
-            }
-
-
-        }
-
-        impFile.close();
-        return true;
-    }
-    else
-        return false;
+	const char* begin       = nullptr;
+	const char* end         = nullptr;
+	std::size_t lines       = 0;
+	std::size_t firstVertex = 0;
+	std::size_t points      = 0;
+	bool        stopped     = false; // a line was not parsed and the import must stop there
+};
+
+inline bool isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
 
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/**
+ * Parses the number in [begin, end), independently of the current locale.
+ * Numbers with at most 15 significant digits and a small exponent are
+ * computed exactly with a single multiplication or division; the others
+ * (and inf, nan...) are converted by QByteArray::toDouble, that uses the C
+ * locale like QString::toFloat.
+ */
+bool parseNumber(const char* begin, const char* end, double& value)
+{
+	static const double powers[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	const char*   p         = begin;
+	bool          negative  = false;
+	std::uint64_t mantissa  = 0;
+	int           digits    = 0; // significant digits in the mantissa
+	int           exponent  = 0;
+	bool          anyDigit  = false;
+	bool          truncated = false;
+
+	if (p < end && (*p == '+' || *p == '-'))
+		negative = *p++ == '-';
+	for (; p < end && isDigit(*p); ++p) {
+		anyDigit = true;
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else {
+			truncated = true;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (++p; p < end && isDigit(*p); ++p) {
+			anyDigit = true;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				--exponent;
+			}
+			else {
+				truncated = true;
+			}
+		}
+	}
+	if (anyDigit && p < end && (*p == 'e' || *p == 'E')) {
+		++p;
+		bool negativeExp = false;
+		if (p < end && (*p == '+' || *p == '-'))
+			negativeExp = *p++ == '-';
+		if (p == end || !isDigit(*p))
+			anyDigit = false;
+		int e = 0;
+		for (; p < end && isDigit(*p); ++p)
+			e = std::min(e * 10 + (*p - '0'), 100000);
+		exponent += negativeExp ? -e : e;
+	}
+
+	if (anyDigit && p == end && !truncated && digits <= 15 && exponent >= -22 && exponent <= 22) {
+		double v = double(mantissa);
+		v        = exponent < 0 ? v / powers[-exponent] : v * powers[exponent];
+		value    = negative ? -v : v;
+		return true;
+	}
+
+	bool ok;
+	value = QByteArray(begin, int(end - begin)).toDouble(&ok);
+	return ok;
+}
+
+/**
+ * Parses the first n values of the line [begin, end), like QString::split
+ * with Qt::SkipEmptyParts on the simplified line: with the SPACE separator the
+ * values are separated by any sequence of blanks.
+ * Returns false if there are less than n values or one of them is not a
+ * number.
+ */
+bool parseLine(const char* begin, const char* end, char separator, int n, double* values)
+{
+	const char* p = begin;
+	for (int i = 0; i < n; ++i) {
+		const char* tokenBegin;
+		const char* tokenEnd;
+		if (separator == ' ') {
+			while (p < end && isBlank(*p))
+				++p;
+			if (p == end)
+				return false;
+			tokenBegin = p;
+			while (p < end && !isBlank(*p))
+				++p;
+			tokenEnd = p;
+		}
+		else {
+			do {
+				if (p >= end)
+					return false;
+				tokenBegin = p;
+				while (p < end && *p != separator)
+					++p;
+				tokenEnd = p;
+				if (p < end)
+					++p;
+				while (tokenBegin < tokenEnd && isBlank(*tokenBegin))
+					++tokenBegin;
+				while (tokenEnd > tokenBegin && isBlank(tokenEnd[-1]))
+					--tokenEnd;
+			} while (tokenBegin == tokenEnd);
+		}
+		if (!parseNumber(tokenBegin, tokenEnd, values[i]))
+			return false;
+	}
+	return true;
+}
+
+inline unsigned char toColorComponent(double c)
+{
+	return (unsigned char) std::min(std::max(c, 0.0), 255.0);
+}
+
+} // namespace
+
+/**
+ * Loads the points of the file, that is memory mapped (or read at once if it
+ * cannot be mapped) and split in line-aligned chunks parsed concurrently.
+ * The lines are counted first, to allocate all the vertices at once.
+ * Coordinates are parsed in double precision; if recenter is true, the
+ * rounded coordinates of the first point are subtracted from all the points
+ * and stored in the transformation matrix of the mesh.
+ */
+bool parseTXT(QString filename, CMeshO &m, int rowToSkip, int dataSeparator, int dataFormat, int rgbMode, int onError, bool recenter, CallBackPos *cb)
+{
+	if (dataFormat < 0 || dataFormat >= (int) txtFormats.size())
+		return false;
+
+	QFile impFile(filename);
+	if (!impFile.open(QIODevice::ReadOnly))
+		return false;
+
+	QByteArray  content;
+	const char* data = nullptr;
+	std::size_t size = std::size_t(impFile.size());
+	if (size > 0)
+		data = reinterpret_cast<const char*>(impFile.map(0, impFile.size()));
+	if (data == nullptr) {
+		content = impFile.readAll();
+		data    = content.constData();
+		size    = std::size_t(content.size());
+	}
+	const char* const dataEnd = data + size;
+
+	// skipping first rowToSkip lines, because it's the header
+	const char* dataBegin = data;
+	for (int i = 0; i < rowToSkip; i++) {
+		if (dataBegin == dataEnd)
+			return false;
+		const char* newLine = static_cast<const char*>(std::memchr(dataBegin, '\n', dataEnd - dataBegin));
+		dataBegin = newLine ? newLine + 1 : dataEnd;
+	}
+
+	char separator = ' ';
+	switch (dataSeparator) {
+	case 0: separator = ';'; break;
+	case 1: separator = ','; break;
+	case 2: separator = ' '; break;
+	}
+
+	const std::vector<int>& format = txtFormats[dataFormat];
+	const int valueNumber = int(format.size());
+	int valueIndex[TXT_VALUE_NUMBER];
+	std::fill(valueIndex, valueIndex + TXT_VALUE_NUMBER, -1);
+	for (int i = 0; i < valueNumber; i++)
+		valueIndex[format[i]] = i;
+	const bool hasQuality = valueIndex[TXT_Q] >= 0;
+	const bool hasColor   = valueIndex[TXT_R] >= 0;
+	const bool hasNormal  = valueIndex[TXT_NX] >= 0;
+	const double colorScale = rgbMode == 1 ? 255.0 : 1.0; // [0.0-1.0]
+
+	// line-aligned chunks
+	const std::size_t dataSize = std::size_t(dataEnd - dataBegin);
+	const std::size_t nThreads = meshlab::threadCount();
+	const std::size_t nChunks  = std::max<std::size_t>(1, std::min(8 * nThreads, dataSize / MIN_CHUNK_BYTES));
+	std::vector<TxtChunk> chunks(nChunks);
+	const char* chunkBegin = dataBegin;
+	for (std::size_t c = 0; c < nChunks; c++) {
+		const char* chunkEnd = dataEnd;
+		if (c + 1 < nChunks) {
+			chunkEnd = std::max(chunkBegin, dataBegin + dataSize * (c + 1) / nChunks);
+			const char* newLine = static_cast<const char*>(std::memchr(chunkEnd, '\n', dataEnd - chunkEnd));
+			chunkEnd = newLine ? newLine + 1 : dataEnd;
+		}
+		chunks[c].begin = chunkBegin;
+		chunks[c].end   = chunkEnd;
+		chunkBegin      = chunkEnd;
+	}
+
+	meshlab::parallelFor(
+		nChunks,
+		[&](std::size_t c, unsigned int) {
+			TxtChunk& chunk = chunks[c];
+			chunk.lines = std::count(chunk.begin, chunk.end, '\n');
+			if (chunk.end > chunk.begin && chunk.end[-1] != '\n')
+				chunk.lines++;
+		},
+		cb, 0, 10, "Counting points");
+
+	std::size_t lineNumber = 0;
+	for (TxtChunk& chunk : chunks) {
+		chunk.firstVertex = lineNumber;
+		lineNumber += chunk.lines;
+	}
+	if (lineNumber == 0)
+		return true;
+
+	// the origin of the recentered coordinates: the first point of the file
+	double offset[3] = {0, 0, 0};
+	if (recenter) {
+		double values[TXT_VALUE_NUMBER];
+		for (const char* line = dataBegin; line < dataEnd;) {
+			const char* newLine = static_cast<const char*>(std::memchr(line, '\n', dataEnd - line));
+			const char* lineEnd = newLine ? newLine : dataEnd;
+			if (parseLine(line, lineEnd, separator, valueNumber, values)) {
+				for (int i = 0; i < 3; i++)
+					offset[i] = std::round(values[valueIndex[TXT_X + i]]);
+				break;
+			}
+			line = lineEnd + 1;
+		}
+	}
+
+	const std::size_t firstVertex = m.vert.size();
+	tri::Allocator<CMeshO>::AddVertices(m, lineNumber);
+
+	meshlab::parallelFor(
+		nChunks,
+		[&](std::size_t c, unsigned int) {
+			TxtChunk& chunk = chunks[c];
+			double values[TXT_VALUE_NUMBER];
+			for (const char* line = chunk.begin; line < chunk.end;) {
+				const char* newLine = static_cast<const char*>(std::memchr(line, '\n', chunk.end - line));
+				const char* lineEnd = newLine ? newLine : chunk.end;
+				if (parseLine(line, lineEnd, separator, valueNumber, values)) {
+					CVertexO& v = m.vert[firstVertex + chunk.firstVertex + chunk.points++];
+					v.P() = Point3m(
+						Scalarm(values[valueIndex[TXT_X]] - offset[0]),
+						Scalarm(values[valueIndex[TXT_Y]] - offset[1]),
+						Scalarm(values[valueIndex[TXT_Z]] - offset[2]));
+					if (hasQuality)
+						v.Q() = Scalarm(values[valueIndex[TXT_Q]]);
+					if (hasColor)
+						v.C() = Color4b(
+							toColorComponent(values[valueIndex[TXT_R]] * colorScale),
+							toColorComponent(values[valueIndex[TXT_G]] * colorScale),
+							toColorComponent(values[valueIndex[TXT_B]] * colorScale),
+							255);
+					if (hasNormal)
+						v.N() = Point3m(
+							Scalarm(values[valueIndex[TXT_NX]]),
+							Scalarm(values[valueIndex[TXT_NY]]),
+							Scalarm(values[valueIndex[TXT_NZ]]));
+				}
+				else if (onError == 1) { // stop
+					chunk.stopped = true;
+					break;
+				}
+				line = lineEnd + 1;
+			}
+		},
+		cb, 10, 95, "Parsing points");
+
+	// the points of the chunks are moved next to each other, up to the first
+	// line that stopped the import; the unused vertices are removed (there
+	// are no faces referring to them)
+	std::size_t pointNumber = 0;
+	for (const TxtChunk& chunk : chunks) {
+		const std::size_t from = firstVertex + chunk.firstVertex;
+		const std::size_t to   = firstVertex + pointNumber;
+		for (std::size_t i = 0; i < chunk.points && from != to; i++) {
+			m.vert[to + i].P() = m.vert[from + i].P();
+			if (hasQuality)
+				m.vert[to + i].Q() = m.vert[from + i].Q();
+			if (hasColor)
+				m.vert[to + i].C() = m.vert[from + i].C();
+			if (hasNormal)
+				m.vert[to + i].N() = m.vert[from + i].N();
+		}
+		pointNumber += chunk.points;
+		if (chunk.stopped)
+			break;
+	}
+	if (firstVertex + pointNumber < m.vert.size()) {
+		for (std::size_t i = firstVertex + pointNumber; i < m.vert.size(); i++)
+			tri::Allocator<CMeshO>::DeleteVertex(m, m.vert[i]);
+		tri::Allocator<CMeshO>::CompactVertexVector(m);
+	}
+
+	if (recenter)
+		m.Tr.SetTranslate(Scalarm(offset[0]), Scalarm(offset[1]), Scalarm(offset[2]));
+
+	impFile.close();
+	return true;
 }
 
 
- 
- 
 MESHLAB_PLUGIN_NAME_EXPORTER(TxtIOPlugin)